@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Write the device configuration blobs of test_devcfg.c with tools/devcfg_compile.py.
+
+    devcfg_vectors.py OUTDIR
+
+site.bin is a small installation whose contents the test checks; badpin.bin
+sets a pin the ESP32 does not have and inpin.bin puts the buzzer on an
+input-only one; sats_N.bin list N named satellites over
+every zone, for the boot-load benchmark.
+"""
+import os
+import random
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+import devcfg_compile  # noqa: E402
+
+PARTITION_SIZE = 0x8000
+BENCH_SATS = (0, 100, 1000)
+
+SITE = {
+    'pins': {'led': 5, 'ir_sensor': 18, 'buzzer': 19},
+    'names': {'light': 'Hall Light', 'alarm': 'House Alarm', 'door': 'Front Door'},
+    'rules': 'on door_open if after 22:00 and disarmed then light_on 120',
+    'zones': ['Unassigned', 'Front', 'Garage'],
+    'satellites': [
+        {'id': '24:0a:c4:12:34:56', 'zone': 1, 'name': 'Porch Window'},
+        {'id': '24:0a:c4:00:00:01', 'zone': 2, 'name': 'Garage Door'},
+        {'id': '24:0a:c4:ff:00:02'},
+    ],
+}
+
+
+def bench(rng, count):
+    ids = rng.sample(range(1 << 24), count)
+    return {
+        'zones': ['Zone %d' % z for z in range(devcfg_compile.MAX_ZONE + 1)],
+        'satellites': [{'id': '24:0a:c4:%02x:%02x:%02x' % (i >> 16, (i >> 8) & 0xff, i & 0xff),
+                        'zone': 1 + n % devcfg_compile.MAX_ZONE, 'name': 'Window %d' % n}
+                       for n, i in enumerate(ids)],
+    }
+
+
+def main():
+    out = sys.argv[1]
+    rng = random.Random(100)
+    configs = {
+        'site.bin': SITE,
+        'badpin.bin': {'pins': {'led': 45, 'ir_sensor': 18}},
+        'inpin.bin': {'pins': {'led': 5, 'ir_sensor': 35, 'buzzer': 34}},
+    }
+    for count in BENCH_SATS:
+        configs['sats_%d.bin' % count] = bench(rng, count)
+    os.makedirs(out, exist_ok=True)
+    for name, cfg in configs.items():
+        blob = devcfg_compile.compile_config(cfg)
+        if len(blob) > PARTITION_SIZE:
+            raise SystemExit('%s: %d bytes, partition is %d' % (name, len(blob), PARTITION_SIZE))
+        with open(os.path.join(out, name), 'wb') as f:
+            f.write(blob)
+
+
+if __name__ == '__main__':
+    main()
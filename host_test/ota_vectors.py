@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Write the OTA decoder test vectors (test_ota_decode.c) with tools/ota_delta.py.
+
+    ota_vectors.py OUTDIR
+
+old.bin and new.bin are synthetic app images: new.bin is old.bin with code
+patched, inserted, removed and moved, the kind of change a rebuild makes.
+"""
+import os
+import random
+import sys
+import zlib
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+import ota_delta  # noqa: E402
+
+
+def image(rng, size):
+    # Compressible, word-structured bytes behind the 0xE9 app image magic
+    words = [rng.getrandbits(32).to_bytes(4, 'little') for _ in range(512)]
+    body = b''.join(rng.choice(words) for _ in range(size // 4))
+    return b'\xe9' + body[1:]
+
+
+def main():
+    out = sys.argv[1]
+    rng = random.Random(82)
+    old = image(rng, 256 * 1024)
+    new = bytearray(old)
+    new[1000:1004] = b'\x01\x02\x03\x04'                        # patched constant
+    new[40000:40000] = image(rng, 3000)[1:]                     # inserted function
+    del new[90000:92000]                                        # removed function
+    new[150000:150000] = bytes(new[10000:14000])                # moved/duplicated code
+    new[-64:] = bytes(rng.getrandbits(8) for _ in range(64))    # new app descriptor/hash
+    new = bytes(new)
+    other = bytes([old[0]]) + bytes(b ^ 0x5a for b in old[1:])
+
+    def gen(src, dst, compress):
+        patch = ota_delta.encode(src, dst, ota_delta.gen_ops(src, dst))
+        if compress:
+            c = zlib.compressobj(9, zlib.DEFLATED, 15)
+            patch = c.compress(patch) + c.flush()
+        return patch
+
+    files = {
+        'old.bin': old,
+        'new.bin': new,
+        'new.delta': gen(old, new, True),
+        'new.raw.delta': gen(old, new, False),
+        'new.zlib': zlib.compress(new, 9),
+        'other.delta': gen(other, new, True),
+    }
+    os.makedirs(out, exist_ok=True)
+    for name, data in files.items():
+        with open(os.path.join(out, name), 'wb') as f:
+            f.write(data)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,11 @@
+#pragma once
+#include <esp_err.h>
+
+typedef enum {
+    POP_TYPE_NONE,
+    POP_TYPE_MAC,
+    POP_TYPE_RANDOM,
+} app_network_pop_type_t;
+
+/* Brings the station up at once: posts IP_EVENT_STA_GOT_IP (host_cloud.c) */
+esp_err_t app_network_start(app_network_pop_type_t pop_type);
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* The tinycbor encoder subset the modules use (host_cbor.c). Same wire
+ * format: shortest heads, definite lengths unless CborIndefiniteLength. */
+typedef enum {
+    CborNoError = 0,
+    CborErrorOutOfMemory = (int)(~0U / 2 + 1),
+} CborError;
+
+typedef struct CborEncoder {
+    uint8_t *ptr;
+    const uint8_t *end;
+    size_t extra;           // bytes that did not fit
+    bool indefinite;        // container closed with a break byte
+} CborEncoder;
+
+#define CborIndefiniteLength    SIZE_MAX
+
+void cbor_encoder_init(CborEncoder *encoder, uint8_t *buffer, size_t size, int flags);
+CborError cbor_encode_uint(CborEncoder *encoder, uint64_t value);
+CborError cbor_encode_int(CborEncoder *encoder, int64_t value);
+CborError cbor_encode_boolean(CborEncoder *encoder, bool value);
+CborError cbor_encode_text_string(CborEncoder *encoder, const char *string, size_t length);
+CborError cbor_encode_text_stringz(CborEncoder *encoder, const char *string);
+CborError cbor_encode_byte_string(CborEncoder *encoder, const uint8_t *string, size_t length);
+CborError cbor_encoder_create_array(CborEncoder *parent, CborEncoder *array, size_t length);
+CborError cbor_encoder_create_map(CborEncoder *parent, CborEncoder *map, size_t length);
+CborError cbor_encoder_close_container(CborEncoder *parent, const CborEncoder *container);
+size_t cbor_encoder_get_buffer_size(const CborEncoder *encoder, const uint8_t *buffer);
+size_t cbor_encoder_get_extra_bytes_needed(const CborEncoder *encoder);
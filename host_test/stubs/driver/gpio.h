@@ -0,0 +1,11 @@
+#pragma once
+#include <esp_err.h>
+
+/* Pin numbers only, as on the ESP32 (40 pads) */
+typedef int gpio_num_t;
+
+#define GPIO_NUM_NC             -1
+#define SOC_GPIO_PIN_COUNT      40
+#define GPIO_IS_VALID_GPIO(n)   ((n) >= 0 && (n) < SOC_GPIO_PIN_COUNT)
+/* GPIO 34-39 are input-only */
+#define GPIO_IS_VALID_OUTPUT_GPIO(n)    (GPIO_IS_VALID_GPIO(n) && (n) < 34)
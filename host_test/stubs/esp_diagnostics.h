@@ -0,0 +1,5 @@
+#pragma once
+#include <esp_err.h>
+#include <esp_log.h>
+
+#define ESP_DIAG_EVENT(tag, ...) host_log("DIAG", tag, __VA_ARGS__)
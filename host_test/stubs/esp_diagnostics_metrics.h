@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+
+typedef enum {
+    ESP_DIAG_DATA_TYPE_BOOL,
+    ESP_DIAG_DATA_TYPE_INT,
+    ESP_DIAG_DATA_TYPE_UINT,
+} esp_diag_data_type_t;
+
+esp_err_t esp_diag_metrics_register(const char *tag, const char *key, const char *label, const char *path,
+                                    esp_diag_data_type_t type);
+esp_err_t esp_diag_metrics_add_int(const char *key, int32_t i);
+esp_err_t esp_diag_metrics_add_uint(const char *key, uint32_t u);
@@ -0,0 +1,5 @@
+#pragma once
+#include <esp_partition.h>
+
+/* The partition registered with host_partition_set_running() (host_stubs.h) */
+const esp_partition_t *esp_ota_get_running_partition(void);
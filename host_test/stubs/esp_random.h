@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* Pseudo-random, seeded with host_random_seed() (host_stubs.h) */
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
@@ -0,0 +1,10 @@
+#pragma once
+#include <esp_event.h>
+
+ESP_EVENT_DECLARE_BASE(RMAKER_COMMON_EVENT);
+
+typedef enum {
+    RMAKER_MQTT_EVENT_CONNECTED = 1,
+    RMAKER_MQTT_EVENT_DISCONNECTED,
+    RMAKER_MQTT_EVENT_PUBLISHED,
+} esp_rmaker_common_event_t;
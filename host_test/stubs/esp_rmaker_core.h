@@ -0,0 +1,77 @@
+#pragma once
+#include <esp_err.h>
+
+typedef struct esp_rmaker_node esp_rmaker_node_t;
+typedef struct esp_rmaker_device esp_rmaker_device_t;
+typedef struct esp_rmaker_param esp_rmaker_param_t;
+
+typedef enum {
+    RMAKER_VAL_TYPE_INVALID,
+    RMAKER_VAL_TYPE_BOOLEAN,
+    RMAKER_VAL_TYPE_INTEGER,
+    RMAKER_VAL_TYPE_FLOAT,
+    RMAKER_VAL_TYPE_STRING,
+} esp_rmaker_val_type_t;
+
+typedef union {
+    bool b;
+    int i;
+    float f;
+    char *s;
+} esp_rmaker_val_t;
+
+typedef struct {
+    esp_rmaker_val_type_t type;
+    esp_rmaker_val_t val;
+} esp_rmaker_param_val_t;
+
+typedef enum {
+    ESP_RMAKER_REQ_SRC_INIT,
+    ESP_RMAKER_REQ_SRC_CLOUD,
+    ESP_RMAKER_REQ_SRC_SCHEDULE,
+    ESP_RMAKER_REQ_SRC_LOCAL,
+} esp_rmaker_req_src_t;
+
+typedef struct {
+    esp_rmaker_req_src_t src;
+} esp_rmaker_write_ctx_t;
+
+typedef struct {
+    esp_rmaker_req_src_t src;
+} esp_rmaker_read_ctx_t;
+
+typedef esp_err_t (*esp_rmaker_device_write_cb_t)(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+                                                   const esp_rmaker_param_val_t val, void *priv_data,
+                                                   esp_rmaker_write_ctx_t *ctx);
+typedef esp_err_t (*esp_rmaker_device_read_cb_t)(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+                                                  void *priv_data, esp_rmaker_read_ctx_t *ctx);
+
+#define PROP_FLAG_WRITE     (1 << 0)
+#define PROP_FLAG_READ      (1 << 1)
+#define PROP_FLAG_PERSIST   (1 << 3)
+
+/* Starts the agent, which makes the first connect (host_cloud.c) */
+esp_err_t esp_rmaker_start(void);
+const char *esp_rmaker_get_node_id(void);
+
+esp_rmaker_device_t *esp_rmaker_device_create(const char *name, const char *type, void *priv);
+esp_rmaker_device_t *esp_rmaker_service_create(const char *name, const char *type, void *priv);
+esp_err_t esp_rmaker_device_add_cb(const esp_rmaker_device_t *device, esp_rmaker_device_write_cb_t write_cb,
+                                   esp_rmaker_device_read_cb_t read_cb);
+esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param);
+esp_err_t esp_rmaker_node_add_device(const esp_rmaker_node_t *node, const esp_rmaker_device_t *device);
+esp_err_t esp_rmaker_device_delete(const esp_rmaker_device_t *device);
+const char *esp_rmaker_device_get_name(const esp_rmaker_device_t *device);
+esp_rmaker_param_t *esp_rmaker_param_create(const char *name, const char *type, esp_rmaker_param_val_t val,
+                                            uint8_t flags);
+const char *esp_rmaker_param_get_name(const esp_rmaker_param_t *param);
+esp_rmaker_param_val_t *esp_rmaker_param_get_val(esp_rmaker_param_t *param);
+esp_err_t esp_rmaker_param_add_ui_type(const esp_rmaker_param_t *param, const char *ui_type);
+esp_err_t esp_rmaker_param_add_bounds(const esp_rmaker_param_t *param, esp_rmaker_param_val_t min,
+                                      esp_rmaker_param_val_t max, esp_rmaker_param_val_t step);
+esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val);
+esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val);
+esp_rmaker_param_val_t esp_rmaker_bool(bool val);
+esp_rmaker_param_val_t esp_rmaker_int(int val);
+esp_rmaker_param_val_t esp_rmaker_float(float val);
+esp_rmaker_param_val_t esp_rmaker_str(const char *val);
@@ -0,0 +1,9 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+/* The node's session to the broker stand-in of host_cloud.c */
+esp_err_t esp_rmaker_mqtt_connect(void);
+esp_err_t esp_rmaker_mqtt_disconnect(void);
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id);
@@ -0,0 +1,6 @@
+#pragma once
+#define ESP_RMAKER_DEVICE_OTHER "esp.device.other"
+#define ESP_RMAKER_UI_TOGGLE    "esp.ui.toggle"
+#define ESP_RMAKER_UI_TEXT      "esp.ui.text"
+#define ESP_RMAKER_UI_SLIDER    "esp.ui.slider"
+#define ESP_RMAKER_UI_HIDDEN    "esp.ui.hidden"
@@ -0,0 +1,5 @@
+#pragma once
+#include <esp_err.h>
+
+/* True once host_time_synced is set */
+bool esp_rmaker_time_check(void);
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+/* zlib's crc32(), which the ROM function matches */
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
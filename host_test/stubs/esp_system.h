@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+
+/* The host has no fixed heap: this stays constant, so heap deltas measured
+ * around an allocation read 0 */
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_event.h>
+
+/* Station events, posted by the app_network_start() stand-in (host_cloud.c) */
+ESP_EVENT_DECLARE_BASE(WIFI_EVENT);
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+#define WIFI_EVENT_STA_DISCONNECTED 5
+#define IP_EVENT_STA_GOT_IP         0
+
+typedef enum {
+    WIFI_IF_STA,
+} wifi_interface_t;
+
+typedef union {
+    struct {
+        uint8_t ssid[32];
+        uint8_t password[64];
+    } sta;
+} wifi_config_t;
+
+/* Always a provisioned station */
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf);
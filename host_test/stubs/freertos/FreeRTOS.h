@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdPASS              1
+#define pdFAIL              0
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffffUL
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+/* Tests are single threaded: critical sections only count their nesting,
+ * so a test can check that no lock is held where it must not be */
+typedef struct {
+    int depth;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+
+extern int host_locks_held;
+#define portENTER_CRITICAL(m)   do { (m)->depth++; host_locks_held++; } while (0)
+#define portEXIT_CRITICAL(m)    do { (m)->depth--; host_locks_held--; } while (0)
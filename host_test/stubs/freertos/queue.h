@@ -0,0 +1,10 @@
+#pragma once
+#include "FreeRTOS.h"
+
+/* Copying queues between tasks (host_lan.c); a task blocked on one gives up
+ * the host task lock */
+typedef struct host_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
@@ -0,0 +1,23 @@
+#pragma once
+#include "FreeRTOS.h"
+
+/* Tasks are host threads (host_lan.c). Only one of them runs at a time: each
+ * holds the host task lock and gives it up while blocked in recv() or
+ * vTaskDelay(), as a task gives up the CPU. */
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                       TaskHandle_t *out);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+
+typedef enum {
+    eSetBits,
+} eNotifyAction;
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
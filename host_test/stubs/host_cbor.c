@@ -0,0 +1,134 @@
+/* CBOR encoder (RFC 8949) behind the tinycbor API, see cbor.h
+ *
+ * Like tinycbor, an encoder that runs out of buffer keeps counting the bytes
+ * it could not write and every call from then on returns
+ * CborErrorOutOfMemory.
+ */
+
+#include <string.h>
+#include "cbor.h"
+
+#define MAJOR_UINT      0
+#define MAJOR_NINT      1
+#define MAJOR_BYTES     2
+#define MAJOR_TEXT      3
+#define MAJOR_ARRAY     4
+#define MAJOR_MAP       5
+#define SIMPLE_FALSE    0xf4
+#define SIMPLE_TRUE     0xf5
+#define BREAK           0xff
+
+static CborError put(CborEncoder *e, const void *data, size_t len)
+{
+    if (e->extra || (size_t)(e->end - e->ptr) < len) {
+        e->extra += len;
+        return CborErrorOutOfMemory;
+    }
+    memcpy(e->ptr, data, len);
+    e->ptr += len;
+    return CborNoError;
+}
+
+/* Major type and argument in the shortest head */
+static CborError put_head(CborEncoder *e, int major, uint64_t value)
+{
+    uint8_t head[9];
+    size_t n = 1;
+    if (value < 24) {
+        head[0] = major << 5 | value;
+    } else {
+        int bytes = value <= UINT8_MAX ? 1 : value <= UINT16_MAX ? 2 : value <= UINT32_MAX ? 4 : 8;
+        head[0] = major << 5 | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27);
+        for (int i = bytes - 1; i >= 0; i--) {
+            head[n++] = value >> (8 * i);
+        }
+    }
+    return put(e, head, n);
+}
+
+void cbor_encoder_init(CborEncoder *encoder, uint8_t *buffer, size_t size, int flags)
+{
+    encoder->ptr = buffer;
+    encoder->end = buffer + size;
+    encoder->extra = 0;
+    encoder->indefinite = false;
+}
+
+CborError cbor_encode_uint(CborEncoder *encoder, uint64_t value)
+{
+    return put_head(encoder, MAJOR_UINT, value);
+}
+
+CborError cbor_encode_int(CborEncoder *encoder, int64_t value)
+{
+    return value < 0 ? put_head(encoder, MAJOR_NINT, (uint64_t)(-1 - value)) : put_head(encoder, MAJOR_UINT, value);
+}
+
+CborError cbor_encode_boolean(CborEncoder *encoder, bool value)
+{
+    uint8_t b = value ? SIMPLE_TRUE : SIMPLE_FALSE;
+    return put(encoder, &b, 1);
+}
+
+CborError cbor_encode_text_string(CborEncoder *encoder, const char *string, size_t length)
+{
+    CborError err = put_head(encoder, MAJOR_TEXT, length);
+    return err | put(encoder, string, length);
+}
+
+CborError cbor_encode_text_stringz(CborEncoder *encoder, const char *string)
+{
+    return cbor_encode_text_string(encoder, string, strlen(string));
+}
+
+CborError cbor_encode_byte_string(CborEncoder *encoder, const uint8_t *string, size_t length)
+{
+    CborError err = put_head(encoder, MAJOR_BYTES, length);
+    return err | put(encoder, string, length);
+}
+
+static CborError create_container(CborEncoder *parent, CborEncoder *container, int major, size_t length)
+{
+    CborError err;
+    if (length == CborIndefiniteLength) {
+        uint8_t b = major << 5 | 31;
+        err = put(parent, &b, 1);
+    } else {
+        err = put_head(parent, major, length);
+    }
+    *container = *parent;
+    container->indefinite = length == CborIndefiniteLength;
+    return err;
+}
+
+CborError cbor_encoder_create_array(CborEncoder *parent, CborEncoder *array, size_t length)
+{
+    return create_container(parent, array, MAJOR_ARRAY, length);
+}
+
+CborError cbor_encoder_create_map(CborEncoder *parent, CborEncoder *map, size_t length)
+{
+    return create_container(parent, map, MAJOR_MAP, length);
+}
+
+CborError cbor_encoder_close_container(CborEncoder *parent, const CborEncoder *container)
+{
+    bool indefinite = parent->indefinite;
+    *parent = *container;
+    parent->indefinite = indefinite;
+    if (container->indefinite) {
+        uint8_t b = BREAK;
+        return put(parent, &b, 1);
+    }
+    return parent->extra ? CborErrorOutOfMemory : CborNoError;
+}
+
+size_t cbor_encoder_get_buffer_size(const CborEncoder *encoder, const uint8_t *buffer)
+{
+    return encoder->ptr - buffer;
+}
+
+size_t cbor_encoder_get_extra_bytes_needed(const CborEncoder *encoder)
+{
+    return encoder->extra;
+}
@@ -0,0 +1,250 @@
+/* Host stand-ins for the station and the RainMaker MQTT session.
+ *
+ * The broker answers through esp_timers, as the MQTT client answers from its
+ * own task: CONNECTED after HOST_CLOUD_CONNECT_MS, PUBLISHED after
+ * HOST_CLOUD_ACK_MS. Run the clock (host_clock_advance() or
+ * host_clock_realtime()) for the answers to arrive.
+ *
+ * With host_cloud_broker() the connects go to a broker in the test process
+ * instead, shared by all the node processes; its answers are read by a thread
+ * of this process and posted under the task lock. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp_wifi.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+#include <app_network.h>
+
+#include "host_stubs.h"
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+ESP_EVENT_DEFINE_BASE(RMAKER_COMMON_EVENT);
+
+host_cloud_stats_t host_cloud;
+
+static bool s_broker_up = true;
+static bool s_session;
+static esp_timer_handle_t s_connecting;     // CONNECTED on its way
+static int s_msg_id;
+static void (*s_on_publish)(const char *topic, const char *payload);
+static uint32_t s_random = 1;
+static int s_broker_sock = -1;               // shared broker, -1 = the local one
+static struct sockaddr_in s_broker_addr;
+static bool s_broker_waiting;               // connect sent, no answer yet
+
+/* ---------------- Station ---------------- */
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    memset(conf, 0, sizeof(*conf));
+    strcpy((char *)conf->sta.ssid, "home");
+    return ESP_OK;
+}
+
+esp_err_t app_network_start(app_network_pop_type_t pop_type)
+{
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, 0);
+    return ESP_OK;
+}
+
+void host_random_seed(uint32_t seed)
+{
+    s_random = seed ? seed : 1;
+}
+
+/* xorshift32 */
+uint32_t esp_random(void)
+{
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    return s_random;
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *p = buf;
+    for (size_t i = 0; i < len; i++) {
+        p[i] = esp_random();
+    }
+}
+
+/* ---------------- Broker ---------------- */
+
+void host_cloud_set_up(bool up)
+{
+    s_broker_up = up;
+    if (!up && s_session) {
+        s_session = false;
+        esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_DISCONNECTED, NULL, 0, 0);
+    }
+}
+
+bool host_cloud_session_up(void)
+{
+    return s_session;
+}
+
+void host_cloud_on_publish(void (*cb)(const char *topic, const char *payload))
+{
+    s_on_publish = cb;
+}
+
+static void connected_cb(void *arg)
+{
+    esp_timer_delete(s_connecting);
+    s_connecting = NULL;
+    if (!s_broker_up) {
+        return;
+    }
+    s_session = true;
+    host_cloud.sessions++;
+    esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_CONNECTED, NULL, 0, 0);
+}
+
+typedef struct {
+    esp_timer_handle_t timer;
+    int msg_id;
+} host_ack_t;
+
+static void ack_cb(void *arg)
+{
+    host_ack_t *ack = arg;
+    if (s_session) {
+        esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_PUBLISHED, &ack->msg_id, sizeof(ack->msg_id), 0);
+    }
+    esp_timer_delete(ack->timer);
+    free(ack);
+}
+
+static esp_timer_handle_t after_ms(int ms, esp_timer_cb_t cb, void *arg)
+{
+    esp_timer_create_args_t args = { .callback = cb, .arg = arg, .name = "cloud" };
+    esp_timer_handle_t timer;
+    esp_timer_create(&args, &timer);
+    esp_timer_start_once(timer, ms * 1000LL);
+    return timer;
+}
+
+/* ---------------- Shared broker ---------------- */
+
+static void broker_send(const char *msg)
+{
+    sendto(s_broker_sock, msg, strlen(msg), 0, (struct sockaddr *)&s_broker_addr, sizeof(s_broker_addr));
+}
+
+static void *broker_main(void *arg)
+{
+    char msg[8];
+    while (1) {
+        ssize_t n = recv(s_broker_sock, msg, sizeof(msg), 0);
+        if (n <= 0) {
+            continue;
+        }
+        host_task_lock();
+        if (msg[0] == 'A' && s_broker_waiting) {
+            s_broker_waiting = false;
+            s_session = true;
+            host_cloud.sessions++;
+            esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_CONNECTED, NULL, 0, 0);
+        } else if (msg[0] == 'A') {
+            broker_send("D");       // given up on meanwhile
+        } else if (msg[0] == 'R' && s_broker_waiting) {
+            s_broker_waiting = false;
+            esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_DISCONNECTED, NULL, 0, 0);
+        } else if (msg[0] == 'X' && s_session) {
+            s_session = false;
+            esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_DISCONNECTED, NULL, 0, 0);
+        }
+        host_task_unlock();
+    }
+    return NULL;
+}
+
+void host_cloud_broker(int port)
+{
+    s_broker_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    s_broker_addr = (struct sockaddr_in) {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    struct sockaddr_in any = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    bind(s_broker_sock, (struct sockaddr *)&any, sizeof(any));
+    pthread_t thread;
+    pthread_create(&thread, NULL, broker_main, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_rmaker_mqtt_connect(void)
+{
+    host_cloud.connects++;
+    if (s_broker_sock >= 0) {
+        if (!s_session && !s_broker_waiting) {
+            s_broker_waiting = true;
+            broker_send("C");
+        }
+        return ESP_OK;
+    }
+    if (!s_session && !s_connecting) {
+        s_connecting = after_ms(HOST_CLOUD_CONNECT_MS, connected_cb, NULL);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_mqtt_disconnect(void)
+{
+    s_broker_waiting = false;
+    if (s_session && s_broker_sock >= 0) {
+        broker_send("D");
+    }
+    if (s_connecting) {
+        esp_timer_delete(s_connecting);
+        s_connecting = NULL;
+    }
+    if (s_session) {
+        s_session = false;
+        esp_event_post(RMAKER_COMMON_EVENT, RMAKER_MQTT_EVENT_DISCONNECTED, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_mqtt_publish(const char *topic, void *data, size_t data_len, uint8_t qos, int *msg_id)
+{
+    if (!s_session) {
+        return ESP_FAIL;
+    }
+    host_cloud.publishes++;
+    *msg_id = ++s_msg_id;
+    if (s_on_publish) {
+        char *payload = strndup(data, data_len);
+        s_on_publish(topic, payload);
+        free(payload);
+    }
+    host_ack_t *ack = malloc(sizeof(*ack));
+    ack->msg_id = *msg_id;
+    ack->timer = after_ms(HOST_CLOUD_ACK_MS, ack_cb, ack);
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_start(void)
+{
+    host_cloud.starts++;
+    return esp_rmaker_mqtt_connect();
+}
+
+const char *esp_rmaker_get_node_id(void)
+{
+    return "host";
+}
@@ -0,0 +1,38 @@
+/* Stand-in for app_home_key.c, which needs mbedtls HMAC and the RainMaker
+ * param: the tag is SHA-256(key | a | b) truncated, enough to tell a frame
+ * made with the home key from one that was not. Every node process of a test
+ * uses the same built-in key. */
+
+#include <string.h>
+#include <mbedtls/sha256.h>
+
+#include "app_home_key.h"
+
+static const uint8_t s_key[APP_HOME_KEY_LEN] = "host test home key, 32 bytes...";
+
+bool app_home_key_available(void)
+{
+    return true;
+}
+
+esp_err_t app_home_key_tag(const void *a, size_t a_len, const void *b, size_t b_len, uint8_t tag[APP_HOME_TAG_LEN])
+{
+    mbedtls_sha256_context ctx;
+    uint8_t mac[32];
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, s_key, sizeof(s_key));
+    mbedtls_sha256_update(&ctx, a, a_len);
+    mbedtls_sha256_update(&ctx, b, b_len);
+    mbedtls_sha256_finish(&ctx, mac);
+    mbedtls_sha256_free(&ctx);
+    memcpy(tag, mac, APP_HOME_TAG_LEN);
+    return ESP_OK;
+}
+
+bool app_home_key_verify(const void *a, size_t a_len, const void *b, size_t b_len, const uint8_t tag[APP_HOME_TAG_LEN])
+{
+    uint8_t expect[APP_HOME_TAG_LEN];
+    app_home_key_tag(a, a_len, b, b_len, expect);
+    return memcmp(expect, tag, APP_HOME_TAG_LEN) == 0;
+}
@@ -0,0 +1,445 @@
+/* Host stand-ins for FreeRTOS tasks and the lwIP sockets of the LAN protocols.
+ *
+ * A task is a thread that runs only while it holds the host task lock; it lets
+ * go of it while blocked in recv() or vTaskDelay(). The test's own thread takes
+ * the lock with host_task_lock() while it drives the node, so the module under
+ * test never runs on two threads at once and the single threaded stubs in
+ * host_stubs.c stay valid.
+ *
+ * A LAN is a range of UDP ports on 127.0.0.1, one per node, each node in its
+ * own process (the modules keep their state in statics). A TCP server binds
+ * the node's port too. */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_mac.h>
+#include <lwip/sockets.h>
+
+#include "host_stubs.h"
+
+#undef bind
+#undef setsockopt
+#undef sendto
+#undef recv
+#undef recvfrom
+#undef accept
+
+static pthread_mutex_t s_task_lock;
+static pthread_once_t s_task_once = PTHREAD_ONCE_INIT;
+
+static int s_speed = 1;        // fake microseconds per host microsecond
+static int s_lan_base;
+static int s_lan_ports;
+static int s_lan_index;
+static uint8_t s_mac[6];
+
+/* ---------------- Tasks ---------------- */
+
+static void task_lock_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+    pthread_mutex_init(&s_task_lock, &attr);
+}
+
+void host_task_lock(void)
+{
+    pthread_once(&s_task_once, task_lock_init);
+    pthread_mutex_lock(&s_task_lock);
+}
+
+void host_task_unlock(void)
+{
+    pthread_mutex_unlock(&s_task_lock);
+}
+
+/* Let go of the lock around a blocking call, if this thread holds it */
+static bool task_yield_begin(void)
+{
+    pthread_once(&s_task_once, task_lock_init);
+    return pthread_mutex_unlock(&s_task_lock) == 0;
+}
+
+static void task_yield_end(bool held)
+{
+    if (held) {
+        pthread_mutex_lock(&s_task_lock);
+    }
+}
+
+struct host_task {
+    TaskFunction_t fn;
+    void *arg;
+    uint32_t notified;
+    pthread_cond_t cond;
+};
+
+static __thread struct host_task *s_current;
+
+static void *task_main(void *p)
+{
+    struct host_task *task = p;
+    s_current = task;
+    host_task_lock();
+    task->fn(task->arg);
+    host_task_unlock();
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                       TaskHandle_t *out)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    task->fn = fn;
+    task->arg = arg;
+    pthread_cond_init(&task->cond, NULL);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_main, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (out) {
+        *out = task;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_current;
+}
+
+/* Wait on cond for up to wait ticks, giving up the task lock the caller holds.
+ * Returns false on timeout. */
+static bool task_wait(pthread_cond_t *cond, TickType_t wait)
+{
+    if (wait == portMAX_DELAY) {
+        pthread_cond_wait(cond, &s_task_lock);
+        return true;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t ns = (int64_t)wait * 1000000 / s_speed;
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec += ns % 1000000000;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, &s_task_lock, &ts) == 0;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    task->notified |= value;
+    pthread_cond_signal(&task->cond);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->notified++;
+    pthread_cond_signal(&task->cond);
+    return pdPASS;
+}
+
+/* Called by a task, holding the lock; waiting gives it up */
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait)
+{
+    struct host_task *task = s_current;
+    task->notified &= ~clear_on_entry;
+    if (!task->notified && wait) {
+        task_wait(&task->cond, wait);
+    }
+    uint32_t bits = task->notified;
+    task->notified &= ~clear_on_exit;
+    if (value) {
+        *value = bits;
+    }
+    return bits ? pdTRUE : pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    struct host_task *task = s_current;
+    if (!task->notified && wait) {
+        task_wait(&task->cond, wait);
+    }
+    uint32_t count = task->notified;
+    if (count) {
+        task->notified = clear_on_exit ? 0 : count - 1;
+    }
+    return count;
+}
+
+struct host_queue {
+    size_t item_size;
+    unsigned length;
+    unsigned head;
+    unsigned count;
+    pthread_cond_t cond;        // signalled whenever an item goes in or out
+    uint8_t items[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q) + (size_t)length * item_size);
+    q->item_size = item_size;
+    q->length = length;
+    pthread_cond_init(&q->cond, NULL);
+    return q;
+}
+
+/* Called by a task, holding the lock; waiting gives it up */
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    while (q->count == q->length) {
+        if (!wait || !task_wait(&q->cond, wait)) {
+            return pdFALSE;
+        }
+    }
+    memcpy(&q->items[(q->head + q->count) % q->length * q->item_size], item, q->item_size);
+    q->count++;
+    pthread_cond_broadcast(&q->cond);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    while (!q->count) {
+        if (!wait || !task_wait(&q->cond, wait)) {
+            return pdFALSE;
+        }
+    }
+    memcpy(item, &q->items[q->head * q->item_size], q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_broadcast(&q->cond);
+    return pdTRUE;
+}
+
+/* ---------------- Real-time clock ---------------- */
+
+static void *clock_main(void *arg)
+{
+    int64_t start_ns = host_wall_ns();
+    int64_t start_us = host_clock_now();
+    while (1) {
+        host_task_lock();
+        int64_t now = start_us + (host_wall_ns() - start_ns) / 1000 * s_speed;
+        if (now > host_clock_now()) {
+            host_clock_advance(now - host_clock_now());
+        }
+        host_task_unlock();
+        struct timespec ts = { 0, 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+void host_clock_speed(int factor)
+{
+    s_speed = factor > 0 ? factor : 1;
+}
+
+void host_clock_realtime(void)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, clock_main, NULL);
+    pthread_detach(thread);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task) {
+        host_task_unlock();
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    bool held = task_yield_begin();
+    int64_t ns = (int64_t)ticks * 1000000 / s_speed;
+    struct timespec ts = { ns / 1000000000, ns % 1000000000 };
+    nanosleep(&ts, NULL);
+    task_yield_end(held);
+}
+
+/* ---------------- MAC ---------------- */
+
+void host_mac_set(const uint8_t mac[6])
+{
+    memcpy(s_mac, mac, 6);
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    memcpy(mac, s_mac, 6);
+    return ESP_OK;
+}
+
+/* ---------------- Sockets ---------------- */
+
+void host_lan_join(int base_port, int ports, int index)
+{
+    s_lan_base = base_port;
+    s_lan_ports = ports;
+    s_lan_index = index;
+}
+
+int host_lan_base_port(int salt)
+{
+    return 20000 + (getpid() * salt) % 12000;
+}
+
+static struct sockaddr_in lan_addr(int index)
+{
+    return (struct sockaddr_in) {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_lan_base + index),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+}
+
+int host_lan_bind(int sock, const struct sockaddr *addr, socklen_t len)
+{
+    struct sockaddr_in own = lan_addr(s_lan_index);
+    return bind(sock, (struct sockaddr *)&own, sizeof(own));
+}
+
+/* Multicast options are accepted and ignored: the group is the port range */
+int host_lan_setsockopt(int sock, int level, int name, const void *val, socklen_t len)
+{
+    if (level == IPPROTO_IP) {
+        return 0;
+    }
+    return setsockopt(sock, level, name, val, len);
+}
+
+ssize_t host_lan_sendto(int sock, const void *buf, size_t len, int flags, const struct sockaddr *to,
+                        socklen_t to_len)
+{
+    const struct sockaddr_in *dst = (const struct sockaddr_in *)to;
+    if (!IN_MULTICAST(ntohl(dst->sin_addr.s_addr))) {
+        return sendto(sock, buf, len, flags, to, to_len);
+    }
+    for (int i = 0; i < s_lan_ports; i++) {
+        if (i != s_lan_index) {
+            struct sockaddr_in peer = lan_addr(i);
+            sendto(sock, buf, len, flags, (struct sockaddr *)&peer, sizeof(peer));
+        }
+    }
+    return len;
+}
+
+ssize_t host_lan_recvfrom(int sock, void *buf, size_t len, int flags, struct sockaddr *from, socklen_t *from_len)
+{
+    bool held = task_yield_begin();
+    ssize_t n = recvfrom(sock, buf, len, flags, from, from_len);
+    int err = errno;
+    task_yield_end(held);
+    errno = err;
+    return n;
+}
+
+int host_lan_accept(int sock, struct sockaddr *addr, socklen_t *len)
+{
+    bool held = task_yield_begin();
+    int conn = accept(sock, addr, len);
+    int err = errno;
+    task_yield_end(held);
+    errno = err;
+    return conn;
+}
+
+ssize_t host_lan_recv(int sock, void *buf, size_t len, int flags)
+{
+    return host_lan_recvfrom(sock, buf, len, flags, NULL, NULL);
+}
+
+/* ---------------- Node processes ---------------- */
+
+static void node_main(int index, int cmd_fd, int reply_fd, void (*setup)(int index), host_node_handler_t handle)
+{
+    FILE *in = fdopen(cmd_fd, "r");
+    FILE *out = fdopen(reply_fd, "w");
+    host_task_lock();
+    setup(index);
+    char line[256], reply[256];
+    while (1) {
+        host_task_unlock();
+        if (!fgets(line, sizeof(line), in)) {
+            _exit(2);
+        }
+        host_task_lock();
+        line[strcspn(line, "\n")] = '\0';
+        if (strcmp(line, "quit") == 0) {
+            fflush(stdout);
+            _exit(host_failures ? 1 : 0);
+        }
+        reply[0] = '\0';
+        handle(line, reply, sizeof(reply));
+        fprintf(out, "%s\n", reply);
+        fflush(out);
+    }
+}
+
+bool host_node_spawn(host_node_t *node, int index, void (*setup)(int index), host_node_handler_t handle)
+{
+    int cmd[2], reply[2];
+    if (pipe(cmd) != 0 || pipe(reply) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        close(cmd[1]);
+        close(reply[0]);
+        node_main(index, cmd[0], reply[1], setup, handle);
+    }
+    close(cmd[0]);
+    close(reply[1]);
+    node->pid = pid;
+    node->cmd = fdopen(cmd[1], "w");
+    node->reply = fdopen(reply[0], "r");
+    return true;
+}
+
+const char *host_node_cmd(host_node_t *node, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(node->cmd, fmt, ap);
+    va_end(ap);
+    fputc('\n', node->cmd);
+    fflush(node->cmd);
+    if (!fgets(node->buf, sizeof(node->buf), node->reply)) {
+        node->buf[0] = '\0';
+    }
+    node->buf[strcspn(node->buf, "\n")] = '\0';
+    return node->buf;
+}
+
+bool host_node_stop(host_node_t *node)
+{
+    fprintf(node->cmd, "quit\n");
+    fclose(node->cmd);
+    fclose(node->reply);
+    int status;
+    waitpid(node->pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,38 @@
+/* tinfl on top of the host zlib, see miniz.h */
+
+#include <string.h>
+#include "miniz.h"
+
+void tinfl_init(tinfl_decompressor *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in, size_t *in_bytes, uint8_t *out_start,
+                              uint8_t *out_next, size_t *out_bytes, mz_uint32 flags)
+{
+    if (!r->started) {
+        if (inflateInit2(&r->zs, (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK) {
+            return TINFL_STATUS_FAILED;
+        }
+        r->started = 1;
+    }
+    r->zs.next_in = (Bytef *)in;
+    r->zs.avail_in = *in_bytes;
+    r->zs.next_out = out_next;
+    r->zs.avail_out = *out_bytes;
+    int ret = inflate(&r->zs, Z_NO_FLUSH);
+    *in_bytes -= r->zs.avail_in;
+    *out_bytes -= r->zs.avail_out;
+    if (ret == Z_STREAM_END) {
+        inflateEnd(&r->zs);
+        r->started = 0;
+        return TINFL_STATUS_DONE;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        inflateEnd(&r->zs);
+        r->started = 0;
+        return TINFL_STATUS_FAILED;
+    }
+    return r->zs.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
@@ -0,0 +1,183 @@
+/* SHA-256 (FIPS 180-4) and HMAC-SHA-256 (RFC 2104) behind the mbedtls API,
+ * see mbedtls/sha256.h and mbedtls/md.h */
+
+#include <string.h>
+#include "mbedtls/sha256.h"
+#include "mbedtls/md.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(mbedtls_sha256_context *ctx, const uint8_t *p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+    ctx->state[5] += f;
+    ctx->state[6] += g;
+    ctx->state[7] += h;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->total = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    size_t fill = ctx->total % 64;
+    ctx->total += ilen;
+    if (fill && fill + ilen >= 64) {
+        memcpy(ctx->buf + fill, input, 64 - fill);
+        sha256_block(ctx, ctx->buf);
+        input += 64 - fill;
+        ilen -= 64 - fill;
+        fill = 0;
+    }
+    for (; ilen >= 64 && fill == 0; input += 64, ilen -= 64) {
+        sha256_block(ctx, input);
+    }
+    memcpy(ctx->buf + fill, input, ilen);
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    uint64_t bits = ctx->total * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t fill = ctx->total % 64;
+    size_t padlen = fill < 56 ? 56 - fill : 120 - fill;
+    for (int i = 0; i < 8; i++) {
+        pad[padlen + i] = bits >> (56 - 8 * i);
+    }
+    mbedtls_sha256_update(ctx, pad, padlen + 8);
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = ctx->state[i] >> 24;
+        output[4 * i + 1] = ctx->state[i] >> 16;
+        output[4 * i + 2] = ctx->state[i] >> 8;
+        output[4 * i + 3] = ctx->state[i];
+    }
+    return 0;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224)
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, is224);
+    mbedtls_sha256_update(&ctx, input, ilen);
+    mbedtls_sha256_finish(&ctx, output);
+    mbedtls_sha256_free(&ctx);
+    return 0;
+}
+
+/* ---------------- HMAC ---------------- */
+
+struct mbedtls_md_info_t {
+    mbedtls_md_type_t type;
+};
+
+static const mbedtls_md_info_t s_sha256_info = { MBEDTLS_MD_SHA256 };
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t md_type)
+{
+    return md_type == MBEDTLS_MD_SHA256 ? &s_sha256_info : NULL;
+}
+
+void mbedtls_md_init(mbedtls_md_context_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md_free(mbedtls_md_context_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *md_info, int hmac)
+{
+    return md_info && hmac ? 0 : -1;
+}
+
+int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen)
+{
+    unsigned char k[64] = { 0 };
+    unsigned char ipad[64];
+    if (keylen > sizeof(k)) {
+        mbedtls_sha256(key, keylen, k, 0);
+    } else {
+        memcpy(k, key, keylen);
+    }
+    for (int i = 0; i < 64; i++) {
+        ipad[i] = k[i] ^ 0x36;
+        ctx->opad[i] = k[i] ^ 0x5c;
+    }
+    mbedtls_sha256_init(&ctx->sha);
+    mbedtls_sha256_starts(&ctx->sha, 0);
+    return mbedtls_sha256_update(&ctx->sha, ipad, sizeof(ipad));
+}
+
+int mbedtls_md_hmac_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen)
+{
+    return mbedtls_sha256_update(&ctx->sha, input, ilen);
+}
+
+int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output)
+{
+    unsigned char inner[32];
+    mbedtls_sha256_finish(&ctx->sha, inner);
+    mbedtls_sha256_init(&ctx->sha);
+    mbedtls_sha256_starts(&ctx->sha, 0);
+    mbedtls_sha256_update(&ctx->sha, ctx->opad, sizeof(ctx->opad));
+    mbedtls_sha256_update(&ctx->sha, inner, sizeof(inner));
+    return mbedtls_sha256_finish(&ctx->sha, output);
+}
@@ -0,0 +1,814 @@
+/* Host stand-ins for the parts of ESP-IDF, FreeRTOS and RainMaker used by
+ * the modules under test. Single threaded: locks only count their nesting
+ * and event handlers run synchronously. */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_event.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_utils.h>
+#include <esp_ota_ops.h>
+#include <esp_rom_crc.h>
+#include <esp_diagnostics_metrics.h>
+#include <esp_system.h>
+#include <nvs.h>
+#include <json_generator.h>
+#include <freertos/semphr.h>
+
+#include "host_stubs.h"
+
+int host_locks_held;
+bool host_time_synced;
+int host_failures;
+int host_nvs_writes;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    static char buf[16];
+    snprintf(buf, sizeof(buf), "0x%x", code);
+    return buf;
+}
+
+void host_log(const char *level, const char *tag, const char *fmt, ...)
+{
+    static int enabled = -1;
+    if (enabled < 0) {
+        enabled = getenv("HOST_TEST_LOG") != NULL;
+    }
+    if (!enabled) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    printf("%s (%lld) %s: ", level, (long long)(host_clock_now() / 1000), tag);
+    vprintf(fmt, ap);
+    printf("\n");
+    fflush(stdout);
+    va_end(ap);
+}
+
+int64_t host_wall_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ---------------- FreeRTOS ---------------- */
+
+struct host_sem {
+    int taken;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(struct host_sem));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    if (sem->taken) {
+        fprintf(stderr, "deadlock: mutex taken twice\n");
+        abort();
+    }
+    sem->taken = 1;
+    host_locks_held++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->taken = 0;
+    host_locks_held--;
+    return pdTRUE;
+}
+
+/* ---------------- esp_timer ---------------- */
+
+struct esp_timer {
+    esp_timer_cb_t cb;
+    void *arg;
+    int64_t alarm;
+    uint64_t period;
+    bool armed;
+    struct esp_timer *next;
+};
+
+static int64_t s_now;
+static struct esp_timer *s_timers;  // armed, sorted by alarm
+
+int64_t host_clock_now(void)
+{
+    return s_now;
+}
+
+void host_clock_set(int64_t us)
+{
+    s_now = us;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now;
+}
+
+static void timer_remove(struct esp_timer *t)
+{
+    for (struct esp_timer **pp = &s_timers; *pp; pp = &(*pp)->next) {
+        if (*pp == t) {
+            *pp = t->next;
+            break;
+        }
+    }
+    t->armed = false;
+}
+
+static void timer_insert(struct esp_timer *t)
+{
+    struct esp_timer **pp = &s_timers;
+    while (*pp && (*pp)->alarm <= t->alarm) {
+        pp = &(*pp)->next;
+    }
+    t->next = *pp;
+    *pp = t;
+    t->armed = true;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->cb = args->callback;
+    t->arg = args->arg;
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    if (t->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->alarm = s_now + (int64_t)timeout_us;
+    t->period = period_us;
+    timer_insert(t);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    return timer_start(t, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us)
+{
+    return timer_start(t, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer_remove(t);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    if (t->armed) {
+        timer_remove(t);
+    }
+    free(t);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    return t->armed;
+}
+
+int host_clock_advance(int64_t us)
+{
+    int64_t target = s_now + us;
+    int ran = 0;
+    while (s_timers && s_timers->alarm <= target) {
+        struct esp_timer *t = s_timers;
+        s_timers = t->next;
+        t->armed = false;
+        if (t->alarm > s_now) {
+            s_now = t->alarm;
+        }
+        if (t->period) {
+            t->alarm += (int64_t)t->period;
+            timer_insert(t);
+        }
+        t->cb(t->arg);
+        ran++;
+    }
+    s_now = target;
+    return ran;
+}
+
+int64_t host_clock_next_expiry(void)
+{
+    return s_timers ? s_timers->alarm : -1;
+}
+
+int host_timers_armed(void)
+{
+    int n = 0;
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        n++;
+    }
+    return n;
+}
+
+/* ---------------- esp_event ---------------- */
+
+#define HOST_MAX_HANDLERS   16
+
+static struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} s_handlers[HOST_MAX_HANDLERS];
+static int s_handler_count;
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg)
+{
+    if (s_handler_count == HOST_MAX_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_handlers[s_handler_count].base = base;
+    s_handlers[s_handler_count].id = id;
+    s_handlers[s_handler_count].handler = handler;
+    s_handlers[s_handler_count++].arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t wait)
+{
+    for (int i = 0; i < s_handler_count; i++) {
+        if (s_handlers[i].base == base && (s_handlers[i].id == ESP_EVENT_ANY_ID || s_handlers[i].id == id)) {
+            s_handlers[i].handler(s_handlers[i].arg, base, id, (void *)data);
+        }
+    }
+    return ESP_OK;
+}
+
+/* ---------------- Partitions ---------------- */
+
+#define HOST_MAX_PARTITIONS 8
+
+static esp_partition_t s_partitions[HOST_MAX_PARTITIONS];
+static int s_partition_count;
+static const esp_partition_t *s_running;
+static int s_mapped;
+
+const esp_partition_t *host_partition_add(const char *label, esp_partition_type_t type, const void *data,
+                                          size_t size)
+{
+    if (s_partition_count == HOST_MAX_PARTITIONS) {
+        return NULL;
+    }
+    esp_partition_t *part = &s_partitions[s_partition_count++];
+    part->type = type;
+    part->subtype = type == ESP_PARTITION_TYPE_APP ? ESP_PARTITION_SUBTYPE_APP_OTA_0 : 0;
+    part->size = size;
+    part->host_data = data;
+    snprintf(part->label, sizeof(part->label), "%s", label);
+    return part;
+}
+
+void host_partition_clear(void)
+{
+    s_partition_count = 0;
+    s_running = NULL;
+}
+
+void host_partition_set_running(const esp_partition_t *part)
+{
+    s_running = part;
+}
+
+int host_partition_mapped(void)
+{
+    return s_mapped;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return s_running;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (int i = 0; i < s_partition_count; i++) {
+        const esp_partition_t *part = &s_partitions[i];
+        if (part->type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || part->subtype == subtype) &&
+            (!label || strcmp(label, part->label) == 0)) {
+            return part;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, partition->host_data + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    if (offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out_ptr = partition->host_data + offset;
+    *out_handle = ++s_mapped;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    s_mapped--;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    return crc32(crc, buf, len);
+}
+
+/* ---------------- NVS ---------------- */
+
+#define HOST_NVS_ENTRIES    32
+
+static struct {
+    char ns[16];
+    char key[16];
+    void *value;
+    size_t len;
+} s_nvs[HOST_NVS_ENTRIES];
+static char s_nvs_open[8][16];
+static const char *s_nvs_path;
+
+/* Record: namespace[16] key[16] length[4] value */
+void host_nvs_file(const char *path)
+{
+    s_nvs_path = strdup(path);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return;
+    }
+    for (int i = 0; i < HOST_NVS_ENTRIES; i++) {
+        uint32_t len;
+        if (fread(s_nvs[i].ns, 16, 1, f) != 1 || fread(s_nvs[i].key, 16, 1, f) != 1 ||
+            fread(&len, 4, 1, f) != 1) {
+            s_nvs[i].ns[0] = '\0';
+            break;
+        }
+        s_nvs[i].value = malloc(len);
+        s_nvs[i].len = len;
+        if (fread(s_nvs[i].value, 1, len, f) != len) {
+            s_nvs[i].ns[0] = '\0';
+            break;
+        }
+    }
+    fclose(f);
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    for (nvs_handle_t h = 0; h < 8; h++) {
+        if (!s_nvs_open[h][0]) {
+            snprintf(s_nvs_open[h], sizeof(s_nvs_open[h]), "%s", name);
+            *out_handle = h;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    s_nvs_open[handle][0] = '\0';
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    if (!s_nvs_path) {
+        return ESP_OK;
+    }
+    FILE *f = fopen(s_nvs_path, "wb");
+    if (!f) {
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < HOST_NVS_ENTRIES; i++) {
+        if (s_nvs[i].ns[0]) {
+            uint32_t len = s_nvs[i].len;
+            fwrite(s_nvs[i].ns, 16, 1, f);
+            fwrite(s_nvs[i].key, 16, 1, f);
+            fwrite(&len, 4, 1, f);
+            fwrite(s_nvs[i].value, 1, len, f);
+        }
+    }
+    fclose(f);
+    return ESP_OK;
+}
+
+static int nvs_find(nvs_handle_t handle, const char *key, bool create)
+{
+    int free_slot = -1;
+    for (int i = 0; i < HOST_NVS_ENTRIES; i++) {
+        if (!s_nvs[i].ns[0]) {
+            free_slot = free_slot < 0 ? i : free_slot;
+        } else if (strcmp(s_nvs[i].ns, s_nvs_open[handle]) == 0 && strcmp(s_nvs[i].key, key) == 0) {
+            return i;
+        }
+    }
+    if (create && free_slot >= 0) {
+        snprintf(s_nvs[free_slot].ns, sizeof(s_nvs[free_slot].ns), "%s", s_nvs_open[handle]);
+        snprintf(s_nvs[free_slot].key, sizeof(s_nvs[free_slot].key), "%s", key);
+        return free_slot;
+    }
+    return -1;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    int i = nvs_find(handle, key, false);
+    if (i < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value) {
+        memcpy(out_value, s_nvs[i].value, *length < s_nvs[i].len ? *length : s_nvs[i].len);
+    }
+    *length = s_nvs[i].len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    int i = nvs_find(handle, key, true);
+    if (i < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    free(s_nvs[i].value);
+    s_nvs[i].value = malloc(length);
+    memcpy(s_nvs[i].value, value, length);
+    s_nvs[i].len = length;
+    host_nvs_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t len = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 192 * 1024;
+}
+
+/* ---------------- Insights metrics ---------------- */
+
+#define HOST_METRICS_MAX    16
+
+static struct {
+    char key[32];
+    int64_t value;
+    int samples;
+} s_metrics[HOST_METRICS_MAX];
+
+esp_err_t esp_diag_metrics_register(const char *tag, const char *key, const char *label, const char *path,
+                                    esp_diag_data_type_t type)
+{
+    for (int i = 0; i < HOST_METRICS_MAX; i++) {
+        if (strcmp(s_metrics[i].key, key) == 0) {
+            return ESP_FAIL;
+        }
+        if (!s_metrics[i].key[0]) {
+            snprintf(s_metrics[i].key, sizeof(s_metrics[i].key), "%s", key);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t metrics_add(const char *key, int64_t value)
+{
+    for (int i = 0; i < HOST_METRICS_MAX && s_metrics[i].key[0]; i++) {
+        if (strcmp(s_metrics[i].key, key) == 0) {
+            s_metrics[i].value = value;
+            s_metrics[i].samples++;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_diag_metrics_add_int(const char *key, int32_t i)
+{
+    return metrics_add(key, i);
+}
+
+esp_err_t esp_diag_metrics_add_uint(const char *key, uint32_t u)
+{
+    return metrics_add(key, u);
+}
+
+int host_metric(const char *key, int64_t *value)
+{
+    for (int i = 0; i < HOST_METRICS_MAX && s_metrics[i].key[0]; i++) {
+        if (strcmp(s_metrics[i].key, key) == 0) {
+            *value = s_metrics[i].value;
+            return s_metrics[i].samples;
+        }
+    }
+    return -1;
+}
+
+/* ---------------- json_generator ---------------- */
+
+static int json_put(json_gen_str_t *jstr, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static int json_put(json_gen_str_t *jstr, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(jstr->buf + jstr->len, jstr->buf_size - jstr->len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || n >= jstr->buf_size - jstr->len) {
+        return -1;
+    }
+    jstr->len += n;
+    return 0;
+}
+
+/* Separator before a value, and its name inside an object */
+static int json_item(json_gen_str_t *jstr, const char *name)
+{
+    int err = jstr->first[jstr->depth] ? 0 : json_put(jstr, ",");
+    jstr->first[jstr->depth] = false;
+    if (name) {
+        err |= json_put(jstr, "\"%s\":", name);
+    }
+    return err;
+}
+
+static int json_open(json_gen_str_t *jstr, const char *name, char c)
+{
+    int err = jstr->depth ? json_item(jstr, name) : 0;
+    err |= json_put(jstr, "%c", c);
+    jstr->first[++jstr->depth] = true;
+    return err;
+}
+
+static int json_close(json_gen_str_t *jstr, char c)
+{
+    jstr->depth--;
+    return json_put(jstr, "%c", c);
+}
+
+void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size, json_gen_flush_cb_t flush_cb, void *priv)
+{
+    memset(jstr, 0, sizeof(*jstr));
+    jstr->buf = buf;
+    jstr->buf_size = buf_size;
+    buf[0] = '\0';
+}
+
+int json_gen_str_end(json_gen_str_t *jstr)
+{
+    return 0;
+}
+
+int json_gen_start_object(json_gen_str_t *jstr)
+{
+    return json_open(jstr, NULL, '{');
+}
+
+int json_gen_end_object(json_gen_str_t *jstr)
+{
+    return json_close(jstr, '}');
+}
+
+int json_gen_start_array(json_gen_str_t *jstr)
+{
+    return json_open(jstr, NULL, '[');
+}
+
+int json_gen_end_array(json_gen_str_t *jstr)
+{
+    return json_close(jstr, ']');
+}
+
+int json_gen_push_array(json_gen_str_t *jstr, const char *name)
+{
+    return json_open(jstr, name, '[');
+}
+
+int json_gen_pop_array(json_gen_str_t *jstr)
+{
+    return json_close(jstr, ']');
+}
+
+int json_gen_push_object(json_gen_str_t *jstr, const char *name)
+{
+    return json_open(jstr, name, '{');
+}
+
+int json_gen_pop_object(json_gen_str_t *jstr)
+{
+    return json_close(jstr, '}');
+}
+
+int json_gen_obj_set_int(json_gen_str_t *jstr, const char *name, int val)
+{
+    return json_item(jstr, name) | json_put(jstr, "%d", val);
+}
+
+int json_gen_obj_set_bool(json_gen_str_t *jstr, const char *name, bool val)
+{
+    return json_item(jstr, name) | json_put(jstr, "%s", val ? "true" : "false");
+}
+
+int json_gen_obj_set_string(json_gen_str_t *jstr, const char *name, const char *val)
+{
+    return json_item(jstr, name) | json_put(jstr, "\"%s\"", val);
+}
+
+int json_gen_arr_set_int(json_gen_str_t *jstr, int val)
+{
+    return json_item(jstr, NULL) | json_put(jstr, "%d", val);
+}
+
+/* ---------------- Wall clock ---------------- */
+
+static time_t s_epoch;
+
+void host_epoch_set(time_t epoch)
+{
+    s_epoch = epoch - (time_t)(s_now / 1000000);
+}
+
+/* Linked with -Wl,--wrap=time: the modules' time() follows the fake clock */
+time_t __wrap_time(time_t *out)
+{
+    time_t t = s_epoch + (time_t)(s_now / 1000000);
+    if (out) {
+        *out = t;
+    }
+    return t;
+}
+
+/* ---------------- RainMaker ---------------- */
+
+struct esp_rmaker_device {
+    const char *name;
+};
+
+struct esp_rmaker_param {
+    const char *name;
+    esp_rmaker_param_val_t val;
+};
+
+bool esp_rmaker_time_check(void)
+{
+    return host_time_synced;
+}
+
+static esp_rmaker_device_t *device_new(const char *name)
+{
+    esp_rmaker_device_t *dev = calloc(1, sizeof(*dev));
+    dev->name = name;
+    return dev;
+}
+
+esp_rmaker_device_t *esp_rmaker_device_create(const char *name, const char *type, void *priv)
+{
+    return device_new(name);
+}
+
+esp_rmaker_device_t *esp_rmaker_service_create(const char *name, const char *type, void *priv)
+{
+    return device_new(name);
+}
+
+esp_err_t esp_rmaker_device_add_cb(const esp_rmaker_device_t *device, esp_rmaker_device_write_cb_t write_cb,
+                                   esp_rmaker_device_read_cb_t read_cb)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_device_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_node_add_device(const esp_rmaker_node_t *node, const esp_rmaker_device_t *device)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_device_delete(const esp_rmaker_device_t *device)
+{
+    free((esp_rmaker_device_t *)device);
+    return ESP_OK;
+}
+
+const char *esp_rmaker_device_get_name(const esp_rmaker_device_t *device)
+{
+    return device->name;
+}
+
+esp_rmaker_param_t *esp_rmaker_param_create(const char *name, const char *type, esp_rmaker_param_val_t val,
+                                            uint8_t flags)
+{
+    esp_rmaker_param_t *param = calloc(1, sizeof(*param));
+    param->name = name;
+    param->val = val;
+    return param;
+}
+
+const char *esp_rmaker_param_get_name(const esp_rmaker_param_t *param)
+{
+    return param->name;
+}
+
+esp_rmaker_param_val_t *esp_rmaker_param_get_val(esp_rmaker_param_t *param)
+{
+    return &param->val;
+}
+
+esp_err_t esp_rmaker_param_add_ui_type(const esp_rmaker_param_t *param, const char *ui_type)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_add_bounds(const esp_rmaker_param_t *param, esp_rmaker_param_val_t min,
+                                      esp_rmaker_param_val_t max, esp_rmaker_param_val_t step)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_update(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    ((esp_rmaker_param_t *)param)->val = val;
+    return ESP_OK;
+}
+
+esp_err_t esp_rmaker_param_update_and_report(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    return esp_rmaker_param_update(param, val);
+}
+
+esp_rmaker_param_val_t esp_rmaker_bool(bool val)
+{
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_BOOLEAN, .val.b = val };
+}
+
+esp_rmaker_param_val_t esp_rmaker_int(int val)
+{
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_INTEGER, .val.i = val };
+}
+
+esp_rmaker_param_val_t esp_rmaker_float(float val)
+{
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_FLOAT, .val.f = val };
+}
+
+esp_rmaker_param_val_t esp_rmaker_str(const char *val)
+{
+    return (esp_rmaker_param_val_t){ .type = RMAKER_VAL_TYPE_STRING, .val.s = (char *)val };
+}
@@ -0,0 +1,143 @@
+/* Test control for the host stand-ins of ESP-IDF (host_stubs.c) */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+#include <esp_partition.h>
+
+/* Number of portMUX critical sections and semaphores currently held */
+extern int host_locks_held;
+
+/* What esp_rmaker_time_check() returns */
+extern bool host_time_synced;
+
+/* Fake esp_timer clock. Timers are kept in one list sorted by expiry, as
+ * esp_timer does, so its insertion cost can be compared against. */
+int64_t host_clock_now(void);
+void host_clock_set(int64_t us);
+
+/* Move the clock to now + us, running every timer that expires on the way, in
+ * expiry order with the clock set to its expiry. Returns the callbacks run. */
+int host_clock_advance(int64_t us);
+
+/* Expiry of the earliest armed esp_timer, -1 if none */
+int64_t host_clock_next_expiry(void);
+
+/* Armed esp_timers */
+int host_timers_armed(void);
+
+/* From now on the clock follows the host's, and timers fire from a thread of
+ * their own under the task lock, as from the esp_timer task (host_lan.c) */
+void host_clock_realtime(void);
+
+/* Run the real-time clock, task delays and task notify timeouts factor times
+ * faster than the host's, to simulate minutes in seconds. Before
+ * host_clock_realtime(). */
+void host_clock_speed(int factor);
+
+/* Register a memory buffer as a partition (not copied, must stay valid) */
+const esp_partition_t *host_partition_add(const char *label, esp_partition_type_t type, const void *data,
+                                          size_t size);
+void host_partition_clear(void);
+
+/* What esp_ota_get_running_partition() returns */
+void host_partition_set_running(const esp_partition_t *part);
+
+/* Mappings not yet released with esp_partition_munmap() */
+int host_partition_mapped(void);
+
+/* Set what time() returns now; it then advances with the fake clock */
+void host_epoch_set(time_t epoch);
+
+/* nvs_set_*() calls so far */
+extern int host_nvs_writes;
+
+/* Keep NVS in a file: load it now and rewrite it on every nvs_commit(), so a
+ * node process can be restarted with what it had stored */
+void host_nvs_file(const char *path);
+
+/* Run the test thread as a task (host_lan.c): hold the lock while calling into
+ * the modules, let go of it to let their tasks run */
+void host_task_lock(void);
+void host_task_unlock(void);
+
+/* Put this process on a LAN of ports base_port .. base_port + ports - 1, as
+ * node index; esp_read_mac() returns mac */
+void host_lan_join(int base_port, int ports, int index);
+
+/* A base port for a test's LAN, apart for tests running in parallel (pid
+ * times a per-test salt) and below the kernel's ephemeral range, where the
+ * unbound sockets of the other tests get their ports */
+int host_lan_base_port(int salt);
+void host_mac_set(const uint8_t mac[6]);
+
+/* A node process of a multi-node test, driven over a pipe one command line at
+ * a time. The node calls setup(index) once and then handle() for each command,
+ * both with the task lock held; "quit" ends it with its CHECK() result. */
+typedef void (*host_node_handler_t)(const char *cmd, char *reply, size_t reply_len);
+
+typedef struct {
+    pid_t pid;
+    FILE *cmd;
+    FILE *reply;
+    char buf[256];
+} host_node_t;
+
+bool host_node_spawn(host_node_t *node, int index, void (*setup)(int index), host_node_handler_t handle);
+
+/* Send a command, wait for and return its reply line */
+const char *host_node_cmd(host_node_t *node, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* Quit the node; returns false if it exited with failed CHECK()s */
+bool host_node_stop(host_node_t *node);
+
+/* Broker stand-in (host_cloud.c). While up, it accepts a connect after
+ * HOST_CLOUD_CONNECT_MS and acknowledges a publish after HOST_CLOUD_ACK_MS;
+ * while down, connects get no answer. */
+#define HOST_CLOUD_CONNECT_MS   20
+#define HOST_CLOUD_ACK_MS       10
+
+typedef struct {
+    int starts;         // esp_rmaker_start()
+    int connects;       // connects tried, including the agent's first one
+    int sessions;       // connects accepted
+    int publishes;      // publishes accepted
+} host_cloud_stats_t;
+
+extern host_cloud_stats_t host_cloud;
+
+void host_cloud_set_up(bool up);
+
+/* Send connects to a broker shared by several node processes instead: the one
+ * the test runs on UDP port, on 127.0.0.1. It gets "C" for a connect and "D"
+ * for a disconnect, and answers "A" (accepted), "R" (refused) or, at any time,
+ * "X" (session dropped). */
+void host_cloud_broker(int port);
+bool host_cloud_session_up(void);
+
+/* Called for every accepted publish */
+void host_cloud_on_publish(void (*cb)(const char *topic, const char *payload));
+
+/* Samples added to a registered Insights metric, -1 if it was never
+ * registered; value is the last one added */
+int host_metric(const char *key, int64_t *value);
+
+/* Seed of esp_random() */
+void host_random_seed(uint32_t seed);
+
+/* Monotonic host time for benchmarks */
+int64_t host_wall_ns(void);
+
+/* Failed CHECK()s; a test exits non-zero if any */
+extern int host_failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            host_failures++; \
+        } \
+    } while (0)
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdbool.h>
+
+/* Compact JSON into a fixed buffer, strings not escaped */
+typedef struct {
+    char *buf;
+    int buf_size;
+    int len;
+    int depth;
+    bool first[8];      // nothing written yet at this depth
+} json_gen_str_t;
+
+typedef void (*json_gen_flush_cb_t)(char *buf, void *priv);
+
+void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size, json_gen_flush_cb_t flush_cb, void *priv);
+int json_gen_str_end(json_gen_str_t *jstr);
+int json_gen_start_object(json_gen_str_t *jstr);
+int json_gen_end_object(json_gen_str_t *jstr);
+int json_gen_start_array(json_gen_str_t *jstr);
+int json_gen_end_array(json_gen_str_t *jstr);
+int json_gen_push_array(json_gen_str_t *jstr, const char *name);
+int json_gen_pop_array(json_gen_str_t *jstr);
+int json_gen_push_object(json_gen_str_t *jstr, const char *name);
+int json_gen_pop_object(json_gen_str_t *jstr);
+int json_gen_obj_set_int(json_gen_str_t *jstr, const char *name, int val);
+int json_gen_obj_set_bool(json_gen_str_t *jstr, const char *name, bool val);
+int json_gen_obj_set_string(json_gen_str_t *jstr, const char *name, const char *val);
+int json_gen_arr_set_int(json_gen_str_t *jstr, int val);
@@ -0,0 +1,26 @@
+#pragma once
+/* BSD sockets over host UDP on 127.0.0.1 (host_lan.c). A LAN is a range of
+ * ports, one per node: bind() takes the node's port whatever was asked, and a
+ * datagram sent to a multicast address goes to every other port of the range.
+ * TCP servers get the node's port the same way. */
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+int host_lan_bind(int sock, const struct sockaddr *addr, socklen_t len);
+int host_lan_setsockopt(int sock, int level, int name, const void *val, socklen_t len);
+ssize_t host_lan_sendto(int sock, const void *buf, size_t len, int flags, const struct sockaddr *to,
+                        socklen_t to_len);
+ssize_t host_lan_recv(int sock, void *buf, size_t len, int flags);
+ssize_t host_lan_recvfrom(int sock, void *buf, size_t len, int flags, struct sockaddr *from, socklen_t *from_len);
+int host_lan_accept(int sock, struct sockaddr *addr, socklen_t *len);
+
+#define bind        host_lan_bind
+#define setsockopt  host_lan_setsockopt
+#define sendto      host_lan_sendto
+#define recv        host_lan_recv
+#define recvfrom    host_lan_recvfrom
+#define accept      host_lan_accept
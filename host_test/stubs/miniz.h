@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <zlib.h>
+
+/* The subset of miniz's tinfl used by app_ota_decode.c, on top of the host
+ * zlib (host_miniz.c). Output may go anywhere in the caller's dictionary:
+ * zlib keeps its own window. */
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE              32768
+#define TINFL_FLAG_PARSE_ZLIB_HEADER    1
+#define TINFL_FLAG_HAS_MORE_INPUT       2
+#define TINFL_FLAG_COMPUTE_ADLER32      8
+
+typedef enum {
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    z_stream zs;
+    int started;
+} tinfl_decompressor;
+
+void tinfl_init(tinfl_decompressor *r);
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in, size_t *in_bytes, uint8_t *out_start,
+                              uint8_t *out_next, size_t *out_bytes, mz_uint32 flags);
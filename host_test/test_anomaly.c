@@ -0,0 +1,220 @@
+/* Door activity anomaly detector: replay harness
+ *
+ *   test_anomaly                 built-in five-week household trace, with checks
+ *   test_anomaly TRACE.csv       replay a recorded trace, print the alerts
+ *
+ * A trace line is "<unix time>,<open|close|arm|disarm>", in time order. The
+ * real app_occupancy.c and app_anomaly.c run on the fake clock: time() and the
+ * one-minute rollover timer follow the trace, and the node boots at the time of
+ * the first line. Times are UTC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <esp_event.h>
+#include <esp_rmaker_core.h>
+
+#include "app_anomaly.h"
+#include "app_timer.h"
+#include "app_occupancy.h"
+#include "app_events.h"
+#include "app_priv.h"
+#include "app_alert.h"
+#include "app_report.h"
+#include "host_stubs.h"
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+#define MAX_ALERTS  64
+#define DAY         (24 * 3600)
+
+static bool s_armed;
+static bool s_booted;
+static time_t s_alerts[MAX_ALERTS];
+static int s_alert_count;
+static int64_t s_handler_ns;
+static int s_opens;
+
+bool app_alarm_is_enabled(void)
+{
+    return s_armed;
+}
+
+esp_err_t app_alert_raise(app_alert_prio_t prio, uint8_t zone, const char *what)
+{
+    time_t now = time(NULL);
+    char when[32];
+    strftime(when, sizeof(when), "%a %Y-%m-%d %H:%M", gmtime(&now));
+    printf("  alert %s  %s\n", when, what);
+    if (s_alert_count < MAX_ALERTS) {
+        s_alerts[s_alert_count++] = now;
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_report_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    return ESP_OK;
+}
+
+esp_err_t app_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    return ESP_OK;
+}
+
+/* Boot at the first event, then move the fake clock to each event */
+static void replay(time_t t, const char *what)
+{
+    if (!s_booted) {
+        host_epoch_set(t);
+        host_time_synced = true;
+        CHECK(app_timer_service_init() == ESP_OK, "timer init");
+        CHECK(app_occupancy_init(NULL) == ESP_OK, "occupancy init");
+        CHECK(app_anomaly_init() == ESP_OK, "anomaly init");
+        s_booted = true;
+    }
+    time_t now = time(NULL);
+    if (t > now) {
+        host_clock_advance((int64_t)(t - now) * 1000000);
+    }
+    app_event_data_t data = { .src = APP_EVENT_SRC_SENSOR };
+    if (strcmp(what, "open") == 0) {
+        int64_t t0 = host_wall_ns();
+        esp_event_post(APP_EVENT, APP_EVENT_DOOR_OPENED, &data, sizeof(data), 0);
+        s_handler_ns += host_wall_ns() - t0;
+        s_opens++;
+    } else if (strcmp(what, "close") == 0) {
+        esp_event_post(APP_EVENT, APP_EVENT_DOOR_CLOSED, &data, sizeof(data), 0);
+    } else if (strcmp(what, "arm") == 0) {
+        s_armed = true;
+    } else if (strcmp(what, "disarm") == 0) {
+        s_armed = false;
+    }
+}
+
+static void open_close(time_t t)
+{
+    replay(t, "open");
+    replay(t + 20, "close");
+}
+
+/* n opens spread over the hour starting at hour_start */
+static void opens_in_hour(time_t hour_start, int n)
+{
+    for (int i = 0; i < n; i++) {
+        open_close(hour_start + 60 + i * (3300 / (n > 0 ? n : 1)) + rand() % 60);
+    }
+}
+
+static int alerts_between(time_t from, time_t to)
+{
+    int n = 0;
+    for (int i = 0; i < s_alert_count; i++) {
+        n += s_alerts[i] >= from && s_alerts[i] < to;
+    }
+    return n;
+}
+
+static void synthetic(void)
+{
+    srand(87);
+    const time_t day0 = 1772409600;     // Mon 2026-03-02 00:00 UTC
+    const int days = 35;
+
+    /* Boot at 07:30 into a busy morning: the half hour must not be learned */
+    replay(day0 + 7 * 3600 + 1800, "disarm");
+    for (int i = 0; i < 12; i++) {
+        open_close(day0 + 7 * 3600 + 1860 + i * 120);
+    }
+    replay(day0 + 8 * 3600 + 120, "disarm");
+    app_occupancy_stats_t st;
+    app_occupancy_get(&st);
+    CHECK(st.days_hour[7] == 0, "the partial boot hour was learned (%u)", st.days_hour[7]);
+
+    time_t burst = 0, night = 0;
+    for (int d = 0; d < days; d++) {
+        time_t base = day0 + (time_t)d * DAY;
+        bool weekend = d % 7 >= 5;
+        if (d == 30) {
+            /* Forgot to arm; someone comes in at 03:10 */
+            night = base + 3 * 3600;
+            open_close(night + 600);
+            replay(base + 6 * 3600 + 1800, "disarm");
+        } else if (d > 0) {
+            replay(base + 6 * 3600 + 1800, "disarm");
+        }
+        if (d > 0) {
+            if (weekend) {
+                for (int h = 9; h < 21; h++) {
+                    opens_in_hour(base + h * 3600, rand() % 3);
+                }
+            } else {
+                opens_in_hour(base + 7 * 3600, 2 + rand() % 3);
+                opens_in_hour(base + 12 * 3600, rand() % 2);
+                if (d == 32) {
+                    /* A Friday afternoon with the door going all the time */
+                    burst = base + 14 * 3600;
+                    opens_in_hour(burst, 8);
+                }
+                for (int h = 17; h < 20; h++) {
+                    opens_in_hour(base + h * 3600, 1 + rand() % 3);
+                }
+            }
+        }
+        if (d != 29) {
+            replay(base + 23 * 3600, "arm");
+        }
+    }
+    replay(day0 + (time_t)days * DAY + 3600, "disarm");
+
+    CHECK(alerts_between(day0, day0 + 5 * DAY) == 0, "alerts during the first five days of learning");
+    CHECK(alerts_between(night, night + 3600) == 1, "night open while disarmed not flagged");
+    CHECK(alerts_between(burst, burst + 3600) == 1, "afternoon burst not flagged (or flagged twice)");
+    int false_alerts = s_alert_count - alerts_between(night, night + 3600) - alerts_between(burst, burst + 3600);
+    CHECK(false_alerts == 0, "%d alerts on ordinary days", false_alerts);
+
+    app_occupancy_get(&st);
+    /* Every whole hour after boot was learned, one NVS write per 6 */
+    int learned = days * 24 - 8;
+    CHECK(host_nvs_writes == learned / 6, "%d baseline writes for %d learned hours", host_nvs_writes, learned);
+    printf("%d days, %d opens, %d alerts (%d false), %d NVS writes\n", days, s_opens, s_alert_count,
+           false_alerts, host_nvs_writes);
+}
+
+static void from_file(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("cannot open %s\n", path);
+        exit(2);
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        char what[16];
+        long long t;
+        if (sscanf(line, "%lld,%15s", &t, what) == 2) {
+            replay((time_t)t, what);
+        }
+    }
+    fclose(f);
+    printf("%d opens, %d alerts\n", s_opens, s_alert_count);
+}
+
+int main(int argc, char **argv)
+{
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    if (argc > 1) {
+        from_file(argv[1]);
+    } else {
+        synthetic();
+    }
+    if (s_opens) {
+        printf("occupancy + anomaly handlers: %lld ns per door open\n", (long long)(s_handler_ns / s_opens));
+    }
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
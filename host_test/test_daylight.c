@@ -0,0 +1,257 @@
+/* Sunset automation schedule over whole years
+ *
+ * Runs app_daylight_sched.c the way app_daylight.c drives it: wake at the
+ * next trigger (or after at most an hour), apply what is due, re-arm. The
+ * switches it produces must be exactly one ON at sunset + offset for every
+ * date with a sunset and one OFF at the local off time for every date,
+ * across DST changes (including an off time inside the skipped and the
+ * repeated hour) and at a polar latitude. esp_daylight is replaced by the
+ * NOAA sunrise equation.
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_daylight_sched.h"
+
+#define MAX_ARM_SEC     (60 * 60)       // DAYLIGHT_MAX_ARM_SEC
+#define MAX_EVENTS      1000
+
+static int s_failures;
+static int s_sun_calls;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            s_failures++; \
+        } \
+    } while (0)
+
+static double rad(double d)
+{
+    return d * M_PI / 180.0;
+}
+
+static double deg(double r)
+{
+    return r * 180.0 / M_PI;
+}
+
+/* NOAA sunrise equation (solar calculator spreadsheet), evaluated at local solar noon */
+static bool ref_sun(int year, int month, int day, double lat, double lon, time_t *sunrise, time_t *sunset)
+{
+    s_sun_calls++;
+    struct tm t = { .tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day, .tm_hour = 12 };
+    time_t noon_utc = timegm(&t);
+    double jd = noon_utc / 86400.0 + 2440587.5 - lon / 360.0;
+    double jc = (jd - 2451545.0) / 36525.0;
+    double l0 = fmod(280.46646 + jc * (36000.76983 + jc * 0.0003032), 360.0);
+    double m = 357.52911 + jc * (35999.05029 - 0.0001537 * jc);
+    double e = 0.016708634 - jc * (0.000042037 + 0.0000001267 * jc);
+    double c = sin(rad(m)) * (1.914602 - jc * (0.004817 + 0.000014 * jc)) +
+               sin(rad(2 * m)) * (0.019993 - 0.000101 * jc) + sin(rad(3 * m)) * 0.000289;
+    double omega = 125.04 - 1934.136 * jc;
+    double app_long = l0 + c - 0.00569 - 0.00478 * sin(rad(omega));
+    double eps0 = 23 + (26 + (21.448 - jc * (46.815 + jc * (0.00059 - jc * 0.001813))) / 60) / 60;
+    double eps = eps0 + 0.00256 * cos(rad(omega));
+    double decl = deg(asin(sin(rad(eps)) * sin(rad(app_long))));
+    double y = tan(rad(eps / 2)) * tan(rad(eps / 2));
+    double eqtime = 4 * deg(y * sin(2 * rad(l0)) - 2 * e * sin(rad(m)) +
+                            4 * e * y * sin(rad(m)) * cos(2 * rad(l0)) -
+                            0.5 * y * y * sin(4 * rad(l0)) - 1.25 * e * e * sin(2 * rad(m)));
+    double cos_ha = cos(rad(90.833)) / (cos(rad(lat)) * cos(rad(decl))) - tan(rad(lat)) * tan(rad(decl));
+    if (cos_ha < -1.0 || cos_ha > 1.0) {
+        return false;   // polar day or night
+    }
+    double ha = deg(acos(cos_ha));
+    double noon_min = 720 - 4 * lon - eqtime;
+    time_t midnight = noon_utc - 12 * 3600;
+    *sunrise = midnight + (time_t)((noon_min - 4 * ha) * 60);
+    *sunset = midnight + (time_t)((noon_min + 4 * ha) * 60);
+    return true;
+}
+
+typedef struct {
+    const char *name;
+    const char *tz;
+    double lat;
+    double lon;
+    int offset_min;
+    int off_minute;
+    int year;
+} scenario_t;
+
+typedef struct {
+    time_t at;
+    int state;
+} event_t;
+
+static time_t local_midnight(int year, int month, int day)
+{
+    struct tm t = { .tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day, .tm_isdst = -1 };
+    return mktime(&t);
+}
+
+static int cmp_time(const void *a, const void *b)
+{
+    time_t x = *(const time_t *)a, y = *(const time_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Expected triggers in [start, end): ON from the reference sunsets, OFF at the off time of every date */
+static int expected(const scenario_t *sc, int state, time_t start, time_t end, time_t *out)
+{
+    int n = 0;
+    for (int d = -1; d <= 367; d++) {
+        struct tm t = { .tm_year = sc->year - 1900, .tm_mday = 1 + d, .tm_hour = 12, .tm_isdst = -1 };
+        mktime(&t);
+        time_t at;
+        if (state) {
+            time_t rise, set;
+            if (!ref_sun(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, sc->lat, sc->lon, &rise, &set)) {
+                continue;
+            }
+            at = set + (time_t)sc->offset_min * 60;
+        } else {
+            t.tm_hour = sc->off_minute / 60;
+            t.tm_min = sc->off_minute % 60;
+            t.tm_isdst = -1;
+            at = mktime(&t);
+        }
+        if (at >= start && at < end) {
+            out[n++] = at;
+        }
+    }
+    qsort(out, n, sizeof(out[0]), cmp_time);
+    return n;
+}
+
+static void run(const scenario_t *sc)
+{
+    setenv("TZ", sc->tz, 1);
+    tzset();
+
+    app_daylight_sched_t sched = {
+        .offset_min = sc->offset_min,
+        .off_minute = sc->off_minute,
+        .latitude = sc->lat,
+        .longitude = sc->lon,
+        .sun = ref_sun,
+    };
+    app_daylight_sched_invalidate(&sched);
+
+    static event_t events[MAX_EVENTS];
+    int count = 0;
+    int wakeups = 0;
+    time_t start = local_midnight(sc->year, 1, 1);
+    time_t end = local_midnight(sc->year + 1, 1, 1);
+    s_sun_calls = 0;
+    for (time_t now = start - 1; now < end; wakeups++) {
+        now = app_daylight_sched_next(&sched, now, now + MAX_ARM_SEC);
+        if (now >= end) {
+            break;
+        }
+        int state = app_daylight_sched_due(&sched, now);
+        if (state >= 0 && count < MAX_EVENTS) {
+            events[count].at = now;
+            events[count++].state = state;
+        }
+    }
+    int computations = s_sun_calls;
+
+    int on_days = 0;
+    for (int state = 0; state <= 1; state++) {
+        static time_t want[MAX_EVENTS], got[MAX_EVENTS];
+        int n_want = expected(sc, state, start, end, want);
+        int n_got = 0;
+        for (int i = 0; i < count; i++) {
+            if (events[i].state == state) {
+                got[n_got++] = events[i].at;
+            }
+        }
+        CHECK(n_got == n_want, "%s: %d %s switches, expected %d", sc->name, n_got, state ? "ON" : "OFF", n_want);
+        for (int i = 0; i < n_got && i < n_want; i++) {
+            if (got[i] != want[i]) {
+                char buf[32];
+                struct tm lt;
+                localtime_r(&want[i], &lt);
+                strftime(buf, sizeof(buf), "%F %T %Z", &lt);
+                CHECK(got[i] == want[i], "%s: %s switch %d off by %lld s (expected %s)", sc->name,
+                      state ? "ON" : "OFF", i, (long long)(got[i] - want[i]), buf);
+                break;
+            }
+        }
+        if (state) {
+            on_days = n_want;
+        }
+    }
+    /* Yesterday/today/tomorrow cache: one computation per date, plus the dates around the year */
+    int days = (int)((end - start + 43200) / 86400);
+    CHECK(computations <= days + 3, "%s: %d sunset computations for %d days", sc->name, computations, days);
+
+    printf("%-28s %d ON, %d switches, %d wakeups, %d sunset computations\n",
+           sc->name, on_days, count, wakeups, computations);
+}
+
+/* Off time inside the skipped hour and inside the repeated hour: exactly one OFF on those dates */
+static void run_dst_off_time(const char *name, const char *tz, int year, int month, int day, int off_minute)
+{
+    setenv("TZ", tz, 1);
+    tzset();
+    app_daylight_sched_t sched = {
+        .offset_min = 0,
+        .off_minute = off_minute,
+        .latitude = 52.52,
+        .longitude = 13.40,
+        .sun = ref_sun,
+    };
+    app_daylight_sched_invalidate(&sched);
+
+    time_t start = local_midnight(year, month, day);
+    time_t end = local_midnight(year, month, day + 1);
+    int offs = 0;
+    for (time_t now = start; now < end;) {
+        now = app_daylight_sched_next(&sched, now, now + MAX_ARM_SEC);
+        if (now < end && app_daylight_sched_due(&sched, now) == 0) {
+            offs++;
+        }
+    }
+    CHECK(offs == 1, "%s: %d OFF switches on the DST change date", name, offs);
+    printf("%-28s %d OFF on the DST change date\n", name, offs);
+}
+
+int main(void)
+{
+    static const scenario_t scenarios[] = {
+        { "Berlin, sunset-15, off 23:00", "CET-1CEST,M3.5.0,M10.5.0/3", 52.52, 13.40, -15, 23 * 60, 2026 },
+        { "Berlin, sunset+90, off 01:00", "CET-1CEST,M3.5.0,M10.5.0/3", 52.52, 13.40, 90, 1 * 60, 2026 },
+        { "Berlin, sunset+180, 23:30", "CET-1CEST,M3.5.0,M10.5.0/3", 52.52, 13.40, 180, 23 * 60 + 30, 2026 },
+        { "Los Angeles, sunset+0, 22:30", "PST8PDT,M3.2.0,M11.1.0", 34.05, -118.24, 0, 22 * 60 + 30, 2026 },
+        { "Sydney, sunset-30, off 23:00", "AEST-10AEDT,M10.1.0,M4.1.0/3", -33.87, 151.21, -30, 23 * 60, 2026 },
+        { "Tromso, polar, off 23:00", "CET-1CEST,M3.5.0,M10.5.0/3", 69.65, 18.96, 0, 23 * 60, 2026 },
+        { "Tromso, polar, 2028 leap", "CET-1CEST,M3.5.0,M10.5.0/3", 69.65, 18.96, 60, 0, 2028 },
+    };
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        run(&scenarios[i]);
+    }
+
+    /* 2026: CEST starts 29 March (02:00 -> 03:00), ends 25 October (03:00 -> 02:00) */
+    run_dst_off_time("Berlin, off in skipped hour", "CET-1CEST,M3.5.0,M10.5.0/3", 2026, 3, 29, 2 * 60 + 30);
+    run_dst_off_time("Berlin, off in repeated hour", "CET-1CEST,M3.5.0,M10.5.0/3", 2026, 10, 25, 2 * 60 + 30);
+
+    /* The polar scenarios must actually hit dates without a sunset */
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    time_t rise, set;
+    CHECK(!ref_sun(2026, 6, 21, 69.65, 18.96, &rise, &set), "Tromso has a sunset at midsummer");
+    CHECK(!ref_sun(2026, 12, 21, 69.65, 18.96, &rise, &set), "Tromso has a sunset at midwinter");
+
+    printf("%s\n", s_failures ? "FAILED" : "OK");
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/* Device configuration blob: loading, lookups and boot-load benchmark
+ *
+ *   test_devcfg VECTOR_DIR      (blobs written by devcfg_vectors.py)
+ *
+ * Links the real app_devcfg.c. Each blob is copied to the start of an erased
+ * 32 KB "devcfg" partition, as parttool.py writes it, and mapped from there.
+ * Bad blobs must leave every getter on the built-in default. Then times the
+ * boot load (map, validate, CRC) and satellite lookups for 0 to 1000
+ * satellites.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_devcfg.h"
+#include "host_stubs.h"
+
+#define PARTITION_SIZE  0x8000
+#define ROUNDS          200
+
+static const char *s_dir;
+static uint8_t s_flash[PARTITION_SIZE];
+
+/* Erase the partition, write the blob file to it and load it */
+static esp_err_t flash(const char *name, size_t *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", s_dir, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("cannot open %s\n", path);
+        exit(2);
+    }
+    memset(s_flash, 0xff, sizeof(s_flash));
+    size_t n = fread(s_flash, 1, sizeof(s_flash), f);
+    fclose(f);
+    if (len) {
+        *len = n;
+    }
+    host_partition_clear();
+    host_partition_add(APP_DEVCFG_PARTITION, ESP_PARTITION_TYPE_DATA, s_flash, sizeof(s_flash));
+    return app_devcfg_init();
+}
+
+static bool str_is(const char *s, const char *want)
+{
+    return s && strcmp(s, want) == 0;
+}
+
+static void check_defaults(const char *what)
+{
+    CHECK(app_devcfg_pin(APP_DEVCFG_LED_GPIO, 2) == 2, "%s: LED pin not the default", what);
+    CHECK(str_is(app_devcfg_name(APP_DEVCFG_DOOR_NAME, "Door"), "Door"), "%s: door name not the default", what);
+    CHECK(app_devcfg_rules() == NULL, "%s: rules set", what);
+    CHECK(app_devcfg_zone_name(1) == NULL, "%s: zone name set", what);
+    CHECK(!app_devcfg_find_satellite((const uint8_t[6]){ 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56 }, NULL, NULL),
+          "%s: satellite found", what);
+}
+
+static void site(void)
+{
+    host_partition_clear();
+    CHECK(app_devcfg_init() == ESP_ERR_NOT_FOUND, "no partition");
+    check_defaults("no partition");
+
+    host_partition_add(APP_DEVCFG_PARTITION, ESP_PARTITION_TYPE_DATA, memset(s_flash, 0xff, sizeof(s_flash)),
+                       sizeof(s_flash));
+    CHECK(app_devcfg_init() == ESP_ERR_NOT_FOUND, "blank partition");
+    check_defaults("blank partition");
+    CHECK(host_partition_mapped() == 0, "blank partition left mapped");
+
+    size_t len;
+    CHECK(flash("site.bin", &len) == ESP_OK, "site.bin not loaded");
+    CHECK(app_devcfg_pin(APP_DEVCFG_LED_GPIO, 2) == 5 && app_devcfg_pin(APP_DEVCFG_IR_SENSOR_GPIO, 4) == 18 &&
+          app_devcfg_pin(APP_DEVCFG_BUZZER_GPIO, 21) == 19, "pins");
+    CHECK(str_is(app_devcfg_name(APP_DEVCFG_LIGHT_NAME, "Light"), "Hall Light") &&
+          str_is(app_devcfg_name(APP_DEVCFG_ALARM_NAME, "Alarm"), "House Alarm") &&
+          str_is(app_devcfg_name(APP_DEVCFG_DOOR_NAME, "Door"), "Front Door"), "device names");
+    CHECK(str_is(app_devcfg_rules(), "on door_open if after 22:00 and disarmed then light_on 120"), "rules");
+    CHECK(str_is(app_devcfg_zone_name(1), "Front") && str_is(app_devcfg_zone_name(2), "Garage"), "zone names");
+    CHECK(app_devcfg_zone_name(3) == NULL, "zone 3 has a name");
+
+    uint8_t zone = 0;
+    const char *name = NULL;
+    CHECK(app_devcfg_find_satellite((const uint8_t[6]){ 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56 }, &zone, &name) &&
+          zone == 1 && str_is(name, "Porch Window"), "satellite 12:34:56");
+    CHECK(app_devcfg_find_satellite((const uint8_t[6]){ 0x24, 0x0a, 0xc4, 0xff, 0x00, 0x02 }, &zone, &name) &&
+          zone == 0 && name == NULL, "satellite ff:00:02");
+    CHECK(!app_devcfg_find_satellite((const uint8_t[6]){ 0x24, 0x0a, 0xc4, 0x12, 0x34, 0x57 }, NULL, NULL),
+          "unknown satellite found");
+
+    /* Loading again releases the previous mapping; a bad blob drops the old config */
+    CHECK(app_devcfg_init() == ESP_OK && host_partition_mapped() == 1, "%d mappings after a reload",
+          host_partition_mapped());
+    s_flash[len - 2] ^= 0x01;
+    CHECK(app_devcfg_init() == ESP_ERR_INVALID_CRC, "corrupt string table accepted");
+    check_defaults("corrupt blob");
+    CHECK(host_partition_mapped() == 0, "corrupt blob left mapped");
+
+    CHECK(flash("site.bin", &len) == ESP_OK, "site.bin not reloaded");
+    host_partition_clear();
+    host_partition_add(APP_DEVCFG_PARTITION, ESP_PARTITION_TYPE_DATA, s_flash, len - 4);
+    CHECK(app_devcfg_init() == ESP_ERR_INVALID_SIZE, "blob larger than its partition accepted");
+    check_defaults("truncated blob");
+
+    /* GPIO 45 does not exist on the ESP32 */
+    CHECK(flash("badpin.bin", NULL) == ESP_OK, "badpin.bin not loaded");
+    CHECK(app_devcfg_pin(APP_DEVCFG_LED_GPIO, 2) == 2, "invalid LED pin used");
+    CHECK(app_devcfg_pin(APP_DEVCFG_IR_SENSOR_GPIO, 4) == 18, "IR sensor pin");
+    CHECK(app_devcfg_pin(APP_DEVCFG_BUZZER_GPIO, 21) == 21, "unset buzzer pin not the default");
+
+    /* GPIO 34-39 are input-only: fine for the IR sensor, not for the buzzer */
+    CHECK(flash("inpin.bin", NULL) == ESP_OK, "inpin.bin not loaded");
+    CHECK(app_devcfg_pin(APP_DEVCFG_LED_GPIO, 2) == 5, "LED pin");
+    CHECK(app_devcfg_pin(APP_DEVCFG_IR_SENSOR_GPIO, 4) == 35, "input-only IR sensor pin refused");
+    CHECK(app_devcfg_pin(APP_DEVCFG_BUZZER_GPIO, 21) == 21, "input-only buzzer pin used");
+}
+
+static void bench(int count)
+{
+    char file[32];
+    snprintf(file, sizeof(file), "sats_%d.bin", count);
+    size_t len;
+    CHECK(flash(file, &len) == ESP_OK, "%s not loaded", file);
+
+    int64_t t0 = host_wall_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        app_devcfg_init();
+    }
+    int64_t load_ns = (host_wall_ns() - t0) / ROUNDS;
+
+    /* Every satellite of the blob, looked up by id */
+    const app_devcfg_header_t *hdr = (const app_devcfg_header_t *)s_flash;
+    const app_devcfg_sat_t *sats = (const app_devcfg_sat_t *)(s_flash + hdr->sats_off);
+    CHECK(hdr->sat_count == count, "%s: %u satellites", file, hdr->sat_count);
+    int found = 0;
+    t0 = host_wall_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < hdr->sat_count; i++) {
+            uint8_t zone;
+            const char *name;
+            found += app_devcfg_find_satellite(sats[i].id, &zone, &name) && zone == sats[i].zone && name;
+        }
+    }
+    int64_t lookup_ns = count ? (host_wall_ns() - t0) / ((int64_t)ROUNDS * count) : 0;
+    CHECK(found == ROUNDS * count, "%s: %d of %d lookups found", file, found, ROUNDS * count);
+    printf("%4d satellites, %5zu bytes: boot load %6lld ns, lookup %3lld ns\n", count, len, (long long)load_ns,
+           (long long)lookup_ns);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: test_devcfg VECTOR_DIR\n");
+        return 2;
+    }
+    s_dir = argv[1];
+    site();
+    bench(0);
+    bench(100);
+    bench(1000);
+    CHECK(host_partition_mapped() == 1, "%d mappings held", host_partition_mapped());
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,377 @@
+/* Local control fast path: authenticated sessions over loopback TCP
+ *
+ * The real app_fastpath.c, app_actuator.c and app_home_key.c run as tasks in
+ * this process, on the host's clock, with the home key provisioned through
+ * NVS. The test thread is the client: it opens sessions on 127.0.0.1, signs
+ * each request with HMAC-SHA-256 of the session nonce as the wire format says,
+ * and times every round trip. Replayed and unauthenticated frames must be
+ * refused, and a peer that does not authenticate within 1.5 s must lose the
+ * session. Round trips include the actuator queue for light commands.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <nvs.h>
+#include <mbedtls/md.h>
+
+#include "app_fastpath.h"
+#include "app_actuator.h"
+#include "app_home_key.h"
+#include "app_payload.h"
+#include "app_priv.h"
+#include "host_stubs.h"
+
+#define SESSIONS    3
+#define COMMANDS    1000    // per session, light and status alternating
+#define AUTH_MS     1500
+
+static const uint8_t s_key[APP_HOME_KEY_LEN] = "fast path test home key 32 byte";
+
+/* ---------------- Node side ---------------- */
+
+static volatile bool s_light;
+static volatile bool s_alarm;
+
+esp_err_t app_light_set(bool on)
+{
+    s_light = on;
+    return ESP_OK;
+}
+
+bool app_light_get(void)
+{
+    return s_light;
+}
+
+esp_err_t app_alarm_set(bool enable, app_event_src_t src)
+{
+    s_alarm = enable;
+    return ESP_OK;
+}
+
+bool app_alarm_is_enabled(void)
+{
+    return s_alarm;
+}
+
+bool app_door_is_open(void)
+{
+    return false;
+}
+
+/* Payload encoders are measured by test_payload; a fixed body is enough here */
+static int fixed_payload(uint8_t *buf, size_t len)
+{
+    static const char body[] = "{\"ok\":true}";
+    if (len < sizeof(body) - 1) {
+        return -1;
+    }
+    memcpy(buf, body, sizeof(body) - 1);
+    return sizeof(body) - 1;
+}
+
+int app_payload_snapshot(app_payload_fmt_t fmt, uint8_t *buf, size_t len)
+{
+    return fixed_payload(buf, len);
+}
+
+int app_payload_history(app_payload_fmt_t fmt, size_t page, uint8_t *buf, size_t len)
+{
+    return fixed_payload(buf, len);
+}
+
+/* ---------------- Client ---------------- */
+
+typedef struct {
+    int sock;
+    uint8_t nonce[APP_FASTPATH_NONCE_LEN];
+} session_t;
+
+static int s_port;
+
+static bool recv_exact(int sock, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        ssize_t r = recv(sock, buf + got, len - got, 0);
+        if (r <= 0) {
+            return false;
+        }
+        got += r;
+    }
+    return true;
+}
+
+/* true once the server has closed the session */
+static bool closed_by_server(int sock)
+{
+    uint8_t b;
+    return recv(sock, &b, 1, 0) == 0;
+}
+
+static bool session_open(session_t *s)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    for (int tries = 0; tries < 100; tries++) {
+        s->sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (connect(s->sock, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            break;
+        }
+        close(s->sock);
+        s->sock = -1;
+        usleep(20 * 1000);     // server not listening yet
+    }
+    if (s->sock < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(s->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { 5, 0 };
+    setsockopt(s->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    uint8_t hello[APP_FASTPATH_HELLO_LEN];
+    if (!recv_exact(s->sock, hello, sizeof(hello)) || hello[0] != 'S' || hello[1] != 'H' ||
+        hello[2] != APP_FASTPATH_VERSION) {
+        close(s->sock);
+        return false;
+    }
+    memcpy(s->nonce, &hello[4], sizeof(s->nonce));
+    return true;
+}
+
+static void session_close(session_t *s)
+{
+    close(s->sock);
+}
+
+/* tag = HMAC-SHA256(home key, nonce || first 8 bytes)[0..15] */
+static void frame_build(const session_t *s, uint8_t cmd, uint8_t value, uint32_t seq,
+                        uint8_t frame[APP_FASTPATH_REQ_LEN])
+{
+    uint8_t mac[32];
+    frame[0] = 'S';
+    frame[1] = 'H';
+    frame[2] = cmd;
+    frame[3] = value;
+    for (int i = 0; i < 4; i++) {
+        frame[4 + i] = seq >> (8 * i);
+    }
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    mbedtls_md_hmac_starts(&ctx, s_key, sizeof(s_key));
+    mbedtls_md_hmac_update(&ctx, s->nonce, sizeof(s->nonce));
+    mbedtls_md_hmac_update(&ctx, frame, 8);
+    mbedtls_md_hmac_finish(&ctx, mac);
+    mbedtls_md_free(&ctx);
+    memcpy(&frame[8], mac, APP_HOME_TAG_LEN);
+}
+
+/* Send a frame and read the response (and payload); returns the status, -1 if none */
+static int exchange(const session_t *s, const uint8_t frame[APP_FASTPATH_REQ_LEN], uint8_t *state)
+{
+    uint8_t resp[APP_FASTPATH_RESP_LEN];
+    if (send(s->sock, frame, APP_FASTPATH_REQ_LEN, 0) != APP_FASTPATH_REQ_LEN ||
+        !recv_exact(s->sock, resp, sizeof(resp)) || resp[0] != 'S' || resp[1] != 'H' ||
+        memcmp(&resp[4], &frame[4], 4) != 0) {
+        return -1;
+    }
+    if (state) {
+        *state = resp[3];
+    }
+    if (resp[2] == APP_FASTPATH_OK &&
+        (frame[2] == APP_FASTPATH_CMD_SNAPSHOT || frame[2] == APP_FASTPATH_CMD_HISTORY)) {
+        uint8_t hdr[APP_FASTPATH_PAYLOAD_HDR], body[1024];
+        size_t len;
+        if (!recv_exact(s->sock, hdr, sizeof(hdr)) || (len = hdr[0] | hdr[1] << 8) > sizeof(body) ||
+            !recv_exact(s->sock, body, len)) {
+            return -1;
+        }
+    }
+    return resp[2];
+}
+
+static int request(const session_t *s, uint8_t cmd, uint8_t value, uint32_t seq, uint8_t *state)
+{
+    uint8_t frame[APP_FASTPATH_REQ_LEN];
+    frame_build(s, cmd, value, seq, frame);
+    return exchange(s, frame, state);
+}
+
+/* ---------------- Checks ---------------- */
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char *what, int64_t *ns, int n)
+{
+    qsort(ns, n, sizeof(*ns), cmp_i64);
+    printf("%-8s %5d round trips: p50 %4lld us, p90 %4lld us, p99 %4lld us, max %5lld us\n", what, n,
+           (long long)(ns[n / 2] / 1000), (long long)(ns[n * 9 / 10] / 1000), (long long)(ns[n * 99 / 100] / 1000),
+           (long long)(ns[n - 1] / 1000));
+}
+
+static void latency(void)
+{
+    static int64_t light_ns[SESSIONS * COMMANDS / 2], status_ns[SESSIONS * COMMANDS / 2];
+    int lights = 0, statuses = 0, failed = 0;
+    for (int n = 0; n < SESSIONS; n++) {
+        session_t s;
+        if (!session_open(&s)) {
+            CHECK(false, "session %d not opened", n);
+            return;
+        }
+        for (uint32_t seq = 1; seq <= COMMANDS; seq++) {
+            bool light = seq % 4 == 1;
+            uint8_t cmd = seq % 2 ? APP_FASTPATH_CMD_LIGHT : APP_FASTPATH_CMD_STATUS;
+            uint8_t state = 0;
+            int64_t t0 = host_wall_ns();
+            int status = request(&s, cmd, light, seq, &state);
+            int64_t ns = host_wall_ns() - t0;
+            if (cmd == APP_FASTPATH_CMD_LIGHT) {
+                light_ns[lights++] = ns;
+                failed += status != APP_FASTPATH_OK || !(state & APP_FASTPATH_STATE_LIGHT) != !light;
+            } else {
+                status_ns[statuses++] = ns;
+                failed += status != APP_FASTPATH_OK;
+            }
+        }
+        session_close(&s);
+    }
+    CHECK(failed == 0, "%d of %d commands failed or reported the wrong light state", failed, lights + statuses);
+    printf("%d sessions of %d commands on 127.0.0.1\n", SESSIONS, COMMANDS);
+    print_percentiles("light", light_ns, lights);
+    print_percentiles("status", status_ns, statuses);
+}
+
+static void replays(void)
+{
+    session_t s;
+    uint8_t captured[APP_FASTPATH_REQ_LEN];
+    CHECK(session_open(&s), "session not opened");
+    CHECK(request(&s, APP_FASTPATH_CMD_LIGHT, 1, 10, NULL) == APP_FASTPATH_OK, "light on refused");
+    CHECK(request(&s, APP_FASTPATH_CMD_LIGHT, 0, 10, NULL) == APP_FASTPATH_ERR_REPLAY, "repeated seq accepted");
+    CHECK(request(&s, APP_FASTPATH_CMD_LIGHT, 0, 9, NULL) == APP_FASTPATH_ERR_REPLAY, "older seq accepted");
+    CHECK(s_light, "light turned off by a replayed seq");
+    frame_build(&s, APP_FASTPATH_CMD_LIGHT, 0, 11, captured);
+    CHECK(exchange(&s, captured, NULL) == APP_FASTPATH_OK, "light off refused");
+    CHECK(exchange(&s, captured, NULL) == APP_FASTPATH_ERR_REPLAY, "captured frame replayed in its session");
+    CHECK(request(&s, APP_FASTPATH_CMD_LIGHT, 1, 12, NULL) == APP_FASTPATH_OK, "light on refused");
+    session_close(&s);
+
+    /* The next session has a new nonce: the frame captured before no longer verifies */
+    CHECK(session_open(&s), "session not opened");
+    CHECK(exchange(&s, captured, NULL) == APP_FASTPATH_ERR_AUTH, "frame from another session accepted");
+    CHECK(closed_by_server(s.sock), "session kept open after a failed authentication");
+    CHECK(s_light, "light turned off by a frame from another session");
+    session_close(&s);
+}
+
+static void unauthenticated(void)
+{
+    session_t s;
+    uint8_t frame[APP_FASTPATH_REQ_LEN];
+    CHECK(session_open(&s), "session not opened");
+    frame_build(&s, APP_FASTPATH_CMD_ALARM, 1, 1, frame);
+    frame[8] ^= 0x01;
+    CHECK(exchange(&s, frame, NULL) == APP_FASTPATH_ERR_AUTH, "bad tag accepted");
+    CHECK(closed_by_server(s.sock), "session kept open after a bad tag");
+    CHECK(!s_alarm, "alarm armed by an unauthenticated frame");
+    session_close(&s);
+
+    /* Authenticated once, a bad frame still ends the session */
+    CHECK(session_open(&s), "session not opened");
+    CHECK(request(&s, APP_FASTPATH_CMD_STATUS, 0, 1, NULL) == APP_FASTPATH_OK, "status refused");
+    frame_build(&s, APP_FASTPATH_CMD_ALARM, 1, 2, frame);
+    frame[APP_FASTPATH_REQ_LEN - 1] ^= 0x80;
+    CHECK(exchange(&s, frame, NULL) == APP_FASTPATH_ERR_AUTH, "bad tag accepted after authentication");
+    CHECK(closed_by_server(s.sock), "session kept open after a bad tag");
+    CHECK(!s_alarm, "alarm armed by an unauthenticated frame");
+    session_close(&s);
+}
+
+/* ms until the server closes a session that sends nothing, or trickles a frame */
+static int auth_deadline(bool trickle)
+{
+    session_t s;
+    uint8_t frame[APP_FASTPATH_REQ_LEN];
+    if (!session_open(&s)) {
+        return -1;
+    }
+    frame_build(&s, APP_FASTPATH_CMD_STATUS, 0, 1, frame);
+    int64_t t0 = host_wall_ns();
+    int ms = -1;
+    if (!trickle) {
+        struct timeval tv = { 3, 0 };
+        setsockopt(s.sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (closed_by_server(s.sock)) {
+            ms = (host_wall_ns() - t0) / 1000000;
+        }
+    }
+    for (int i = 0; trickle && i < APP_FASTPATH_REQ_LEN; i++) {
+        send(s.sock, &frame[i], 1, MSG_NOSIGNAL);
+        struct timeval tv = { 0, 100 * 1000 };
+        setsockopt(s.sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (closed_by_server(s.sock)) {
+            ms = (host_wall_ns() - t0) / 1000000;
+            break;
+        }
+    }
+    session_close(&s);
+    return ms;
+}
+
+static void deadlines(void)
+{
+    int idle = auth_deadline(false);
+    CHECK(idle >= AUTH_MS - 100 && idle <= AUTH_MS + 500, "silent peer closed after %d ms", idle);
+    int slow = auth_deadline(true);
+    CHECK(slow >= AUTH_MS - 100 && slow <= AUTH_MS + 500, "trickling peer closed after %d ms", slow);
+    printf("unauthenticated sessions closed after %d ms (silent) and %d ms (one byte per 100 ms)\n", idle, slow);
+
+    /* The server is free for the next client */
+    session_t s;
+    CHECK(session_open(&s) && request(&s, APP_FASTPATH_CMD_SNAPSHOT, 0, 1, NULL) == APP_FASTPATH_OK,
+          "no snapshot after the deadlines");
+    session_close(&s);
+}
+
+int main(void)
+{
+    s_port = host_lan_base_port(11);
+    host_lan_join(s_port, 1, 0);
+    host_clock_realtime();
+
+    host_task_lock();
+    nvs_handle_t nvs;
+    nvs_open("home", NVS_READWRITE, &nvs);
+    nvs_set_blob(nvs, "key", s_key, sizeof(s_key));
+    nvs_commit(nvs);
+    nvs_close(nvs);
+    CHECK(app_home_key_init(NULL) == ESP_OK && app_home_key_available(), "home key not loaded");
+    CHECK(app_actuator_init() == ESP_OK, "actuator init");
+    CHECK(app_fastpath_start() == ESP_OK, "fast path start");
+    host_task_unlock();
+
+    latency();
+    replays();
+    unauthenticated();
+    deadlines();
+
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+/* Reconnect backoff of a fleet of nodes against one broker
+ *
+ * Forty node processes run the real app_conn.c, each on its own clock running
+ * SPEED times faster than the host's, and connect to a broker stand-in in this
+ * process that accepts at most CAPACITY connects per second and refuses the
+ * rest, as a broker busy with TLS handshakes would. The nodes boot together,
+ * as after a power cut, and later the broker goes away for a minute and drops
+ * every session. The fleet must come back in bounded time without hitting the
+ * broker all in the same second.
+ *
+ * The same scenario is then run by a second fleet without app_conn: each node
+ * connects at boot and retries FIXED_RETRY_S after every refusal or drop, as
+ * the MQTT client does on its own, and its numbers are printed for comparison.
+ * Wi-Fi is not simulated: its re-association stays with app_network and is not
+ * jittered.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include <esp_event.h>
+#include <esp_timer.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+
+#include "app_conn.h"
+#include "host_stubs.h"
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+#define NODES           40
+#define SPEED           20      // fake seconds per host second
+#define CAPACITY        4       // connects the broker accepts per second
+#define OUTAGE_S        60
+#define FIXED_RETRY_S   10      // the MQTT client's own reconnect interval
+#define MAX_S           400
+
+/* ---------------- Node process ---------------- */
+
+static int s_broker_port;
+
+static void network_up(void)
+{
+    esp_rmaker_start();     // RainMaker makes the first connect itself
+}
+
+static void node_setup(int index)
+{
+    host_clock_speed(SPEED);
+    host_clock_set(2000000);
+    host_random_seed(index + 1);
+    host_cloud_broker(s_broker_port);
+    host_clock_realtime();
+    CHECK(app_conn_start(network_up) == ESP_OK, "node %d: conn start", index);
+}
+
+/*   state: online attempts failures. The Insights metrics must follow the stats. */
+static void node_handle(const char *cmd, char *reply, size_t reply_len)
+{
+    app_conn_stats_t st;
+    int64_t attempts = 0, failures = 0;
+    app_conn_get_stats(&st);
+    CHECK(host_metric("conn_attempts", &attempts) >= 0 && host_metric("conn_failures", &failures) >= 0 &&
+          host_metric("conn_detect_ms", &(int64_t){ 0 }) >= 0, "metrics not registered");
+    CHECK(attempts == st.mqtt_attempts && failures == st.mqtt_failures, "metrics %lld/%lld, stats %lu/%lu",
+          (long long)attempts, (long long)failures, (unsigned long)st.mqtt_attempts,
+          (unsigned long)st.mqtt_failures);
+    snprintf(reply, reply_len, "%d %lu %lu", app_conn_is_online(), (unsigned long)st.mqtt_attempts,
+             (unsigned long)st.mqtt_failures);
+}
+
+/* The MQTT client on its own: reconnect FIXED_RETRY_S after a refusal or a drop */
+static esp_timer_handle_t s_retry;
+
+static void retry_cb(void *arg)
+{
+    esp_rmaker_mqtt_connect();
+}
+
+static void fixed_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == RMAKER_MQTT_EVENT_DISCONNECTED) {
+        esp_timer_start_once(s_retry, FIXED_RETRY_S * 1000000LL);
+    }
+}
+
+static void fixed_setup(int index)
+{
+    host_clock_speed(SPEED);
+    host_clock_set(2000000);
+    host_cloud_broker(s_broker_port);
+    host_clock_realtime();
+    esp_timer_create(&(esp_timer_create_args_t){ .callback = retry_cb, .name = "retry" }, &s_retry);
+    esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, fixed_event_handler, NULL);
+    esp_rmaker_start();
+}
+
+/*   state: online attempts (after the first connect) */
+static void fixed_handle(const char *cmd, char *reply, size_t reply_len)
+{
+    snprintf(reply, reply_len, "%d %d 0", host_cloud_session_up(), host_cloud.connects - 1);
+}
+
+/* ---------------- Broker ---------------- */
+
+static host_node_t s_nodes[NODES];
+static int s_sock;
+static struct sockaddr_in s_peers[NODES];   // the nodes, in order of first connect
+static bool s_connected[NODES];
+static int s_peer_count;
+static bool s_up = true;
+static int64_t s_t0;
+static int s_hist[MAX_S];                   // connects per fake second
+static int s_accepted_in, s_accepted_s = -1;
+
+static int fake_s(void)
+{
+    int s = (host_wall_ns() - s_t0) * SPEED / 1000000000LL;
+    return s < MAX_S ? s : MAX_S - 1;
+}
+
+static int connected(void)
+{
+    int n = 0;
+    for (int i = 0; i < s_peer_count; i++) {
+        n += s_connected[i];
+    }
+    return n;
+}
+
+static int peer(const struct sockaddr_in *from)
+{
+    for (int i = 0; i < s_peer_count; i++) {
+        if (s_peers[i].sin_port == from->sin_port) {
+            return i;
+        }
+    }
+    if (s_peer_count == NODES) {
+        return -1;
+    }
+    s_peers[s_peer_count] = *from;
+    return s_peer_count++;
+}
+
+static void answer(int i, const char *msg)
+{
+    sendto(s_sock, msg, 1, 0, (struct sockaddr *)&s_peers[i], sizeof(s_peers[i]));
+}
+
+/* Serve connects until the fake second `until`, or until every node is
+ * connected if all is set. Returns the fake second it stopped at. */
+static int serve(int until, bool all)
+{
+    while (fake_s() < until && !(all && connected() == NODES)) {
+        char msg[8];
+        struct sockaddr_in from;
+        socklen_t len = sizeof(from);
+        if (recvfrom(s_sock, msg, sizeof(msg), 0, (struct sockaddr *)&from, &len) <= 0) {
+            continue;
+        }
+        int i = peer(&from), now = fake_s();
+        if (i < 0) {
+            continue;
+        }
+        if (msg[0] == 'D') {
+            s_connected[i] = false;
+            continue;
+        }
+        s_hist[now]++;
+        if (now != s_accepted_s) {
+            s_accepted_s = now;
+            s_accepted_in = 0;
+        }
+        if (s_up && s_accepted_in < CAPACITY) {
+            s_accepted_in++;
+            s_connected[i] = true;
+            answer(i, "A");
+        } else {
+            answer(i, "R");
+        }
+    }
+    return fake_s();
+}
+
+static void open_broker(void)
+{
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    bind(s_sock, (struct sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(s_sock, (struct sockaddr *)&addr, &len);
+    s_broker_port = ntohs(addr.sin_port);
+    struct timeval tv = { 0, 2000 };
+    setsockopt(s_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+/* Highest number of connects in one second of [from, to), and their total */
+static int peak(int from, int to, int *total)
+{
+    int max = 0;
+    *total = 0;
+    for (int s = from; s < to; s++) {
+        *total += s_hist[s];
+        if (s_hist[s] > max) {
+            max = s_hist[s];
+        }
+    }
+    return max;
+}
+
+typedef struct {
+    int boot_s, boot_connects, boot_peak;
+    int outage_connects;
+    int back_s, back_connects, back_peak;
+    unsigned long attempts, failures;       // reported by the nodes
+} fleet_run_t;
+
+/* Boot a fleet, take the broker away for OUTAGE_S and serve it back */
+static fleet_run_t run(void (*setup)(int index), host_node_handler_t handle)
+{
+    fleet_run_t r = { 0 };
+    memset(s_hist, 0, sizeof(s_hist));
+    memset(s_connected, 0, sizeof(s_connected));
+    s_peer_count = 0;
+    s_accepted_s = -1;
+    s_up = true;
+
+    /* Power comes back: every node boots at once */
+    s_t0 = host_wall_ns();
+    for (int i = 0; i < NODES; i++) {
+        CHECK(host_node_spawn(&s_nodes[i], i, setup, handle), "spawn node %d", i);
+    }
+    r.boot_s = serve(MAX_S / 2, true);
+    r.boot_peak = peak(0, r.boot_s + 1, &r.boot_connects);
+    CHECK(connected() == NODES, "%d of %d nodes connected after boot", connected(), NODES);
+
+    /* The broker goes away and every session drops */
+    s_up = false;
+    for (int i = 0; i < s_peer_count; i++) {
+        if (s_connected[i]) {
+            s_connected[i] = false;
+            answer(i, "X");
+        }
+    }
+    int down_s = fake_s();
+    serve(down_s + OUTAGE_S, false);
+    int up_s = fake_s();
+    peak(down_s, up_s, &r.outage_connects);
+
+    s_up = true;
+    int back_s = serve(MAX_S, true);
+    r.back_peak = peak(up_s, back_s + 1, &r.back_connects);
+    r.back_s = back_s - up_s;
+    CHECK(connected() == NODES, "%d of %d nodes back after the outage", connected(), NODES);
+
+    for (int i = 0; i < NODES; i++) {
+        int online;
+        unsigned long a, f;
+        if (sscanf(host_node_cmd(&s_nodes[i], "state"), "%d %lu %lu", &online, &a, &f) == 3) {
+            r.attempts += a;
+            r.failures += f;
+        }
+    }
+    for (int i = 0; i < NODES; i++) {
+        CHECK(host_node_stop(&s_nodes[i]), "node %d reported failures", i);
+    }
+    return r;
+}
+
+static void print_run(const char *name, const fleet_run_t *r)
+{
+    printf("%s boot: %d nodes connected after %d s, %d connects, at most %d in one second\n", name, NODES,
+           r->boot_s, r->boot_connects, r->boot_peak);
+    printf("%s outage: %d connects in %d s\n", name, r->outage_connects, OUTAGE_S);
+    printf("%s recovery: %d nodes back %d s after the broker, %d connects, at most %d in one second\n", name,
+           NODES, r->back_s, r->back_connects, r->back_peak);
+}
+
+int main(void)
+{
+    signal(SIGPIPE, SIG_IGN);
+    open_broker();
+
+    fleet_run_t jitter = run(node_setup, node_handle);
+    print_run("app_conn", &jitter);
+    CHECK(jitter.back_s <= CONFIG_APP_CONN_BACKOFF_CAP_MS / 1000 + 5, "fleet back only %d s after the broker",
+          jitter.back_s);
+    CHECK(jitter.back_peak <= NODES / 2, "%d connects in one second after the outage", jitter.back_peak);
+    printf("app_conn: %lu reconnect attempts, %lu failed, over %d nodes\n", jitter.attempts, jitter.failures, NODES);
+
+    /* The same broker and outage with the MQTT client's fixed interval */
+    char name[16];
+    snprintf(name, sizeof(name), "fixed %d s", FIXED_RETRY_S);
+    fleet_run_t fixed = run(fixed_setup, fixed_handle);
+    print_run(name, &fixed);
+    printf("%s: %lu reconnect attempts over %d nodes\n", name, fixed.attempts, NODES);
+
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
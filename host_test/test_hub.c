@@ -0,0 +1,211 @@
+/* Hub mode: satellites scaling past the zones, report-to-ACK latency
+ *
+ * The real app_hub.c and its UDP transport run as tasks on the host; the test
+ * is the satellites, sending authenticated reports to the hub's port on
+ * 127.0.0.1 one at a time and timing each until its ACK, as
+ * tools/satellite_sim.py does against a device. Satellites without a devcfg
+ * zone fill zones 1..APP_ZONE_MAX and the rest share the last one, so all of
+ * CONFIG_APP_HUB_MAX_SATELLITES are accepted and one in the shared zone still
+ * triggers the alarm. Prints latency per satellite count and the hub's RAM
+ * per satellite.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <lwip/sockets.h>
+
+#include "app_hub.h"
+#include "app_home_key.h"
+#include "app_events.h"
+#include "app_arming.h"
+#include "app_siren.h"
+#include "app_alert.h"
+#include "app_nodecfg.h"
+#include "app_report.h"
+#include "app_priv.h"
+#include "host_stubs.h"
+
+#define ROUNDS          20
+#define ACK_TIMEOUT_MS  500
+
+static const int s_counts[] = { 8, 16, 32, CONFIG_APP_HUB_MAX_SATELLITES };
+
+/* ---------------- Alarm stand-ins ---------------- */
+
+static bool s_armed;
+static int s_triggers;
+static uint8_t s_trigger_zone;
+
+bool app_alarm_is_enabled(void)
+{
+    return s_armed;
+}
+
+uint32_t app_arming_triggered(uint32_t changed_zones)
+{
+    return changed_zones;   // away: every zone is watched
+}
+
+void app_siren_trigger(void)
+{
+}
+
+void app_siren_clear(void)
+{
+}
+
+esp_err_t app_alert_raise(app_alert_prio_t prio, uint8_t zone, const char *what)
+{
+    s_triggers++;
+    s_trigger_zone = zone;
+    return ESP_OK;
+}
+
+esp_err_t app_event_post_zone(app_event_id_t id, app_event_src_t src, uint8_t zone)
+{
+    return ESP_OK;
+}
+
+esp_err_t app_nodecfg_report(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t app_report_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    return esp_rmaker_device_add_param(device, param);
+}
+
+esp_err_t app_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    return ESP_OK;
+}
+
+/* ---------------- Satellites ---------------- */
+
+typedef struct {
+    uint8_t id[6];
+    uint32_t seq;
+    bool open;
+} sat_t;
+
+static sat_t s_sats[CONFIG_APP_HUB_MAX_SATELLITES + 1];
+static int s_sock;
+static struct sockaddr_in s_hub;
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+/* Toggle the door and report it; returns ns until the ACK, -1 if none came */
+static int64_t report(sat_t *sat)
+{
+    uint8_t frame[APP_HUB_FRAME_LEN] = { 'S', 'T', APP_HUB_VERSION, APP_HUB_REPORT };
+    sat->open = !sat->open;
+    memcpy(&frame[4], sat->id, 6);
+    put_le32(&frame[10], ++sat->seq);
+    frame[14] = sat->open ? APP_HUB_STATE_OPEN : 0;
+    frame[15] = 90;
+    app_home_key_tag(NULL, 0, frame, APP_HUB_HDR_LEN, &frame[APP_HUB_HDR_LEN]);
+
+    int64_t t0 = host_wall_ns();
+    sendto(s_sock, frame, sizeof(frame), 0, (struct sockaddr *)&s_hub, sizeof(s_hub));
+    uint8_t ack[64];
+    int len;
+    while ((len = recv(s_sock, ack, sizeof(ack), 0)) > 0) {
+        if (len == APP_HUB_FRAME_LEN && ack[3] == APP_HUB_ACK && memcmp(&ack[4], &frame[4], 10) == 0 &&
+            app_home_key_verify(NULL, 0, ack, APP_HUB_HDR_LEN, &ack[APP_HUB_HDR_LEN])) {
+            return host_wall_ns() - t0;
+        }
+    }
+    return -1;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Every one of the first count satellites reports ROUNDS times, one at a time */
+static void bench(int count)
+{
+    static int64_t ns[ROUNDS * CONFIG_APP_HUB_MAX_SATELLITES];
+    int n = 0, lost = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < count; i++) {
+            int64_t t = report(&s_sats[i]);
+            if (t < 0) {
+                lost++;
+            } else {
+                ns[n++] = t;
+            }
+        }
+    }
+    CHECK(lost == 0, "%d sats: %d reports without ACK", count, lost);
+    if (!n) {
+        return;
+    }
+    qsort(ns, n, sizeof(ns[0]), cmp_i64);
+    printf("%4d sats: %4d reports, report-to-ACK p50 %4lld us, p99 %4lld us, max %5lld us\n", count, n,
+           (long long)(ns[n / 2] / 1000), (long long)(ns[n * 99 / 100] / 1000), (long long)(ns[n - 1] / 1000));
+}
+
+int main(void)
+{
+    int port = host_lan_base_port(5);
+    host_lan_join(port, 1, 0);
+    host_clock_realtime();
+    for (int i = 0; i <= CONFIG_APP_HUB_MAX_SATELLITES; i++) {
+        memcpy(s_sats[i].id, (const uint8_t[6]){ 0x02, 0x53, 0x49, 0, 0, i }, 6);
+    }
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct timeval tv = { .tv_usec = ACK_TIMEOUT_MS * 1000 };
+    setsockopt(s_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    s_hub = (struct sockaddr_in) {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    host_task_lock();
+    CHECK(app_hub_init(NULL) == ESP_OK && app_hub_start() == ESP_OK, "hub start");
+    host_task_unlock();
+
+    /* First reports register the satellites; each count adds the ones after the last */
+    for (size_t c = 0; c < sizeof(s_counts) / sizeof(s_counts[0]); c++) {
+        bench(s_counts[c]);
+    }
+
+    app_hub_stats_t st;
+    app_hub_get_stats(&st);
+    int own = APP_ZONE_MAX - 1;     // zones 1..29 to themselves, the rest in zone 30
+    CHECK(st.satellites == CONFIG_APP_HUB_MAX_SATELLITES, "%lu satellites registered",
+          (unsigned long)st.satellites);
+    CHECK(st.shared_zone == (uint32_t)(CONFIG_APP_HUB_MAX_SATELLITES - own), "%lu in the shared zone",
+          (unsigned long)st.shared_zone);
+
+    /* A satellite in the shared zone triggers the alarm for that zone */
+    s_armed = true;
+    sat_t *last = &s_sats[CONFIG_APP_HUB_MAX_SATELLITES - 1];
+    if (last->open) {
+        report(last);
+    }
+    report(last);
+    CHECK(s_triggers == 1 && s_trigger_zone == APP_ZONE_MAX, "%d triggers, zone %d", s_triggers, s_trigger_zone);
+
+    /* The registry is full: one more gets no ACK */
+    CHECK(report(&s_sats[CONFIG_APP_HUB_MAX_SATELLITES]) < 0, "satellite past the registry acknowledged");
+
+    printf("per satellite: %lu bytes of hub RAM (slot reserved at build time, %d-bit pointers here), "
+           "%d bytes of NVS; the RainMaker device heap is logged by the hub on target\n",
+           (unsigned long)st.slot_size, (int)sizeof(void *) * 8, 8 + 4);
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,274 @@
+/* LAN alarm sync between node processes, and replays of captured frames
+ *
+ * Each node is a process running the real app_lansync.c on the loopback LAN
+ * of host_lan.c, with its NVS kept in a file so it can be restarted. The test
+ * process listens on the LAN like any other host would, captures the frames
+ * and sends them again to the nodes, as an attacker on the Wi-Fi could.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include <esp_event.h>
+
+#include "app_lansync.h"
+#include "app_events.h"
+#include "app_siren.h"
+#include "app_priv.h"
+#include "host_stubs.h"
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+#define NODES       4
+#define LAN_PORTS   (NODES + 1)     // the last port is the test's own
+#define EPOCH       1772409600
+#define SETTLE_MS   200
+
+/* ---------------- Node process ---------------- */
+
+static bool s_armed;
+static int s_sirens;
+
+bool app_alarm_is_enabled(void)
+{
+    return s_armed;
+}
+
+esp_err_t app_alarm_set(bool enable, app_event_src_t src)
+{
+    s_armed = enable;
+    return ESP_OK;
+}
+
+void app_siren_trigger(void)
+{
+    s_sirens++;
+}
+
+esp_err_t app_event_post_zone(app_event_id_t id, app_event_src_t src, uint8_t zone)
+{
+    app_event_data_t data = { .src = src, .zone = zone };
+    return esp_event_post(APP_EVENT, id, &data, sizeof(data), 0);
+}
+
+esp_err_t app_event_post(app_event_id_t id, app_event_src_t src)
+{
+    return app_event_post_zone(id, src, 0);
+}
+
+static int s_base_port;
+static char s_nvs_dir[64];
+
+static void node_setup(int index)
+{
+    char path[96];
+    snprintf(path, sizeof(path), "%s/node%d.nvs", s_nvs_dir, index);
+    host_nvs_file(path);
+    host_lan_join(s_base_port, LAN_PORTS, index);
+    host_mac_set((const uint8_t[6]){ 0x02, 0, 0, 0, 0, index + 1 });
+    host_clock_set(2000000);   // boot takes a while
+    host_epoch_set(EPOCH);
+    CHECK(app_lansync_start() == ESP_OK, "node %d: start", index);
+}
+
+/*   epoch T | sync 0/1 | arm | disarm | trigger Z | tick MS | state */
+static void node_handle(const char *cmd, char *reply, size_t reply_len)
+{
+    long v;
+    if (sscanf(cmd, "epoch %ld", &v) == 1) {
+        host_epoch_set((time_t)v);
+    } else if (sscanf(cmd, "sync %ld", &v) == 1) {
+        host_time_synced = v;
+    } else if (strcmp(cmd, "arm") == 0) {
+        s_armed = true;
+    } else if (strcmp(cmd, "disarm") == 0) {
+        s_armed = false;
+        app_event_post(APP_EVENT_ALARM_DISARMED, APP_EVENT_SRC_USER);
+    } else if (sscanf(cmd, "trigger %ld", &v) == 1) {
+        s_sirens++;
+        app_event_post_zone(APP_EVENT_ALARM_TRIGGERED, APP_EVENT_SRC_SENSOR, v);
+    } else if (sscanf(cmd, "tick %ld", &v) == 1) {
+        host_clock_advance(v * 1000);
+    }
+    snprintf(reply, reply_len, "%d %d", s_armed, s_sirens);
+}
+
+/* ---------------- Test process ---------------- */
+
+static host_node_t s_nodes[NODES];
+static int s_sock;
+
+static void start(int i)
+{
+    CHECK(host_node_spawn(&s_nodes[i], i, node_setup, node_handle), "spawn node %d", i);
+}
+
+static void stop(int i)
+{
+    CHECK(host_node_stop(&s_nodes[i]), "node %d reported failures", i);
+}
+
+static void state(int i, int *armed, int *sirens)
+{
+    sscanf(host_node_cmd(&s_nodes[i], "state"), "%d %d", armed, sirens);
+}
+
+static bool armed(int i)
+{
+    int a, s;
+    state(i, &a, &s);
+    return a;
+}
+
+static int sirens(int i)
+{
+    int a, s;
+    state(i, &a, &s);
+    return s;
+}
+
+static void settle(void)
+{
+    usleep(SETTLE_MS * 1000);
+}
+
+/* Wait up to a second for node i to reach armed/sirens; returns the ms it took */
+static int wait_for(int i, int want_armed, int want_sirens)
+{
+    int64_t t0 = host_wall_ns();
+    for (int ms = 0; ms < 1000; ms++) {
+        int a, s;
+        state(i, &a, &s);
+        if (a == want_armed && s == want_sirens) {
+            return (int)((host_wall_ns() - t0) / 1000000);
+        }
+        usleep(1000);
+    }
+    return -1;
+}
+
+/* Next frame the test port heard, false if none within a second */
+static bool capture(uint8_t *frame)
+{
+    return recv(s_sock, frame, APP_LANSYNC_FRAME_LEN, 0) == APP_LANSYNC_FRAME_LEN;
+}
+
+static void replay(int i, const uint8_t *frame)
+{
+    struct sockaddr_in to = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_base_port + i),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    sendto(s_sock, frame, APP_LANSYNC_FRAME_LEN, 0, (struct sockaddr *)&to, sizeof(to));
+}
+
+static void open_lan(void)
+{
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    for (int tries = 0; tries < 50; tries++) {
+        s_base_port = host_lan_base_port(7 + tries * 10);
+        struct sockaddr_in addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(s_base_port + NODES),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        };
+        if (bind(s_sock, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            break;
+        }
+    }
+    struct timeval tv = { 1, 0 };
+    setsockopt(s_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+int main(void)
+{
+    open_lan();
+    snprintf(s_nvs_dir, sizeof(s_nvs_dir), "/tmp/test_lansync.XXXXXX");
+    if (!mkdtemp(s_nvs_dir)) {
+        return 2;
+    }
+    for (int i = 0; i < 3; i++) {
+        start(i);
+        host_node_cmd(&s_nodes[i], "sync 1");
+        host_node_cmd(&s_nodes[i], "arm");
+    }
+
+    /* An intrusion on node 0 sounds the sirens of 1 and 2, once despite the repeats */
+    host_node_cmd(&s_nodes[0], "trigger 3");
+    int ms1 = wait_for(1, 1, 1), ms2 = wait_for(2, 1, 1);
+    CHECK(ms1 >= 0 && ms2 >= 0, "trigger did not reach the other nodes");
+    host_node_cmd(&s_nodes[0], "tick 100");
+    settle();
+    CHECK(sirens(1) == 1 && sirens(2) == 1, "repeats applied again: %d, %d sirens", sirens(1), sirens(2));
+    uint8_t triggered[APP_LANSYNC_FRAME_LEN], frame[APP_LANSYNC_FRAME_LEN];
+    CHECK(capture(triggered) && triggered[3] == APP_LANSYNC_TRIGGERED, "no TRIGGERED frame on the LAN");
+    for (int n = 1; n < APP_LANSYNC_REPEATS; n++) {
+        CHECK(capture(frame) && memcmp(frame, triggered, sizeof(frame)) == 0, "repeat %d differs or is missing", n);
+    }
+    printf("trigger reached the other nodes in %d and %d ms\n", ms1, ms2);
+
+    /* Disarming on node 0 disarms the others */
+    host_node_cmd(&s_nodes[0], "disarm");
+    CHECK(wait_for(1, 0, 1) >= 0 && wait_for(2, 0, 1) >= 0, "disarm did not reach the other nodes");
+    uint8_t disarmed[APP_LANSYNC_FRAME_LEN];
+    CHECK(capture(disarmed) && disarmed[3] == APP_LANSYNC_DISARMED, "no DISARMED frame on the LAN");
+
+    /* Replayed while the nodes are up: older than the last seq */
+    host_node_cmd(&s_nodes[1], "arm");
+    host_node_cmd(&s_nodes[2], "arm");
+    replay(1, disarmed);
+    replay(2, disarmed);
+    settle();
+    CHECK(armed(1) && armed(2), "replayed DISARMED applied on a running node");
+
+    /* Replayed after a reboot, before the clock is set: the peer table was kept */
+    stop(2);
+    start(2);
+    host_node_cmd(&s_nodes[2], "arm");
+    replay(2, disarmed);
+    replay(2, triggered);
+    settle();
+    CHECK(armed(2), "replayed DISARMED applied after a reboot without clock");
+    CHECK(sirens(2) == 0, "replayed TRIGGERED applied after a reboot");
+
+    /* A node that never heard node 0 and has no clock cannot tell the frame is old */
+    start(3);
+    host_node_cmd(&s_nodes[3], "arm");
+    replay(3, disarmed);
+    settle();
+    CHECK(armed(3), "unverifiable DISARMED applied by a new node");
+    replay(3, triggered);
+    CHECK(wait_for(3, 1, 1) >= 0, "a new node without clock ignored TRIGGERED");
+
+    /* With its clock set an hour later, the captured frame is stale */
+    host_node_cmd(&s_nodes[3], "epoch %ld", (long)EPOCH + 3600);
+    host_node_cmd(&s_nodes[3], "sync 1");
+    replay(3, disarmed);
+    settle();
+    CHECK(armed(3), "stale DISARMED applied");
+
+    /* A fresh DISARMED still reaches everyone, including the rebooted node without clock */
+    host_node_cmd(&s_nodes[0], "epoch %ld", (long)EPOCH + 3600);
+    host_node_cmd(&s_nodes[0], "arm");
+    host_node_cmd(&s_nodes[0], "disarm");
+    CHECK(wait_for(1, 0, 1) >= 0, "node 1 not disarmed");
+    CHECK(wait_for(2, 0, 0) >= 0, "rebooted node 2 not disarmed");
+    CHECK(wait_for(3, 0, 1) >= 0, "node 3 not disarmed");
+
+    for (int i = 0; i < NODES; i++) {
+        stop(i);
+    }
+    char cmd[96];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", s_nvs_dir);
+    if (system(cmd) != 0) {
+        printf("could not remove %s\n", s_nvs_dir);
+    }
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/* Node config deduplication: config bytes on the wire, against the broker stand-in
+ *
+ * The real app_nodecfg.c runs on the fake clock with the broker of
+ * host_cloud.c, under a stand-in for the RainMaker core that publishes the
+ * config on the first connect of the boot, as the core does. The node then
+ * reconnects, reports an unchanged config as the hub does after adding a
+ * satellite, and gets a new satellite while offline. The core's own publish is
+ * not taken as acknowledged, so the first report sends the config once. The bytes the broker
+ * receives on the config topic are compared with what the same node would
+ * send calling esp_rmaker_report_node_details() for every report.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_event.h>
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+
+#include "app_nodecfg.h"
+#include "app_conn.h"
+#include "host_stubs.h"
+
+#define RECONNECTS  20
+#define REPORTS     5
+
+static char s_config[8192];
+static int s_config_bytes;      // received by the broker on the config topic
+static int s_config_publishes;
+
+/* ---------------- RainMaker stand-ins ---------------- */
+
+char *esp_rmaker_get_node_config(void)
+{
+    return strdup(s_config);
+}
+
+bool app_conn_is_online(void)
+{
+    return host_cloud_session_up();
+}
+
+void app_conn_watch_publish(int msg_id)
+{
+}
+
+/* The core reports the config itself on the first connect of a boot */
+static void core_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    static bool reported;
+    if (id == RMAKER_MQTT_EVENT_CONNECTED && !reported) {
+        int msg_id;
+        reported = true;
+        esp_rmaker_mqtt_publish("node/host/config", s_config, strlen(s_config), 1, &msg_id);
+    }
+}
+
+static void on_publish(const char *topic, const char *payload)
+{
+    if (strstr(topic, "/config")) {
+        s_config_bytes += strlen(payload);
+        s_config_publishes++;
+    }
+}
+
+/* A node config shaped like RainMaker's: node info, then devices with params */
+static void build_config(int satellites)
+{
+    int n = snprintf(s_config, sizeof(s_config),
+                     "{\"node_id\":\"host\",\"config_version\":\"2020-03-20\",\"info\":{\"name\":\"Smart Home\","
+                     "\"fw_version\":\"1.0\",\"type\":\"Smart Home\",\"model\":\"esp32\"},\"devices\":[");
+    const char *devices[] = { "Home Light", "Alarm System", "Door Sensor Status" };
+    for (int i = 0; i < 3 + satellites; i++) {
+        char name[32];
+        if (i < 3) {
+            snprintf(name, sizeof(name), "%s", devices[i]);
+        } else {
+            snprintf(name, sizeof(name), "Satellite 0000%02x", i);
+        }
+        n += snprintf(s_config + n, sizeof(s_config) - n,
+                      "%s{\"name\":\"%s\",\"type\":\"esp.device.other\",\"params\":["
+                      "{\"name\":\"Name\",\"type\":\"esp.param.name\",\"data_type\":\"string\",\"properties\":[\"read\",\"write\"]},"
+                      "{\"name\":\"Door Status\",\"data_type\":\"string\",\"properties\":[\"read\"]},"
+                      "{\"name\":\"Battery\",\"data_type\":\"int\",\"properties\":[\"read\"]},"
+                      "{\"name\":\"Zone\",\"data_type\":\"int\",\"properties\":[\"read\",\"write\"],"
+                      "\"bounds\":{\"min\":0,\"max\":30,\"step\":1}}]}",
+                      i ? "," : "", name);
+    }
+    snprintf(s_config + n, sizeof(s_config) - n, "]}");
+}
+
+static void reconnect(void)
+{
+    host_cloud_set_up(false);
+    host_clock_advance(1000000);
+    host_cloud_set_up(true);
+    esp_rmaker_mqtt_connect();
+    host_clock_advance(100000);
+}
+
+int main(void)
+{
+    host_clock_set(2000000);
+    host_cloud_on_publish(on_publish);
+    build_config(2);
+    esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, core_event_handler, NULL);
+    CHECK(app_nodecfg_init() == ESP_OK, "init");
+    esp_rmaker_start();
+    host_clock_advance(100000);
+    int len = strlen(s_config);
+    CHECK(s_config_publishes == 1, "%d config publishes on the first connect", s_config_publishes);
+
+    /* Reconnects: the core does not send the config again, and neither do we */
+    for (int i = 0; i < RECONNECTS; i++) {
+        reconnect();
+    }
+    app_nodecfg_stats_t st;
+    app_nodecfg_get_stats(&st);
+    CHECK(s_config_publishes == 1, "config published on reconnect");
+    CHECK(st.skipped == 0 && st.bytes_saved == 0, "reconnects counted as saved: %lu bytes",
+          (unsigned long)st.bytes_saved);
+
+    /* Reports of an unchanged config: the first gets an ack of our own, the
+     * rest would each have been a full publish */
+    int before = s_config_bytes;
+    for (int i = 0; i < REPORTS; i++) {
+        app_nodecfg_report();
+        host_clock_advance(100000);
+    }
+    app_nodecfg_get_stats(&st);
+    int baseline = (REPORTS - 1) * len;
+    CHECK(s_config_bytes == before + len && st.published == 1, "unchanged config published %d times",
+          (s_config_bytes - before) / len);
+    CHECK(st.skipped == REPORTS - 1 && st.bytes_saved == (uint32_t)baseline,
+          "%lu reports, %lu bytes counted, %d expected", (unsigned long)st.skipped, (unsigned long)st.bytes_saved,
+          baseline);
+    printf("%d-byte config: %d reconnects sent no config, %d unchanged reports saved %d bytes\n", len, RECONNECTS,
+           REPORTS, baseline);
+
+    /* A satellite added while offline goes out on the next connect, once */
+    host_cloud_set_up(false);
+    host_clock_advance(1000000);
+    build_config(3);
+    app_nodecfg_report();
+    host_cloud_set_up(true);
+    esp_rmaker_mqtt_connect();
+    host_clock_advance(100000);
+    CHECK(s_config_publishes == 3, "%d config publishes after a change made offline", s_config_publishes);
+    reconnect();
+    app_nodecfg_report();
+    host_clock_advance(100000);
+    app_nodecfg_get_stats(&st);
+    CHECK(s_config_publishes == 3 && st.published == 2, "new config published again once acknowledged");
+    CHECK(host_nvs_writes == 0, "config hash written to NVS");
+
+    /* Same node without deduplication: every report publishes, and the one made offline is lost */
+    int without = len + REPORTS * len;
+    printf("config bytes to the broker: %d including the offline change, %d with "
+           "esp_rmaker_report_node_details() on every report, without it\n", s_config_bytes, without);
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
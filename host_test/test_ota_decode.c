@@ -0,0 +1,160 @@
+/* OTA payload decoder: delta and zlib payloads made by tools/ota_delta.py
+ *
+ *   test_ota_decode VECTOR_DIR      (vectors written by ota_vectors.py)
+ *
+ * Links the real app_ota_decode.c with old.bin as the running partition. Every
+ * payload is fed in several chunk sizes, as the HTTPS download delivers it,
+ * and the output must be new.bin byte for byte.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_ota_decode.h"
+#include "host_stubs.h"
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} blob_t;
+
+typedef struct {
+    const blob_t *expect;
+    size_t pos;
+    bool mismatch;
+} sink_t;
+
+static const char *s_dir;
+
+static blob_t load(const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", s_dir, name);
+    blob_t b = { 0 };
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("cannot open %s\n", path);
+        exit(2);
+    }
+    fseek(f, 0, SEEK_END);
+    b.len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    b.data = malloc(b.len);
+    if (fread(b.data, 1, b.len, f) != b.len) {
+        exit(2);
+    }
+    fclose(f);
+    return b;
+}
+
+static esp_err_t sink_write(const uint8_t *data, size_t len, void *ctx)
+{
+    sink_t *sink = ctx;
+    if (sink->pos + len > sink->expect->len || memcmp(sink->expect->data + sink->pos, data, len) != 0) {
+        sink->mismatch = true;
+    }
+    sink->pos += len;
+    return ESP_OK;
+}
+
+/* Feed payload in chunks of chunk bytes (0: all at once); returns the first error */
+static esp_err_t decode(const blob_t *payload, size_t chunk, const blob_t *expect, sink_t *sink, const char **fmt)
+{
+    *sink = (sink_t){ .expect = expect };
+    app_ota_decoder_t *dec = app_ota_decoder_create(sink_write, sink);
+    esp_err_t err = ESP_OK;
+    size_t step = chunk ? chunk : payload->len;
+    for (size_t off = 0; off < payload->len && err == ESP_OK; off += step) {
+        size_t n = payload->len - off < step ? payload->len - off : step;
+        err = app_ota_decoder_feed(dec, payload->data + off, n);
+    }
+    if (err == ESP_OK) {
+        err = app_ota_decoder_finish(dec);
+    }
+    *fmt = app_ota_decoder_format(dec);
+    app_ota_decoder_destroy(dec);
+    return err;
+}
+
+static void check_ok(const char *name, const blob_t *payload, const blob_t *expect, const char *want_fmt)
+{
+    static const size_t chunks[] = { 1, 7, 1000, 4096, 16384, 0 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        sink_t sink;
+        const char *fmt;
+        int64_t t0 = host_wall_ns();
+        esp_err_t err = decode(payload, chunks[i], expect, &sink, &fmt);
+        int64_t ns = host_wall_ns() - t0;
+        CHECK(err == ESP_OK, "%s chunk %zu: error 0x%x", name, chunks[i], err);
+        CHECK(!sink.mismatch && sink.pos == expect->len, "%s chunk %zu: output differs (%zu of %zu bytes)",
+              name, chunks[i], sink.pos, expect->len);
+        CHECK(strcmp(fmt, want_fmt) == 0, "%s: format %s, expected %s", name, fmt, want_fmt);
+        if (chunks[i] == 4096 && payload != expect) {
+            printf("%-14s %7zu -> %7zu bytes (%5.1f%%), %s, %.1f MB/s host decode\n", name, payload->len,
+                   expect->len, 100.0 * payload->len / expect->len, fmt, expect->len * 1e3 / ns);
+        }
+    }
+}
+
+static void check_err(const char *name, const blob_t *payload, const blob_t *expect, esp_err_t want)
+{
+    sink_t sink;
+    const char *fmt;
+    esp_err_t err = decode(payload, 1000, expect, &sink, &fmt);
+    CHECK(err == want, "%s: error 0x%x, expected 0x%x", name, err, want);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        printf("usage: %s VECTOR_DIR\n", argv[0]);
+        return 2;
+    }
+    s_dir = argv[1];
+    blob_t old = load("old.bin");
+    blob_t new = load("new.bin");
+    blob_t delta = load("new.delta");
+    blob_t raw_delta = load("new.raw.delta");
+    blob_t zlib = load("new.zlib");
+    blob_t other = load("other.delta");
+
+    /* The running partition is larger than the image, as on the device */
+    uint8_t *flash = malloc(old.len + 65536);
+    memcpy(flash, old.data, old.len);
+    memset(flash + old.len, 0xff, 65536);
+    host_partition_set_running(host_partition_add("ota_0", ESP_PARTITION_TYPE_APP, flash, old.len + 65536));
+
+    check_ok("plain", &new, &new, "plain");
+    check_ok("zlib", &zlib, &new, "zlib");
+    check_ok("delta", &raw_delta, &new, "delta");
+    check_ok("zlib+delta", &delta, &new, "zlib+delta");
+
+    /* Patch made for another build: refused before anything is written */
+    check_err("wrong source", &other, &new, ESP_ERR_INVALID_VERSION);
+
+    /* Truncated download */
+    blob_t cut = { delta.data, delta.len / 2 };
+    check_err("truncated", &cut, &new, ESP_ERR_INVALID_SIZE);
+
+    /* Insert data flipped in transit: the rebuilt image hash catches it */
+    blob_t bad = { malloc(raw_delta.len), raw_delta.len };
+    memcpy(bad.data, raw_delta.data, raw_delta.len);
+    bad.data[raw_delta.len - 2] ^= 0xff;
+    check_err("corrupt insert", &bad, &new, ESP_ERR_INVALID_CRC);
+
+    /* Copy beyond the source image */
+    memcpy(bad.data, raw_delta.data, raw_delta.len);
+    for (size_t pos = 76; pos < bad.len; pos++) {
+        if (bad.data[pos] == 0x01) {
+            bad.data[pos + 5] = 0xff;
+            bad.data[pos + 6] = 0xff;
+            bad.data[pos + 7] = 0xff;
+            break;
+        }
+    }
+    check_err("copy overflow", &bad, &new, ESP_ERR_INVALID_RESPONSE);
+
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/* Local payload encoders: CBOR against JSON
+ *
+ * Links the real app_payload.c and app_history.c; the CBOR library is the
+ * tinycbor stand-in of stubs/host_cbor.c and JSON the json_generator one of
+ * host_stubs.c. Both encoders run on the same snapshot and the same full
+ * history page. The JSON snapshot must read back as expected, every CBOR
+ * payload must be one well-formed item of the expected shape, and a buffer
+ * one byte short must fail both. Then prints the size and the time per encode
+ * of each payload in each format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_event.h>
+#include <esp_system.h>
+
+#include "app_payload.h"
+#include "app_history.h"
+#include "app_events.h"
+#include "app_priv.h"
+#include "host_stubs.h"
+
+#define ROUNDS          20000
+#define EVENTS          40
+#define BUF_LEN         1024
+#define BOOT_EPOCH      1760000000LL
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+bool app_light_get(void)
+{
+    return true;
+}
+
+bool app_door_is_open(void)
+{
+    return false;
+}
+
+bool app_alarm_is_enabled(void)
+{
+    return true;
+}
+
+int64_t app_time_from_mono_us(int64_t mono_us)
+{
+    return BOOT_EPOCH * 1000000 + mono_us;
+}
+
+/* ---------------- CBOR reader ---------------- */
+
+/* Skip one data item; returns the byte after it, NULL if malformed. Its head
+ * argument (length, element count or value) goes to *count. */
+static const uint8_t *cbor_skip(const uint8_t *p, const uint8_t *end, uint64_t *count)
+{
+    if (p >= end) {
+        return NULL;
+    }
+    int major = *p >> 5, info = *p & 0x1f;
+    p++;
+    uint64_t arg = info;
+    if (info >= 24 && info <= 27) {
+        int n = 1 << (info - 24);
+        if (end - p < n) {
+            return NULL;
+        }
+        for (arg = 0; n--; ) {
+            arg = arg << 8 | *p++;
+        }
+    } else if (info > 27) {
+        return NULL;
+    }
+    if (count) {
+        *count = arg;
+    }
+    switch (major) {
+    case 2:
+    case 3:
+        return (uint64_t)(end - p) < arg ? NULL : p + arg;
+    case 4:
+    case 5:
+        for (uint64_t i = 0; i < arg * (major == 5 ? 2 : 1) && p; i++) {
+            p = cbor_skip(p, end, NULL);
+        }
+        return p;
+    case 7:
+        return info == 20 || info == 21 ? p : NULL;
+    default:
+        return p;
+    }
+}
+
+/* One well-formed item filling len bytes, a map of pairs entries */
+static bool cbor_is_map(const uint8_t *buf, int len, uint64_t pairs)
+{
+    uint64_t n = 0;
+    return len > 0 && *buf >> 5 == 5 && cbor_skip(buf, buf + len, &n) == buf + len && n == pairs;
+}
+
+/* ---------------- Benchmark ---------------- */
+
+typedef int (*encode_fn_t)(app_payload_fmt_t fmt, uint8_t *buf, size_t len);
+
+static int encode_snapshot(app_payload_fmt_t fmt, uint8_t *buf, size_t len)
+{
+    return app_payload_snapshot(fmt, buf, len);
+}
+
+static int encode_history(app_payload_fmt_t fmt, uint8_t *buf, size_t len)
+{
+    return app_payload_history(fmt, 0, buf, len);
+}
+
+static void bench(const char *what, encode_fn_t encode)
+{
+    static const char *const fmt_name[] = { [APP_PAYLOAD_CBOR] = "CBOR", [APP_PAYLOAD_JSON] = "JSON" };
+    static uint8_t buf[BUF_LEN];
+    int len[2];
+    int64_t ns[2];
+    for (int f = APP_PAYLOAD_CBOR; f <= APP_PAYLOAD_JSON; f++) {
+        len[f] = encode(f, buf, sizeof(buf));
+        CHECK(len[f] > 0 && encode(f, buf, len[f] - 1) < 0, "%s %s: %d bytes, one short accepted", what,
+              fmt_name[f], len[f]);
+        int64_t t0 = host_wall_ns();
+        for (int r = 0; r < ROUNDS; r++) {
+            encode(f, buf, sizeof(buf));
+        }
+        ns[f] = (host_wall_ns() - t0) / ROUNDS;
+    }
+    printf("%-8s CBOR %4d bytes %5lld ns, JSON %4d bytes %5lld ns per encode (CBOR %d%% of the size)\n", what,
+           len[APP_PAYLOAD_CBOR], (long long)ns[APP_PAYLOAD_CBOR], len[APP_PAYLOAD_JSON],
+           (long long)ns[APP_PAYLOAD_JSON], len[APP_PAYLOAD_CBOR] * 100 / len[APP_PAYLOAD_JSON]);
+}
+
+int main(void)
+{
+    host_clock_set(3600 * 1000000LL);
+    CHECK(app_history_init() == ESP_OK, "history init");
+    for (int i = 0; i < EVENTS; i++) {
+        host_clock_advance(37 * 1000000LL);
+        app_event_data_t data = {
+            .src = i % 3 ? APP_EVENT_SRC_SENSOR : APP_EVENT_SRC_USER,
+            .zone = i % 5,
+            .mono_us = host_clock_now(),
+        };
+        esp_event_post(APP_EVENT, i % 2 ? APP_EVENT_DOOR_CLOSED : APP_EVENT_DOOR_OPENED, &data, sizeof(data), 0);
+    }
+
+    /* Same snapshot, both formats */
+    uint8_t buf[BUF_LEN];
+    int len = app_payload_snapshot(APP_PAYLOAD_JSON, buf, sizeof(buf));
+    char want[160];
+    snprintf(want, sizeof(want),
+             "{\"light\":true,\"alarm\":true,\"door\":false,\"up\":%lld,\"heap\":%lu,\"heap_min\":%lu,\"hist\":%d}",
+             (long long)(host_clock_now() / 1000), (unsigned long)esp_get_free_heap_size(),
+             (unsigned long)esp_get_minimum_free_heap_size(), EVENTS);
+    CHECK(len == (int)strlen(want) && memcmp(buf, want, len) == 0, "JSON snapshot %.*s", len > 0 ? len : 0, buf);
+    len = app_payload_snapshot(APP_PAYLOAD_CBOR, buf, sizeof(buf));
+    CHECK(cbor_is_map(buf, len, 7), "CBOR snapshot malformed (%d bytes)", len);
+
+    /* Same history page, both formats: the newest APP_PAYLOAD_HISTORY_PAGE events */
+    len = app_payload_history(APP_PAYLOAD_JSON, 0, buf, sizeof(buf));
+    CHECK(len > 0 && memcmp(buf, "{\"page\":0,\"total\":40,\"ev\":[[", 28) == 0, "JSON history %.*s",
+          len > 0 ? len : 0, buf);
+    len = app_payload_history(APP_PAYLOAD_CBOR, 0, buf, sizeof(buf));
+    CHECK(cbor_is_map(buf, len, 3), "CBOR history malformed (%d bytes)", len);
+    const uint8_t *p = len > 0 ? buf + 1 : NULL;     // past the map head: page, total, then ev
+    for (int i = 0; i < 5 && p; i++) {
+        p = cbor_skip(p, buf + len, NULL);
+    }
+    uint64_t entries = 0;
+    CHECK(p && cbor_skip(p, buf + len, &entries) && entries == APP_PAYLOAD_HISTORY_PAGE,
+          "CBOR history: %llu entries", (unsigned long long)entries);
+
+    bench("snapshot", encode_snapshot);
+    bench("history", encode_history);
+
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+/* Rule engine: actions run without s_lock, batching, and an evaluation benchmark
+ *
+ * Links the real app_rules.c and app_timer.c against the host stubs. The
+ * app_priv/app_alert hooks below check that no lock is held when an action
+ * calls into the alarm and light code.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_event.h>
+#include <esp_rmaker_core.h>
+
+#include "app_rules.h"
+#include "app_events.h"
+#include "app_priv.h"
+#include "app_alert.h"
+#include "app_timer.h"
+#include "app_devcfg.h"
+#include "host_stubs.h"
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+static bool s_light;
+static bool s_armed;
+static int s_light_calls;
+static int s_alarm_calls;
+static int s_alerts;
+static const char *s_reload;    // rules to load from inside the next action
+
+esp_err_t app_light_set(bool on)
+{
+    CHECK(host_locks_held == 0, "app_light_set() called with %d lock(s) held", host_locks_held);
+    s_light = on;
+    s_light_calls++;
+    if (s_reload) {
+        const char *text = s_reload;
+        s_reload = NULL;
+        CHECK(app_rules_load(text, NULL, 0) == ESP_OK, "reload from an action failed");
+    }
+    return ESP_OK;
+}
+
+bool app_light_get(void)
+{
+    return s_light;
+}
+
+bool app_door_is_open(void)
+{
+    return true;
+}
+
+bool app_alarm_is_enabled(void)
+{
+    return s_armed;
+}
+
+esp_err_t app_alarm_set(bool enable, app_event_src_t src)
+{
+    CHECK(host_locks_held == 0, "app_alarm_set() called with %d lock(s) held", host_locks_held);
+    s_armed = enable;
+    s_alarm_calls++;
+    return ESP_OK;
+}
+
+esp_err_t app_alert_raise(app_alert_prio_t prio, uint8_t zone, const char *what)
+{
+    CHECK(host_locks_held == 0, "app_alert_raise() called with %d lock(s) held", host_locks_held);
+    s_alerts++;
+    return ESP_OK;
+}
+
+const char *app_devcfg_rules(void)
+{
+    return NULL;
+}
+
+static void post(app_event_id_t id)
+{
+    app_event_data_t data = { .src = APP_EVENT_SRC_SENSOR };
+    esp_event_post(APP_EVENT, id, &data, sizeof(data), 0);
+}
+
+static void reset_counts(void)
+{
+    s_light_calls = s_alarm_calls = s_alerts = 0;
+}
+
+static void test_actions(void)
+{
+    CHECK(app_rules_load("on door_open then light_on 2; on door_open if armed then alert;"
+                         "on door_close if disarmed then arm", NULL, 0) == ESP_OK, "load");
+    reset_counts();
+    s_armed = false;
+    post(APP_EVENT_DOOR_OPENED);
+    CHECK(s_light && s_light_calls == 1 && s_alerts == 0, "door_open: light %d calls %d alerts %d",
+          s_light, s_light_calls, s_alerts);
+    post(APP_EVENT_DOOR_CLOSED);
+    CHECK(s_armed && s_alarm_calls == 1, "door_close did not arm");
+    post(APP_EVENT_DOOR_OPENED);
+    CHECK(s_alerts == 1, "armed door_open did not alert");
+
+    /* light_on 2: the app_timer switches it off two seconds later */
+    host_clock_advance(1900 * 1000);
+    CHECK(s_light, "light went off early");
+    host_clock_advance(200 * 1000);
+    CHECK(!s_light, "light_on timeout did not switch the light off");
+}
+
+/* More fired actions than one batch holds: all of them run, in order */
+static void test_batches(void)
+{
+    char text[4096] = "";
+    for (int i = 0; i < 60; i++) {
+        strcat(text, "on door_open then light_on 1, light_off, light_on;");
+    }
+    CHECK(app_rules_load(text, NULL, 0) == ESP_OK, "load 60 rules");
+    reset_counts();
+    post(APP_EVENT_DOOR_OPENED);
+    CHECK(s_light_calls == 180, "%d light actions, expected 180", s_light_calls);
+    CHECK(s_light, "actions ran out of order");
+
+    /* Replacing the rules from an action drops the rest of the old set */
+    reset_counts();
+    s_reload = "on door_close then light_off";
+    post(APP_EVENT_DOOR_OPENED);
+    CHECK(s_light_calls > 0 && s_light_calls < 180, "%d light actions after a reload", s_light_calls);
+    printf("%-40s %d of 180 actions before the reload\n", "reload during an event:", s_light_calls);
+}
+
+static void bench(int rules, int firing)
+{
+    static char text[65536];
+    text[0] = '\0';
+    for (int i = 0; i < rules; i++) {
+        /* Mostly rules whose conditions fail, as in a real rule set, spread over the events */
+        static const char *const events[] = { "door_open", "door_close", "alarm_arm", "alarm_trigger" };
+        char rule[96];
+        if (i < firing) {
+            snprintf(rule, sizeof(rule), "on door_open if disarmed then light_on 60;");
+        } else {
+            snprintf(rule, sizeof(rule), "on %s if after %02d:%02d and armed and light_off then alert;",
+                     events[i % 4], (i / 60) % 24, i % 60);
+        }
+        strcat(text, rule);
+    }
+    char msg[64];
+    int64_t t0 = host_wall_ns();
+    esp_err_t err = app_rules_load(text, msg, sizeof(msg));
+    int64_t compile_ns = host_wall_ns() - t0;
+    CHECK(err == ESP_OK, "bench load: %s", msg);
+
+    s_armed = false;
+    host_time_synced = true;
+    const int iterations = 100000;
+    t0 = host_wall_ns();
+    for (int i = 0; i < iterations; i++) {
+        post(APP_EVENT_DOOR_OPENED);
+    }
+    int64_t per_event = (host_wall_ns() - t0) / iterations;
+    printf("%4d rules (%d on door_open, %d firing): %-18s compile %6lld us, %5lld ns/event\n",
+           rules, (rules - firing) / 4 + firing, firing, msg, (long long)(compile_ns / 1000),
+           (long long)per_event);
+}
+
+int main(void)
+{
+    app_timer_service_init();
+    CHECK(app_rules_init(NULL) == ESP_OK, "init");
+
+    test_actions();
+    test_batches();
+
+    bench(10, 1);
+    bench(100, 4);
+    bench(400, 8);
+
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+/* Application timer service: fake-clock harness and a benchmark against a sorted list
+ *
+ * The real app_timer.c runs on the fake clock of host_stubs.c, whose esp_timer
+ * keeps its timers in one list sorted by expiry, like the device's esp_timer.
+ * That list is this repo's own stub, not IDF's esp_timer (nor the linux
+ * target's), so the esp_timer column is a model of the device cost. The harness
+ * starts, restarts and cancels thousands of timers from tens of milliseconds
+ * to two hours at random while the clock moves, and checks that every timer
+ * fires exactly once, on the tick it is due, that cancelled ones never fire,
+ * and that the tick only wakes up for something to run or cascade. The
+ * benchmark then times start, restart, cancel and expiry with 1,000 to 10,000
+ * timers armed, against one stub esp_timer per timer. The timings are printed,
+ * not checked: wall-clock figures on a shared host are not pass/fail material.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "app_timer.h"
+#include "host_stubs.h"
+
+#define TICK_US         (CONFIG_APP_TIMER_TICK_MS * 1000LL)
+#define MAX_TIMERS      10000
+#define CHURN_TIMERS    4000
+#define CHURN_STEPS     40000
+
+typedef struct {
+    app_timer_t timer;
+    int64_t due_us;         // 0: not started or cancelled
+    int fired;
+    int repeats;            // restarts itself from its callback this many times
+    uint32_t delay_ms;
+} item_t;
+
+static item_t s_items[MAX_TIMERS];
+static int s_early;
+static int s_late;
+static int s_stray;         // fired while cancelled
+
+/* Tick an app_timer started now for delay_ms is due on */
+static int64_t due_us(uint32_t delay_ms)
+{
+    int64_t ticks = (delay_ms + CONFIG_APP_TIMER_TICK_MS - 1) / CONFIG_APP_TIMER_TICK_MS;
+    return (host_clock_now() / TICK_US + ticks + 1) * TICK_US;
+}
+
+static void item_start(item_t *it, uint32_t delay_ms)
+{
+    it->delay_ms = delay_ms;
+    it->due_us = due_us(delay_ms);
+    CHECK(app_timer_start(&it->timer, delay_ms) == ESP_OK, "start %u ms", (unsigned)delay_ms);
+}
+
+static void item_cb(app_timer_t *timer, void *arg)
+{
+    item_t *it = arg;
+    int64_t now = host_clock_now();
+    if (!it->due_us) {
+        s_stray++;
+        return;
+    }
+    s_early += now < it->due_us;
+    s_late += now > it->due_us;
+    it->fired++;
+    it->due_us = 0;
+    if (it->repeats > 0) {
+        it->repeats--;
+        item_start(it, it->delay_ms);
+    }
+}
+
+/* From 10 ms to two hours, most of them short, as in the firmware */
+static uint32_t random_delay(void)
+{
+    switch (rand() % 4) {
+    case 0:
+        return rand() % 1000;
+    case 1:
+        return rand() % 60000;
+    case 2:
+        return rand() % 600000;
+    default:
+        return rand() % 7200000;
+    }
+}
+
+static void test_churn(void)
+{
+    srand(99);
+    for (int i = 0; i < CHURN_TIMERS; i++) {
+        app_timer_setup(&s_items[i].timer, item_cb, &s_items[i]);
+    }
+    int started = 0, wakeups = 0;
+    int64_t t0 = host_clock_now();
+    for (int step = 0; step < CHURN_STEPS; step++) {
+        item_t *it = &s_items[rand() % CHURN_TIMERS];
+        int op = rand() % 10;
+        if (op < 6) {
+            it->repeats = rand() % 8 == 0 ? 3 : 0;
+            item_start(it, random_delay());
+            started++;
+        } else if (op < 8) {
+            app_timer_cancel(&it->timer);
+            it->due_us = 0;
+            it->repeats = 0;
+        }
+        wakeups += host_clock_advance(rand() % 500 * 1000);
+    }
+    /* Everything left runs out within two hours and three repeats */
+    wakeups += host_clock_advance(4 * 7200 * 1000000LL);
+    int pending = 0, fired = 0;
+    for (int i = 0; i < CHURN_TIMERS; i++) {
+        pending += s_items[i].due_us != 0 || app_timer_is_active(&s_items[i].timer);
+        fired += s_items[i].fired;
+    }
+    CHECK(!s_early && !s_late, "%d timers fired early, %d late", s_early, s_late);
+    CHECK(!s_stray, "%d cancelled timers fired", s_stray);
+    CHECK(!pending, "%d timers never fired", pending);
+    CHECK(host_timers_armed() == 0, "tick still armed with no timer active");
+    int64_t ticks = (host_clock_now() - t0) / TICK_US;
+    printf("churn: %d starts, %d fired on their tick, %d wake-ups over %lld ticks\n", started, fired, wakeups,
+           (long long)ticks);
+}
+
+/* A lone exit delay wakes the tick to cascade and to fire, not on every tick */
+static void test_wakeups(void)
+{
+    item_t *it = &s_items[0];
+    app_timer_setup(&it->timer, item_cb, it);
+    it->fired = 0;
+    item_start(it, 30000);
+    int wakeups = host_clock_advance(31 * 1000000LL);
+    CHECK(it->fired == 1, "30 s timer fired %d times", it->fired);
+    CHECK(wakeups <= 3, "%d wake-ups for one 30 s timer", wakeups);
+    printf("one 30 s timer: %d wake-ups (%d ticks)\n", wakeups, 30000 / CONFIG_APP_TIMER_TICK_MS);
+
+    /* A shorter timer started meanwhile re-arms the tick earlier */
+    item_t *other = &s_items[1];
+    app_timer_setup(&other->timer, item_cb, other);
+    other->fired = it->fired = 0;
+    item_start(it, 30000);
+    host_clock_advance(1000000);
+    item_start(other, 50);
+    host_clock_advance(100000);
+    CHECK(other->fired == 1 && !s_late, "timer started under a later armed tick fired late");
+    host_clock_advance(30 * 1000000LL);
+    CHECK(it->fired == 1 && !s_late, "the longer timer fired %d times", it->fired);
+}
+
+/* ---------------- Benchmark ---------------- */
+
+static int s_bench_fired;
+
+static void bench_timer_cb(app_timer_t *timer, void *arg)
+{
+    s_bench_fired++;
+}
+
+static void bench_esp_timer_cb(void *arg)
+{
+    s_bench_fired++;
+}
+
+static uint32_t s_delays[2][MAX_TIMERS];
+
+static void bench(int n)
+{
+    static esp_timer_handle_t handles[MAX_TIMERS];
+    srand(n);
+    for (int i = 0; i < n; i++) {
+        s_delays[0][i] = 1 + rand() % 600000;
+        s_delays[1][i] = 1 + rand() % 600000;
+        app_timer_setup(&s_items[i].timer, bench_timer_cb, NULL);
+        esp_timer_create_args_t args = { .callback = bench_esp_timer_cb, .name = "bench" };
+        esp_timer_create(&args, &handles[i]);
+    }
+    int64_t ns[2][4];
+
+    /* app_timer: start all, restart all, cancel every other, let the rest expire */
+    s_bench_fired = 0;
+    int64_t t0 = host_wall_ns();
+    for (int i = 0; i < n; i++) {
+        app_timer_start(&s_items[i].timer, s_delays[0][i]);
+    }
+    int64_t t1 = host_wall_ns();
+    for (int i = 0; i < n; i++) {
+        app_timer_start(&s_items[i].timer, s_delays[1][i]);
+    }
+    int64_t t2 = host_wall_ns();
+    for (int i = 0; i < n; i += 2) {
+        app_timer_cancel(&s_items[i].timer);
+    }
+    int64_t t3 = host_wall_ns();
+    host_clock_advance(601 * 1000000LL);
+    int64_t t4 = host_wall_ns();
+    CHECK(s_bench_fired == n / 2, "app_timer: %d of %d fired", s_bench_fired, n / 2);
+    ns[0][0] = (t1 - t0) / n;
+    ns[0][1] = (t2 - t1) / n;
+    ns[0][2] = (t3 - t2) / (n / 2);
+    ns[0][3] = (t4 - t3) / (n / 2);
+
+    /* The same with one esp_timer per timer */
+    s_bench_fired = 0;
+    t0 = host_wall_ns();
+    for (int i = 0; i < n; i++) {
+        esp_timer_start_once(handles[i], s_delays[0][i] * 1000ULL);
+    }
+    t1 = host_wall_ns();
+    for (int i = 0; i < n; i++) {
+        esp_timer_stop(handles[i]);
+        esp_timer_start_once(handles[i], s_delays[1][i] * 1000ULL);
+    }
+    t2 = host_wall_ns();
+    for (int i = 0; i < n; i += 2) {
+        esp_timer_stop(handles[i]);
+    }
+    t3 = host_wall_ns();
+    host_clock_advance(601 * 1000000LL);
+    t4 = host_wall_ns();
+    CHECK(s_bench_fired == n / 2, "esp_timer: %d of %d fired", s_bench_fired, n / 2);
+    ns[1][0] = (t1 - t0) / n;
+    ns[1][1] = (t2 - t1) / n;
+    ns[1][2] = (t3 - t2) / (n / 2);
+    ns[1][3] = (t4 - t3) / (n / 2);
+    for (int i = 0; i < n; i++) {
+        esp_timer_delete(handles[i]);
+    }
+
+    printf("%5d timers, ns per op    start  restart  cancel  expire\n", n);
+    printf("    app_timer            %6lld   %6lld  %6lld  %6lld\n", (long long)ns[0][0], (long long)ns[0][1],
+           (long long)ns[0][2], (long long)ns[0][3]);
+    printf("    esp_timer (stub)     %6lld   %6lld  %6lld  %6lld\n", (long long)ns[1][0], (long long)ns[1][1],
+           (long long)ns[1][2], (long long)ns[1][3]);
+    printf("    start %.1fx, restart %.1fx the sorted list\n", (double)ns[1][0] / (ns[0][0] ? ns[0][0] : 1),
+           (double)ns[1][1] / (ns[0][1] ? ns[0][1] : 1));
+}
+
+int main(void)
+{
+    host_clock_set(2000000);
+    CHECK(app_timer_service_init() == ESP_OK, "init");
+    test_churn();
+    test_wakeups();
+
+    bench(1000);
+    bench(2000);
+    bench(5000);
+    bench(10000);
+
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+/* Shared uplink: election after a power cut, alert hand-over and failover
+ *
+ * Three node processes run the real app_uplink.c, app_conn.c and app_alert.c
+ * on the loopback LAN, on the host's clock, each with the broker stand-in of
+ * host_cloud.c. All of them boot at once, as after a power cut: only the
+ * elected node may start RainMaker and connect. A follower's alerts must reach
+ * the cloud through the leader, and one raised while the leader hangs must
+ * still arrive once the next node has taken over. The test process listens on
+ * the LAN as well, and replays the dead leader's last heartbeat: it must not
+ * take the session away from the new one.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <esp_event.h>
+
+#include "app_uplink.h"
+#include "app_conn.h"
+#include "app_alert.h"
+#include "app_timer.h"
+#include "app_report.h"
+#include "app_siren.h"
+#include "app_priv.h"
+#include "host_stubs.h"
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+#define NODES       3
+#define MAX_SEEN    32
+
+/* ---------------- Node process ---------------- */
+
+static char s_seen[MAX_SEEN][160];     // alert payloads this node published
+static int s_seen_count;
+
+bool app_alarm_is_enabled(void)
+{
+    return false;
+}
+
+bool app_door_is_open(void)
+{
+    return false;
+}
+
+bool app_light_get(void)
+{
+    return false;
+}
+
+app_siren_stage_t app_siren_get_stage(void)
+{
+    return APP_SIREN_IDLE;
+}
+
+esp_err_t app_report_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    return ESP_OK;
+}
+
+esp_err_t app_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    return ESP_OK;
+}
+
+static void on_publish(const char *topic, const char *payload)
+{
+    if (strstr(topic, "/alert") && s_seen_count < MAX_SEEN) {
+        snprintf(s_seen[s_seen_count++], sizeof(s_seen[0]), "%s", payload);
+    }
+}
+
+static int s_base_port;
+
+static void node_setup(int index)
+{
+    host_lan_join(s_base_port, NODES + 1, index);     // the last port is the test's recorder
+    host_mac_set((const uint8_t[6]){ 0x02, 0, 0, 0, 0, index + 1 });
+    host_random_seed(index + 1);
+    host_clock_set(2000000);
+    host_cloud_on_publish(on_publish);
+    host_clock_realtime();
+    CHECK(app_timer_service_init() == ESP_OK, "node %d: timer init", index);
+    CHECK(app_alert_init() == ESP_OK, "node %d: alert init", index);
+    CHECK(app_uplink_start(NULL) == ESP_OK, "node %d: uplink start", index);
+    CHECK(app_conn_start(NULL) == ESP_OK, "node %d: conn start", index);
+}
+
+/*   alert high|low TEXT | state | seen TEXT */
+static void node_handle(const char *cmd, char *reply, size_t reply_len)
+{
+    char text[64];
+    if (sscanf(cmd, "alert high %63[^\n]", text) == 1) {
+        app_alert_raise(APP_ALERT_HIGH, 0, text);
+    } else if (sscanf(cmd, "alert low %63[^\n]", text) == 1) {
+        app_alert_raise(APP_ALERT_LOW, 0, text);
+    } else if (sscanf(cmd, "seen %63[^\n]", text) == 1) {
+        int n = 0;
+        for (int i = 0; i < s_seen_count; i++) {
+            n += strstr(s_seen[i], text) != NULL;
+        }
+        snprintf(reply, reply_len, "%d", n);
+        return;
+    }
+    snprintf(reply, reply_len, "%d %d %d %d", app_uplink_get_role(), host_cloud_session_up(), host_cloud.starts,
+             host_cloud.connects);
+}
+
+/* ---------------- Test process ---------------- */
+
+typedef struct {
+    int role;
+    int online;
+    int starts;
+    int connects;
+} node_state_t;
+
+static host_node_t s_nodes[NODES];
+static bool s_alive[NODES];
+static int s_dead_starts;
+static int s_dead_connects;
+
+static node_state_t state(int i)
+{
+    node_state_t st = { 0 };
+    sscanf(host_node_cmd(&s_nodes[i], "state"), "%d %d %d %d", &st.role, &st.online, &st.starts, &st.connects);
+    return st;
+}
+
+static int seen(int i, const char *text)
+{
+    return atoi(host_node_cmd(&s_nodes[i], "seen %s", text));
+}
+
+/* The single live leader once every live node has a role, -1 until then */
+static int leader(void)
+{
+    int found = -1, leaders = 0;
+    for (int i = 0; i < NODES; i++) {
+        if (!s_alive[i]) {
+            continue;
+        }
+        node_state_t st = state(i);
+        if (st.role == APP_UPLINK_ELECTING) {
+            return -1;
+        }
+        if (st.role == APP_UPLINK_LEADER) {
+            found = i;
+            leaders++;
+        }
+    }
+    return leaders == 1 ? found : -1;
+}
+
+static int wait_leader(int timeout_ms)
+{
+    for (int ms = 0; ms < timeout_ms; ms += 50) {
+        int l = leader();
+        if (l >= 0 && state(l).online) {
+            return l;
+        }
+        usleep(50 * 1000);
+    }
+    return -1;
+}
+
+/* Cloud starts and connects over all nodes, the killed ones included */
+static void totals(int *starts, int *connects)
+{
+    *starts = s_dead_starts;
+    *connects = s_dead_connects;
+    for (int i = 0; i < NODES; i++) {
+        if (s_alive[i]) {
+            node_state_t st = state(i);
+            *starts += st.starts;
+            *connects += st.connects;
+        }
+    }
+}
+
+static int wait_seen(int i, const char *text, int timeout_ms)
+{
+    for (int ms = 0; ms < timeout_ms; ms += 50) {
+        int n = seen(i, text);
+        if (n) {
+            return n;
+        }
+        usleep(50 * 1000);
+    }
+    return 0;
+}
+
+/* Stop node i where it is; it no longer answers commands */
+static void freeze_node(int i)
+{
+    node_state_t st = state(i);
+    s_dead_starts += st.starts;
+    s_dead_connects += st.connects;
+    kill(s_nodes[i].pid, SIGSTOP);
+    s_alive[i] = false;
+}
+
+/* ---------------- Recorder ---------------- */
+
+static int s_rec = -1;
+static uint8_t s_rec_frame[512];
+static int s_rec_len;
+
+static void recorder_open(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(s_base_port + NODES),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    s_rec = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    CHECK(s_rec >= 0 && bind(s_rec, (struct sockaddr *)&addr, sizeof(addr)) == 0, "recorder socket");
+}
+
+/* Drain what the nodes multicast, keeping node i's last leader heartbeat */
+static void record_leader(int i)
+{
+    uint8_t frame[sizeof(s_rec_frame)];
+    int len;
+    while ((len = recv(s_rec, frame, sizeof(frame), MSG_DONTWAIT)) > 0) {
+        if (len > APP_UPLINK_HDR_LEN + 1 && frame[3] == APP_UPLINK_HEARTBEAT && frame[9] == i + 1 &&
+            (frame[APP_UPLINK_HDR_LEN + 1] & APP_UPLINK_FLAG_LEADER)) {
+            memcpy(s_rec_frame, frame, len);
+            s_rec_len = len;
+        }
+    }
+}
+
+static void replay(void)
+{
+    for (int i = 0; i < NODES; i++) {
+        struct sockaddr_in peer = {
+            .sin_family = AF_INET,
+            .sin_port = htons(s_base_port + i),
+            .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        };
+        sendto(s_rec, s_rec_frame, s_rec_len, 0, (struct sockaddr *)&peer, sizeof(peer));
+    }
+}
+
+static void kill_node(int i)
+{
+    kill(s_nodes[i].pid, SIGKILL);
+    waitpid(s_nodes[i].pid, NULL, 0);
+    fclose(s_nodes[i].cmd);
+    fclose(s_nodes[i].reply);
+}
+
+static void kill_all(void)
+{
+    for (int i = 0; i < NODES; i++) {
+        if (s_nodes[i].pid) {
+            kill(s_nodes[i].pid, SIGKILL);
+        }
+    }
+}
+
+int main(void)
+{
+    signal(SIGPIPE, SIG_IGN);
+    s_base_port = host_lan_base_port(13);
+
+    /* Power comes back: every node boots at once */
+    recorder_open();
+    int64_t t0 = host_wall_ns();
+    for (int i = 0; i < NODES; i++) {
+        CHECK(host_node_spawn(&s_nodes[i], i, node_setup, node_handle), "spawn node %d", i);
+        s_alive[i] = true;
+    }
+    int first = wait_leader(10000);
+    CHECK(first == NODES - 1, "leader %d, expected the highest MAC", first);
+    if (first < 0) {
+        kill_all();
+        return 1;
+    }
+    printf("leader elected and online %lld ms after boot\n", (long long)((host_wall_ns() - t0) / 1000000));
+    sleep(1);
+    int starts, connects;
+    totals(&starts, &connects);
+    CHECK(starts == 1 && connects == 1, "%d RainMaker starts, %d connects after boot, expected 1 and 1",
+          starts, connects);
+
+    /* A follower's alert is published by the leader, once: the ack stops the repeats */
+    host_node_cmd(&s_nodes[0], "alert low Door A");
+    CHECK(wait_seen(first, "Door A", 2000) == 1, "follower alert not published by the leader");
+    sleep(3);
+    CHECK(seen(first, "Door A") == 1, "follower alert published %d times", seen(first, "Door A"));
+    CHECK(seen(0, "Door A") == 0 && seen(1, "Door A") == 0, "a follower published on its own");
+
+    /* The leader hangs before it can take the next one, then dies */
+    record_leader(first);
+    CHECK(s_rec_len > 0, "no leader heartbeat recorded");
+    freeze_node(first);
+    host_node_cmd(&s_nodes[0], "alert high Door B");
+    sleep(2);
+    int64_t t_kill = host_wall_ns();
+    kill_node(first);
+    int next = wait_leader(10000);
+    CHECK(next == 1, "leader %d after failover, expected node 1", next);
+    if (next < 0) {
+        kill_all();
+        return 1;
+    }
+    printf("failover: next leader online %lld ms after the old one died\n",
+           (long long)((host_wall_ns() - t_kill) / 1000000));
+    CHECK(wait_seen(next, "Door B", 3000) >= 1, "alert held by the follower lost in the failover");
+    CHECK(seen(0, "Door B") == 0, "follower published on its own");
+    totals(&starts, &connects);
+    CHECK(starts == 2 && connects == 2, "%d RainMaker starts, %d connects after failover, expected 2 and 2",
+          starts, connects);
+    printf("%d nodes: %d cloud connects for one boot and one failover\n", NODES, connects);
+
+    /* The dead leader's heartbeat, replayed whenever its slot could have timed out */
+    for (int r = 0; r < 8; r++) {
+        replay();
+        usleep(1000 * 1000);
+        CHECK(leader() == next && state(next).online, "replayed heartbeat of the dead leader unseated node %d",
+              next);
+    }
+
+    for (int i = 0; i < NODES; i++) {
+        if (s_alive[i]) {
+            CHECK(host_node_stop(&s_nodes[i]), "node %d reported failures", i);
+        }
+    }
+    printf("%s\n", host_failures ? "FAILED" : "OK");
+    return host_failures ? 1 : 0;
+}
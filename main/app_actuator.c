@@ -0,0 +1,88 @@
+/* Actuator task
+ *
+ * Single consumer of a small command queue. Runs above the IR sensor task so
+ * that queued commands are applied as soon as they are posted.
+ */
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_log.h>
+
+#include "app_actuator.h"
+#include "app_priv.h"
+
+static const char *TAG = "app_actuator";
+
+#define ACTUATOR_TASK_STACK     3072
+#define ACTUATOR_TASK_PRIO      6
+#define ACTUATOR_QUEUE_LEN      8
+
+typedef struct {
+    uint8_t target;         // app_actuator_target_t
+    uint8_t value;
+    uint8_t src;            // app_event_src_t
+    TaskHandle_t waiter;    // notified once applied, may be NULL
+} actuator_cmd_t;
+
+static QueueHandle_t s_queue;
+
+static void actuator_task(void *arg)
+{
+    actuator_cmd_t cmd;
+    while (1) {
+        if (xQueueReceive(s_queue, &cmd, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        switch (cmd.target) {
+        case APP_ACTUATOR_LIGHT:
+            app_light_set(cmd.value);
+            break;
+        case APP_ACTUATOR_ALARM:
+            app_alarm_set(cmd.value, cmd.src);
+            break;
+        case APP_ACTUATOR_PING:
+            break;
+        default:
+            ESP_LOGW(TAG, "Unknown target %d", cmd.target);
+            break;
+        }
+        if (cmd.waiter) {
+            xTaskNotifyGive(cmd.waiter);
+        }
+    }
+}
+
+esp_err_t app_actuator_submit(app_actuator_target_t target, bool value, app_event_src_t src, uint32_t wait_ms)
+{
+    actuator_cmd_t cmd = {
+        .target = target,
+        .value = value,
+        .src = src,
+        .waiter = wait_ms ? xTaskGetCurrentTaskHandle() : NULL,
+    };
+    if (cmd.waiter) {
+        /* Drop a completion left over from an earlier timed-out wait */
+        ulTaskNotifyTake(pdTRUE, 0);
+    }
+    if (xQueueSend(s_queue, &cmd, 0) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (cmd.waiter && ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms)) == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_actuator_init(void)
+{
+    s_queue = xQueueCreate(ACTUATOR_QUEUE_LEN, sizeof(actuator_cmd_t));
+    if (!s_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(actuator_task, "actuator", ACTUATOR_TASK_STACK, NULL, ACTUATOR_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create actuator task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
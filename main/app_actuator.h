@@ -0,0 +1,49 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "app_events.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    APP_ACTUATOR_LIGHT = 0,
+    APP_ACTUATOR_ALARM,
+    APP_ACTUATOR_PING,      // no-op, measures queue and scheduling latency
+} app_actuator_target_t;
+
+/* Start the actuator task
+ *
+ * The actuator task owns applying commands that do not come through write_cb,
+ * so that latency-sensitive callers only pay for a queue send.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_actuator_init(void);
+
+/* Enqueue a command for the actuator
+ *
+ * @param[in] target Light, Alarm System or ping.
+ * @param[in] value New on/off state.
+ * @param[in] src Origin of the command, carried into the resulting APP_EVENT.
+ * @param[in] wait_ms 0 to return right after enqueueing, otherwise wait up to
+ *                    this long for the actuator to apply the command.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_TIMEOUT if the queue is full or the command was not applied in time.
+ */
+esp_err_t app_actuator_submit(app_actuator_target_t target, bool value, app_event_src_t src, uint32_t wait_ms);
+
+#ifdef __cplusplus
+}
+#endif
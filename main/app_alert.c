@@ -0,0 +1,389 @@
+/* Alert manager
+ *
+ * One coalescing channel per priority:
+ *
+ *   idle --alert--> send now, window open --timer--> suppressed alerts?
+ *                                                     yes: send follow-up, window open again
+ *                                                     no:  idle
+ *
+ * so a burst costs one notification up front and at most one per window
+ * after it, and the first alert of an incident is never delayed. A token
+ * bucket shared by both channels keeps the total under the push service
+ * limit; the last few tokens are reserved for high-priority alerts.
+ *
+ * Every notification is held (oldest dropped first) until the broker
+ * acknowledges it: it is published at QoS 1 on the alert topic, and the
+ * connection manager drops a session that does not acknowledge in time.
+ * Whatever is still held when the session comes back, whether raised offline
+ * or lost in a dead session, is published again in order. A notification can
+ * therefore arrive twice, never silently not at all.
+ *
+ * A shared-uplink follower has no session: it hands its held notifications to
+ * the leader one at a time, oldest first, and drops each only when the leader
+ * acknowledges having taken it into its own held list. Unacknowledged ones are
+ * handed over again every ALERT_FORWARD_RETRY_MS, and published by this node
+ * itself if it becomes leader.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_diagnostics.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+#include <json_generator.h>
+
+#include "app_alert.h"
+#include "app_conn.h"
+#include "app_uplink.h"
+#include "app_arming.h"
+#include "app_timer.h"
+
+static const char *TAG = "app_alert";
+
+#define ALERT_WINDOW_MS     (CONFIG_APP_ALERT_WINDOW_SEC * 1000u)
+#define ALERT_TOKEN_US      (3600 * 1000000LL / CONFIG_APP_ALERT_MAX_PER_HOUR)
+#define ALERT_TEXT_LEN      64
+#define ALERT_ZONES_LEN     ((APP_ZONE_MAX + 1) * 3)   // "z," per zone, up to two digits
+/* Longest follow-up: text, count, every zone and the window, with room for
+ * the node prefix a relaying leader adds */
+#define ALERT_MSG_LEN       256
+#define ALERT_HELD_LEN      8
+#define ALERT_UNSENT        -1      // msg_id: not published on the current session
+#define ALERT_ACKED         0
+#define ALERT_FORWARD_RETRY_MS  1000
+
+typedef struct {
+    bool window_open;
+    uint32_t suppressed;        // alerts counted since the last notification
+    uint32_t zones;             // bitmask of zones among them
+    char what[ALERT_TEXT_LEN];  // text of the alert that opened the incident
+    app_timer_t timer;
+} alert_chan_t;
+
+static alert_chan_t s_chan[APP_ALERT_PRIO_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_bucket_us;     // token bucket as a timestamp: full when <= now - capacity
+
+/* Notifications not acknowledged yet, oldest first */
+typedef struct {
+    uint32_t seq;
+    int msg_id;
+    char msg[ALERT_MSG_LEN];
+} alert_held_t;
+
+static alert_held_t s_held[ALERT_HELD_LEN];
+static int s_held_head;
+static int s_held_count;
+static uint32_t s_held_seq;
+static uint32_t s_held_dropped;
+#ifdef CONFIG_APP_UPLINK_SHARED
+static app_timer_t s_forward_timer;
+#endif
+
+static const char *const s_prio_name[APP_ALERT_PRIO_MAX] = {
+    [APP_ALERT_HIGH] = "high",
+    [APP_ALERT_LOW] = "low",
+};
+
+/* Take one notification token. Tokens regenerate at MAX_PER_HOUR per hour,
+ * up to MAX_PER_HOUR; low priority has to leave HIGH_RESERVE of them. Locked. */
+static bool take_token(app_alert_prio_t prio)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t full = now - CONFIG_APP_ALERT_MAX_PER_HOUR * ALERT_TOKEN_US;
+    if (s_bucket_us < full) {
+        s_bucket_us = full;
+    }
+    int reserve = prio == APP_ALERT_HIGH ? 0 : CONFIG_APP_ALERT_HIGH_RESERVE;
+    int available = (now - s_bucket_us) / ALERT_TOKEN_US;
+    if (available <= reserve) {
+        return false;
+    }
+    s_bucket_us += ALERT_TOKEN_US;
+    return true;
+}
+
+_Static_assert(ALERT_MSG_LEN >= ALERT_TEXT_LEN + ALERT_ZONES_LEN + 64, "alert follow-up does not fit");
+
+static void format_zones(char *buf, size_t len, uint32_t zones)
+{
+    size_t n = 0;
+    buf[0] = '\0';
+    for (int z = 0; z <= APP_ZONE_MAX && n < len; z++) {
+        if (zones & (1u << z)) {
+            n += snprintf(buf + n, len - n, "%s%d", n ? "," : "", z);
+        }
+    }
+}
+
+/* ---------------- Delivery ---------------- */
+
+/* Hold a notification until it is acknowledged. Returns its sequence number. */
+static uint32_t held_add(const char *msg)
+{
+    char copy[ALERT_MSG_LEN];
+    snprintf(copy, sizeof(copy), "%s", msg);
+    portENTER_CRITICAL(&s_lock);
+    if (s_held_count == ALERT_HELD_LEN) {
+        s_held_head = (s_held_head + 1) % ALERT_HELD_LEN;
+        s_held_count--;
+        s_held_dropped++;
+    }
+    alert_held_t *h = &s_held[(s_held_head + s_held_count) % ALERT_HELD_LEN];
+    h->seq = ++s_held_seq;
+    h->msg_id = ALERT_UNSENT;
+    memcpy(h->msg, copy, sizeof(h->msg));
+    s_held_count++;
+    uint32_t seq = h->seq;
+    portEXIT_CRITICAL(&s_lock);
+    return seq;
+}
+
+/* Same topic and payload as esp_rmaker_raise_alert(), which does not return the msg_id */
+static void publish(uint32_t seq, const char *msg)
+{
+    char topic[64];
+    char payload[ALERT_MSG_LEN + 32];
+    json_gen_str_t jstr;
+    json_gen_str_start(&jstr, payload, sizeof(payload), NULL, NULL);
+    json_gen_start_object(&jstr);
+    json_gen_obj_set_string(&jstr, "esp.alert.str", msg);
+    json_gen_end_object(&jstr);
+    json_gen_str_end(&jstr);
+    snprintf(topic, sizeof(topic), "node/%s/alert", esp_rmaker_get_node_id());
+
+    int msg_id = -1;
+    if (esp_rmaker_mqtt_publish(topic, payload, strlen(payload), 1, &msg_id) != ESP_OK || msg_id <= 0) {
+        ESP_LOGW(TAG, "Alert publish failed, holding it for the next session");
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_held_count; i++) {
+        alert_held_t *h = &s_held[(s_held_head + i) % ALERT_HELD_LEN];
+        if (h->seq == seq) {
+            h->msg_id = msg_id;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    app_conn_watch_publish(msg_id);
+}
+
+/* Drop the acknowledged notifications from the front. Locked. */
+static void held_trim(void)
+{
+    while (s_held_count && s_held[s_held_head].msg_id == ALERT_ACKED) {
+        s_held_head = (s_held_head + 1) % ALERT_HELD_LEN;
+        s_held_count--;
+    }
+}
+
+static void alert_mqtt_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == RMAKER_MQTT_EVENT_PUBLISHED && data) {
+        int msg_id = *(int *)data;
+        portENTER_CRITICAL(&s_lock);
+        for (int i = 0; i < s_held_count; i++) {
+            alert_held_t *h = &s_held[(s_held_head + i) % ALERT_HELD_LEN];
+            if (h->msg_id == msg_id) {
+                h->msg_id = ALERT_ACKED;
+            }
+        }
+        held_trim();
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    if (id != RMAKER_MQTT_EVENT_CONNECTED) {
+        return;
+    }
+    /* New session: everything still held goes out again, oldest first */
+    char msg[ALERT_MSG_LEN];
+    uint32_t done = 0;
+    while (1) {
+        uint32_t seq = 0;
+        portENTER_CRITICAL(&s_lock);
+        for (int i = 0; i < s_held_count; i++) {
+            alert_held_t *h = &s_held[(s_held_head + i) % ALERT_HELD_LEN];
+            if (h->seq > done && h->msg_id != ALERT_ACKED) {
+                seq = h->seq;
+                memcpy(msg, h->msg, sizeof(msg));
+                break;
+            }
+        }
+        uint32_t dropped = s_held_dropped;
+        s_held_dropped = 0;
+        portEXIT_CRITICAL(&s_lock);
+        if (dropped) {
+            ESP_LOGW(TAG, "%lu alerts dropped while undelivered", (unsigned long)dropped);
+        }
+        if (!seq) {
+            break;
+        }
+        publish(seq, msg);
+        done = seq;
+    }
+}
+
+#ifdef CONFIG_APP_UPLINK_SHARED
+/* Hand the oldest unacknowledged notification to the leader, if we follow one */
+static void forward_held(void)
+{
+    char msg[ALERT_MSG_LEN];
+    uint32_t seq = 0;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_held_count && !seq; i++) {
+        alert_held_t *h = &s_held[(s_held_head + i) % ALERT_HELD_LEN];
+        if (h->msg_id != ALERT_ACKED) {
+            seq = h->seq;
+            memcpy(msg, h->msg, sizeof(msg));
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (!seq || app_conn_is_online()) {
+        return;     // nothing held, or published on our own session
+    }
+    app_uplink_forward_alert(seq, msg);
+    /* Again until acknowledged; also covers having no live leader right now */
+    app_timer_start(&s_forward_timer, ALERT_FORWARD_RETRY_MS);
+}
+
+static void forward_timer_cb(app_timer_t *timer, void *arg)
+{
+    forward_held();
+}
+
+void app_alert_forward_acked(uint32_t seq)
+{
+    bool found = false;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_held_count; i++) {
+        alert_held_t *h = &s_held[(s_held_head + i) % ALERT_HELD_LEN];
+        if (h->seq == seq && h->msg_id != ALERT_ACKED) {
+            h->msg_id = ALERT_ACKED;
+            found = true;
+        }
+    }
+    held_trim();
+    portEXIT_CRITICAL(&s_lock);
+    if (found) {
+        forward_held();
+    }
+}
+
+esp_err_t app_alert_relay(const char *msg)
+{
+    ESP_LOGI(TAG, "[relay] %s", msg);
+    uint32_t seq = held_add(msg);
+    if (app_conn_is_online()) {
+        publish(seq, msg);
+    }
+    return ESP_OK;
+}
+#endif
+
+static void send(app_alert_prio_t prio, const char *msg, uint32_t count)
+{
+    ESP_LOGI(TAG, "[%s] %s", s_prio_name[prio], msg);
+    ESP_DIAG_EVENT("ALERT", "%s: %s (%u)", s_prio_name[prio], msg, (unsigned)count);
+    uint32_t seq = held_add(msg);
+    if (app_conn_is_online()) {
+        publish(seq, msg);
+    }
+#ifdef CONFIG_APP_UPLINK_SHARED
+    else if (!app_timer_is_active(&s_forward_timer)) {
+        /* A follower has no cloud session of its own; one forwarded at a time */
+        forward_held();
+    }
+#endif
+}
+
+static void window_timer_cb(app_timer_t *timer, void *arg)
+{
+    app_alert_prio_t prio = (app_alert_prio_t)(intptr_t)arg;
+    alert_chan_t *ch = &s_chan[prio];
+    char msg[ALERT_MSG_LEN];
+    char what[ALERT_TEXT_LEN];
+    char zones[ALERT_ZONES_LEN];
+    uint32_t count = 0;
+    uint32_t zone_mask = 0;
+    bool reopen = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (ch->suppressed == 0) {
+        ch->window_open = false;
+    } else {
+        reopen = true;
+        if (take_token(prio)) {
+            count = ch->suppressed;
+            zone_mask = ch->zones;
+            memcpy(what, ch->what, sizeof(what));
+            ch->suppressed = 0;
+            ch->zones = 0;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (count) {
+        format_zones(zones, sizeof(zones), zone_mask);
+        snprintf(msg, sizeof(msg), "%s: %u more in zone%s %s in the last %d s", what, (unsigned)count,
+                 strchr(zones, ',') ? "s" : "", zones, CONFIG_APP_ALERT_WINDOW_SEC);
+        send(prio, msg, count);
+    }
+    if (reopen) {
+        /* Over budget: keep counting and try again after another window */
+        app_timer_start(&ch->timer, ALERT_WINDOW_MS);
+    }
+}
+
+esp_err_t app_alert_raise(app_alert_prio_t prio, uint8_t zone, const char *what)
+{
+    if (prio >= APP_ALERT_PRIO_MAX || zone > APP_ZONE_MAX || !what) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    alert_chan_t *ch = &s_chan[prio];
+    bool first = false;
+    bool sent = false;
+    char text[ALERT_TEXT_LEN];
+    snprintf(text, sizeof(text), "%s", what);
+
+    portENTER_CRITICAL(&s_lock);
+    if (!ch->window_open) {
+        first = true;
+        ch->window_open = true;
+        memcpy(ch->what, text, sizeof(ch->what));
+        ch->suppressed = 0;
+        ch->zones = 0;
+        sent = take_token(prio);
+    }
+    if (!sent) {
+        ch->suppressed++;
+        ch->zones |= 1u << zone;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (sent) {
+        send(prio, what, 1);
+    }
+    if (first) {
+        app_timer_start(&ch->timer, ALERT_WINDOW_MS);
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_alert_init(void)
+{
+    for (int i = 0; i < APP_ALERT_PRIO_MAX; i++) {
+        app_timer_setup(&s_chan[i].timer, window_timer_cb, (void *)(intptr_t)i);
+    }
+#ifdef CONFIG_APP_UPLINK_SHARED
+    app_timer_setup(&s_forward_timer, forward_timer_cb, NULL);
+#endif
+    /* Start with a full budget */
+    s_bucket_us = esp_timer_get_time() - CONFIG_APP_ALERT_MAX_PER_HOUR * ALERT_TOKEN_US;
+    return esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, alert_mqtt_handler, NULL);
+}
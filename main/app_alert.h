@@ -0,0 +1,70 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    APP_ALERT_HIGH = 0,     // intrusion: may use the reserved part of the budget
+    APP_ALERT_LOW,          // advisory: unusual activity, rule notifications
+    APP_ALERT_PRIO_MAX,
+} app_alert_prio_t;
+
+/* Start the alert manager
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_alert_init(void);
+
+/* Raise a push notification through the alert manager
+ *
+ * The first alert of a priority is sent immediately and opens a coalescing
+ * window of CONFIG_APP_ALERT_WINDOW_SEC. Further alerts in the window are
+ * only counted; when it closes, one follow-up lists the count and the
+ * affected zones, and a new window starts. All notifications share a budget
+ * of CONFIG_APP_ALERT_MAX_PER_HOUR, and low-priority alerts cannot use the
+ * last CONFIG_APP_ALERT_HIGH_RESERVE of it. Alerts over budget are carried
+ * into the next follow-up instead of being dropped.
+ *
+ * @param[in] prio Alert priority.
+ * @param[in] zone Zone index (0 = local door sensor), 0..APP_ZONE_MAX.
+ * @param[in] what Notification text for the first alert of a window.
+ *
+ * @return ESP_OK if the alert was sent or coalesced.
+ * @return error in case of failure.
+ */
+esp_err_t app_alert_raise(app_alert_prio_t prio, uint8_t zone, const char *what);
+
+/* Publish a notification forwarded by a shared-uplink follower
+ *
+ * Called on the leader. The notification is held and published like the
+ * node's own, without coalescing or budget, which the follower applied.
+ *
+ * @param[in] msg Notification text, already prefixed with the follower's id.
+ *
+ * @return ESP_OK once the notification is held for delivery.
+ */
+esp_err_t app_alert_relay(const char *msg);
+
+/* The leader has taken the forwarded notification seq: stop holding it
+ *
+ * Called on a shared-uplink follower; the next held notification, if any, is
+ * forwarded.
+ *
+ * @param[in] seq Id the notification was forwarded with.
+ */
+void app_alert_forward_acked(uint32_t seq);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,79 @@
+/* Door activity anomaly detector
+ *
+ * Judges each door open against the per-hour-of-day baseline that
+ * app_occupancy.c already keeps (decayed mean and mean absolute deviation of
+ * the opens in that hour, separately for workdays and weekends, Q8 fixed
+ * point, learned from whole hours only and persisted in NVS). This module
+ * keeps no counters, timer or model of its own.
+ *
+ * An open while disarmed is unusual when the opens so far this hour exceed
+ * mean + 4 * dev + 0.5, i.e. a single open in an hour that has been quiet
+ * every day is enough. One alert per hour at most.
+ *
+ * Per event: one copy of the current hour from app_occupancy and one compare.
+ */
+
+#include <stdio.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_diagnostics.h>
+
+#include "app_anomaly.h"
+#include "app_occupancy.h"
+#include "app_events.h"
+#include "app_priv.h"
+#include "app_alert.h"
+
+static const char *TAG = "app_anomaly";
+
+#define ANOMALY_MIN_DAYS        5       // days of the same kind before an hour is judged
+#define ANOMALY_DEV_MULT        4
+#define ANOMALY_SLACK_Q8        128     // +0.5 open
+#define ANOMALY_HOUR_US         (3600 * 1000000LL)
+#define Q8                      256
+
+/* Last alert; only touched from the event loop task */
+static int s_alert_hour = -1;
+static int64_t s_alert_us;
+
+static bool hour_unusual(const app_occupancy_hour_t *hr)
+{
+    if (hr->days < ANOMALY_MIN_DAYS) {
+        return false;
+    }
+    int64_t limit = hr->base_q8 + ANOMALY_DEV_MULT * (int64_t)hr->dev_q8 + ANOMALY_SLACK_Q8;
+    return (int64_t)hr->opens * Q8 > limit;
+}
+
+static void anomaly_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const app_event_data_t *ev = data;
+    if (ev && ev->src == APP_EVENT_SRC_TEST) {
+        return;
+    }
+    /* app_occupancy registered first, so this open is already counted */
+    app_occupancy_hour_t hr;
+    app_occupancy_get_hour(&hr);
+    if (hr.hour < 0 || app_alarm_is_enabled() || !hour_unusual(&hr)) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (hr.hour == s_alert_hour && now - s_alert_us < ANOMALY_HOUR_US) {
+        return;
+    }
+    s_alert_hour = hr.hour;
+    s_alert_us = now;
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "Unusual door activity: %u opens between %02d:00 and %02d:00",
+             (unsigned)hr.opens, hr.hour, (hr.hour + 1) % 24);
+    ESP_LOGW(TAG, "%s", msg);
+    ESP_DIAG_EVENT("ANOMALY", "hour %d: %u opens, usual %u.%02u", hr.hour, (unsigned)hr.opens,
+                   (unsigned)(hr.base_q8 / Q8), (unsigned)(hr.base_q8 % Q8 * 100 / Q8));
+    app_alert_raise(APP_ALERT_LOW, 0, msg);
+}
+
+esp_err_t app_anomaly_init(void)
+{
+    return esp_event_handler_register(APP_EVENT, APP_EVENT_DOOR_OPENED, anomaly_event_handler, NULL);
+}
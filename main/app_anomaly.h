@@ -0,0 +1,32 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start the door activity anomaly detector
+ *
+ * Raises a low-priority alert when, with the alarm disarmed, the opens in the
+ * current hour exceed what that hour of day usually sees according to the
+ * app_occupancy baseline (mean and mean absolute deviation), workdays and
+ * weekends apart. Needs five days of history of the same kind per hour before
+ * it flags anything.
+ *
+ * Call after app_occupancy_init().
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_anomaly_init(void);
+
+#ifdef __cplusplus
+}
+#endif
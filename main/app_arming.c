@@ -0,0 +1,122 @@
+/* Arming modes
+ *
+ * Each mode has a zone bitmask. The active mask is the mask of the current
+ * mode while armed and 0 while disarmed, recomputed on every mode, mask or
+ * power change, so the trigger check on the sensor path is a single AND.
+ */
+
+#include <string.h>
+#include <esp_log.h>
+#include <esp_diagnostics.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+
+#include "app_arming.h"
+
+static const char *TAG = "app_arming";
+
+static const char *s_mode_names[APP_ARM_MODE_MAX] = {
+    [APP_ARM_AWAY] = "Away",
+    [APP_ARM_STAY] = "Stay",
+    [APP_ARM_NIGHT] = "Night",
+};
+
+static const char *const s_mask_param_names[APP_ARM_MODE_MAX] = {
+    [APP_ARM_AWAY] = "Away Zones",
+    [APP_ARM_STAY] = "Stay Zones",
+    [APP_ARM_NIGHT] = "Night Zones",
+};
+
+/* Defaults: Away watches everything; the local door is an entry door, so
+ * Stay and Night watch it too. Interior zones get added to Away only. */
+static uint32_t s_masks[APP_ARM_MODE_MAX] = {
+    [APP_ARM_AWAY] = APP_ZONE_BIT(APP_ZONE_MAX + 1) - 1,
+    [APP_ARM_STAY] = APP_ZONE_BIT(APP_ZONE_LOCAL_DOOR),
+    [APP_ARM_NIGHT] = APP_ZONE_BIT(APP_ZONE_LOCAL_DOOR),
+};
+
+static app_arm_mode_t s_mode = APP_ARM_AWAY;
+static bool s_armed;
+static volatile uint32_t s_active_mask;
+
+static esp_rmaker_param_t *s_mode_param;
+static esp_rmaker_param_t *s_mask_params[APP_ARM_MODE_MAX];
+
+static void update_active_mask(void)
+{
+    s_active_mask = s_armed ? s_masks[s_mode] : 0;
+}
+
+uint32_t app_arming_triggered(uint32_t changed_zones)
+{
+    return changed_zones & s_active_mask;
+}
+
+void app_arming_set_armed(bool armed)
+{
+    s_armed = armed;
+    update_active_mask();
+}
+
+app_arm_mode_t app_arming_get_mode(void)
+{
+    return s_mode;
+}
+
+esp_err_t app_arming_handle_write(const esp_rmaker_param_t *param, const esp_rmaker_param_val_t val)
+{
+    if (param == s_mode_param) {
+        if (val.type != RMAKER_VAL_TYPE_STRING || !val.val.s) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        int mode = -1;
+        for (int i = 0; i < APP_ARM_MODE_MAX; i++) {
+            if (strcmp(val.val.s, s_mode_names[i]) == 0) {
+                mode = i;
+            }
+        }
+        if (mode < 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_mode = mode;
+        ESP_DIAG_EVENT("ALARM_ACTION", "Arming mode: %s (zones 0x%08x)", s_mode_names[s_mode],
+                       (unsigned)s_masks[s_mode]);
+    } else {
+        int mode = -1;
+        for (int i = 0; i < APP_ARM_MODE_MAX; i++) {
+            if (param == s_mask_params[i]) {
+                mode = i;
+            }
+        }
+        if (mode < 0) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (val.type != RMAKER_VAL_TYPE_INTEGER || val.val.i < 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_masks[mode] = (uint32_t)val.val.i;
+        ESP_LOGI(TAG, "%s = 0x%08x", s_mask_param_names[mode], (unsigned)s_masks[mode]);
+    }
+    update_active_mask();
+    esp_rmaker_param_update(param, val);
+    return ESP_OK;
+}
+
+esp_err_t app_arming_init(esp_rmaker_device_t *alarm_dev)
+{
+    s_mode_param = esp_rmaker_param_create("Arming Mode", NULL, esp_rmaker_str(s_mode_names[s_mode]),
+                                           PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    esp_rmaker_param_add_ui_type(s_mode_param, ESP_RMAKER_UI_DROPDOWN);
+    esp_rmaker_param_add_valid_str_list(s_mode_param, s_mode_names, APP_ARM_MODE_MAX);
+    esp_rmaker_device_add_param(alarm_dev, s_mode_param);
+
+    for (int i = 0; i < APP_ARM_MODE_MAX; i++) {
+        s_mask_params[i] = esp_rmaker_param_create(s_mask_param_names[i], NULL, esp_rmaker_int(s_masks[i]),
+                                                   PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+        esp_rmaker_device_add_param(alarm_dev, s_mask_params[i]);
+    }
+    /* Persisted values are restored through write_cb (ESP_RMAKER_REQ_SRC_INIT) */
+    update_active_mask();
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_ZONE_BIT(zone)  (1u << (zone))
+#define APP_ZONE_LOCAL_DOOR 0       // this node's door sensor
+#define APP_ZONE_MAX        30      // masks are int params, so bit 31 cannot be set
+
+typedef enum {
+    APP_ARM_AWAY = 0,       // every zone
+    APP_ARM_STAY,           // perimeter only, interior zones bypassed
+    APP_ARM_NIGHT,          // entry doors only
+    APP_ARM_MODE_MAX,
+} app_arm_mode_t;
+
+/* Add the arming params to the Alarm System device
+ *
+ * Params: "Arming Mode" (Away/Stay/Night) and one zone bitmask per mode
+ * ("Away Zones", "Stay Zones", "Night Zones"; bit n = zone n), all persisted.
+ *
+ * @param[in] alarm_dev Alarm System device handle.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_arming_init(esp_rmaker_device_t *alarm_dev);
+
+/* Handle a write to one of the arming params
+ *
+ * @return ESP_OK if the param belongs to arming and was applied.
+ * @return ESP_ERR_NOT_FOUND if the param is not an arming param.
+ * @return error in case of failure.
+ */
+esp_err_t app_arming_handle_write(const esp_rmaker_param_t *param, const esp_rmaker_param_val_t val);
+
+/* Armed state changed (Alarm System Power) */
+void app_arming_set_armed(bool armed);
+
+/* Zones among changed_zones that trigger the alarm right now
+ *
+ * One AND with the active mask (all zero while disarmed), whatever the
+ * number of zones.
+ */
+uint32_t app_arming_triggered(uint32_t changed_zones);
+
+app_arm_mode_t app_arming_get_mode(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,469 @@
+/* Connection manager
+ *
+ * After a power cut every node in the street boots, joins Wi-Fi and opens a
+ * TLS session to the broker at the same moment, and then retries on the same
+ * fixed interval. This module spreads that out:
+ *
+ *   - a provisioned node waits a random 0..CONFIG_APP_CONN_BOOT_JITTER_MS
+ *     before starting Wi-Fi, so the first association and broker connect of
+ *     the fleet are spread too
+ *   - app_network_start() failures are retried with backoff, instead of
+ *     aborting (the alarm keeps running meanwhile)
+ *   - once the cloud session drops, the manager takes reconnection over from
+ *     the MQTT client and paces it with decorrelated jitter:
+ *         sleep = min(cap, random(base, 3 * sleep))
+ *     restarting from a fresh draw when Wi-Fi comes back, so nodes that lost
+ *     the AP together do not hit the broker together
+ *
+ * Wi-Fi re-association itself stays with app_network. Alerts raised while
+ * offline are held by the alert manager and sent on reconnect. Reconnect
+ * attempts, failed attempts and the dead-session detection time are Insights
+ * metrics besides the CONN diag events.
+ *
+ * With CONFIG_APP_UPLINK_SHARED the session is not wanted until app_uplink
+ * makes this node the leader of its home, and RainMaker, which makes the first
+ * connect, is only started then. After a power cut one node per home connects.
+ *
+ * A half-open session (AP up, its uplink gone) still accepts publishes and is
+ * only noticed at the MQTT keepalive, minutes later. Publishes registered with
+ * app_conn_watch_publish() must be acknowledged within
+ * CONFIG_APP_CONN_ACK_TIMEOUT_MS, and while the alarm is armed an empty QoS 1
+ * report probes the session every CONFIG_APP_CONN_PROBE_SEC when nothing else
+ * was acknowledged. A missing ack drops the session and reconnects, and the
+ * alert manager republishes whatever was not acknowledged.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp_wifi.h>
+#include <esp_diagnostics.h>
+#if CONFIG_DIAG_ENABLE_METRICS
+#include <esp_diagnostics_metrics.h>
+#endif
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+#include <app_network.h>
+
+#include "app_conn.h"
+#include "app_events.h"
+
+static const char *TAG = "app_conn";
+
+#define CONN_TASK_STACK         4096
+#define CONN_TASK_PRIO          3
+#define CONN_ATTEMPT_TIMEOUT_US (30 * 1000000LL)
+#define CONN_ACK_TIMEOUT_US     (CONFIG_APP_CONN_ACK_TIMEOUT_MS * 1000LL)
+#define CONN_PROBE_US           (CONFIG_APP_CONN_PROBE_SEC * 1000000LL)
+#define CONN_WATCH_MAX          8
+
+#define CONN_METRIC_ATTEMPTS    "conn_attempts"
+#define CONN_METRIC_FAILURES    "conn_failures"
+#define CONN_METRIC_DETECT      "conn_detect_ms"
+
+/* Task notification bits */
+#define CONN_EV_WIFI_UP         (1 << 0)
+#define CONN_EV_WIFI_DOWN       (1 << 1)
+#define CONN_EV_MQTT_UP         (1 << 2)
+#define CONN_EV_MQTT_DOWN       (1 << 3)
+#define CONN_EV_WANTED          (1 << 4)
+#define CONN_EV_WATCH           (1 << 5)
+
+static TaskHandle_t s_task;
+static void (*s_on_network_up)(void);
+static volatile bool s_wifi_up;
+static volatile bool s_mqtt_up;
+#ifdef CONFIG_APP_UPLINK_SHARED
+static volatile bool s_wanted = false;
+static bool s_cloud_started;    // esp_rmaker_start() called
+#else
+static volatile bool s_wanted = true;
+static bool s_cloud_started = true;     // by app_main
+#endif
+static bool s_managed;          // reconnection has been taken over from the MQTT client
+static uint32_t s_sleep_ms = CONFIG_APP_CONN_BACKOFF_BASE_MS;
+static int64_t s_down_since_us;
+static app_conn_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Publishes waiting for their ack (msg_id 0 = free slot) */
+static struct {
+    int msg_id;
+    int64_t sent_us;
+} s_watch[CONN_WATCH_MAX];
+static volatile bool s_probing;
+static int64_t s_alive_us;      // last time the session was known to deliver
+
+/* Next decorrelated-jitter delay */
+static uint32_t conn_backoff_ms(void)
+{
+    uint32_t lo = CONFIG_APP_CONN_BACKOFF_BASE_MS;
+    uint32_t hi = s_sleep_ms * 3;
+    if (hi > CONFIG_APP_CONN_BACKOFF_CAP_MS) {
+        hi = CONFIG_APP_CONN_BACKOFF_CAP_MS;
+    }
+    s_sleep_ms = hi > lo ? lo + esp_random() % (hi - lo + 1) : lo;
+    s_stats.backoff_ms = s_sleep_ms;
+    return s_sleep_ms;
+}
+
+static void conn_metric(const char *key, uint32_t value)
+{
+#if CONFIG_DIAG_ENABLE_METRICS
+    esp_diag_metrics_add_uint(key, value);
+#endif
+}
+
+static void conn_metrics_register(void)
+{
+#if CONFIG_DIAG_ENABLE_METRICS
+    static const struct {
+        const char *key;
+        const char *label;
+    } metrics[] = {
+        { CONN_METRIC_ATTEMPTS, "Cloud reconnect attempts" },
+        { CONN_METRIC_FAILURES, "Cloud reconnects failed" },
+        { CONN_METRIC_DETECT, "Dead session detected after (ms)" },
+    };
+    for (size_t i = 0; i < sizeof(metrics) / sizeof(metrics[0]); i++) {
+        esp_err_t err = esp_diag_metrics_register("CONN", metrics[i].key, metrics[i].label, "app.conn",
+                                                  ESP_DIAG_DATA_TYPE_UINT);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to register metric %s: %s", metrics[i].key, esp_err_to_name(err));
+        }
+    }
+#endif
+}
+
+static void conn_notify(uint32_t bits)
+{
+    if (s_task) {
+        xTaskNotify(s_task, bits, eSetBits);
+    }
+}
+
+static void conn_watch_clear(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_watch, 0, sizeof(s_watch));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void conn_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        if (s_wifi_up) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.wifi_disconnects++;
+            portEXIT_CRITICAL(&s_lock);
+        }
+        s_wifi_up = false;
+        conn_notify(CONN_EV_WIFI_DOWN);
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        s_wifi_up = true;
+        conn_notify(CONN_EV_WIFI_UP);
+    } else if (base == RMAKER_COMMON_EVENT && id == RMAKER_MQTT_EVENT_CONNECTED) {
+        s_alive_us = esp_timer_get_time();
+        s_mqtt_up = true;
+        conn_notify(CONN_EV_MQTT_UP);
+    } else if (base == RMAKER_COMMON_EVENT && id == RMAKER_MQTT_EVENT_DISCONNECTED) {
+        if (s_mqtt_up) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.mqtt_disconnects++;
+            portEXIT_CRITICAL(&s_lock);
+        }
+        s_mqtt_up = false;
+        conn_watch_clear();
+        conn_notify(CONN_EV_MQTT_DOWN);
+    } else if (base == RMAKER_COMMON_EVENT && id == RMAKER_MQTT_EVENT_PUBLISHED && data) {
+        int msg_id = *(int *)data;
+        portENTER_CRITICAL(&s_lock);
+        for (int i = 0; i < CONN_WATCH_MAX; i++) {
+            if (s_watch[i].msg_id == msg_id) {
+                s_watch[i].msg_id = 0;
+            }
+        }
+        portEXIT_CRITICAL(&s_lock);
+        s_alive_us = esp_timer_get_time();
+    } else if (base == APP_EVENT && (id == APP_EVENT_ALARM_ARMED || id == APP_EVENT_ALARM_DISARMED)) {
+        s_probing = id == APP_EVENT_ALARM_ARMED;
+        conn_notify(CONN_EV_WATCH);
+    }
+}
+
+/* ---------------- Bring-up ---------------- */
+
+static bool conn_provisioned(void)
+{
+    wifi_config_t cfg;
+    return esp_wifi_get_config(WIFI_IF_STA, &cfg) == ESP_OK && cfg.sta.ssid[0] != '\0';
+}
+
+static void conn_network_start(void)
+{
+    if (conn_provisioned() && CONFIG_APP_CONN_BOOT_JITTER_MS > 0) {
+        uint32_t delay = esp_random() % (CONFIG_APP_CONN_BOOT_JITTER_MS + 1);
+        ESP_LOGI(TAG, "Starting network in %lu ms", (unsigned long)delay);
+        vTaskDelay(pdMS_TO_TICKS(delay));
+    }
+    esp_err_t err;
+    while ((err = app_network_start(POP_TYPE_RANDOM)) != ESP_OK) {
+        s_stats.network_start_failures++;
+        uint32_t delay = conn_backoff_ms();
+        ESP_LOGW(TAG, "Network start failed (%s), retrying in %lu ms", esp_err_to_name(err), (unsigned long)delay);
+        ESP_DIAG_EVENT("CONN", "Network start failed: %s", esp_err_to_name(err));
+        vTaskDelay(pdMS_TO_TICKS(delay));
+    }
+    s_sleep_ms = CONFIG_APP_CONN_BACKOFF_BASE_MS;
+}
+
+/* ---------------- Liveness ---------------- */
+
+/* The session took publishes but acknowledged none of them in time */
+static void conn_dead(int64_t now)
+{
+    uint32_t detect_ms = (now - s_alive_us) / 1000;
+    portENTER_CRITICAL(&s_lock);
+    s_stats.dead_sessions++;
+    s_stats.last_detect_ms = detect_ms;
+    portEXIT_CRITICAL(&s_lock);
+    conn_metric(CONN_METRIC_DETECT, detect_ms);
+    ESP_LOGW(TAG, "No publish ack, dropping the cloud session (silent for %lu ms)", (unsigned long)detect_ms);
+    ESP_DIAG_EVENT("CONN", "Dead session detected after %lu ms silent", (unsigned long)detect_ms);
+    conn_watch_clear();
+    s_mqtt_up = false;
+    esp_rmaker_mqtt_disconnect();
+    conn_notify(CONN_EV_MQTT_DOWN);
+}
+
+static void conn_probe(int64_t now)
+{
+    char topic[64];
+    char empty[] = "{}";    // a param report that changes nothing
+    int msg_id = -1;
+    snprintf(topic, sizeof(topic), "node/%s/params/local", esp_rmaker_get_node_id());
+    if (esp_rmaker_mqtt_publish(topic, empty, strlen(empty), 1, &msg_id) == ESP_OK && msg_id > 0) {
+        app_conn_watch_publish(msg_id);
+    } else {
+        s_alive_us = now;   // not accepted locally: try again next interval
+    }
+}
+
+/* Time out watched publishes and probe while armed.
+ * Returns when to look again, 0 if nothing is pending. */
+static int64_t conn_liveness(int64_t now)
+{
+    if (!s_mqtt_up) {
+        return 0;
+    }
+    int64_t oldest = 0;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < CONN_WATCH_MAX; i++) {
+        if (s_watch[i].msg_id && (!oldest || s_watch[i].sent_us < oldest)) {
+            oldest = s_watch[i].sent_us;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (oldest) {
+        if (now - oldest >= CONN_ACK_TIMEOUT_US) {
+            conn_dead(now);
+            return 0;
+        }
+        return oldest + CONN_ACK_TIMEOUT_US;
+    }
+    if (!s_probing) {
+        return 0;
+    }
+    if (now - s_alive_us >= CONN_PROBE_US) {
+        conn_probe(now);
+        return now + CONN_ACK_TIMEOUT_US;
+    }
+    return s_alive_us + CONN_PROBE_US;
+}
+
+/* ---------------- Cloud session ---------------- */
+
+static void conn_record_up(int64_t now)
+{
+    if (s_down_since_us) {
+        uint32_t outage_ms = (now - s_down_since_us) / 1000;
+        portENTER_CRITICAL(&s_lock);
+        s_stats.last_outage_ms = outage_ms;
+        if (outage_ms > s_stats.max_outage_ms) {
+            s_stats.max_outage_ms = outage_ms;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGI(TAG, "Cloud session back after %lu ms", (unsigned long)outage_ms);
+        ESP_DIAG_EVENT("CONN", "Reconnected after %lu ms: %lu attempts %lu failed, %lu wifi drops, backoff %lu ms",
+                       (unsigned long)outage_ms, (unsigned long)s_stats.mqtt_attempts,
+                       (unsigned long)s_stats.mqtt_failures, (unsigned long)s_stats.wifi_disconnects,
+                       (unsigned long)s_stats.backoff_ms);
+        s_down_since_us = 0;
+    }
+    s_sleep_ms = CONFIG_APP_CONN_BACKOFF_BASE_MS;
+}
+
+static void conn_supervise(void)
+{
+    int64_t next_attempt_us = 0;    // 0 = nothing scheduled
+    int64_t deadline_us = 0;        // attempt in flight until then, 0 = none
+
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        int64_t due = deadline_us ? deadline_us : (s_wifi_up ? next_attempt_us : 0);
+        int64_t live = conn_liveness(now);
+        if (live && (!due || live < due)) {
+            due = live;
+        }
+        TickType_t wait = portMAX_DELAY;
+        if (due) {
+            wait = due > now ? pdMS_TO_TICKS((due - now) / 1000) + 1 : 0;
+        }
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+        now = esp_timer_get_time();
+
+        if (bits & CONN_EV_MQTT_UP) {
+            deadline_us = next_attempt_us = 0;
+            conn_record_up(now);
+        }
+        if (bits & CONN_EV_MQTT_DOWN) {
+            if (!s_down_since_us) {
+                s_down_since_us = now;
+            }
+        }
+        if (!s_wanted) {
+            if (s_mqtt_up || deadline_us) {
+                esp_rmaker_mqtt_disconnect();
+            }
+            deadline_us = next_attempt_us = 0;
+            s_managed = true;
+            continue;
+        }
+        if (!s_cloud_started) {
+            /* Elected: RainMaker makes the first connect itself */
+            ESP_LOGI(TAG, "Starting RainMaker");
+            esp_rmaker_start();
+            s_cloud_started = true;
+            s_managed = false;
+            continue;
+        }
+        if (s_mqtt_up) {
+            continue;
+        }
+        if ((bits & (CONN_EV_MQTT_DOWN | CONN_EV_WANTED)) && !deadline_us && !next_attempt_us) {
+            /* Stop the client's own fixed-interval retries; we pace them from here */
+            if (bits & CONN_EV_MQTT_DOWN) {
+                esp_rmaker_mqtt_disconnect();
+            }
+            s_managed = true;
+            next_attempt_us = now + conn_backoff_ms() * 1000LL;
+        }
+        if (!s_managed) {
+            continue;   // the first connect after boot is made by RainMaker itself
+        }
+        if ((bits & CONN_EV_WIFI_UP) && !deadline_us) {
+            /* The whole street may have just got its AP back: draw a fresh delay */
+            next_attempt_us = now + conn_backoff_ms() * 1000LL;
+        }
+        if (deadline_us && now >= deadline_us) {
+            s_stats.mqtt_failures++;
+            conn_metric(CONN_METRIC_FAILURES, s_stats.mqtt_failures);
+            esp_rmaker_mqtt_disconnect();
+            deadline_us = 0;
+            next_attempt_us = now + conn_backoff_ms() * 1000LL;
+        }
+        if (next_attempt_us && now >= next_attempt_us && s_wifi_up) {
+            next_attempt_us = 0;
+            s_stats.mqtt_attempts++;
+            conn_metric(CONN_METRIC_ATTEMPTS, s_stats.mqtt_attempts);
+            ESP_LOGI(TAG, "Reconnecting (attempt %lu)", (unsigned long)s_stats.mqtt_attempts);
+            esp_rmaker_mqtt_connect();
+            deadline_us = now + CONN_ATTEMPT_TIMEOUT_US;
+        }
+    }
+}
+
+static void conn_task(void *arg)
+{
+    conn_network_start();
+    if (s_on_network_up) {
+        s_on_network_up();
+    }
+    conn_supervise();
+}
+
+/* ---------------- API ---------------- */
+
+bool app_conn_is_online(void)
+{
+    return s_mqtt_up;
+}
+
+void app_conn_set_wanted(bool wanted)
+{
+    if (wanted != s_wanted) {
+        s_wanted = wanted;
+        conn_notify(CONN_EV_WANTED);
+    }
+}
+
+void app_conn_watch_publish(int msg_id)
+{
+    int64_t now = esp_timer_get_time();
+    int slot = 0;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < CONN_WATCH_MAX; i++) {
+        if (!s_watch[i].msg_id) {
+            slot = i;
+            break;
+        }
+        if (s_watch[i].sent_us < s_watch[slot].sent_us) {
+            slot = i;   // full: the oldest gives way
+        }
+    }
+    s_watch[slot].msg_id = msg_id;
+    s_watch[slot].sent_us = now;
+    portEXIT_CRITICAL(&s_lock);
+    conn_notify(CONN_EV_WATCH);
+}
+
+void app_conn_get_stats(app_conn_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t app_conn_start(void (*on_network_up)(void))
+{
+    s_on_network_up = on_network_up;
+    esp_err_t err = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, conn_event_handler, NULL);
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, conn_event_handler, NULL);
+    }
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, conn_event_handler, NULL);
+    }
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(APP_EVENT, APP_EVENT_ALARM_ARMED, conn_event_handler, NULL);
+    }
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(APP_EVENT, APP_EVENT_ALARM_DISARMED, conn_event_handler, NULL);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    conn_metrics_register();    // after app_insights_enable()
+    if (xTaskCreate(conn_task, "conn", CONN_TASK_STACK, NULL, CONN_TASK_PRIO, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create connection manager task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
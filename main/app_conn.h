@@ -0,0 +1,69 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t network_start_failures;
+    uint32_t wifi_disconnects;
+    uint32_t mqtt_disconnects;
+    uint32_t mqtt_attempts;     // reconnect attempts made by the manager
+    uint32_t mqtt_failures;     // attempts that did not connect in time
+    uint32_t backoff_ms;        // last delay drawn
+    uint32_t last_outage_ms;    // cloud session down -> up
+    uint32_t max_outage_ms;
+    uint32_t dead_sessions;     // sessions dropped for a missing publish ack
+    uint32_t last_detect_ms;    // last ack seen -> session declared dead
+} app_conn_stats_t;
+
+/* Start the connection manager task
+ *
+ * The task brings the network up (after a random delay of up to
+ * CONFIG_APP_CONN_BOOT_JITTER_MS on a provisioned node, and retrying
+ * app_network_start() with backoff instead of giving up), calls on_network_up
+ * once, and then reconnects the cloud session with decorrelated-jitter
+ * exponential backoff whenever it drops. Local features keep running
+ * throughout.
+ *
+ * @param[in] on_network_up Called from the manager task once the network is started.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_conn_start(void (*on_network_up)(void));
+
+/* Whether the cloud (MQTT) session is up */
+bool app_conn_is_online(void);
+
+/* Keep or drop the cloud session, e.g. for a shared-uplink follower
+ *
+ * Wanted by default, except with CONFIG_APP_UPLINK_SHARED: then the session is
+ * not wanted, and RainMaker not started, until the node is elected leader.
+ */
+void app_conn_set_wanted(bool wanted);
+
+/* Expect an ack for a QoS 1 publish made on the current session
+ *
+ * If it is not acknowledged within CONFIG_APP_CONN_ACK_TIMEOUT_MS the session
+ * is considered dead: it is dropped and reconnected.
+ *
+ * @param[in] msg_id Message id returned by esp_rmaker_mqtt_publish().
+ */
+void app_conn_watch_publish(int msg_id);
+
+void app_conn_get_stats(app_conn_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,191 @@
+/* Sunset automation for the Home Light
+ *
+ * "On at sunset (+/- offset), off at a fixed local time", computed on-device
+ * from the configured location with esp_daylight.
+ *
+ * - Sunrise/sunset is computed at most once per calendar day and cached.
+ * - Only the next trigger is armed, as a single one-shot esp_timer. When it fires
+ *   the light is switched and the following trigger is armed. No polling loop.
+ *
+ * The trigger times themselves come from app_daylight_sched.c.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_diagnostics.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+#include <esp_rmaker_utils.h>
+#include <esp_daylight.h>
+
+#include "app_daylight.h"
+#include "app_daylight_sched.h"
+#include "app_priv.h"
+
+static const char *TAG = "app_daylight";
+
+/* Re-evaluate at least this often so that timezone/DST changes from the
+ * timezone service are picked up even when the next trigger is far away. */
+#define DAYLIGHT_MAX_ARM_SEC        (60 * 60)
+/* Retry interval while SNTP has not yet given us wall-clock time */
+#define DAYLIGHT_TIME_RETRY_SEC     60
+
+#define DAYLIGHT_OFFSET_MIN_MINUTES (-180)
+#define DAYLIGHT_OFFSET_MAX_MINUTES 180
+
+static bool s_enabled;
+static app_daylight_sched_t s_sched = {
+    .offset_min = 0,
+    .off_minute = 23 * 60,
+    .sun = esp_daylight_calc_sunrise_sunset_utc,
+};
+static esp_timer_handle_t s_timer;
+
+static esp_rmaker_param_t *s_enable_param;
+static esp_rmaker_param_t *s_offset_param;
+static esp_rmaker_param_t *s_off_time_param;
+static esp_rmaker_param_t *s_lat_param;
+static esp_rmaker_param_t *s_lon_param;
+
+/* ---------------- Helpers ---------------- */
+
+/* Parse "HH:MM" into minute of day. Empty string disables auto off. */
+static int parse_hhmm(const char *str)
+{
+    int h, m;
+    if (!str || str[0] == '\0') {
+        return -1;
+    }
+    if (sscanf(str, "%d:%d", &h, &m) != 2 || h < 0 || h > 23 || m < 0 || m > 59) {
+        return -2;
+    }
+    return h * 60 + m;
+}
+
+/* ---------------- Trigger scheduling ---------------- */
+
+/* Find the next ON/OFF trigger after now and arm the timer for it */
+static void daylight_rearm(void)
+{
+    esp_timer_stop(s_timer);
+    if (!s_enabled) {
+        return;
+    }
+    if (!esp_rmaker_time_check()) {
+        ESP_LOGI(TAG, "Waiting for time sync");
+        esp_timer_start_once(s_timer, (uint64_t)DAYLIGHT_TIME_RETRY_SEC * 1000000ULL);
+        return;
+    }
+
+    time_t now = time(NULL);
+    const app_daylight_day_t *c = app_daylight_sched_day(&s_sched, now, 0);
+    if (c->valid) {
+        ESP_LOGD(TAG, "Today: sunrise %lld sunset %lld", (long long)c->sunrise, (long long)c->sunset);
+    } else {
+        ESP_LOGD(TAG, "Today: no sunset at this location");
+    }
+    time_t next = app_daylight_sched_next(&s_sched, now, now + DAYLIGHT_MAX_ARM_SEC);
+
+    ESP_LOGI(TAG, "Next evaluation in %lld s", (long long)(next - now));
+    esp_timer_start_once(s_timer, (uint64_t)(next - now) * 1000000ULL);
+}
+
+static void daylight_timer_cb(void *arg)
+{
+    if (s_enabled && esp_rmaker_time_check()) {
+        int state = app_daylight_sched_due(&s_sched, time(NULL));
+        if (state >= 0) {
+            ESP_DIAG_EVENT("LIGHT_ACTION", "Sunset automation: Light -> %s", state ? "ON" : "OFF");
+            app_light_set(state == 1);
+        }
+    }
+    daylight_rearm();
+}
+
+/* ---------------- RainMaker params ---------------- */
+
+esp_err_t app_daylight_handle_write(const esp_rmaker_param_t *param, const esp_rmaker_param_val_t val)
+{
+    if (param == s_enable_param) {
+        s_enabled = val.val.b;
+    } else if (param == s_offset_param) {
+        int offset = val.val.i;
+        if (offset < DAYLIGHT_OFFSET_MIN_MINUTES || offset > DAYLIGHT_OFFSET_MAX_MINUTES) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_sched.offset_min = offset;
+    } else if (param == s_off_time_param) {
+        int minute = parse_hhmm(val.val.s);
+        if (minute == -2) {
+            ESP_LOGW(TAG, "Invalid off time \"%s\", expected HH:MM", val.val.s);
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_sched.off_minute = minute;
+    } else if (param == s_lat_param) {
+        if (val.val.f < -90.0f || val.val.f > 90.0f) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_sched.latitude = val.val.f;
+        app_daylight_sched_invalidate(&s_sched);
+    } else if (param == s_lon_param) {
+        if (val.val.f < -180.0f || val.val.f > 180.0f) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        s_sched.longitude = val.val.f;
+        app_daylight_sched_invalidate(&s_sched);
+    } else {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_rmaker_param_update(param, val);
+    daylight_rearm();
+    return ESP_OK;
+}
+
+esp_err_t app_daylight_init(esp_rmaker_device_t *light_dev)
+{
+    app_daylight_sched_invalidate(&s_sched);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = daylight_timer_cb,
+        .name = "daylight",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create daylight timer");
+        return err;
+    }
+
+    s_enable_param = esp_rmaker_param_create("Sunset Auto", NULL, esp_rmaker_bool(s_enabled),
+                                             PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    esp_rmaker_param_add_ui_type(s_enable_param, ESP_RMAKER_UI_TOGGLE);
+
+    s_offset_param = esp_rmaker_param_create("Sunset Offset", NULL, esp_rmaker_int(s_sched.offset_min),
+                                             PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    esp_rmaker_param_add_ui_type(s_offset_param, ESP_RMAKER_UI_SLIDER);
+    esp_rmaker_param_add_bounds(s_offset_param, esp_rmaker_int(DAYLIGHT_OFFSET_MIN_MINUTES),
+                                esp_rmaker_int(DAYLIGHT_OFFSET_MAX_MINUTES), esp_rmaker_int(5));
+
+    s_off_time_param = esp_rmaker_param_create("Auto Off Time", NULL, esp_rmaker_str("23:00"),
+                                               PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    esp_rmaker_param_add_ui_type(s_off_time_param, ESP_RMAKER_UI_TEXT);
+
+    s_lat_param = esp_rmaker_param_create("Latitude", NULL, esp_rmaker_float(s_sched.latitude),
+                                          PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    s_lon_param = esp_rmaker_param_create("Longitude", NULL, esp_rmaker_float(s_sched.longitude),
+                                          PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+
+    esp_rmaker_device_add_param(light_dev, s_enable_param);
+    esp_rmaker_device_add_param(light_dev, s_offset_param);
+    esp_rmaker_device_add_param(light_dev, s_off_time_param);
+    esp_rmaker_device_add_param(light_dev, s_lat_param);
+    esp_rmaker_device_add_param(light_dev, s_lon_param);
+
+    /* Persisted values are restored through write_cb (ESP_RMAKER_REQ_SRC_INIT),
+     * which calls app_daylight_handle_write() and arms the timer. */
+    return ESP_OK;
+}
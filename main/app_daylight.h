@@ -0,0 +1,42 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Add the sunset automation params to the Home Light device
+ *
+ * Params: "Sunset Auto" (bool), "Sunset Offset" (minutes), "Auto Off Time" (HH:MM),
+ * "Latitude" and "Longitude" (degrees). All of them persist across reboots.
+ *
+ * @param[in] light_dev Home Light device handle.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_daylight_init(esp_rmaker_device_t *light_dev);
+
+/* Handle a write to one of the sunset automation params
+ *
+ * Called from write_cb for the Home Light device. Re-arms the trigger timer.
+ *
+ * @return ESP_OK if the param belongs to the daylight automation and was applied.
+ * @return ESP_ERR_NOT_FOUND if the param is not a daylight param.
+ * @return error in case of failure.
+ */
+esp_err_t app_daylight_handle_write(const esp_rmaker_param_t *param, const esp_rmaker_param_val_t val);
+
+#ifdef __cplusplus
+}
+#endif
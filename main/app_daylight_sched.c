@@ -0,0 +1,124 @@
+/* Sunset automation schedule
+ *
+ * Sunset is an absolute (UTC) time, the auto-off time is local wall-clock
+ * time, so a date is always resolved through the local timezone with
+ * mktime(): DST changes move the off time with the clock and leave sunset
+ * where it is. Only the triggers of the previous, current and next local
+ * date are ever looked at.
+ */
+
+#include "app_daylight_sched.h"
+
+/* Tolerance for "trigger just elapsed": the timer may fire a little late */
+#define DAYLIGHT_DUE_WINDOW_SEC     5
+
+/* Local time_t of minute_of_day on the date day_offset days after base.
+ * mktime() normalises overflow. */
+static time_t local_time_on_day(const struct tm *base, int day_offset, int minute_of_day)
+{
+    struct tm t = *base;
+    t.tm_mday += day_offset;
+    t.tm_hour = minute_of_day / 60;
+    t.tm_min = minute_of_day % 60;
+    t.tm_sec = 0;
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+void app_daylight_sched_invalidate(app_daylight_sched_t *sched)
+{
+    for (int i = 0; i < APP_DAYLIGHT_CACHE_SIZE; i++) {
+        sched->cache[i].year = -1;
+    }
+}
+
+static const app_daylight_day_t *sched_lookup(app_daylight_sched_t *sched, const struct tm *base, int day_offset)
+{
+    struct tm day = *base;
+    day.tm_mday += day_offset;
+    day.tm_hour = 12;
+    day.tm_min = 0;
+    day.tm_sec = 0;
+    day.tm_isdst = -1;
+    mktime(&day);   // normalise tm_year/tm_mon/tm_mday/tm_yday
+
+    app_daylight_day_t *slot = &sched->cache[0];
+    for (int i = 0; i < APP_DAYLIGHT_CACHE_SIZE; i++) {
+        app_daylight_day_t *c = &sched->cache[i];
+        if (c->year == day.tm_year && c->yday == day.tm_yday) {
+            return c;
+        }
+        /* Track the oldest entry for eviction on a miss */
+        if (c->year < slot->year || (c->year == slot->year && c->yday < slot->yday)) {
+            slot = c;
+        }
+    }
+
+    slot->year = day.tm_year;
+    slot->yday = day.tm_yday;
+    slot->valid = sched->sun(day.tm_year + 1900, day.tm_mon + 1, day.tm_mday,
+                             sched->latitude, sched->longitude, &slot->sunrise, &slot->sunset);
+    return slot;
+}
+
+const app_daylight_day_t *app_daylight_sched_day(app_daylight_sched_t *sched, time_t now, int day_offset)
+{
+    struct tm today;
+    localtime_r(&now, &today);
+    return sched_lookup(sched, &today, day_offset);
+}
+
+time_t app_daylight_sched_next(app_daylight_sched_t *sched, time_t now, time_t limit)
+{
+    struct tm today;
+    localtime_r(&now, &today);
+
+    /* Yesterday too: sunset + offset can fall after midnight (a positive
+     * offset, or a late sunset near the polar circle) */
+    time_t next = limit;
+    for (int d = -1; d <= 1; d++) {
+        const app_daylight_day_t *c = sched_lookup(sched, &today, d);
+        if (c->valid) {
+            time_t on_at = c->sunset + (time_t)sched->offset_min * 60;
+            if (on_at > now && on_at < next) {
+                next = on_at;
+            }
+        }
+        if (sched->off_minute >= 0) {
+            time_t off_at = local_time_on_day(&today, d, sched->off_minute);
+            if (off_at > now && off_at < next) {
+                next = off_at;
+            }
+        }
+    }
+    return next;
+}
+
+int app_daylight_sched_due(app_daylight_sched_t *sched, time_t now)
+{
+    struct tm today;
+    localtime_r(&now, &today);
+
+    /* Look at yesterday's and today's sunset: the latest trigger not in the future wins */
+    time_t last_on = 0, last_off = 0;
+    for (int d = -1; d <= 0; d++) {
+        const app_daylight_day_t *c = sched_lookup(sched, &today, d);
+        if (c->valid) {
+            time_t on_at = c->sunset + (time_t)sched->offset_min * 60;
+            if (on_at <= now && on_at > last_on) {
+                last_on = on_at;
+            }
+        }
+        if (sched->off_minute >= 0) {
+            time_t off_at = local_time_on_day(&today, d, sched->off_minute);
+            if (off_at <= now && off_at > last_off) {
+                last_off = off_at;
+            }
+        }
+    }
+    time_t last = last_on > last_off ? last_on : last_off;
+    if (last == 0 || now - last > DAYLIGHT_DUE_WINDOW_SEC) {
+        return -1;
+    }
+    return last == last_on ? 1 : 0;
+}
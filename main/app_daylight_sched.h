@@ -0,0 +1,67 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdbool.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sunset automation schedule
+ *
+ * The trigger times of app_daylight.c, from sunset times and the local
+ * timezone (TZ). No ESP-IDF dependencies: host_test/test_daylight.c runs it
+ * over whole years, across DST changes and at polar latitudes.
+ */
+
+/* Sunrise/sunset in UTC for a date. Returns false when the sun does not set
+ * (polar day or night). esp_daylight_calc_sunrise_sunset_utc on the device. */
+typedef bool (*app_daylight_sun_fn_t)(int year, int month, int day, double latitude, double longitude,
+                                      time_t *sunrise, time_t *sunset);
+
+typedef struct {
+    int year;
+    int yday;
+    bool valid;       // false for polar day/night (no sunset on that date)
+    time_t sunrise;
+    time_t sunset;
+} app_daylight_day_t;
+
+/* Yesterday, today and tomorrow */
+#define APP_DAYLIGHT_CACHE_SIZE     3
+
+typedef struct {
+    int offset_min;   // minutes relative to sunset, negative = before sunset
+    int off_minute;   // local minute of day for auto off, -1 = disabled
+    double latitude;
+    double longitude;
+    app_daylight_sun_fn_t sun;
+    app_daylight_day_t cache[APP_DAYLIGHT_CACHE_SIZE];
+} app_daylight_sched_t;
+
+/* Drop cached sunset times, after a location change */
+void app_daylight_sched_invalidate(app_daylight_sched_t *sched);
+
+/* Sunset times of the local date day_offset days after now's, computed at most once per date */
+const app_daylight_day_t *app_daylight_sched_day(app_daylight_sched_t *sched, time_t now, int day_offset);
+
+/* Next ON or OFF trigger after now, or limit if there is none before it */
+time_t app_daylight_sched_next(app_daylight_sched_t *sched, time_t now, time_t limit);
+
+/* State due at now: 1 = ON, 0 = OFF, -1 = no trigger elapsed in the last few seconds
+ *
+ * The light is ON between (sunset + offset) and the off time, crossing
+ * midnight if needed. Only triggers that just elapsed count, so a manual
+ * change is not overridden by a periodic re-evaluation.
+ */
+int app_daylight_sched_due(app_daylight_sched_t *sched, time_t now);
+
+#ifdef __cplusplus
+}
+#endif
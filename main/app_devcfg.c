@@ -0,0 +1,191 @@
+/* Device configuration blob
+ *
+ * Pins, device names, zone names, satellite assignments and default rules,
+ * compiled on the host (tools/devcfg_compile.py) into a binary blob in the
+ * "devcfg" partition. The partition is mapped once at boot and every getter
+ * reads straight from the mapping: there is no parsing and nothing is copied
+ * into RAM, so a blob with hundreds of satellites costs the same at boot as
+ * an empty one, apart from the CRC pass. Names returned are pointers into
+ * flash and stay valid for the life of the firmware.
+ */
+
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <driver/gpio.h>
+
+#include "app_devcfg.h"
+
+static const char *TAG = "app_devcfg";
+
+_Static_assert(sizeof(app_devcfg_header_t) == 52, "devcfg header layout");
+_Static_assert(sizeof(app_devcfg_sat_t) == 12, "devcfg satellite layout");
+
+static const uint8_t *s_blob;   // NULL = use the built-in defaults
+static const app_devcfg_header_t *s_hdr;
+static const app_devcfg_zone_t *s_zones;
+static const app_devcfg_sat_t *s_sats;
+static esp_partition_mmap_handle_t s_map;
+
+/* String at a blob offset, NULL if unset or outside the string table */
+static const char *devcfg_str(uint32_t off)
+{
+    if (!s_blob || !off || off < s_hdr->strings_off || off >= s_hdr->total_len) {
+        return NULL;
+    }
+    return (const char *)s_blob + off;
+}
+
+static bool devcfg_range_ok(uint32_t off, uint32_t len, uint32_t total)
+{
+    return off % 4 == 0 && off <= total && len <= total - off;
+}
+
+static esp_err_t devcfg_validate(const uint8_t *blob, uint32_t size)
+{
+    const app_devcfg_header_t *hdr = (const app_devcfg_header_t *)blob;
+    if (hdr->magic != APP_DEVCFG_MAGIC) {
+        return ESP_ERR_NOT_FOUND;   // blank (erased) partition
+    }
+    if (hdr->version != APP_DEVCFG_VERSION || hdr->hdr_len < sizeof(*hdr)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    uint32_t total = hdr->total_len;
+    if (total > size || total < hdr->hdr_len ||
+        !devcfg_range_ok(hdr->zones_off, hdr->zone_count * sizeof(app_devcfg_zone_t), total) ||
+        !devcfg_range_ok(hdr->sats_off, hdr->sat_count * sizeof(app_devcfg_sat_t), total) ||
+        hdr->strings_off < hdr->hdr_len || hdr->strings_off > total) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    /* A NUL at the end bounds every string in the table */
+    if (total > hdr->strings_off && blob[total - 1] != '\0') {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (esp_rom_crc32_le(0, blob + hdr->hdr_len, total - hdr->hdr_len) != hdr->crc32) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+int app_devcfg_pin(app_devcfg_pin_t pin, int def)
+{
+    if (!s_blob) {
+        return def;
+    }
+    int8_t gpio = -1;
+    switch (pin) {
+    case APP_DEVCFG_LED_GPIO:
+        gpio = s_hdr->led_gpio;
+        break;
+    case APP_DEVCFG_IR_SENSOR_GPIO:
+        gpio = s_hdr->ir_sensor_gpio;
+        break;
+    case APP_DEVCFG_BUZZER_GPIO:
+        gpio = s_hdr->buzzer_gpio;
+        break;
+    }
+    if (gpio < 0) {
+        return def;
+    }
+    if (!GPIO_IS_VALID_GPIO(gpio)) {
+        ESP_LOGW(TAG, "GPIO %d does not exist on this chip, using %d", gpio, def);
+        return def;
+    }
+    /* The LED and the buzzer are driven: an input-only pad (34-39 on the ESP32) would stay silent */
+    if (pin != APP_DEVCFG_IR_SENSOR_GPIO && !GPIO_IS_VALID_OUTPUT_GPIO(gpio)) {
+        ESP_LOGW(TAG, "GPIO %d is input-only on this chip, using %d", gpio, def);
+        return def;
+    }
+    return gpio;
+}
+
+const char *app_devcfg_name(app_devcfg_name_t which, const char *def)
+{
+    if (!s_blob) {
+        return def;
+    }
+    uint32_t off = which == APP_DEVCFG_LIGHT_NAME ? s_hdr->light_name
+                 : which == APP_DEVCFG_ALARM_NAME ? s_hdr->alarm_name : s_hdr->door_name;
+    const char *name = devcfg_str(off);
+    return name && name[0] ? name : def;
+}
+
+const char *app_devcfg_rules(void)
+{
+    return s_blob ? devcfg_str(s_hdr->rules) : NULL;
+}
+
+const char *app_devcfg_zone_name(uint8_t zone)
+{
+    if (!s_blob || zone >= s_hdr->zone_count) {
+        return NULL;
+    }
+    return devcfg_str(s_zones[zone].name);
+}
+
+bool app_devcfg_find_satellite(const uint8_t id[6], uint8_t *zone, const char **name)
+{
+    if (!s_blob) {
+        return false;
+    }
+    int lo = 0;
+    int hi = (int)s_hdr->sat_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = memcmp(id, s_sats[mid].id, sizeof(s_sats[mid].id));
+        if (cmp == 0) {
+            if (zone) {
+                *zone = s_sats[mid].zone;
+            }
+            if (name) {
+                *name = devcfg_str(s_sats[mid].name);
+            }
+            return true;
+        }
+        if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return false;
+}
+
+esp_err_t app_devcfg_init(void)
+{
+    int64_t start = esp_timer_get_time();
+    if (s_blob) {
+        esp_partition_munmap(s_map);
+        s_blob = NULL;
+    }
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           APP_DEVCFG_PARTITION);
+    if (!part) {
+        ESP_LOGI(TAG, "No %s partition, using built-in configuration", APP_DEVCFG_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    const void *ptr;
+    esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &s_map);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map %s: %s", APP_DEVCFG_PARTITION, esp_err_to_name(err));
+        return err;
+    }
+    err = devcfg_validate(ptr, part->size);
+    if (err != ESP_OK) {
+        esp_partition_munmap(s_map);
+        if (err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Invalid configuration blob (%s), using built-in configuration", esp_err_to_name(err));
+        }
+        return err;
+    }
+    s_blob = ptr;
+    s_hdr = ptr;
+    s_zones = (const app_devcfg_zone_t *)(s_blob + s_hdr->zones_off);
+    s_sats = (const app_devcfg_sat_t *)(s_blob + s_hdr->sats_off);
+    ESP_LOGI(TAG, "Configuration: %u bytes, %u zones, %u satellites, loaded in %lld us",
+             (unsigned)s_hdr->total_len, s_hdr->zone_count, s_hdr->sat_count,
+             (long long)(esp_timer_get_time() - start));
+    return ESP_OK;
+}
@@ -0,0 +1,113 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Device configuration blob, in the "devcfg" data partition
+ *
+ * Built on the host by tools/devcfg_compile.py and read in place through a
+ * flash mapping: records are fixed-size structs, 4-byte aligned, and names
+ * are offsets from the start of the blob into a table of NUL-terminated
+ * strings (0 = not set). All integers little endian.
+ *
+ *     header | zones[zone_count] | satellites[sat_count] (sorted by id) | strings
+ *
+ * crc32 (zlib / esp_rom_crc32_le) covers everything after the header. A
+ * reader accepts any hdr_len >= its own header size, so fields can be
+ * appended; incompatible changes bump the version.
+ */
+#define APP_DEVCFG_MAGIC        0x46434853  // "SHCF"
+#define APP_DEVCFG_VERSION      1
+#define APP_DEVCFG_PARTITION    "devcfg"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;
+    uint32_t total_len;
+    uint32_t crc32;
+    int8_t led_gpio;            // -1 = built-in default
+    int8_t ir_sensor_gpio;
+    int8_t buzzer_gpio;
+    uint8_t reserved;
+    uint32_t light_name;        // device names, string offsets
+    uint32_t alarm_name;
+    uint32_t door_name;
+    uint32_t rules;             // default automation rules text
+    uint16_t zone_count;
+    uint16_t sat_count;
+    uint32_t zones_off;
+    uint32_t sats_off;
+    uint32_t strings_off;
+} app_devcfg_header_t;
+
+typedef struct {
+    uint32_t name;
+} app_devcfg_zone_t;            // indexed by zone number
+
+typedef struct {
+    uint8_t id[6];
+    uint8_t zone;
+    uint8_t reserved;
+    uint32_t name;
+} app_devcfg_sat_t;
+
+typedef enum {
+    APP_DEVCFG_LIGHT_NAME,
+    APP_DEVCFG_ALARM_NAME,
+    APP_DEVCFG_DOOR_NAME,
+} app_devcfg_name_t;
+
+typedef enum {
+    APP_DEVCFG_LED_GPIO,
+    APP_DEVCFG_IR_SENSOR_GPIO,
+    APP_DEVCFG_BUZZER_GPIO,
+} app_devcfg_pin_t;
+
+/* Map and validate the configuration blob
+ *
+ * Without a devcfg partition or a valid blob, every getter returns the
+ * built-in default. Calling it again reads the partition again.
+ *
+ * @return ESP_OK if a valid blob was found.
+ * @return ESP_ERR_NOT_FOUND if there is no partition or it is blank.
+ * @return ESP_ERR_INVALID_VERSION / ESP_ERR_INVALID_CRC / ESP_ERR_INVALID_SIZE for a bad blob.
+ */
+esp_err_t app_devcfg_init(void);
+
+/* Configured GPIO, or def if none is set or it is not a GPIO of this chip */
+int app_devcfg_pin(app_devcfg_pin_t pin, int def);
+
+/* Configured device name (pointer into flash), or def */
+const char *app_devcfg_name(app_devcfg_name_t which, const char *def);
+
+/* Default automation rules text, NULL if none */
+const char *app_devcfg_rules(void);
+
+/* Zone name, NULL if not configured */
+const char *app_devcfg_zone_name(uint8_t zone);
+
+/* Look up a satellite by id (binary search)
+ *
+ * @param[in] id Satellite id.
+ * @param[out] zone Configured zone (optional).
+ * @param[out] name Configured device name, NULL if none (optional).
+ *
+ * @return true if the satellite is in the blob.
+ */
+bool app_devcfg_find_satellite(const uint8_t id[6], uint8_t *zone, const char **name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,59 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_event.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Application events, posted to the default event loop */
+ESP_EVENT_DECLARE_BASE(APP_EVENT);
+
+typedef enum {
+    APP_EVENT_DOOR_OPENED = 0,
+    APP_EVENT_DOOR_CLOSED,
+    APP_EVENT_ALARM_ARMED,
+    APP_EVENT_ALARM_DISARMED,
+    APP_EVENT_ALARM_TRIGGERED,
+    APP_EVENT_MAX,
+} app_event_id_t;
+
+/* Who caused the event. Rules do not react to events caused by rules,
+ * so rule actions cannot loop. Synthetic self-test events are ignored by
+ * rules and history. Events relayed from another node of the home are not
+ * sent back out on the LAN. */
+typedef enum {
+    APP_EVENT_SRC_SENSOR = 0,
+    APP_EVENT_SRC_USER,
+    APP_EVENT_SRC_RULE,
+    APP_EVENT_SRC_TEST,
+    APP_EVENT_SRC_PEER,
+} app_event_src_t;
+
+typedef struct {
+    uint8_t src;        // app_event_src_t
+    uint8_t zone;       // zone index, 0 = local door sensor
+    int64_t mono_us;    // esp_timer time of the event; app_time_from_mono_us() gives UTC
+} app_event_data_t;
+
+/* Post an application event to the default event loop (non-blocking)
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure (e.g. event queue full).
+ */
+esp_err_t app_event_post(app_event_id_t id, app_event_src_t src);
+
+/* Same as app_event_post() for an event that concerns a specific zone */
+esp_err_t app_event_post_zone(app_event_id_t id, app_event_src_t src, uint8_t zone);
+
+#ifdef __cplusplus
+}
+#endif
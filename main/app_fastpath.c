@@ -0,0 +1,255 @@
+/* Local control fast path
+ *
+ * Persistent TCP session carrying fixed-size, HMAC-authenticated binary commands
+ * for the light and the alarm. Commands are applied through the actuator queue,
+ * skipping JSON parsing and write_cb's string routing. See app_fastpath.h for
+ * the wire format.
+ */
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp_diagnostics.h>
+#include <lwip/sockets.h>
+
+#include "app_fastpath.h"
+#include "app_home_key.h"
+#include "app_actuator.h"
+#include "app_payload.h"
+#include "app_priv.h"
+
+static const char *TAG = "app_fastpath";
+
+#define FASTPATH_TASK_STACK     4096
+#define FASTPATH_TASK_PRIO      6
+#define FASTPATH_IDLE_TIMEOUT_S 300
+/* The session is single-client: a connection must authenticate its first frame
+ * within this time, so an idle or unauthenticated peer cannot hold it */
+#define FASTPATH_AUTH_TIMEOUT_MS 1500
+/* Upper bound on how long a command may wait for the actuator before we answer BUSY */
+#define FASTPATH_APPLY_WAIT_MS  40
+/* Response header + payload; payloads are encoded in place after the header */
+#define FASTPATH_TX_BUF_LEN     1024
+
+typedef struct {
+    uint32_t count;
+    int64_t total_us;
+    int64_t max_us;
+} fastpath_stats_t;
+
+/* Receive exactly len bytes. A non-zero deadline (esp_timer time) also bounds a
+ * peer that trickles the frame in byte by byte. */
+static int recv_all(int sock, uint8_t *buf, size_t len, int64_t deadline)
+{
+    size_t got = 0;
+    while (got < len) {
+        int r = recv(sock, buf + got, len - got, 0);
+        if (r <= 0 || (deadline && esp_timer_get_time() > deadline)) {
+            return -1;
+        }
+        got += r;
+    }
+    return 0;
+}
+
+static void set_recv_timeout(int sock, int ms)
+{
+    struct timeval tv = { .tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t fastpath_state(void)
+{
+    return (app_light_get() ? APP_FASTPATH_STATE_LIGHT : 0) |
+           (app_alarm_is_enabled() ? APP_FASTPATH_STATE_ALARM : 0) |
+           (app_door_is_open() ? APP_FASTPATH_STATE_DOOR : 0);
+}
+
+static app_fastpath_status_t fastpath_exec(uint8_t cmd, uint8_t value)
+{
+    esp_err_t err;
+    switch (cmd) {
+    case APP_FASTPATH_CMD_LIGHT:
+        err = app_actuator_submit(APP_ACTUATOR_LIGHT, value != 0, APP_EVENT_SRC_USER, FASTPATH_APPLY_WAIT_MS);
+        break;
+    case APP_FASTPATH_CMD_ALARM:
+        err = app_actuator_submit(APP_ACTUATOR_ALARM, value != 0, APP_EVENT_SRC_USER, FASTPATH_APPLY_WAIT_MS);
+        break;
+    case APP_FASTPATH_CMD_STATUS:
+    case APP_FASTPATH_CMD_SNAPSHOT:
+    case APP_FASTPATH_CMD_HISTORY:
+        return APP_FASTPATH_OK;
+    default:
+        return APP_FASTPATH_ERR_CMD;
+    }
+    return err == ESP_OK ? APP_FASTPATH_OK : APP_FASTPATH_ERR_BUSY;
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+/* Encode the payload for SNAPSHOT/HISTORY directly after the response header.
+ * Returns the number of bytes appended to tx, or -1 if it did not fit. */
+static int fastpath_payload(uint8_t cmd, uint8_t value, uint8_t *tx)
+{
+    app_payload_fmt_t fmt = (value & APP_FASTPATH_VALUE_JSON) ? APP_PAYLOAD_JSON : APP_PAYLOAD_CBOR;
+    uint8_t *hdr = tx + APP_FASTPATH_RESP_LEN;
+    uint8_t *body = hdr + APP_FASTPATH_PAYLOAD_HDR;
+    size_t room = FASTPATH_TX_BUF_LEN - APP_FASTPATH_RESP_LEN - APP_FASTPATH_PAYLOAD_HDR;
+
+    int64_t start = esp_timer_get_time();
+    int len = cmd == APP_FASTPATH_CMD_SNAPSHOT ? app_payload_snapshot(fmt, body, room)
+                                               : app_payload_history(fmt, value & 0x7f, body, room);
+    int64_t elapsed = esp_timer_get_time() - start;
+    if (len < 0) {
+        return -1;
+    }
+    put_le16(hdr, len);
+    put_le16(hdr + 2, elapsed > UINT16_MAX ? UINT16_MAX : elapsed);
+    return APP_FASTPATH_PAYLOAD_HDR + len;
+}
+
+static void fastpath_session(int sock)
+{
+    static uint8_t tx[FASTPATH_TX_BUF_LEN];
+    uint8_t hello[APP_FASTPATH_HELLO_LEN] = { 'S', 'H', APP_FASTPATH_VERSION, 0 };
+    uint8_t *nonce = &hello[4];
+    esp_fill_random(nonce, APP_FASTPATH_NONCE_LEN);
+    if (send(sock, hello, sizeof(hello), 0) != sizeof(hello)) {
+        return;
+    }
+
+    fastpath_stats_t stats = { 0 };
+    uint32_t last_seq = 0;
+    bool authenticated = false;
+    int64_t auth_deadline = esp_timer_get_time() + FASTPATH_AUTH_TIMEOUT_MS * 1000LL;
+    set_recv_timeout(sock, FASTPATH_AUTH_TIMEOUT_MS);
+    uint8_t req[APP_FASTPATH_REQ_LEN];
+    while (1) {
+        if (recv_all(sock, req, sizeof(req), authenticated ? 0 : auth_deadline) != 0) {
+            if (!authenticated) {
+                ESP_LOGW(TAG, "No request within %d ms, closing session", FASTPATH_AUTH_TIMEOUT_MS);
+            }
+            break;
+        }
+        int64_t start = esp_timer_get_time();
+        uint32_t seq = get_le32(&req[4]);
+        uint8_t *resp = tx;
+        size_t resp_len = APP_FASTPATH_RESP_LEN;
+        resp[0] = 'S';
+        resp[1] = 'H';
+        resp[2] = APP_FASTPATH_OK;
+        memcpy(&resp[4], &req[4], 4);
+
+        if (req[0] != 'S' || req[1] != 'H' ||
+            !app_home_key_verify(nonce, APP_FASTPATH_NONCE_LEN, req, 8, &req[8])) {
+            resp[2] = APP_FASTPATH_ERR_AUTH;
+            resp[3] = 0;
+            send(sock, resp, resp_len, 0);
+            ESP_LOGW(TAG, "Authentication failed, closing session");
+            break;
+        }
+        if (!authenticated) {
+            authenticated = true;
+            set_recv_timeout(sock, FASTPATH_IDLE_TIMEOUT_S * 1000);
+        }
+        if (seq <= last_seq) {
+            resp[2] = APP_FASTPATH_ERR_REPLAY;
+        } else {
+            last_seq = seq;
+            resp[2] = fastpath_exec(req[2], req[3]);
+        }
+        resp[3] = fastpath_state();
+        if (resp[2] == APP_FASTPATH_OK &&
+            (req[2] == APP_FASTPATH_CMD_SNAPSHOT || req[2] == APP_FASTPATH_CMD_HISTORY)) {
+            int extra = fastpath_payload(req[2], req[3], tx);
+            if (extra < 0) {
+                resp[2] = APP_FASTPATH_ERR_CMD;
+            } else {
+                resp_len += extra;
+            }
+        }
+        if (send(sock, resp, resp_len, 0) != (int)resp_len) {
+            break;
+        }
+
+        int64_t elapsed = esp_timer_get_time() - start;
+        stats.count++;
+        stats.total_us += elapsed;
+        if (elapsed > stats.max_us) {
+            stats.max_us = elapsed;
+        }
+    }
+
+    if (stats.count) {
+        ESP_LOGI(TAG, "Session closed: %lu commands, avg %lld us, max %lld us", (unsigned long)stats.count,
+                 (long long)(stats.total_us / stats.count), (long long)stats.max_us);
+        ESP_DIAG_EVENT("LOCAL_CTRL", "Fast path: %lu cmds avg %lld us max %lld us", (unsigned long)stats.count,
+                       (long long)(stats.total_us / stats.count), (long long)stats.max_us);
+    }
+}
+
+static void fastpath_task(void *arg)
+{
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+    int opt = 1;
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_APP_FASTPATH_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_sock, 1) != 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %d: errno %d", CONFIG_APP_FASTPATH_PORT, errno);
+        close(listen_sock);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Listening on port %d", CONFIG_APP_FASTPATH_PORT);
+
+    while (1) {
+        int sock = accept(listen_sock, NULL, NULL);
+        if (sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (!app_home_key_available()) {
+            ESP_LOGW(TAG, "Home key not provisioned, refusing session");
+            close(sock);
+            continue;
+        }
+        /* Small frames on a persistent session: disable Nagle and keep the link alive */
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
+
+        fastpath_session(sock);
+        shutdown(sock, SHUT_RDWR);
+        close(sock);
+    }
+}
+
+esp_err_t app_fastpath_start(void)
+{
+    if (xTaskCreate(fastpath_task, "fastpath", FASTPATH_TASK_STACK, NULL, FASTPATH_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create fast path task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
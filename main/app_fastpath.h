@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Local control fast path wire format (all integers little endian)
+ *
+ * On connect the node sends a hello:
+ *     'S' 'H' version 0  nonce[16]
+ * The client then sends fixed-size requests on the same persistent session:
+ *     'S' 'H' cmd value  seq[4]  tag[16]
+ *     tag = HMAC-SHA256(home key, nonce || first 8 bytes)[0..15]
+ * and gets a fixed-size response for each:
+ *     'S' 'H' status state  seq[4]
+ * seq must increase on every request of a session. The first request must
+ * arrive within 1.5 s of the hello, or the session is closed.
+ *
+ * SNAPSHOT and HISTORY responses are followed by a payload:
+ *     len[2]  encode_us[2]  payload[len]
+ * value bit 7 selects JSON instead of CBOR; for HISTORY bits 0-6 are the page.
+ */
+#define APP_FASTPATH_VERSION        1
+#define APP_FASTPATH_NONCE_LEN      16
+#define APP_FASTPATH_HELLO_LEN      (4 + APP_FASTPATH_NONCE_LEN)
+#define APP_FASTPATH_REQ_LEN        24
+#define APP_FASTPATH_RESP_LEN       8
+#define APP_FASTPATH_PAYLOAD_HDR    4
+#define APP_FASTPATH_VALUE_JSON     0x80
+
+typedef enum {
+    APP_FASTPATH_CMD_LIGHT = 0x01,  // value: 0 = off, 1 = on
+    APP_FASTPATH_CMD_ALARM = 0x02,  // value: 0 = disarm, 1 = arm
+    APP_FASTPATH_CMD_STATUS = 0x03, // value ignored
+    APP_FASTPATH_CMD_SNAPSHOT = 0x04, // status snapshot payload
+    APP_FASTPATH_CMD_HISTORY = 0x05,  // event history page payload
+} app_fastpath_cmd_t;
+
+typedef enum {
+    APP_FASTPATH_OK = 0,
+    APP_FASTPATH_ERR_AUTH,          // session is closed after this
+    APP_FASTPATH_ERR_CMD,
+    APP_FASTPATH_ERR_BUSY,
+    APP_FASTPATH_ERR_REPLAY,
+} app_fastpath_status_t;
+
+/* Bits of the state byte in responses */
+#define APP_FASTPATH_STATE_LIGHT    (1 << 0)
+#define APP_FASTPATH_STATE_ALARM    (1 << 1)
+#define APP_FASTPATH_STATE_DOOR     (1 << 2)
+
+/* Start the local control fast path TCP server
+ *
+ * Requires a provisioned home key (see app_home_key.h); sessions are refused until then.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_fastpath_start(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,71 @@
+/* Event history
+ *
+ * Last CONFIG_APP_HISTORY_LEN application events in a RAM ring buffer,
+ * served page by page to local clients.
+ */
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "app_history.h"
+#include "app_events.h"
+#include "app_time.h"
+
+#define HISTORY_LEN CONFIG_APP_HISTORY_LEN
+
+static app_history_entry_t s_ring[HISTORY_LEN];
+static size_t s_head;       // next slot to write
+static size_t s_count;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void history_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const app_event_data_t *ev = data;
+    if (ev && ev->src == APP_EVENT_SRC_TEST) {
+        return;
+    }
+    int64_t mono = ev ? ev->mono_us : esp_timer_get_time();
+    app_history_entry_t entry = {
+        .wall_s = (uint32_t)(app_time_from_mono_us(mono) / 1000000),
+        .uptime_ms = (uint32_t)(mono / 1000),
+        .id = id,
+        .src = ev ? ev->src : 0,
+        .zone = ev ? ev->zone : 0,
+    };
+
+    portENTER_CRITICAL(&s_lock);
+    s_ring[s_head] = entry;
+    s_head = (s_head + 1) % HISTORY_LEN;
+    if (s_count < HISTORY_LEN) {
+        s_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t app_history_get_page(size_t page, app_history_entry_t *out, size_t max, size_t *total)
+{
+    size_t n = 0;
+    portENTER_CRITICAL(&s_lock);
+    size_t skip = page * max;
+    if (total) {
+        *total = s_count;
+    }
+    for (size_t i = skip; i < s_count && n < max; i++) {
+        out[n++] = s_ring[(s_head + HISTORY_LEN - 1 - i) % HISTORY_LEN];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    /* Entries recorded before the first sync get their time now */
+    for (size_t i = 0; i < n; i++) {
+        if (out[i].wall_s == 0) {
+            out[i].wall_s = (uint32_t)(app_time_from_mono_us(out[i].uptime_ms * 1000LL) / 1000000);
+        }
+    }
+    return n;
+}
+
+esp_err_t app_history_init(void)
+{
+    return esp_event_handler_register(APP_EVENT, ESP_EVENT_ANY_ID, history_event_handler, NULL);
+}
@@ -0,0 +1,45 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t wall_s;        // UTC seconds, 0 if time was not synced yet
+    uint32_t uptime_ms;
+    uint8_t id;             // app_event_id_t
+    uint8_t src;            // app_event_src_t
+    uint8_t zone;
+} app_history_entry_t;
+
+/* Start recording APP_EVENT events into a fixed-size RAM ring
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_history_init(void);
+
+/* Copy one page of history, newest first
+ *
+ * @param[in] page Page number, 0 = newest entries.
+ * @param[out] out Buffer for up to max entries.
+ * @param[in] max Page size.
+ * @param[out] total Total number of entries currently held (optional).
+ *
+ * @return number of entries copied.
+ */
+size_t app_history_get_page(size_t page, app_history_entry_t *out, size_t max, size_t *total);
+
+#ifdef __cplusplus
+}
+#endif
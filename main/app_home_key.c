@@ -0,0 +1,178 @@
+/* Home key
+ *
+ * Shared secret used to authenticate local (LAN) protocols that bypass the cloud.
+ * Stored in NVS, provisioned through a write-only RainMaker param.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <nvs.h>
+#include <mbedtls/md.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+
+#include "app_home_key.h"
+
+static const char *TAG = "app_home_key";
+
+#define HOME_KEY_NVS_NAMESPACE  "home"
+#define HOME_KEY_NVS_KEY        "key"
+
+static uint8_t s_key[APP_HOME_KEY_LEN];
+static bool s_key_valid;
+static SemaphoreHandle_t s_lock;
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static esp_err_t home_key_store(const char *hex)
+{
+    uint8_t key[APP_HOME_KEY_LEN];
+    if (!hex || strlen(hex) != APP_HOME_KEY_LEN * 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < APP_HOME_KEY_LEN; i++) {
+        int hi = hex_nibble(hex[2 * i]);
+        int lo = hex_nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        key[i] = (hi << 4) | lo;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(HOME_KEY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(handle, HOME_KEY_NVS_KEY, key, sizeof(key));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memcpy(s_key, key, sizeof(s_key));
+    s_key_valid = true;
+    xSemaphoreGive(s_lock);
+    memset(key, 0, sizeof(key));
+    return ESP_OK;
+}
+
+static void home_key_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(HOME_KEY_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(s_key);
+    s_key_valid = nvs_get_blob(handle, HOME_KEY_NVS_KEY, s_key, &len) == ESP_OK && len == sizeof(s_key);
+    nvs_close(handle);
+}
+
+bool app_home_key_available(void)
+{
+    return s_key_valid;
+}
+
+esp_err_t app_home_key_tag(const void *a, size_t a_len, const void *b, size_t b_len, uint8_t tag[APP_HOME_TAG_LEN])
+{
+    uint8_t mac[32];
+    mbedtls_md_context_t ctx;
+    int ret;
+
+    if (!s_key_valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    mbedtls_md_init(&ctx);
+    ret = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    if (ret == 0) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        ret = mbedtls_md_hmac_starts(&ctx, s_key, sizeof(s_key));
+        xSemaphoreGive(s_lock);
+    }
+    if (ret == 0 && a_len) {
+        ret = mbedtls_md_hmac_update(&ctx, a, a_len);
+    }
+    if (ret == 0) {
+        ret = mbedtls_md_hmac_update(&ctx, b, b_len);
+    }
+    if (ret == 0) {
+        ret = mbedtls_md_hmac_finish(&ctx, mac);
+    }
+    mbedtls_md_free(&ctx);
+    if (ret != 0) {
+        return ESP_FAIL;
+    }
+    memcpy(tag, mac, APP_HOME_TAG_LEN);
+    return ESP_OK;
+}
+
+bool app_home_key_verify(const void *a, size_t a_len, const void *b, size_t b_len, const uint8_t tag[APP_HOME_TAG_LEN])
+{
+    uint8_t expected[APP_HOME_TAG_LEN];
+    if (app_home_key_tag(a, a_len, b, b_len, expected) != ESP_OK) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (int i = 0; i < APP_HOME_TAG_LEN; i++) {
+        diff |= expected[i] ^ tag[i];
+    }
+    return diff == 0;
+}
+
+static esp_err_t home_key_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+                                   const esp_rmaker_param_val_t val, void *priv_data,
+                                   esp_rmaker_write_ctx_t *ctx)
+{
+    if (strcmp(esp_rmaker_param_get_name(param), "Home Key") != 0) {
+        return ESP_OK;
+    }
+    /* The key is never echoed back into the param, so it does not show up in reports */
+    esp_err_t err = home_key_store(val.val.s);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Rejected home key (expected %d hex characters)", APP_HOME_KEY_LEN * 2);
+    } else {
+        ESP_LOGI(TAG, "Home key updated");
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_home_key_init(const esp_rmaker_node_t *node)
+{
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    home_key_load();
+    ESP_LOGI(TAG, "Home key %s", s_key_valid ? "loaded" : "not provisioned");
+
+    esp_rmaker_device_t *service = esp_rmaker_service_create("Home Network", "custom.service.home-network", NULL);
+    if (!service) {
+        return ESP_FAIL;
+    }
+    esp_rmaker_device_add_cb(service, home_key_write_cb, NULL);
+
+    esp_rmaker_param_t *key_param = esp_rmaker_param_create("Home Key", NULL, esp_rmaker_str(""), PROP_FLAG_WRITE);
+    esp_rmaker_param_add_ui_type(key_param, ESP_RMAKER_UI_HIDDEN);
+    esp_rmaker_device_add_param(service, key_param);
+    return esp_rmaker_node_add_device(node, service);
+}
@@ -0,0 +1,60 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_HOME_KEY_LEN    32
+#define APP_HOME_TAG_LEN    16      // truncated HMAC-SHA256 carried in local frames
+
+/* Create the "Home Network" service and load the home key from NVS
+ *
+ * The home key is a secret shared by all nodes and local clients of one home.
+ * It is set through the write-only "Home Key" param (64 hex characters) and
+ * is never reported back.
+ *
+ * @param[in] node RainMaker node to add the service to.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_home_key_init(const esp_rmaker_node_t *node);
+
+/* Check whether a home key has been provisioned
+ *
+ * @return true if local authenticated protocols can be used.
+ */
+bool app_home_key_available(void);
+
+/* Compute the truncated HMAC-SHA256 tag of two concatenated buffers with the home key
+ *
+ * @param[in] a First buffer (e.g. session nonce), may be NULL if a_len is 0.
+ * @param[in] b Second buffer (e.g. frame header).
+ * @param[out] tag APP_HOME_TAG_LEN bytes.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if no key is provisioned.
+ */
+esp_err_t app_home_key_tag(const void *a, size_t a_len, const void *b, size_t b_len, uint8_t tag[APP_HOME_TAG_LEN]);
+
+/* Constant-time check of a received tag
+ *
+ * @return true if the tag matches.
+ */
+bool app_home_key_verify(const void *a, size_t a_len, const void *b, size_t b_len, const uint8_t tag[APP_HOME_TAG_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
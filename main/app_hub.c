@@ -0,0 +1,422 @@
+/* Hub mode
+ *
+ * Battery door/window sensors ("satellites") carry no RainMaker stack: they
+ * send small HMAC-authenticated reports to this node over a pluggable
+ * transport (ESP-NOW on hardware, UDP for host testing) and the hub represents
+ * each of them as a RainMaker device.
+ *
+ * Satellites are kept in a registry in NVS (id and zone, 8 bytes each) and
+ * their devices are created from it at boot. A satellite reporting for the
+ * first time is added to the registry and to the node at run time. Without a
+ * zone from the installation config it gets a zone of its own while there are
+ * zones left; zones above APP_ZONE_MAX cannot be armed, so the ones after that
+ * share zone APP_ZONE_MAX and can be regrouped with their Zone param.
+ *
+ * A report is applied only if its seq is above the last one applied from that
+ * satellite, across reboots too: the last seq is saved with every door change
+ * (a separate NVS key, 4 bytes per satellite), so an OPEN captured on the air
+ * cannot be replayed after the hub restarts. Periodic reports that change
+ * nothing are not saved; replaying one only repeats the state the door is in.
+ *
+ * Reports are queued by the transport's receive callback and handled by the
+ * hub task, which updates the satellite's params, posts DOOR_OPENED/CLOSED with
+ * the satellite's zone, and triggers the alarm when the active arming mode
+ * watches that zone.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_diagnostics.h>
+#include <nvs.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+
+#include "app_hub.h"
+#include "app_transport.h"
+#include "app_home_key.h"
+#include "app_events.h"
+#include "app_arming.h"
+#include "app_siren.h"
+#include "app_alert.h"
+#include "app_nodecfg.h"
+#include "app_report.h"
+#include "app_devcfg.h"
+#include "app_priv.h"
+
+static const char *TAG = "app_hub";
+
+#define HUB_TASK_STACK          4096
+#define HUB_TASK_PRIO           5       // same as the local sensor task
+#define HUB_QUEUE_LEN           16
+#define HUB_NVS_NAMESPACE       "hub"
+#define HUB_NVS_KEY             "sats"
+#define HUB_NVS_SEQ_KEY         "seqs"
+#define HUB_STATS_EVERY         64      // log latency stats every this many reports
+#define HUB_SHARED_ZONE         APP_ZONE_MAX    // for satellites without a zone once the others are taken
+
+#if CONFIG_APP_HUB_TRANSPORT_UDP
+static const app_transport_t *const s_transport = &app_transport_udp;
+#else
+static const app_transport_t *const s_transport = &app_transport_espnow;
+#endif
+
+/* Persisted part of a satellite */
+typedef struct {
+    uint8_t id[6];
+    uint8_t zone;
+    uint8_t reserved;
+} hub_sat_record_t;
+
+typedef struct {
+    hub_sat_record_t rec;
+    bool seen;              // reported since boot; open and battery are valid
+    bool open;
+    bool triggered;         // this satellite started the siren
+    uint8_t battery;
+    uint32_t seq;           // last applied, persisted on door changes
+    esp_rmaker_param_t *status_param;
+    esp_rmaker_param_t *battery_param;
+    esp_rmaker_param_t *zone_param;
+} hub_sat_t;
+
+typedef struct {
+    uint8_t addr[APP_TRANSPORT_ADDR_LEN];
+    uint8_t frame[APP_HUB_FRAME_LEN];
+    int64_t rx_us;
+} hub_rx_t;
+
+typedef struct {
+    uint32_t count;
+    int64_t total_us;
+    int64_t max_us;
+} hub_stats_t;
+
+static const esp_rmaker_node_t *s_node;
+static hub_sat_t s_sats[CONFIG_APP_HUB_MAX_SATELLITES];
+static int s_count;
+static int s_ram_per_sat;       // last measured heap cost of adding one satellite
+static QueueHandle_t s_queue;
+static hub_stats_t s_stats;
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ---------------- Registry ---------------- */
+
+static void registry_save(void)
+{
+    hub_sat_record_t recs[CONFIG_APP_HUB_MAX_SATELLITES];
+    for (int i = 0; i < s_count; i++) {
+        recs[i] = s_sats[i].rec;
+    }
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(HUB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, HUB_NVS_KEY, recs, s_count * sizeof(recs[0]));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save satellite registry: %s", esp_err_to_name(err));
+    }
+}
+
+static int registry_load(hub_sat_record_t *recs, uint32_t *seqs)
+{
+    nvs_handle_t handle;
+    if (nvs_open(HUB_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return 0;
+    }
+    size_t len = CONFIG_APP_HUB_MAX_SATELLITES * sizeof(recs[0]);
+    if (nvs_get_blob(handle, HUB_NVS_KEY, recs, &len) != ESP_OK) {
+        len = 0;
+    }
+    /* Missing or short (older firmware): those satellites start from 0 */
+    size_t seq_len = CONFIG_APP_HUB_MAX_SATELLITES * sizeof(seqs[0]);
+    if (nvs_get_blob(handle, HUB_NVS_SEQ_KEY, seqs, &seq_len) != ESP_OK) {
+        seq_len = 0;
+    }
+    memset((uint8_t *)seqs + seq_len, 0, CONFIG_APP_HUB_MAX_SATELLITES * sizeof(seqs[0]) - seq_len);
+    nvs_close(handle);
+    return len / sizeof(recs[0]);
+}
+
+/* Last applied seq of every satellite, in registry order */
+static void seqs_save(void)
+{
+    uint32_t seqs[CONFIG_APP_HUB_MAX_SATELLITES];
+    for (int i = 0; i < s_count; i++) {
+        seqs[i] = s_sats[i].seq;
+    }
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(HUB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, HUB_NVS_SEQ_KEY, seqs, s_count * sizeof(seqs[0]));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save satellite seqs: %s", esp_err_to_name(err));
+    }
+}
+
+static hub_sat_t *sat_find(const uint8_t *id)
+{
+    for (int i = 0; i < s_count; i++) {
+        if (memcmp(s_sats[i].rec.id, id, 6) == 0) {
+            return &s_sats[i];
+        }
+    }
+    return NULL;
+}
+
+/* ---------------- Devices ---------------- */
+
+static esp_err_t sat_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+                              const esp_rmaker_param_val_t val, void *priv_data, esp_rmaker_write_ctx_t *ctx)
+{
+    hub_sat_t *sat = priv_data;
+    if (param != sat->zone_param || val.val.i < 0 || val.val.i > APP_ZONE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sat->rec.zone = val.val.i;
+    registry_save();
+    esp_rmaker_param_update(param, val);
+    ESP_LOGI(TAG, "%s moved to zone %d", esp_rmaker_device_get_name(device), sat->rec.zone);
+    return ESP_OK;
+}
+
+/* Create the device of s_sats[s_count] and count it */
+static esp_err_t sat_add_device(hub_sat_t *sat)
+{
+    char name[24];
+    const char *cfg_name = NULL;
+    app_devcfg_find_satellite(sat->rec.id, NULL, &cfg_name);
+    if (cfg_name && cfg_name[0]) {
+        snprintf(name, sizeof(name), "%s", cfg_name);
+    } else {
+        snprintf(name, sizeof(name), "Satellite %02x%02x%02x", sat->rec.id[3], sat->rec.id[4], sat->rec.id[5]);
+    }
+    uint32_t free_before = esp_get_free_heap_size();
+
+    esp_rmaker_device_t *dev = esp_rmaker_device_create(name, ESP_RMAKER_DEVICE_OTHER, sat);
+    if (!dev) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_rmaker_device_add_cb(dev, sat_write_cb, NULL);
+    sat->status_param = esp_rmaker_param_create("Door Status", NULL, esp_rmaker_str("CLOSED"), PROP_FLAG_READ);
+    sat->battery_param = esp_rmaker_param_create("Battery", NULL, esp_rmaker_int(0), PROP_FLAG_READ);
+    sat->zone_param = esp_rmaker_param_create("Zone", NULL, esp_rmaker_int(sat->rec.zone),
+                                              PROP_FLAG_READ | PROP_FLAG_WRITE);
+    esp_rmaker_param_add_bounds(sat->zone_param, esp_rmaker_int(0), esp_rmaker_int(APP_ZONE_MAX),
+                                esp_rmaker_int(1));
+    app_report_add_param(dev, sat->status_param);
+    app_report_add_param(dev, sat->battery_param);
+    esp_rmaker_device_add_param(dev, sat->zone_param);
+    esp_err_t err = esp_rmaker_node_add_device(s_node, dev);
+    if (err != ESP_OK) {
+        esp_rmaker_device_delete(dev);
+        return err;
+    }
+    s_ram_per_sat = (int)(free_before - esp_get_free_heap_size()) + (int)sizeof(hub_sat_t);
+    s_count++;
+    ESP_LOGI(TAG, "%s in zone %d: %d bytes RAM, %d satellites", name, sat->rec.zone, s_ram_per_sat, s_count);
+    return ESP_OK;
+}
+
+/* First report from an unknown satellite */
+static hub_sat_t *sat_register(const uint8_t *id)
+{
+    if (s_count >= CONFIG_APP_HUB_MAX_SATELLITES) {
+        ESP_LOGW(TAG, "Registry full, ignoring satellite %02x%02x%02x", id[3], id[4], id[5]);
+        return NULL;
+    }
+    /* Zone from the installation config, else one zone per satellite; the Zone param can regroup them */
+    uint8_t zone;
+    if (!app_devcfg_find_satellite(id, &zone, NULL) || zone > APP_ZONE_MAX) {
+        zone = s_count < HUB_SHARED_ZONE ? s_count + 1 : HUB_SHARED_ZONE;
+        if (s_count >= HUB_SHARED_ZONE) {
+            ESP_LOGW(TAG, "No zone left for satellite %02x%02x%02x: sharing zone %d", id[3], id[4], id[5], zone);
+        }
+    }
+    hub_sat_t *sat = &s_sats[s_count];
+    memset(sat, 0, sizeof(*sat));
+    memcpy(sat->rec.id, id, 6);
+    sat->rec.zone = zone;
+    if (sat_add_device(sat) != ESP_OK) {
+        return NULL;
+    }
+    registry_save();
+    seqs_save();
+    app_nodecfg_report();
+    ESP_DIAG_EVENT("HUB", "Satellite added: %d total, %d bytes each", s_count, s_ram_per_sat);
+    return sat;
+}
+
+/* ---------------- Reports ---------------- */
+
+static void sat_apply(hub_sat_t *sat, uint32_t seq, uint8_t state, uint8_t battery)
+{
+    sat->seq = seq;
+    bool open = state & APP_HUB_STATE_OPEN;
+    if (battery != sat->battery || !sat->seen) {
+        sat->battery = battery;
+        app_report_param(sat->battery_param, esp_rmaker_int(battery));
+    }
+    bool changed = open != sat->open || !sat->seen;
+    sat->open = open;
+    sat->seen = true;
+    if (!changed) {
+        return;
+    }
+    seqs_save();
+
+    app_report_param(sat->status_param, esp_rmaker_str(open ? "OPENED" : "CLOSED"));
+    app_event_post_zone(open ? APP_EVENT_DOOR_OPENED : APP_EVENT_DOOR_CLOSED, APP_EVENT_SRC_SENSOR, sat->rec.zone);
+
+    if (open && app_alarm_is_enabled() && app_arming_triggered(APP_ZONE_BIT(sat->rec.zone))) {
+        app_siren_trigger();
+        sat->triggered = true;
+        app_event_post_zone(APP_EVENT_ALARM_TRIGGERED, APP_EVENT_SRC_SENSOR, sat->rec.zone);
+        const char *zone_name = app_devcfg_zone_name(sat->rec.zone);
+        char msg[64];
+        if (zone_name && zone_name[0]) {
+            snprintf(msg, sizeof(msg), "%s: satellite opened while alarm is ON!", zone_name);
+        } else {
+            snprintf(msg, sizeof(msg), "Satellite opened while alarm is ON!");
+        }
+        app_alert_raise(APP_ALERT_HIGH, sat->rec.zone, msg);
+        ESP_DIAG_EVENT("SECURITY_ALERT", "Intrusion in zone %d (%s)", sat->rec.zone, zone_name ? zone_name : "");
+    } else if (!open && sat->triggered) {
+        sat->triggered = false;
+        for (int i = 0; i < s_count; i++) {
+            if (s_sats[i].triggered) {
+                return;     // another satellite still holds the siren
+            }
+        }
+        if (app_alarm_is_enabled()) {
+            app_siren_clear();
+        }
+    }
+}
+
+static void hub_handle(const hub_rx_t *rx)
+{
+    const uint8_t *f = rx->frame;
+    if (f[0] != 'S' || f[1] != 'T' || f[2] != APP_HUB_VERSION || f[3] != APP_HUB_REPORT ||
+        !app_home_key_verify(NULL, 0, f, APP_HUB_HDR_LEN, &f[APP_HUB_HDR_LEN])) {
+        return;
+    }
+    hub_sat_t *sat = sat_find(&f[4]);
+    if (!sat) {
+        sat = sat_register(&f[4]);
+        if (!sat) {
+            return;
+        }
+    }
+    uint32_t seq = get_le32(&f[10]);
+    if (seq > sat->seq) {
+        sat_apply(sat, seq, f[14], f[15]);
+    }
+
+    /* Ack repeats too: the satellite retries until it hears one */
+    uint8_t ack[APP_HUB_FRAME_LEN] = { 'S', 'T', APP_HUB_VERSION, APP_HUB_ACK };
+    memcpy(&ack[4], &f[4], 10);
+    if (app_home_key_tag(NULL, 0, ack, APP_HUB_HDR_LEN, &ack[APP_HUB_HDR_LEN]) == ESP_OK) {
+        s_transport->send(rx->addr, ack, sizeof(ack));
+    }
+
+    int64_t elapsed = esp_timer_get_time() - rx->rx_us;
+    s_stats.count++;
+    s_stats.total_us += elapsed;
+    if (elapsed > s_stats.max_us) {
+        s_stats.max_us = elapsed;
+    }
+    if (s_stats.count % HUB_STATS_EVERY == 0) {
+        ESP_LOGI(TAG, "%lu reports from %d satellites: avg %lld us, max %lld us", (unsigned long)s_stats.count,
+                 s_count, (long long)(s_stats.total_us / s_stats.count), (long long)s_stats.max_us);
+        ESP_DIAG_EVENT("HUB", "%d sats, %d B each, report avg %lld us max %lld us", s_count, s_ram_per_sat,
+                       (long long)(s_stats.total_us / s_stats.count), (long long)s_stats.max_us);
+        s_stats = (hub_stats_t) { 0 };
+    }
+}
+
+static void hub_rx_cb(const uint8_t addr[APP_TRANSPORT_ADDR_LEN], const uint8_t *data, size_t len)
+{
+    if (len != APP_HUB_FRAME_LEN) {
+        return;
+    }
+    hub_rx_t rx = {
+        .rx_us = esp_timer_get_time(),
+    };
+    memcpy(rx.addr, addr, APP_TRANSPORT_ADDR_LEN);
+    memcpy(rx.frame, data, APP_HUB_FRAME_LEN);
+    xQueueSend(s_queue, &rx, 0);
+}
+
+static void hub_task(void *arg)
+{
+    hub_rx_t rx;
+    while (1) {
+        if (xQueueReceive(s_queue, &rx, portMAX_DELAY) == pdTRUE) {
+            hub_handle(&rx);
+        }
+    }
+}
+
+/* ---------------- Setup ---------------- */
+
+void app_hub_get_stats(app_hub_stats_t *out)
+{
+    *out = (app_hub_stats_t) {
+        .satellites = s_count,
+        .ram_per_sat = s_ram_per_sat,
+        .slot_size = sizeof(hub_sat_t),
+    };
+    for (int i = 0; i < s_count; i++) {
+        out->shared_zone += s_sats[i].rec.zone == HUB_SHARED_ZONE;
+    }
+}
+
+esp_err_t app_hub_init(const esp_rmaker_node_t *node)
+{
+    s_node = node;
+    static hub_sat_record_t recs[CONFIG_APP_HUB_MAX_SATELLITES];
+    static uint32_t seqs[CONFIG_APP_HUB_MAX_SATELLITES];
+    int n = registry_load(recs, seqs);
+    for (int i = 0; i < n; i++) {
+        hub_sat_t *sat = &s_sats[s_count];
+        memset(sat, 0, sizeof(*sat));
+        sat->rec = recs[i];
+        sat->seq = seqs[i];
+        if (sat_add_device(sat) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create satellite device");
+            return ESP_FAIL;
+        }
+    }
+    s_queue = xQueueCreate(HUB_QUEUE_LEN, sizeof(hub_rx_t));
+    return s_queue ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t app_hub_start(void)
+{
+    if (xTaskCreate(hub_task, "hub", HUB_TASK_STACK, NULL, HUB_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create hub task");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Hub with %d satellites on %s", s_count, s_transport->name);
+    return s_transport->start(hub_rx_cb);
+}
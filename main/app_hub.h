@@ -0,0 +1,68 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Satellite wire format (all integers little endian), on the hub transport
+ *
+ *     'S' 'T' version type  sat[6]  seq[4]  state battery  tag[16]
+ *     tag = HMAC-SHA256(home key, first 16 bytes)[0..15]
+ *
+ * A satellite sends REPORT on every change and periodically; seq must increase
+ * across its reboots. The hub answers every authenticated REPORT, repeats
+ * included, with an ACK carrying the same sat and seq so the satellite can stop
+ * retrying and go back to sleep.
+ */
+#define APP_HUB_VERSION         1
+#define APP_HUB_HDR_LEN         16
+#define APP_HUB_FRAME_LEN       (APP_HUB_HDR_LEN + 16)
+
+typedef enum {
+    APP_HUB_REPORT = 0x01,      // satellite -> hub
+    APP_HUB_ACK = 0x02,         // hub -> satellite
+} app_hub_type_t;
+
+#define APP_HUB_STATE_OPEN      (1 << 0)
+
+typedef struct {
+    uint32_t satellites;        // in the registry
+    uint32_t shared_zone;       // of those, in zone APP_ZONE_MAX
+    uint32_t ram_per_sat;       // heap cost of the last satellite added, plus its slot
+    uint32_t slot_size;         // the hub's own RAM per satellite, reserved at build time
+} app_hub_stats_t;
+
+/* Load the satellite registry and create a RainMaker device per satellite
+ *
+ * Must be called before esp_rmaker_start(). Satellites that report for the
+ * first time later are added to the registry and to the node at run time.
+ *
+ * @param[in] node RainMaker node to add the satellite devices to.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_hub_init(const esp_rmaker_node_t *node);
+
+/* Start the satellite transport (after Wi-Fi is started)
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_hub_start(void);
+
+void app_hub_get_stats(app_hub_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,398 @@
+/* LAN alarm sync
+ *
+ * Nodes of one home share alarm state over UDP multicast, so an intrusion seen
+ * by one node sounds every siren on the LAN without a cloud round trip. Frames
+ * are authenticated with the home key (see app_lansync.h for the format).
+ *
+ * Replay and duplicate protection:
+ *   - seq is reserved from NVS in blocks, so it keeps increasing across reboots
+ *     with one flash write per APP_LANSYNC_SEQ_BLOCK frames
+ *   - receivers keep the last seq of each peer and drop anything not newer
+ *     (this also drops the repeats of a frame). The peer table is kept in NVS,
+ *     so a frame captured before a reboot cannot be replayed after it.
+ *   - a peer is trusted once a frame of it was shown to be fresh: its timestamp
+ *     within LANSYNC_MAX_SKEW_S of ours, both clocks set. Until then (first
+ *     frame, evicted, or no clock) only TRIGGERED is acted on, since sounding the
+ *     siren twice is harmless and missing an intrusion is not; a DISARMED that
+ *     cannot be shown fresh is dropped and does not vouch for later frames.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_mac.h>
+#include <esp_diagnostics.h>
+#include <nvs.h>
+#include <lwip/sockets.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_utils.h>
+
+#include "app_lansync.h"
+#include "app_home_key.h"
+#include "app_events.h"
+#include "app_siren.h"
+#include "app_priv.h"
+
+static const char *TAG = "app_lansync";
+
+#define LANSYNC_TASK_STACK      4096
+#define LANSYNC_TASK_PRIO       6       // same as the fast path: above the sensor task
+#define LANSYNC_PEERS           16
+#define LANSYNC_MAX_SKEW_S      60
+#define LANSYNC_SEQ_BLOCK       256
+#define LANSYNC_JOIN_RETRY_MS   2000
+#define LANSYNC_NVS_NAMESPACE   "lansync"
+#define LANSYNC_NVS_KEY         "seq"
+#define LANSYNC_NVS_PEERS_KEY   "peers"
+
+/* Delay before each repeat of a frame */
+static const uint32_t s_repeat_delay_us[APP_LANSYNC_REPEATS - 1] = { 20000, 60000 };
+
+typedef struct {
+    uint8_t node[6];
+    bool trusted;           // a frame of this peer was shown to be fresh
+    uint32_t seq;
+    int64_t last_us;        // for LRU eviction; 0 = free slot
+} lansync_peer_t;
+
+static int s_sock = -1;
+static struct sockaddr_in s_group;
+static uint8_t s_node[6];
+static uint32_t s_seq;
+static uint32_t s_seq_reserved;     // s_seq may run up to here before the next NVS write
+static lansync_peer_t s_peers[LANSYNC_PEERS];
+
+/* Frame being repeated by s_repeat_timer; a newer frame replaces it */
+static uint8_t s_pending[APP_LANSYNC_FRAME_LEN];
+static int s_pending_sent;
+static esp_timer_handle_t s_repeat_timer;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ---------------- Sequence numbers ---------------- */
+
+static esp_err_t seq_reserve(uint32_t upto)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(LANSYNC_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u32(handle, LANSYNC_NVS_KEY, upto);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err == ESP_OK) {
+        s_seq_reserved = upto;
+    } else {
+        ESP_LOGW(TAG, "Failed to reserve sequence numbers: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+/* Start past everything a previous boot may have used */
+static void seq_init(void)
+{
+    nvs_handle_t handle;
+    uint32_t reserved = 0;
+    if (nvs_open(LANSYNC_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u32(handle, LANSYNC_NVS_KEY, &reserved);
+        nvs_close(handle);
+    }
+    s_seq = reserved;
+    s_seq_reserved = reserved;
+}
+
+/* Frames are sent from the default event loop, so this needs no lock */
+static uint32_t seq_next(void)
+{
+    if (s_seq >= s_seq_reserved && seq_reserve(s_seq + LANSYNC_SEQ_BLOCK) != ESP_OK) {
+        /* Peers that remember us would drop a reused seq; better to send it anyway */
+        ESP_LOGW(TAG, "Sending with unreserved sequence number %lu", (unsigned long)(s_seq + 1));
+    }
+    return ++s_seq;
+}
+
+/* ---------------- Peer table ---------------- */
+
+static void peers_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(LANSYNC_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(s_peers);
+    if (nvs_get_blob(handle, LANSYNC_NVS_PEERS_KEY, s_peers, &len) != ESP_OK || len != sizeof(s_peers)) {
+        memset(s_peers, 0, sizeof(s_peers));
+    }
+    nvs_close(handle);
+    /* Timestamps are from the previous boot: keep the slots, forget the order */
+    for (int i = 0; i < LANSYNC_PEERS; i++) {
+        if (s_peers[i].last_us) {
+            s_peers[i].last_us = 1;
+        }
+    }
+}
+
+/* One write per accepted alarm frame; replays and repeats are dropped before this */
+static void peers_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(LANSYNC_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, LANSYNC_NVS_PEERS_KEY, s_peers, sizeof(s_peers));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save peer table: %s", esp_err_to_name(err));
+    }
+}
+
+/* ---------------- Sending ---------------- */
+
+static void lansync_sendto(const uint8_t *frame)
+{
+    if (sendto(s_sock, frame, APP_LANSYNC_FRAME_LEN, 0, (struct sockaddr *)&s_group, sizeof(s_group)) < 0) {
+        ESP_LOGD(TAG, "sendto failed: errno %d", errno);
+    }
+}
+
+static void repeat_timer_cb(void *arg)
+{
+    uint8_t frame[APP_LANSYNC_FRAME_LEN];
+    int sent;
+    portENTER_CRITICAL(&s_lock);
+    memcpy(frame, s_pending, sizeof(frame));
+    sent = ++s_pending_sent;
+    portEXIT_CRITICAL(&s_lock);
+
+    lansync_sendto(frame);
+    if (sent < APP_LANSYNC_REPEATS) {
+        esp_timer_start_once(s_repeat_timer, s_repeat_delay_us[sent - 1]);
+    }
+}
+
+esp_err_t app_lansync_send(app_lansync_type_t type, uint8_t zone)
+{
+    if (s_sock < 0 || !app_home_key_available()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t frame[APP_LANSYNC_FRAME_LEN] = { 'S', 'Y', APP_LANSYNC_VERSION, type, zone, 0 };
+    memcpy(&frame[6], s_node, sizeof(s_node));
+    put_le32(&frame[12], seq_next());
+    put_le32(&frame[16], esp_rmaker_time_check() ? (uint32_t)time(NULL) : 0);
+    esp_err_t err = app_home_key_tag(NULL, 0, frame, APP_LANSYNC_HDR_LEN, &frame[APP_LANSYNC_HDR_LEN]);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    esp_timer_stop(s_repeat_timer);
+    portENTER_CRITICAL(&s_lock);
+    memcpy(s_pending, frame, sizeof(frame));
+    s_pending_sent = 1;
+    portEXIT_CRITICAL(&s_lock);
+
+    lansync_sendto(frame);
+    esp_timer_start_once(s_repeat_timer, s_repeat_delay_us[0]);
+    return ESP_OK;
+}
+
+static void lansync_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const app_event_data_t *ev = data;
+    if (ev && (ev->src == APP_EVENT_SRC_PEER || ev->src == APP_EVENT_SRC_TEST)) {
+        return;
+    }
+    app_lansync_send(id == APP_EVENT_ALARM_TRIGGERED ? APP_LANSYNC_TRIGGERED : APP_LANSYNC_DISARMED,
+                     ev ? ev->zone : 0);
+}
+
+/* ---------------- Receiving ---------------- */
+
+/* Returns true if the frame is new from this peer and may be applied, and records it */
+static bool peer_accept(const uint8_t *node, uint8_t type, uint32_t seq, uint32_t sent_time, int64_t now)
+{
+    lansync_peer_t *peer = NULL;
+    lansync_peer_t *oldest = &s_peers[0];
+    for (int i = 0; i < LANSYNC_PEERS; i++) {
+        if (s_peers[i].last_us && memcmp(s_peers[i].node, node, 6) == 0) {
+            peer = &s_peers[i];
+            break;
+        }
+        if (s_peers[i].last_us < oldest->last_us) {
+            oldest = &s_peers[i];
+        }
+    }
+    if (peer && seq <= peer->seq) {
+        return false;
+    }
+    if (!peer || !peer->trusted) {
+        /* No trusted seq to compare with, so the frame has to prove it is fresh */
+        bool fresh = false;
+        if (sent_time && esp_rmaker_time_check()) {
+            int64_t skew = (int64_t)time(NULL) - sent_time;
+            if (skew > LANSYNC_MAX_SKEW_S || skew < -LANSYNC_MAX_SKEW_S) {
+                ESP_LOGW(TAG, "Stale frame from " MACSTR " (%lld s)", MAC2STR(node), (long long)skew);
+                return false;
+            }
+            fresh = true;
+        }
+        if (!fresh && type != APP_LANSYNC_TRIGGERED) {
+            ESP_LOGW(TAG, "Ignoring unverifiable frame type %d from " MACSTR " (no clock)", type, MAC2STR(node));
+            return false;
+        }
+        if (!peer) {
+            peer = oldest;
+            memcpy(peer->node, node, 6);
+        }
+        peer->trusted = fresh;
+    }
+    peer->seq = seq;
+    peer->last_us = now;
+    peers_save();
+    return true;
+}
+
+static void lansync_apply(uint8_t type, uint8_t zone, const uint8_t *node)
+{
+    switch (type) {
+    case APP_LANSYNC_TRIGGERED:
+        if (!app_alarm_is_enabled()) {
+            return;
+        }
+        app_siren_trigger();
+        app_event_post_zone(APP_EVENT_ALARM_TRIGGERED, APP_EVENT_SRC_PEER, zone);
+        ESP_DIAG_EVENT("SECURITY_ALERT", "Intrusion on " MACSTR " zone %d", MAC2STR(node), zone);
+        break;
+    case APP_LANSYNC_DISARMED:
+        if (app_alarm_is_enabled()) {
+            app_alarm_set(false, APP_EVENT_SRC_PEER);
+            ESP_DIAG_EVENT("ALARM_ACTION", "Disarmed from " MACSTR, MAC2STR(node));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static int lansync_open(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_APP_LANSYNC_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "Failed to bind port %d: errno %d", CONFIG_APP_LANSYNC_PORT, errno);
+        close(sock);
+        return -1;
+    }
+    /* Stay on the LAN, and do not hear ourselves */
+    uint8_t ttl = 1, loop = 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+    /* Joining fails until the station interface has an address */
+    struct ip_mreq mreq = {
+        .imr_multiaddr = s_group.sin_addr,
+        .imr_interface.s_addr = htonl(INADDR_ANY),
+    };
+    while (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+        vTaskDelay(pdMS_TO_TICKS(LANSYNC_JOIN_RETRY_MS));
+    }
+    return sock;
+}
+
+static void lansync_task(void *arg)
+{
+    int sock = lansync_open();
+    if (sock < 0) {
+        vTaskDelete(NULL);
+        return;
+    }
+    s_sock = sock;
+    ESP_LOGI(TAG, "Joined %s port %d", CONFIG_APP_LANSYNC_GROUP, CONFIG_APP_LANSYNC_PORT);
+
+    uint8_t frame[APP_LANSYNC_FRAME_LEN + 1];
+    while (1) {
+        int len = recv(sock, frame, sizeof(frame), 0);
+        if (len < 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (len != APP_LANSYNC_FRAME_LEN || frame[0] != 'S' || frame[1] != 'Y' ||
+            frame[2] != APP_LANSYNC_VERSION || memcmp(&frame[6], s_node, 6) == 0) {
+            continue;
+        }
+        if (!app_home_key_verify(NULL, 0, frame, APP_LANSYNC_HDR_LEN, &frame[APP_LANSYNC_HDR_LEN])) {
+            ESP_LOGW(TAG, "Bad tag from " MACSTR, MAC2STR(&frame[6]));
+            continue;
+        }
+        if (!peer_accept(&frame[6], frame[3], get_le32(&frame[12]), get_le32(&frame[16]), esp_timer_get_time())) {
+            continue;
+        }
+        lansync_apply(frame[3], frame[4], &frame[6]);
+    }
+}
+
+esp_err_t app_lansync_start(void)
+{
+    s_group = (struct sockaddr_in) {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_APP_LANSYNC_PORT),
+    };
+    if (inet_aton(CONFIG_APP_LANSYNC_GROUP, &s_group.sin_addr) == 0) {
+        ESP_LOGE(TAG, "Bad multicast group %s", CONFIG_APP_LANSYNC_GROUP);
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_read_mac(s_node, ESP_MAC_WIFI_STA);
+    seq_init();
+    peers_load();
+
+    esp_timer_create_args_t timer_args = {
+        .callback = repeat_timer_cb,
+        .name = "lansync",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_repeat_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_event_handler_register(APP_EVENT, APP_EVENT_ALARM_TRIGGERED, lansync_event_handler, NULL);
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(APP_EVENT, APP_EVENT_ALARM_DISARMED, lansync_event_handler, NULL);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (xTaskCreate(lansync_task, "lansync", LANSYNC_TASK_STACK, NULL, LANSYNC_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create LAN sync task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,59 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* LAN alarm sync wire format (UDP multicast, all integers little endian)
+ *
+ *     'S' 'Y' version type  zone 0  node[6]  seq[4]  time[4]  tag[16]
+ *     tag = HMAC-SHA256(home key, first 20 bytes)[0..15]
+ *
+ * node is the sender's Wi-Fi MAC. seq increases with every new frame of a node,
+ * across reboots. time is the sender's Unix time, or 0 if it has not synced yet.
+ * Each frame is sent APP_LANSYNC_REPEATS times with the same seq to ride out
+ * Wi-Fi multicast loss; receivers drop the repeats. A receiver that has not yet
+ * seen a frame of the sender with a fresh time (both clocks set) only acts on
+ * TRIGGERED from it.
+ */
+#define APP_LANSYNC_VERSION     1
+#define APP_LANSYNC_HDR_LEN     20
+#define APP_LANSYNC_FRAME_LEN   (APP_LANSYNC_HDR_LEN + 16)
+#define APP_LANSYNC_REPEATS     3
+
+typedef enum {
+    APP_LANSYNC_TRIGGERED = 0x01,   // intrusion on the sender: sound the siren if armed
+    APP_LANSYNC_DISARMED = 0x02,    // the home was disarmed on the sender
+} app_lansync_type_t;
+
+/* Start the LAN alarm sync task
+ *
+ * Local ALARM_TRIGGERED and ALARM_DISARMED events are multicast to the other
+ * nodes of the home. Frames from other nodes are verified with the home key,
+ * de-duplicated per node and applied locally with APP_EVENT_SRC_PEER, which is
+ * never sent back out.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_lansync_start(void);
+
+/* Multicast an alarm frame now (also done automatically from APP_EVENT)
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_STATE if no home key is provisioned or the task is not running.
+ */
+esp_err_t app_lansync_send(app_lansync_type_t type, uint8_t zone);
+
+#ifdef __cplusplus
+}
+#endif
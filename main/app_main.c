@@ -3,25 +3,45 @@
  * Single-file firmware for:
  * - Home Light (LIGHTBULB) with "Power" param - GPIO 2
  * - Alarm System (SWITCH) with "Power" param - enables/disables alarm
+ *   - Arming Mode (Away/Stay/Night) with per-mode zone masks (app_arming.c)
  * - Door Sensor Status (read-only) - GPIO 3 (IR sensor)
  *   - "Door Status" param (OPENED/CLOSED)
  * - IR sensor task that triggers alarm/buzzer/LED
- *  - Buzzer on GPIO 4
+ *  - Buzzer on GPIO 4, driven by the siren policy (app_siren.c)
+ * - RainMaker schedules for Home Light and Alarm System (e.g. auto-arm at night)
+ * - Sunset automation for Home Light (app_daylight.c)
+ * - Local automation rules evaluated on APP_EVENT (app_rules.c)
+ * - Low-latency local control fast path for light and alarm (app_fastpath.c)
+ * - Alarm trigger/disarm shared with the other nodes on the LAN (app_lansync.c)
+ * - Optional single cloud uplink per home with leader election (app_uplink.c)
+ * - Optional hub mode for battery satellite sensors (app_hub.c)
+ * - Jittered network bring-up and cloud reconnect backoff (app_conn.c)
+ * - Node config published only when it changed (app_nodecfg.c)
+ * - Params changed while offline reported as one snapshot (app_report.c)
+ * - Drift-compensated UTC timestamps from esp_timer (app_time.c)
+ * - Timing-wheel service for application timers (app_timer.c)
+ * - Pins, names, zones and satellites from a binary config partition (app_devcfg.c)
+ * - Occupancy statistics and unusual-activity alerts from door activity
+ *   (app_occupancy.c, app_anomaly.c)
+ * - Streaming, paced OTA with a first-boot self-test (app_ota.c, app_selftest.c)
  *
  * Make sure to re-provision / re-link after flashing so Google Home picks up the corrected device.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <nvs_flash.h>
 #include <driver/gpio.h>
 
 #include <esp_rmaker_core.h>
 #include <esp_rmaker_standard_types.h>
 #include <esp_rmaker_standard_devices.h>
+#include <esp_rmaker_schedule.h>
 
 /* --- ADDED FOR DASHBOARD EVENTS --- */
 #include <esp_diagnostics.h> 
@@ -29,43 +49,95 @@
 #include "app_network.h"
 #include "app_insights.h"
 #include "app_priv.h"
+#include "app_daylight.h"
+#include "app_events.h"
+#include "app_rules.h"
+#include "app_home_key.h"
+#include "app_actuator.h"
+#include "app_fastpath.h"
+#include "app_history.h"
+#include "app_ota.h"
+#include "app_selftest.h"
+#include "app_occupancy.h"
+#include "app_anomaly.h"
+#include "app_alert.h"
+#include "app_siren.h"
+#include "app_arming.h"
+#include "app_lansync.h"
+#include "app_uplink.h"
+#include "app_hub.h"
+#include "app_conn.h"
+#include "app_nodecfg.h"
+#include "app_report.h"
+#include "app_time.h"
+#include "app_timer.h"
+#include "app_devcfg.h"
 
 static const char *TAG = "app_main";
 
-/* Hardware pins */
-#define LED_GPIO         GPIO_NUM_2
-#define IR_SENSOR_GPIO   GPIO_NUM_3
-#define BUZZER_GPIO      GPIO_NUM_4
-
-/* RTOS task config */
-#define IR_TASK_STACK    2048
+/* Hardware pins and device names: built-in defaults, overridden by the
+ * devcfg partition (app_devcfg.c) */
+#define LED_GPIO_DEFAULT        GPIO_NUM_2
+#define IR_SENSOR_GPIO_DEFAULT  GPIO_NUM_3
+#define BUZZER_GPIO_DEFAULT     GPIO_NUM_4
+
+static gpio_num_t led_gpio = LED_GPIO_DEFAULT;
+static gpio_num_t ir_sensor_gpio = IR_SENSOR_GPIO_DEFAULT;
+static gpio_num_t buzzer_gpio = BUZZER_GPIO_DEFAULT;
+static const char *light_name = "Home Light";
+static const char *alarm_name = "Alarm System";
+static const char *door_name = "Door Sensor Status";
+
+/* RTOS task config. The sensor task runs the siren policy, param reports and
+ * alert publishing on a door change, which needs more than the 2 KB that polling did. */
+#define IR_TASK_STACK    4096
 #define IR_TASK_PRIO     5
 
 /* Global flags */
 static volatile bool alarm_enabled = false;
 static volatile bool led_state = false;  // store current LED state (last commanded light state)
+static volatile bool door_open = false;  // last sampled IR sensor state
 
 /* RainMaker params (global handles for updates from tasks) */
 static esp_rmaker_param_t *door_status_param = NULL;
 static esp_rmaker_param_t *alarm_trigger_param = NULL;
+static esp_rmaker_param_t *light_power_param = NULL;
+static esp_rmaker_param_t *alarm_power_param = NULL;
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+esp_err_t app_event_post_zone(app_event_id_t id, app_event_src_t src, uint8_t zone)
+{
+    app_event_data_t data = {
+        .src = src,
+        .zone = zone,
+        .mono_us = esp_timer_get_time(),
+    };
+    return esp_event_post(APP_EVENT, id, &data, sizeof(data), 0);
+}
+
+esp_err_t app_event_post(app_event_id_t id, app_event_src_t src)
+{
+    return app_event_post_zone(id, src, 0);
+}
 
 /* ---------------- Hardware init ---------------- */
 void app_driver_init(void)
 {
     // LED (used as Home Light and also toggled during alarm)
-    gpio_reset_pin(LED_GPIO);
-    gpio_set_direction(LED_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_level(LED_GPIO, 0); // OFF initially
+    gpio_reset_pin(led_gpio);
+    gpio_set_direction(led_gpio, GPIO_MODE_OUTPUT);
+    gpio_set_level(led_gpio, 0); // OFF initially
     led_state = false;
 
     // IR sensor input
-    gpio_reset_pin(IR_SENSOR_GPIO);
-    gpio_set_direction(IR_SENSOR_GPIO, GPIO_MODE_INPUT);
+    gpio_reset_pin(ir_sensor_gpio);
+    gpio_set_direction(ir_sensor_gpio, GPIO_MODE_INPUT);
 
     // Buzzer output
-    gpio_reset_pin(BUZZER_GPIO);
-    gpio_set_direction(BUZZER_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_level(BUZZER_GPIO, 0); // OFF initially
+    gpio_reset_pin(buzzer_gpio);
+    gpio_set_direction(buzzer_gpio, GPIO_MODE_OUTPUT);
+    gpio_set_level(buzzer_gpio, 0); // OFF initially
 }
 
 /* ---------------- Driver helper ----------------
@@ -75,7 +147,7 @@ void app_driver_init(void)
 esp_err_t app_driver_set_gpio(const char *param_name, bool value)
 {
     if (strcmp(param_name, "Power") == 0) {
-        gpio_set_level(LED_GPIO, value ? 1 : 0);
+        gpio_set_level(led_gpio, value ? 1 : 0);
         led_state = value;
         
         ESP_DIAG_EVENT("LIGHT_ACTION", "Light Power -> %s", value ? "ON" : "OFF");
@@ -84,6 +156,90 @@ esp_err_t app_driver_set_gpio(const char *param_name, bool value)
     return ESP_FAIL;
 }
 
+/* ---------------- Light helper ----------------
+ * Switches the Home Light from local automations (not from write_cb)
+ * and reports the new state to the cloud.
+ */
+esp_err_t app_light_set(bool on)
+{
+    esp_err_t err = app_driver_set_gpio("Power", on);
+    if (err == ESP_OK && light_power_param) {
+        app_report_param(light_power_param, esp_rmaker_bool(on));
+    }
+    return err;
+}
+
+bool app_light_get(void)
+{
+    return led_state;
+}
+
+bool app_door_is_open(void)
+{
+    return door_open;
+}
+
+bool app_alarm_is_enabled(void)
+{
+    return alarm_enabled;
+}
+
+/* ---------------- Alarm helper ----------------
+ * Arms/disarms the alarm. When disarming, resets door/alarm status,
+ * buzzer and LED. Does not report the Alarm System param itself.
+ */
+static void alarm_apply(bool enable, app_event_src_t src)
+{
+    alarm_enabled = enable;
+    app_arming_set_armed(enable);
+
+    ESP_DIAG_EVENT("ALARM_ACTION", "Alarm System set to: %s", alarm_enabled ? "ON" : "OFF");
+
+    if (!alarm_enabled) {
+        // Reset door and alarm status when alarm is turned off
+        if (door_status_param) {
+            esp_rmaker_param_update(door_status_param, esp_rmaker_str("CLOSED"));
+        }
+        if (alarm_trigger_param) {
+            esp_rmaker_param_update(alarm_trigger_param, esp_rmaker_bool(false));
+        }
+        app_siren_reset();
+        // restore LED to last commanded state
+        gpio_set_level(led_gpio, led_state ? 1 : 0);
+    }
+
+    app_event_post(enable ? APP_EVENT_ALARM_ARMED : APP_EVENT_ALARM_DISARMED, src);
+}
+
+/* Arms/disarms the alarm from local automations and reports the new state */
+esp_err_t app_alarm_set(bool enable, app_event_src_t src)
+{
+    alarm_apply(enable, src);
+    if (alarm_power_param) {
+        app_report_param(alarm_power_param, esp_rmaker_bool(enable));
+    }
+    return ESP_OK;
+}
+
+/* Param value as text, for logs and diag events */
+static const char *val_to_str(const esp_rmaker_param_val_t *val, char *buf, size_t len)
+{
+    switch (val->type) {
+    case RMAKER_VAL_TYPE_BOOLEAN:
+        return val->val.b ? "ON" : "OFF";
+    case RMAKER_VAL_TYPE_INTEGER:
+        snprintf(buf, len, "%d", val->val.i);
+        return buf;
+    case RMAKER_VAL_TYPE_FLOAT:
+        snprintf(buf, len, "%.2f", val->val.f);
+        return buf;
+    case RMAKER_VAL_TYPE_STRING:
+        return val->val.s ? val->val.s : "";
+    default:
+        return "?";
+    }
+}
+
 /* ---------------- RainMaker write callback ----------------
  * This handles write requests coming from cloud / Google Home / app.
  * Check device name + parameter name to route actions.
@@ -97,8 +253,16 @@ static esp_err_t write_cb(const esp_rmaker_device_t *device,
     const char *dev_name = esp_rmaker_device_get_name(device);
     const char *param_name = esp_rmaker_param_get_name(param);
 
+    if (ctx) {
+        ESP_LOGI(TAG, "Received write request via : %s", esp_rmaker_device_cb_src_to_str(ctx->src));
+        if (ctx->src == ESP_RMAKER_REQ_SRC_SCHEDULE) {
+            char buf[16];
+            ESP_DIAG_EVENT("SCHEDULE_ACTION", "%s %s -> %s", dev_name, param_name, val_to_str(&val, buf, sizeof(buf)));
+        }
+    }
+
     /* --- Home Light handling (toggle LED) --- */
-    if (strcmp(dev_name, "Home Light") == 0 && strcmp(param_name, "Power") == 0) {
+    if (strcmp(dev_name, light_name) == 0 && strcmp(param_name, "Power") == 0) {
         bool new_val = val.val.b;
         if (app_driver_set_gpio(param_name, new_val) == ESP_OK) {
             esp_rmaker_param_update(param, val); // sync back to cloud
@@ -108,34 +272,36 @@ static esp_err_t write_cb(const esp_rmaker_device_t *device,
         return ESP_OK;
     }
 
-    /* --- Alarm System handling --- */
-    if (strcmp(dev_name, "Alarm System") == 0 && strcmp(param_name, "Power") == 0) {
-        alarm_enabled = val.val.b;
-        
-        ESP_DIAG_EVENT("ALARM_ACTION", "Alarm System set to: %s", alarm_enabled ? "ON" : "OFF");
-
-        if (!alarm_enabled) {
-            // Reset door and alarm status when alarm is turned off
-            if (door_status_param) {
-                esp_rmaker_param_update(door_status_param, esp_rmaker_str("CLOSED"));
-            }
-            if (alarm_trigger_param) {
-                esp_rmaker_param_update(alarm_trigger_param, esp_rmaker_bool(false));
-            }
-            gpio_set_level(BUZZER_GPIO, 0);
-            // restore LED to last commanded state
-            gpio_set_level(LED_GPIO, led_state ? 1 : 0);
+    /* --- Home Light sunset automation params --- */
+    if (strcmp(dev_name, light_name) == 0) {
+        esp_err_t err = app_daylight_handle_write(param, val);
+        if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "Invalid value for %s", param_name);
         }
+        return ESP_OK;
+    }
 
+    /* --- Alarm System handling --- */
+    if (strcmp(dev_name, alarm_name) == 0 && strcmp(param_name, "Power") == 0) {
+        alarm_apply(val.val.b, APP_EVENT_SRC_USER);
         esp_rmaker_param_update(param, val); // sync state in cloud
         return ESP_OK;
     }
 
+    /* --- Alarm System arming mode and zone masks --- */
+    if (strcmp(dev_name, alarm_name) == 0) {
+        esp_err_t err = app_arming_handle_write(param, val);
+        if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "Invalid value for %s", param_name);
+        }
+        return ESP_OK;
+    }
+
     return ESP_OK;
 }
 
 /* ---------------- IR sensor + buzzer task ----------------
- * Monitors IR_SENSOR_GPIO:
+ * Monitors ir_sensor_gpio:
  * - Updates Door Status param (OPENED/CLOSED)
  * - If alarm enabled and door opens => update alarm trigger, blink LED & buzzer, send alert
  */
@@ -143,9 +309,17 @@ void ir_sensor_task(void *arg)
 {
     int previous_sensor_state = -1;  // -1 = unknown
     bool notification_sent = false;
+    bool siren_started = false;      // by this sensor, as opposed to a peer node
+    int64_t due_us = 0;              // when this poll should have run
 
     while (1) {
-        int sensor_value = gpio_get_level(IR_SENSOR_GPIO);  // 1=open, 0=closed
+        /* Alarm path latency: how late the sensor poll runs against its schedule */
+        if (due_us) {
+            int64_t late_us = esp_timer_get_time() - due_us;
+            app_ota_alarm_latency_sample(late_us > 0 ? (uint32_t)late_us : 0);
+        }
+
+        int sensor_value = gpio_get_level(ir_sensor_gpio);  // 1=open, 0=closed
 
         /* -----------------------------
          * 1. DOOR STATE HANDLING
@@ -153,14 +327,18 @@ void ir_sensor_task(void *arg)
         if (sensor_value != previous_sensor_state) {
             if (sensor_value == 1) {
                 // Door OPENED
+                door_open = true;
                 ESP_DIAG_EVENT("DOOR_ACTION", "Door Sensor: OPENED");
+                app_event_post(APP_EVENT_DOOR_OPENED, APP_EVENT_SRC_SENSOR);
                 if (door_status_param) {
                     esp_rmaker_param_update(door_status_param, esp_rmaker_str("OPENED"));
                 }
                 notification_sent = false;  // allow new notification
             } else {
                 // Door CLOSED
+                door_open = false;
                 ESP_DIAG_EVENT("DOOR_ACTION", "Door Sensor: CLOSED");
+                app_event_post(APP_EVENT_DOOR_CLOSED, APP_EVENT_SRC_SENSOR);
                 if (door_status_param) {
                     esp_rmaker_param_update(door_status_param, esp_rmaker_str("CLOSED"));
                 }
@@ -177,29 +355,39 @@ void ir_sensor_task(void *arg)
          * 2. ALARM BEHAVIOR
          * ----------------------------- */
         if (alarm_enabled) {
-            if (sensor_value == 1) {
-                // Door OPEN => alarm triggered
+            if (sensor_value == 1 && app_arming_triggered(APP_ZONE_BIT(APP_ZONE_LOCAL_DOOR))) {
+                // Door OPEN in a zone watched by the arming mode => alarm triggered
                 if (alarm_trigger_param) {
                     esp_rmaker_param_update(alarm_trigger_param, esp_rmaker_bool(true));
                 }
 
-                // Blink LED + buzzer
-                gpio_set_level(BUZZER_GPIO, 1);
-                gpio_set_level(LED_GPIO, !led_state);
-                vTaskDelay(pdMS_TO_TICKS(150));
-                gpio_set_level(LED_GPIO, led_state);
-                vTaskDelay(pdMS_TO_TICKS(150));
+                // The siren policy drives the buzzer
+                app_siren_trigger();
+                siren_started = true;
 
+                // Post before blinking: the event also sounds the other nodes (app_lansync.c)
                 if (!notification_sent) {
-                    esp_rmaker_raise_alert("Door opened while alarm is ON!");
+                    app_event_post(APP_EVENT_ALARM_TRIGGERED, APP_EVENT_SRC_SENSOR);
+                    app_alert_raise(APP_ALERT_HIGH, 0, "Door opened while alarm is ON!");
                     ESP_DIAG_EVENT("SECURITY_ALERT", "Intrusion detected");
                     notification_sent = true;
                 }
+
+                // Blink LED
+                gpio_set_level(led_gpio, !led_state);
+                vTaskDelay(pdMS_TO_TICKS(150));
+                gpio_set_level(led_gpio, led_state);
+                due_us = esp_timer_get_time() + 150 * 1000;
+                vTaskDelay(pdMS_TO_TICKS(150));
                 continue;  // skip the bottom delay
             } else {
-                // Door closed while alarm ON
-                gpio_set_level(BUZZER_GPIO, 0);
-                gpio_set_level(LED_GPIO, led_state);
+                // Door closed (or bypassed in this arming mode) while alarm ON.
+                // A siren sounded for a peer node keeps running until disarm or timeout.
+                if (siren_started) {
+                    app_siren_clear();
+                    siren_started = false;
+                }
+                gpio_set_level(led_gpio, led_state);
             }
         } else {
             /* -----------------------------
@@ -211,21 +399,58 @@ void ir_sensor_task(void *arg)
             if (alarm_trigger_param) {
                 esp_rmaker_param_update(alarm_trigger_param, esp_rmaker_bool(false));
             }
-            gpio_set_level(BUZZER_GPIO, 0);
-            gpio_set_level(LED_GPIO, led_state);
+            app_siren_reset();
+            siren_started = false;
+            gpio_set_level(led_gpio, led_state);
         }
 
+        due_us = esp_timer_get_time() + 200 * 1000;
         vTaskDelay(pdMS_TO_TICKS(200));
     }
 }
 
 
+/* ---------------- Network services ----------------
+ * Started by the connection manager once Wi-Fi is up, which may be after a
+ * boot delay or several retries.
+ */
+static void network_ready(void)
+{
+#ifdef CONFIG_APP_FASTPATH_ENABLE
+    // Local control fast path (binary commands on a persistent TCP session)
+    app_fastpath_start();
+#endif
+
+#ifdef CONFIG_APP_LANSYNC_ENABLE
+    // Sound every siren on the LAN without waiting for the cloud
+    app_lansync_start();
+#endif
+
+#ifdef CONFIG_APP_HUB_ENABLE
+    // Listen for satellite sensor reports
+    app_hub_start();
+#endif
+}
+
 /* ---------------- Main ---------------- */
 void app_main()
 {
+    // Installation config (read in place from flash), before the pins are used
+    if (app_devcfg_init() == ESP_OK) {
+        led_gpio = app_devcfg_pin(APP_DEVCFG_LED_GPIO, LED_GPIO_DEFAULT);
+        ir_sensor_gpio = app_devcfg_pin(APP_DEVCFG_IR_SENSOR_GPIO, IR_SENSOR_GPIO_DEFAULT);
+        buzzer_gpio = app_devcfg_pin(APP_DEVCFG_BUZZER_GPIO, BUZZER_GPIO_DEFAULT);
+        light_name = app_devcfg_name(APP_DEVCFG_LIGHT_NAME, light_name);
+        alarm_name = app_devcfg_name(APP_DEVCFG_ALARM_NAME, alarm_name);
+        door_name = app_devcfg_name(APP_DEVCFG_DOOR_NAME, door_name);
+    }
+
     // Hardware init 
     app_driver_init();
 
+    // Shared tick for application timers, before any module starts one
+    app_timer_service_init();
+
     // NVS init
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -238,8 +463,9 @@ void app_main()
     app_network_init();
 
     //RainMaker init
+    // Time sync is required so that schedules fire at the right wall-clock time
     esp_rmaker_config_t rainmaker_cfg = {
-        .enable_time_sync = false,
+        .enable_time_sync = true,
     };
 
     esp_rmaker_node_t *node = esp_rmaker_node_init(&rainmaker_cfg, "SmartHomeNode", "Smart Home Node");
@@ -252,40 +478,45 @@ void app_main()
      * Device type: LIGHTBULB
      * Parameter: "Power" with ESP_RMAKER_PARAM_POWER (standard)
      */
-    esp_rmaker_device_t *light_dev = esp_rmaker_device_create("Home Light", ESP_RMAKER_DEVICE_LIGHTBULB, NULL);
+    esp_rmaker_device_t *light_dev = esp_rmaker_device_create(light_name, ESP_RMAKER_DEVICE_LIGHTBULB, NULL);
     esp_rmaker_device_add_cb(light_dev, write_cb, NULL);
 
-    esp_rmaker_param_t *light_param = esp_rmaker_param_create(
+    light_power_param = esp_rmaker_param_create(
         "Power",
         ESP_RMAKER_PARAM_POWER,
         esp_rmaker_bool(false),
         PROP_FLAG_READ | PROP_FLAG_WRITE
     );
-    esp_rmaker_param_add_ui_type(light_param, ESP_RMAKER_UI_TOGGLE);
-    esp_rmaker_device_add_param(light_dev, light_param);
+    esp_rmaker_param_add_ui_type(light_power_param, ESP_RMAKER_UI_TOGGLE);
+    app_report_add_param(light_dev, light_power_param);
+
+    // Sunset automation params (on at sunset + offset, off at a fixed time)
+    app_daylight_init(light_dev);
     esp_rmaker_node_add_device(node, light_dev);
 
     /* ---------------- Alarm System device ----------------
      * Device type: SWITCH (keeps semantics simple)
      * Parameter: "Power" with ESP_RMAKER_PARAM_POWER (standard)
      */
-    esp_rmaker_device_t *alarm_dev = esp_rmaker_device_create("Alarm System", ESP_RMAKER_DEVICE_SWITCH, NULL);
+    esp_rmaker_device_t *alarm_dev = esp_rmaker_device_create(alarm_name, ESP_RMAKER_DEVICE_SWITCH, NULL);
     esp_rmaker_device_add_cb(alarm_dev, write_cb, NULL);
 
-    esp_rmaker_param_t *alarm_param = esp_rmaker_param_create(
+    alarm_power_param = esp_rmaker_param_create(
         "Power",
         ESP_RMAKER_PARAM_POWER,
         esp_rmaker_bool(false),
         PROP_FLAG_READ | PROP_FLAG_WRITE
     );
-    esp_rmaker_param_add_ui_type(alarm_param, ESP_RMAKER_UI_TOGGLE);
-    esp_rmaker_device_add_param(alarm_dev, alarm_param);
+    esp_rmaker_param_add_ui_type(alarm_power_param, ESP_RMAKER_UI_TOGGLE);
+    app_report_add_param(alarm_dev, alarm_power_param);
+    app_siren_init(buzzer_gpio, alarm_dev);
+    app_arming_init(alarm_dev);
     esp_rmaker_node_add_device(node, alarm_dev);
 
     /* ---------------- Door Sensor Status device ----------------
      * Read-only params: Door Status (OPENED/CLOSED) and Alarm Triggered (bool)
      */
-    esp_rmaker_device_t *door_dev = esp_rmaker_device_create("Door Sensor Status", ESP_RMAKER_DEVICE_OTHER, NULL);
+    esp_rmaker_device_t *door_dev = esp_rmaker_device_create(door_name, ESP_RMAKER_DEVICE_OTHER, NULL);
 
     door_status_param = esp_rmaker_param_create("Door Status", NULL, esp_rmaker_str("CLOSED"),
                                                                 PROP_FLAG_READ);
@@ -294,29 +525,83 @@ void app_main()
 
     esp_rmaker_device_add_param(door_dev, door_status_param);
     esp_rmaker_device_add_param(door_dev, alarm_trigger_param);
+    app_occupancy_init(door_dev);
     esp_rmaker_node_add_device(node, door_dev);
 
-    /* ---------------- OTA + Insights ---------------- */
-    esp_rmaker_ota_enable_default();
+#ifdef CONFIG_APP_HUB_ENABLE
+    /* ---------------- Satellites ----------------
+     * One device per registered satellite sensor, created from the registry in NVS.
+     */
+    app_hub_init(node);
+#endif
+
+    /* ---------------- Home key + actuator ----------------
+     * The home key authenticates local protocols that bypass the cloud.
+     * The actuator task applies commands queued by those local paths.
+     */
+    app_home_key_init(node);
+    app_alert_init();
+    app_nodecfg_init();
+    app_report_init();
+    app_actuator_init();
+    app_time_init();
+    app_history_init();
+    app_anomaly_init();
+
+    /* ---------------- Automation rules ----------------
+     * Local rules ("on door_open if after 22:00 and disarmed then light_on 120")
+     * compiled to bytecode and evaluated on APP_EVENT without a cloud round trip.
+     */
+    app_rules_init(node);
+
+#ifdef CONFIG_APP_UPLINK_SHARED
+    /* ---------------- Shared uplink ----------------
+     * Nodes of the home elect one leader to hold the cloud session.
+     */
+    app_uplink_start(node);
+#endif
+
+    /* ---------------- Schedules ----------------
+     * Schedules are evaluated by esp_schedule using one-shot timers armed for the
+     * next trigger time, so there is no polling. Triggered schedules come back through
+     * write_cb with ctx->src == ESP_RMAKER_REQ_SRC_SCHEDULE, exactly like an app write.
+     * The timezone service lets the phone app set the local timezone so that
+     * "arm at 23:00" means 23:00 local time.
+     */
+    esp_rmaker_timezone_service_enable();
+    esp_rmaker_schedule_enable();
+
+    /* ---------------- OTA + Insights ----------------
+     * Streaming OTA handler: accepts plain or zlib-compressed images and
+     * writes the decoded image straight into the inactive OTA slot.
+     */
+    app_ota_enable();
     
     // Enable ESP Insights
     app_insights_enable();
 
+#ifndef CONFIG_APP_UPLINK_SHARED
     // Start RainMaker agent 
     esp_rmaker_start();
+#else
+    // RainMaker is started by the connection manager once this node is elected leader
+#endif
 
-    // Start network (provisioning or connect)
-    err = app_network_start(POP_TYPE_RANDOM);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Wi-Fi start failed!");
-        abort();
-    }
-
-    // Create IR sensor task 
+    // Create IR sensor task: the alarm works before (and without) the network
     BaseType_t x = xTaskCreate(ir_sensor_task, "ir_sensor_task", IR_TASK_STACK, NULL, IR_TASK_PRIO, NULL);
     if (x != pdPASS) {
         ESP_LOGE(TAG, "Failed to create IR sensor task");
     }
 
+    // Start network (provisioning or connect), with boot jitter and retries
+    err = app_conn_start(network_ready);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Connection manager start failed!");
+        abort();
+    }
+
+    // Verify a freshly updated image before cancelling rollback
+    app_selftest_start();
+
     ESP_LOGI(TAG, "Smart Home System running.");
 }
\ No newline at end of file
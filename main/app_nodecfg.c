@@ -0,0 +1,180 @@
+/* Node configuration reporting
+ *
+ * The node config JSON (devices, params, services) is several KB and only
+ * changes when the firmware or the satellite registry does. It is identified
+ * by its SHA-256, and a full config is published only when it differs from
+ * what this boot has already sent:
+ *
+ *   connect --first of this boot--> RainMaker core reports the config itself,
+ *                                   remember its hash as the core's
+ *           --later--> hash == acked or the core's? skip : publish at QoS 1
+ *   app_nodecfg_report() --> hash == acked? skip : publish at QoS 1
+ *
+ * "acked" is the last config we published and saw the PUBACK for. The core's
+ * publish is QoS 1 too, but its msg_id is not ours to see, so it only spares
+ * reconnects, which the core would not have sent the config on either; an
+ * explicit report of the same config is published once to get an ack. The
+ * hashes live in RAM: the core sends the config on every boot's first
+ * connect anyway, so only reports within one boot are deduplicated. Reconnects
+ * cost no config traffic, and devices added while offline (hub satellites)
+ * reach the cloud on the next connect.
+ *
+ * Saved bytes are counted only for publishes that would otherwise have been
+ * made: app_nodecfg_report() calls, which replace
+ * esp_rmaker_report_node_details(), while online and with a config the cloud
+ * already has. The core sends the config on the first connect of a boot only,
+ * so a reconnect that skips it saves nothing and is not counted.
+ *
+ * The JSON comes from esp_rmaker_get_node_config(), which esp_rainmaker
+ * exports without declaring it in its public headers. main/CMakeLists.txt sets
+ * APP_NODECFG_INTERNAL_API only for the esp_rainmaker versions this was
+ * checked against; with any other, reports go through the public
+ * esp_rmaker_report_node_details() every time, and a report made offline is
+ * sent on the next reconnect, without deduplication.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_diagnostics.h>
+#include <mbedtls/sha256.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+
+#include "app_nodecfg.h"
+#include "app_conn.h"
+
+static const char *TAG = "app_nodecfg";
+
+#define NODECFG_HASH_LEN        32
+
+static uint8_t s_acked[NODECFG_HASH_LEN];   // last config the broker acknowledged
+static uint8_t s_core[NODECFG_HASH_LEN];    // config the core sent on the first connect
+static uint8_t s_sent[NODECFG_HASH_LEN];    // config published, waiting for its ack
+static int s_sent_msg_id;                   // 0 = nothing in flight
+static bool s_connected_once;
+static bool s_pending;                      // reported while offline (without APP_NODECFG_INTERNAL_API)
+static app_nodecfg_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if APP_NODECFG_INTERNAL_API
+
+/* Exported by esp_rainmaker (esp_rmaker_internal.h) but not by its public headers.
+ * Returns a malloc'ed JSON string. */
+extern char *esp_rmaker_get_node_config(void);
+
+/* Publish the config unless the broker already has it. first: the core has just
+ * sent it; requested: app_nodecfg_report() while online. */
+static esp_err_t nodecfg_sync(bool first, bool requested)
+{
+    char *config = esp_rmaker_get_node_config();
+    if (!config) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t len = strlen(config);
+    uint8_t hash[NODECFG_HASH_LEN];
+    mbedtls_sha256((const unsigned char *)config, len, hash, 0);
+    s_stats.last_len = len;
+
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&s_lock);
+    if (first) {
+        /* Published at QoS 1 by the core on its first connect; its msg_id is not ours to see */
+        memcpy(s_core, hash, sizeof(hash));
+    }
+    bool acked = memcmp(hash, s_acked, sizeof(hash)) == 0;
+    bool core = memcmp(hash, s_core, sizeof(hash)) == 0;
+    portEXIT_CRITICAL(&s_lock);
+    if (acked || (!requested && core)) {
+        if (requested) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.skipped++;
+            s_stats.bytes_saved += len;
+            portEXIT_CRITICAL(&s_lock);
+            ESP_LOGI(TAG, "Node config unchanged, %u bytes not sent", (unsigned)len);
+        }
+    } else {
+        char topic[64];
+        int msg_id = -1;
+        snprintf(topic, sizeof(topic), "node/%s/config", esp_rmaker_get_node_id());
+        err = esp_rmaker_mqtt_publish(topic, config, len, 1, &msg_id);
+        if (err == ESP_OK && msg_id > 0) {
+            portENTER_CRITICAL(&s_lock);
+            memcpy(s_sent, hash, sizeof(hash));
+            s_sent_msg_id = msg_id;
+            s_stats.published++;
+            portEXIT_CRITICAL(&s_lock);
+            app_conn_watch_publish(msg_id);
+            ESP_LOGI(TAG, "Node config published, %u bytes", (unsigned)len);
+            ESP_DIAG_EVENT("NODECFG", "Published %u bytes, %lu skipped reports saved %lu bytes",
+                           (unsigned)len, (unsigned long)s_stats.skipped, (unsigned long)s_stats.bytes_saved);
+        } else {
+            ESP_LOGW(TAG, "Node config publish failed, retrying on the next connect");
+            err = err == ESP_OK ? ESP_FAIL : err;
+        }
+    }
+    free(config);
+    return err;
+}
+
+#else
+
+/* No access to the JSON: publish on every report, and on the first reconnect after one made offline */
+static esp_err_t nodecfg_sync(bool first, bool requested)
+{
+    bool send = !first && (requested || s_pending);
+    s_pending = false;
+    if (!send) {
+        return ESP_OK;
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_stats.published++;
+    portEXIT_CRITICAL(&s_lock);
+    return esp_rmaker_report_node_details();
+}
+
+#endif
+
+static void nodecfg_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == RMAKER_MQTT_EVENT_CONNECTED) {
+        bool first = !s_connected_once;
+        s_connected_once = true;
+        s_sent_msg_id = 0;
+        nodecfg_sync(first, false);
+    } else if (id == RMAKER_MQTT_EVENT_PUBLISHED && data) {
+        int msg_id = *(int *)data;
+        portENTER_CRITICAL(&s_lock);
+        if (s_sent_msg_id && msg_id == s_sent_msg_id) {
+            s_sent_msg_id = 0;
+            memcpy(s_acked, s_sent, sizeof(s_acked));
+        }
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+esp_err_t app_nodecfg_report(void)
+{
+    if (!app_conn_is_online()) {
+        s_pending = true;
+        return ESP_OK;  // goes out on the next connect
+    }
+    return nodecfg_sync(false, true);
+}
+
+void app_nodecfg_get_stats(app_nodecfg_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t app_nodecfg_init(void)
+{
+    return esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, nodecfg_event_handler, NULL);
+}
@@ -0,0 +1,50 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t published;         // full configs sent
+    uint32_t skipped;           // reports skipped because the cloud already has the config
+    uint32_t bytes_saved;       // config bytes not sent because of those skips
+    uint32_t last_len;          // size of the current config JSON
+} app_nodecfg_stats_t;
+
+/* Track the node configuration reported to the cloud
+ *
+ * On every cloud reconnect, publishes the config only if it changed since the
+ * RainMaker core or app_nodecfg_report() last sent it. Only reports within one
+ * boot are deduplicated: the core sends the config again on the first connect
+ * after every boot. Call before the network is started.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_nodecfg_init(void);
+
+/* Report the node config after devices or params were added at run time
+ *
+ * Publishes now if the cloud session is up and the broker has not acknowledged
+ * this config yet in this boot; otherwise the change goes out on the next
+ * connect. Replaces esp_rmaker_report_node_details().
+ *
+ * @return ESP_OK if published or nothing to do.
+ * @return error in case of failure.
+ */
+esp_err_t app_nodecfg_report(void);
+
+void app_nodecfg_get_stats(app_nodecfg_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,403 @@
+/* Occupancy statistics
+ *
+ * Streaming aggregates over door transitions, in fixed memory:
+ *   - open counts per local hour (24 slots) and per weekday (7 slots)
+ *   - a baseline per hour of day (decayed mean and mean absolute deviation),
+ *     kept apart for workdays and weekends, and per day, each updated with
+ *     weight 1/8 when the hour or day ends (Q8 fixed point; the per-hour
+ *     baseline is a plain average over its first 8 days)
+ *   - open-duration quantiles from a log-bucket sketch: 8 linear buckets per
+ *     power of two, so any quantile is within 12.5% of the true value
+ *
+ * An event costs a few array increments. Hour and day rollover happens on a
+ * one-minute timer, and that is also when the "Occupancy" param is reported.
+ *
+ * Only hours and days observed from start to end are learned: the one the
+ * node booted (or the clock jumped) into would teach too few opens. The
+ * baselines persist in NVS, written once every OCC_SAVE_HOURS learned hours,
+ * so app_anomaly.c keeps its history across reboots.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <json_generator.h>
+#include <nvs.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_utils.h>
+
+#include "app_occupancy.h"
+#include "app_events.h"
+#include "app_report.h"
+#include "app_timer.h"
+
+static const char *TAG = "app_occupancy";
+
+#define OCC_TICK_MS         (60 * 1000)
+#define OCC_DECAY_SHIFT     3           // baseline weight of a new day: 1/8
+#define OCC_Q8              256
+#define SKETCH_SUB_BITS     3
+#define SKETCH_SUB          (1 << SKETCH_SUB_BITS)
+#define SKETCH_BUCKETS      (SKETCH_SUB * 18)   // up to 2^20 s (12 days)
+#define OCC_PARAM_LEN       320
+#define OCC_NVS_NAMESPACE   "occupancy"
+#define OCC_NVS_KEY         "baseline"
+#define OCC_BASELINE_VERSION 1
+#define OCC_DAY_TYPES       2           // workday, weekend
+#define OCC_SAVE_HOURS      6
+
+/* Persisted part */
+typedef struct {
+    uint8_t version;
+    bool day_seeded;            // first full day seeds base_day instead of decaying into it
+    uint8_t days_hour[OCC_DAY_TYPES][APP_OCCUPANCY_HOURS];     // saturating count of full hours learned
+    uint32_t base_hour_q8[OCC_DAY_TYPES][APP_OCCUPANCY_HOURS];
+    uint32_t dev_hour_q8[OCC_DAY_TYPES][APP_OCCUPANCY_HOURS];
+    uint32_t base_day_q8;
+} occupancy_baseline_t;
+
+typedef struct {
+    bool time_valid;
+    int hour;                   // current local hour, -1 until time is valid
+    int wday;
+    int yday;
+    bool hour_full;             // current hour observed since it started
+    bool day_full;              // current day observed since midnight
+    uint32_t opens_total;
+    uint32_t opens_today;
+    uint16_t opens_hour[APP_OCCUPANCY_HOURS];
+    uint16_t opens_day[APP_OCCUPANCY_DAYS];
+    occupancy_baseline_t base;
+    uint8_t unsaved;            // learned hours not yet in NVS
+    int64_t open_since_us;      // 0 while the door is closed
+    uint16_t sketch[SKETCH_BUCKETS];
+    uint32_t sketch_n;
+} occupancy_t;
+
+static occupancy_t s_occ = {
+    .hour = -1,
+    .base.version = OCC_BASELINE_VERSION,
+};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_rmaker_param_t *s_param;
+static app_timer_t s_timer;
+
+/* ---------------- Duration sketch ---------------- */
+
+static int sketch_index(uint32_t v)
+{
+    if (v < SKETCH_SUB) {
+        return v;
+    }
+    int e = 31 - __builtin_clz(v);
+    int idx = (e - SKETCH_SUB_BITS + 1) * SKETCH_SUB + ((v >> (e - SKETCH_SUB_BITS)) & (SKETCH_SUB - 1));
+    return idx < SKETCH_BUCKETS ? idx : SKETCH_BUCKETS - 1;
+}
+
+/* Midpoint of a bucket */
+static uint32_t sketch_value(int idx)
+{
+    if (idx < SKETCH_SUB) {
+        return idx;
+    }
+    int e = idx / SKETCH_SUB + SKETCH_SUB_BITS - 1;
+    uint32_t width = 1u << (e - SKETCH_SUB_BITS);
+    uint32_t low = (uint32_t)(SKETCH_SUB + idx % SKETCH_SUB) << (e - SKETCH_SUB_BITS);
+    return low + width / 2;
+}
+
+static void sketch_add(occupancy_t *o, uint32_t v)
+{
+    uint16_t *b = &o->sketch[sketch_index(v)];
+    if (*b == UINT16_MAX) {
+        /* Halve everything: keeps the shape, favours recent data. Rare. */
+        o->sketch_n = 0;
+        for (int i = 0; i < SKETCH_BUCKETS; i++) {
+            o->sketch[i] /= 2;
+            o->sketch_n += o->sketch[i];
+        }
+    }
+    (*b)++;
+    o->sketch_n++;
+}
+
+static uint32_t sketch_quantile(const occupancy_t *o, int pct)
+{
+    if (o->sketch_n == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint64_t)o->sketch_n * pct / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < SKETCH_BUCKETS; i++) {
+        seen += o->sketch[i];
+        if (seen > rank) {
+            return sketch_value(i);
+        }
+    }
+    return sketch_value(SKETCH_BUCKETS - 1);
+}
+
+/* ---------------- Aggregates ---------------- */
+
+static void decay(uint32_t *base_q8, uint32_t count)
+{
+    int32_t target = count * OCC_Q8;
+    *base_q8 += (target - (int32_t)*base_q8) >> OCC_DECAY_SHIFT;
+}
+
+static int day_type(int wday)
+{
+    return wday == 0 || wday == 6;
+}
+
+/* Fold a full hour into the mean and mean absolute deviation of its hour of day */
+static void learn_hour(occupancy_baseline_t *b, int type, int h, uint16_t count)
+{
+    int32_t x = (int32_t)count * OCC_Q8;
+    int32_t err = x - (int32_t)b->base_hour_q8[type][h];
+    int32_t abs_err = err < 0 ? -err : err;
+    if (b->days_hour[type][h] == 0) {
+        b->base_hour_q8[type][h] = x;
+        b->dev_hour_q8[type][h] = 0;
+    } else {
+        /* Plain average over the first days, so a short history is not
+         * dominated by the seed (and its zero deviation) */
+        int32_t n = b->days_hour[type][h] + 1;
+        n = n < (1 << OCC_DECAY_SHIFT) ? n : (1 << OCC_DECAY_SHIFT);
+        b->base_hour_q8[type][h] += err / n;
+        b->dev_hour_q8[type][h] += (abs_err - (int32_t)b->dev_hour_q8[type][h]) / n;
+    }
+    if (b->days_hour[type][h] < UINT8_MAX) {
+        b->days_hour[type][h]++;
+    }
+}
+
+/* ---------------- Persistence ---------------- */
+
+static void baseline_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(OCC_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    occupancy_baseline_t base;
+    size_t len = sizeof(base);
+    if (nvs_get_blob(handle, OCC_NVS_KEY, &base, &len) == ESP_OK && len == sizeof(base) &&
+        base.version == OCC_BASELINE_VERSION) {
+        portENTER_CRITICAL(&s_lock);
+        s_occ.base = base;
+        portEXIT_CRITICAL(&s_lock);
+    }
+    nvs_close(handle);
+}
+
+static void baseline_save(const occupancy_baseline_t *base)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(OCC_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, OCC_NVS_KEY, base, sizeof(*base));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save baseline: %s", esp_err_to_name(err));
+    }
+}
+
+static void occupancy_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const app_event_data_t *ev = data;
+    if (ev && ev->src == APP_EVENT_SRC_TEST) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    if (id == APP_EVENT_DOOR_OPENED) {
+        s_occ.opens_total++;
+        if (s_occ.hour >= 0) {
+            s_occ.opens_today++;
+            s_occ.opens_hour[s_occ.hour]++;
+            s_occ.opens_day[s_occ.wday]++;
+        }
+        s_occ.open_since_us = now;
+    } else if (id == APP_EVENT_DOOR_CLOSED && s_occ.open_since_us) {
+        sketch_add(&s_occ, (uint32_t)((now - s_occ.open_since_us) / 1000000));
+        s_occ.open_since_us = 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* Close finished hours/days. Returns true if an hour boundary was crossed. */
+static bool occupancy_rollover(const struct tm *tm)
+{
+    bool crossed = false;
+    occupancy_baseline_t snapshot;
+    bool save = false;
+    portENTER_CRITICAL(&s_lock);
+    if (s_occ.hour < 0) {
+        /* Booted (or got the time) part-way through this hour and day */
+        s_occ.hour = tm->tm_hour;
+        s_occ.wday = tm->tm_wday;
+        s_occ.yday = tm->tm_yday;
+        s_occ.time_valid = true;
+    }
+    if (tm->tm_hour != s_occ.hour) {
+        /* Learn the hour that just ended if it was seen whole. A jump over
+         * hours (clock set, DST) leaves the hour entered partial. */
+        if (s_occ.hour_full) {
+            learn_hour(&s_occ.base, day_type(s_occ.wday), s_occ.hour, s_occ.opens_hour[s_occ.hour]);
+            if (++s_occ.unsaved >= OCC_SAVE_HOURS) {
+                s_occ.unsaved = 0;
+                snapshot = s_occ.base;
+                save = true;
+            }
+        }
+        s_occ.hour_full = tm->tm_hour == (s_occ.hour + 1) % APP_OCCUPANCY_HOURS;
+    }
+    if (tm->tm_yday != s_occ.yday) {
+        /* Day change: fold yesterday into the day baseline */
+        if (s_occ.day_full) {
+            if (s_occ.base.day_seeded) {
+                decay(&s_occ.base.base_day_q8, s_occ.opens_today);
+            } else {
+                s_occ.base.base_day_q8 = s_occ.opens_today * OCC_Q8;
+                s_occ.base.day_seeded = true;
+            }
+        }
+        s_occ.day_full = s_occ.hour_full && tm->tm_hour == 0;
+        s_occ.opens_today = 0;
+        s_occ.wday = tm->tm_wday;
+        s_occ.yday = tm->tm_yday;
+        s_occ.opens_day[s_occ.wday] = 0;
+    }
+    if (tm->tm_hour != s_occ.hour) {
+        /* Clear the slots of the hours we are entering (skipped ones too) */
+        for (int h = (s_occ.hour + 1) % APP_OCCUPANCY_HOURS; ; h = (h + 1) % APP_OCCUPANCY_HOURS) {
+            s_occ.opens_hour[h] = 0;
+            if (h == tm->tm_hour) {
+                break;
+            }
+        }
+        s_occ.hour = tm->tm_hour;
+        crossed = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (save) {
+        baseline_save(&snapshot);
+    }
+    return crossed;
+}
+
+/* ---------------- Publishing ---------------- */
+
+void app_occupancy_get(app_occupancy_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    out->time_valid = s_occ.time_valid;
+    out->opens_total = s_occ.opens_total;
+    memcpy(out->opens_hour, s_occ.opens_hour, sizeof(out->opens_hour));
+    memcpy(out->opens_day, s_occ.opens_day, sizeof(out->opens_day));
+    int type = day_type(s_occ.wday);
+    for (int h = 0; h < APP_OCCUPANCY_HOURS; h++) {
+        out->base_hour[h] = (float)s_occ.base.base_hour_q8[type][h] / OCC_Q8;
+        out->dev_hour[h] = (float)s_occ.base.dev_hour_q8[type][h] / OCC_Q8;
+        out->days_hour[h] = s_occ.base.days_hour[type][h];
+    }
+    out->base_day = (float)s_occ.base.base_day_q8 / OCC_Q8;
+    out->open_p50_s = sketch_quantile(&s_occ, 50);
+    out->open_p90_s = sketch_quantile(&s_occ, 90);
+    out->open_p99_s = sketch_quantile(&s_occ, 99);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void app_occupancy_get_hour(app_occupancy_hour_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    int h = s_occ.hour;
+    out->hour = h;
+    if (h >= 0) {
+        out->opens = s_occ.opens_hour[h];
+        int type = day_type(s_occ.wday);
+        out->base_q8 = s_occ.base.base_hour_q8[type][h];
+        out->dev_q8 = s_occ.base.dev_hour_q8[type][h];
+        out->days = s_occ.base.days_hour[type][h];
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* {"n":..,"h":[24],"d":[7],"bh":[24 tenths],"bd":tenths,"p50":s,"p90":s,"p99":s} */
+static void occupancy_publish(void)
+{
+    static char buf[OCC_PARAM_LEN];
+    app_occupancy_stats_t st;
+    app_occupancy_get(&st);
+
+    json_gen_str_t jstr;
+    int err = 0;
+    json_gen_str_start(&jstr, buf, sizeof(buf), NULL, NULL);
+    err |= json_gen_start_object(&jstr);
+    err |= json_gen_obj_set_int(&jstr, "n", st.opens_total);
+    err |= json_gen_push_array(&jstr, "h");
+    for (int h = 0; h < APP_OCCUPANCY_HOURS; h++) {
+        err |= json_gen_arr_set_int(&jstr, st.opens_hour[h]);
+    }
+    err |= json_gen_pop_array(&jstr);
+    err |= json_gen_push_array(&jstr, "d");
+    for (int d = 0; d < APP_OCCUPANCY_DAYS; d++) {
+        err |= json_gen_arr_set_int(&jstr, st.opens_day[d]);
+    }
+    err |= json_gen_pop_array(&jstr);
+    err |= json_gen_push_array(&jstr, "bh");
+    for (int h = 0; h < APP_OCCUPANCY_HOURS; h++) {
+        err |= json_gen_arr_set_int(&jstr, (int)(st.base_hour[h] * 10 + 0.5f));
+    }
+    err |= json_gen_pop_array(&jstr);
+    err |= json_gen_obj_set_int(&jstr, "bd", (int)(st.base_day * 10 + 0.5f));
+    err |= json_gen_obj_set_int(&jstr, "p50", st.open_p50_s);
+    err |= json_gen_obj_set_int(&jstr, "p90", st.open_p90_s);
+    err |= json_gen_obj_set_int(&jstr, "p99", st.open_p99_s);
+    err |= json_gen_end_object(&jstr);
+    json_gen_str_end(&jstr);
+    if (err) {
+        ESP_LOGW(TAG, "Occupancy summary does not fit in %d bytes", OCC_PARAM_LEN);
+        return;
+    }
+    app_report_param(s_param, esp_rmaker_str(buf));
+}
+
+static void occupancy_timer_cb(app_timer_t *timer, void *arg)
+{
+    app_timer_start(timer, OCC_TICK_MS);
+    if (!esp_rmaker_time_check()) {
+        return;
+    }
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    if (occupancy_rollover(&tm)) {
+        occupancy_publish();
+    }
+}
+
+esp_err_t app_occupancy_init(esp_rmaker_device_t *door_dev)
+{
+    baseline_load();
+    s_param = esp_rmaker_param_create("Occupancy", NULL, esp_rmaker_str("{}"), PROP_FLAG_READ);
+    app_report_add_param(door_dev, s_param);
+
+    app_timer_setup(&s_timer, occupancy_timer_cb, NULL);
+    app_timer_start(&s_timer, OCC_TICK_MS);
+    esp_err_t err = esp_event_handler_register(APP_EVENT, APP_EVENT_DOOR_OPENED, occupancy_event_handler, NULL);
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(APP_EVENT, APP_EVENT_DOOR_CLOSED, occupancy_event_handler, NULL);
+    }
+    return err;
+}
@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_OCCUPANCY_HOURS 24
+#define APP_OCCUPANCY_DAYS  7
+
+typedef struct {
+    bool time_valid;                            // false until SNTP time is available
+    uint32_t opens_total;                       // since boot
+    uint16_t opens_hour[APP_OCCUPANCY_HOURS];   // by local hour of day, last 24 h
+    uint16_t opens_day[APP_OCCUPANCY_DAYS];     // by weekday (0 = Sunday), last 7 days
+    /* Baseline for today's kind of day (workday or weekend) */
+    float base_hour[APP_OCCUPANCY_HOURS];       // decayed mean opens per hour of day
+    float dev_hour[APP_OCCUPANCY_HOURS];        // decayed mean absolute deviation of those
+    uint8_t days_hour[APP_OCCUPANCY_HOURS];     // full hours learned per hour of day (saturating)
+    float base_day;                             // decayed mean opens per day
+    uint32_t open_p50_s;                        // door-open duration quantiles
+    uint32_t open_p90_s;
+    uint32_t open_p99_s;
+} app_occupancy_stats_t;
+
+/* The current hour against its baseline for today's kind of day (workday or
+ * weekend), in Q8 fixed point (256 = one open) */
+typedef struct {
+    int hour;                   // local hour of day, -1 until time is valid (other fields unset)
+    uint16_t opens;             // opens so far in this hour
+    uint32_t base_q8;           // decayed mean opens in this hour of day
+    uint32_t dev_q8;            // decayed mean absolute deviation
+    uint8_t days;               // full hours learned for this hour of day (saturating)
+} app_occupancy_hour_t;
+
+/* Start occupancy statistics and add the "Occupancy" param to the door device
+ *
+ * Door transitions are folded into fixed-size aggregates with constant work
+ * per event: hourly and daily open counts, a decayed per-hour baseline and a
+ * log-bucket sketch of open durations. Workdays and weekends have separate
+ * per-hour baselines. The read-only "Occupancy" param is a
+ * compact JSON summary, reported once per hour. The baseline is learned from
+ * whole hours only and kept in NVS.
+ *
+ * Call after nvs_flash_init().
+ *
+ * @param[in] door_dev Door Sensor Status device handle.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_occupancy_init(esp_rmaker_device_t *door_dev);
+
+/* Copy the current aggregates */
+void app_occupancy_get(app_occupancy_stats_t *out);
+
+/* Copy the current hour's count and baseline (cheap enough for every event) */
+void app_occupancy_get_hour(app_occupancy_hour_t *out);
+
+#ifdef __cplusplus
+}
+#endif
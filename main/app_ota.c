@@ -0,0 +1,320 @@
+/* Streaming OTA handler
+ *
+ * Download -> decode (plain / zlib / delta) -> esp_ota_write() into the inactive slot.
+ * The partition is opened with OTA_WITH_SEQUENTIAL_WRITES so flash is erased
+ * sector by sector just ahead of the writes instead of the whole slot up front.
+ *
+ * Pacing keeps the update out of the way of the alarm path:
+ *   - the OTA runs below the sensor and actuator task priorities
+ *   - writes go to flash one sector at a time with a yield after each, so a
+ *     single erase is the longest cache stall
+ *   - the download is capped at CONFIG_APP_OTA_RATE_KBPS, and slowed to
+ *     CONFIG_APP_OTA_ALARM_RATE_KBPS (0 = paused) while the alarm is sounding
+ * The sensor task reports its polling latency, which is summarised per OTA run
+ * next to the idle baseline.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_ota_ops.h>
+#include <esp_http_client.h>
+#include <esp_crt_bundle.h>
+#include <esp_diagnostics.h>
+
+#include <esp_rmaker_ota.h>
+#include <esp_rmaker_utils.h>
+
+#include "app_ota.h"
+#include "app_ota_decode.h"
+#include "app_siren.h"
+#include "app_selftest.h"
+
+static const char *TAG = "app_ota";
+
+#define OTA_HTTP_BUF_SIZE       4096
+#define OTA_HTTP_TIMEOUT_MS     10000
+#define OTA_REBOOT_DELAY_SEC    5
+#define OTA_WRITE_CHUNK         4096    // one flash sector
+#define OTA_TASK_PRIO           2       // below the sensor (5) and actuator (6) tasks
+#define OTA_PAUSE_POLL_MS       500
+
+typedef struct {
+    esp_ota_handle_t ota;
+    size_t downloaded;      // bytes received over the network
+    int64_t start_us;
+    int64_t pace_us;        // earliest time the next chunk may be read
+    uint32_t throttled_ms;  // time spent sleeping for the rate cap
+    uint32_t alarm_ms;      // part of it spent while the alarm was sounding
+} ota_session_t;
+
+/* ---------------- Alarm latency ---------------- */
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} latency_stats_t;
+
+static portMUX_TYPE s_latency_lock = portMUX_INITIALIZER_UNLOCKED;
+static latency_stats_t s_latency[2];    // [0] idle, [1] during OTA
+static volatile bool s_ota_running;
+
+void app_ota_alarm_latency_sample(uint32_t us)
+{
+    portENTER_CRITICAL(&s_latency_lock);
+    latency_stats_t *l = &s_latency[s_ota_running ? 1 : 0];
+    l->count++;
+    l->sum_us += us;
+    if (us > l->max_us) {
+        l->max_us = us;
+    }
+    portEXIT_CRITICAL(&s_latency_lock);
+}
+
+static void latency_run_start(void)
+{
+    portENTER_CRITICAL(&s_latency_lock);
+    memset(&s_latency[1], 0, sizeof(s_latency[1]));
+    s_ota_running = true;
+    portEXIT_CRITICAL(&s_latency_lock);
+}
+
+static void latency_run_stop(latency_stats_t *idle, latency_stats_t *ota)
+{
+    portENTER_CRITICAL(&s_latency_lock);
+    s_ota_running = false;
+    *idle = s_latency[0];
+    *ota = s_latency[1];
+    portEXIT_CRITICAL(&s_latency_lock);
+}
+
+static uint32_t latency_avg(const latency_stats_t *l)
+{
+    return l->count ? (uint32_t)(l->sum_us / l->count) : 0;
+}
+
+/* ---------------- Pacing ---------------- */
+
+/* Any siren stage past IDLE: an intrusion is being handled (chirp, siren, alerts
+ * after the siren timed out, or the cool-down), not merely "armed with the door open" */
+static bool alarm_sounding(void)
+{
+    return app_siren_get_stage() != APP_SIREN_IDLE;
+}
+
+/* Token bucket: sleep until len more bytes fit under the current rate cap */
+static void ota_pace(ota_session_t *s, size_t len)
+{
+    while (alarm_sounding() && CONFIG_APP_OTA_ALARM_RATE_KBPS == 0) {
+        vTaskDelay(pdMS_TO_TICKS(OTA_PAUSE_POLL_MS));
+        s->throttled_ms += OTA_PAUSE_POLL_MS;
+        s->alarm_ms += OTA_PAUSE_POLL_MS;
+    }
+    bool alarm = alarm_sounding();
+    uint32_t kbps = alarm ? CONFIG_APP_OTA_ALARM_RATE_KBPS : CONFIG_APP_OTA_RATE_KBPS;
+    if (kbps == 0) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (s->pace_us < now) {
+        s->pace_us = now;
+    }
+    s->pace_us += (int64_t)len * 1000000 / ((int64_t)kbps * 1024);
+    uint32_t wait_ms = (s->pace_us - now) / 1000;
+    if (wait_ms) {
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+        s->throttled_ms += wait_ms;
+        if (alarm) {
+            s->alarm_ms += wait_ms;
+        }
+    }
+}
+
+static esp_err_t ota_write(const uint8_t *data, size_t len, void *ctx)
+{
+    ota_session_t *s = ctx;
+    while (len) {
+        size_t n = len < OTA_WRITE_CHUNK ? len : OTA_WRITE_CHUNK;
+        esp_err_t err = esp_ota_write(s->ota, data, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        data += n;
+        len -= n;
+        /* Each sector may have cost an erase with the cache disabled; let the
+         * alarm path catch up before the next one */
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+static void ota_report(esp_rmaker_ota_handle_t handle, ota_status_t status, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void ota_report(esp_rmaker_ota_handle_t handle, ota_status_t status, const char *fmt, ...)
+{
+    char info[96];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(info, sizeof(info), fmt, args);
+    va_end(args);
+    esp_rmaker_ota_report_status(handle, status, info);
+}
+
+static esp_err_t app_ota_cb(esp_rmaker_ota_handle_t handle, esp_rmaker_ota_data_t *ota_data)
+{
+    if (!ota_data->url) {
+        return ESP_FAIL;
+    }
+    ota_report(handle, OTA_STATUS_IN_PROGRESS, "Starting OTA upgrade");
+
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    if (!update_partition) {
+        ota_report(handle, OTA_STATUS_FAILED, "No OTA partition");
+        return ESP_FAIL;
+    }
+
+    esp_http_client_config_t http_cfg = {
+        .url = ota_data->url,
+        .cert_pem = ota_data->server_cert,
+        .timeout_ms = OTA_HTTP_TIMEOUT_MS,
+        .buffer_size = 1024,
+        .keep_alive_enable = true,
+    };
+    if (!http_cfg.cert_pem) {
+        http_cfg.crt_bundle_attach = esp_crt_bundle_attach;
+    }
+
+    ota_session_t session = {
+        .start_us = esp_timer_get_time(),
+    };
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    esp_err_t err = ESP_FAIL;
+    char *buf = malloc(OTA_HTTP_BUF_SIZE);
+    app_ota_decoder_t *dec = app_ota_decoder_create(ota_write, &session);
+    esp_http_client_handle_t client = esp_http_client_init(&http_cfg);
+    bool ota_started = false;
+    if (!buf || !dec || !client) {
+        ota_report(handle, OTA_STATUS_FAILED, "Out of memory");
+        goto cleanup;
+    }
+
+    err = esp_http_client_open(client, 0);
+    if (err != ESP_OK) {
+        ota_report(handle, OTA_STATUS_FAILED, "Failed to open HTTP connection");
+        goto cleanup;
+    }
+    int64_t content_length = esp_http_client_fetch_headers(client);
+    if (esp_http_client_get_status_code(client) != 200) {
+        ota_report(handle, OTA_STATUS_FAILED, "HTTP status %d", esp_http_client_get_status_code(client));
+        err = ESP_FAIL;
+        goto cleanup;
+    }
+
+    err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &session.ota);
+    if (err != ESP_OK) {
+        ota_report(handle, OTA_STATUS_FAILED, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        goto cleanup;
+    }
+    ota_started = true;
+    ota_report(handle, OTA_STATUS_IN_PROGRESS, "Downloading firmware image");
+    if (prio > OTA_TASK_PRIO) {
+        vTaskPrioritySet(NULL, OTA_TASK_PRIO);
+    }
+    latency_run_start();
+
+    while (1) {
+        int len = esp_http_client_read(client, buf, OTA_HTTP_BUF_SIZE);
+        if (len < 0) {
+            ota_report(handle, OTA_STATUS_FAILED, "Download error");
+            err = ESP_FAIL;
+            goto cleanup;
+        }
+        if (len == 0) {
+            if (esp_http_client_is_complete_data_received(client)) {
+                break;
+            }
+            ota_report(handle, OTA_STATUS_FAILED, "Connection closed early");
+            err = ESP_FAIL;
+            goto cleanup;
+        }
+        session.downloaded += len;
+        ota_pace(&session, len);
+        err = app_ota_decoder_feed(dec, (const uint8_t *)buf, len);
+        if (err != ESP_OK) {
+            ota_report(handle, OTA_STATUS_FAILED, "Image write failed: %s", esp_err_to_name(err));
+            goto cleanup;
+        }
+    }
+
+    err = app_ota_decoder_finish(dec);
+    if (err != ESP_OK) {
+        ota_report(handle, OTA_STATUS_FAILED, "Bad %s image: %s", app_ota_decoder_format(dec),
+                   esp_err_to_name(err));
+        goto cleanup;
+    }
+    /* esp_ota_end() validates the image (checksum, SHA-256, signature if enabled) */
+    err = esp_ota_end(session.ota);
+    ota_started = false;
+    if (err != ESP_OK) {
+        ota_report(handle, OTA_STATUS_FAILED, "Image validation failed: %s", esp_err_to_name(err));
+        goto cleanup;
+    }
+    err = esp_ota_set_boot_partition(update_partition);
+    if (err != ESP_OK) {
+        ota_report(handle, OTA_STATUS_FAILED, "Failed to set boot partition");
+        goto cleanup;
+    }
+
+    int64_t elapsed_ms = (esp_timer_get_time() - session.start_us) / 1000;
+    size_t image_size = app_ota_decoder_output_size(dec);
+    latency_stats_t idle, ota;
+    latency_run_stop(&idle, &ota);
+    ESP_LOGI(TAG, "OTA %s: downloaded %u of %lld bytes, image %u bytes, %lld ms (throttled %u ms, %u ms for alarm)",
+             app_ota_decoder_format(dec), (unsigned)session.downloaded, (long long)content_length,
+             (unsigned)image_size, (long long)elapsed_ms, (unsigned)session.throttled_ms,
+             (unsigned)session.alarm_ms);
+    ESP_LOGI(TAG, "Alarm path latency avg/max: %u/%u us during OTA, %u/%u us idle",
+             (unsigned)latency_avg(&ota), (unsigned)ota.max_us, (unsigned)latency_avg(&idle),
+             (unsigned)idle.max_us);
+    ESP_DIAG_EVENT("OTA", "%s image: download %u B, image %u B, %lld ms, throttled %u ms, "
+                   "alarm latency max %u us (idle %u us)", app_ota_decoder_format(dec),
+                   (unsigned)session.downloaded, (unsigned)image_size, (long long)elapsed_ms,
+                   (unsigned)session.throttled_ms, (unsigned)ota.max_us, (unsigned)idle.max_us);
+    ota_report(handle, OTA_STATUS_IN_PROGRESS, "%s image: %u B downloaded, %u B written, %lld ms",
+               app_ota_decoder_format(dec), (unsigned)session.downloaded, (unsigned)image_size,
+               (long long)elapsed_ms);
+
+    ESP_LOGI(TAG, "OTA upgrade successful. Rebooting in %d seconds...", OTA_REBOOT_DELAY_SEC);
+    esp_rmaker_reboot(OTA_REBOOT_DELAY_SEC);
+
+cleanup:
+    s_ota_running = false;
+    vTaskPrioritySet(NULL, prio);
+    if (ota_started) {
+        esp_ota_abort(session.ota);
+    }
+    if (client) {
+        esp_http_client_close(client);
+        esp_http_client_cleanup(client);
+    }
+    app_ota_decoder_destroy(dec);
+    free(buf);
+    return err;
+}
+
+esp_err_t app_ota_enable(void)
+{
+    esp_rmaker_ota_config_t ota_config = {
+        .server_cert = ESP_RMAKER_OTA_DEFAULT_SERVER_CERT,
+        .ota_cb = app_ota_cb,
+        .ota_diag = app_selftest_ota_diag,
+    };
+    return esp_rmaker_ota_enable(&ota_config, OTA_USING_TOPICS);
+}
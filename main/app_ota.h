@@ -0,0 +1,36 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Enable RainMaker OTA with the application's streaming OTA handler
+ *
+ * Replaces esp_rmaker_ota_enable_default(). The handler accepts plain,
+ * zlib-compressed and delta images (see app_ota_decode.h), decodes them while
+ * downloading and writes straight into the inactive OTA partition.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_ota_enable(void);
+
+/* Record one alarm path latency sample
+ *
+ * Called by the sensor task with how late it ran against its schedule.
+ * Samples taken while an OTA is running are summarised separately from the
+ * idle baseline and reported with the OTA result.
+ */
+void app_ota_alarm_latency_sample(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,465 @@
+/* Streaming OTA payload decoder
+ *
+ * Two stages:
+ *   outer: zlib (inflated with the ROM tinfl decompressor into a 32K circular
+ *          dictionary) or raw
+ *   inner: plain app image, or a delta patch against the running image
+ *
+ * Every chunk produced is handed straight to the writer, so no image-sized
+ * buffer or extra partition is needed. Delta patches need one 4K copy buffer.
+ *
+ * Delta patch format (integers little endian), see tools/ota_delta.py:
+ *   header: "SHD1" src_size[4] dst_size[4] src_sha256[32] dst_sha256[32]
+ *   ops   : 0x01 src_off[4] len[4]   copy from the running image
+ *           0x02 len[4] data[len]    insert literal bytes
+ *           0x00                     end of patch
+ * src_sha256 must match the first src_size bytes of the running partition,
+ * and dst_sha256 must match the reconstructed image.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "miniz.h"
+
+#include "app_ota_decode.h"
+
+static const char *TAG = "app_ota_decode";
+
+#define ESP_IMAGE_MAGIC     0xE9
+#define ZLIB_CMF_DEFLATE_32K 0x78
+#define DELTA_MAGIC         "SHD1"
+#define DELTA_HDR_LEN       (4 + 4 + 4 + 32 + 32)
+#define DELTA_COPY_BUF_LEN  4096
+
+enum {
+    DELTA_OP_END = 0x00,
+    DELTA_OP_COPY = 0x01,
+    DELTA_OP_INSERT = 0x02,
+};
+
+typedef enum {
+    DECODE_DETECT = 0,
+    DECODE_RAW,         // outer: no compression
+    DECODE_ZLIB,        // outer: zlib
+    DECODE_PLAIN,       // inner: app image
+    DECODE_DELTA,       // inner: delta patch
+} decode_format_t;
+
+typedef enum {
+    DELTA_HEADER = 0,
+    DELTA_OP,
+    DELTA_INSERT_DATA,
+    DELTA_DONE,
+} delta_state_t;
+
+typedef struct {
+    delta_state_t state;
+    uint8_t hdr[DELTA_HDR_LEN];
+    size_t hdr_len;
+    size_t hdr_need;        // bytes needed for the current header/op
+    uint32_t src_size;
+    uint32_t dst_size;
+    uint32_t insert_left;
+    uint8_t dst_sha256[32];
+    mbedtls_sha256_context dst_hash;
+    const esp_partition_t *src;
+    uint8_t *copy_buf;
+} delta_t;
+
+struct app_ota_decoder {
+    decode_format_t outer;
+    decode_format_t inner;
+    bool done;              // zlib trailer seen
+    bool logged;
+    size_t out_size;
+    app_ota_write_fn_t write;
+    void *ctx;
+
+    /* zlib */
+    tinfl_decompressor *inflator;
+    uint8_t *dict;
+    size_t dict_ofs;
+
+    /* delta */
+    delta_t *delta;
+};
+
+static esp_err_t inner_feed(app_ota_decoder_t *dec, const uint8_t *data, size_t len);
+
+static esp_err_t emit(app_ota_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    dec->out_size += len;
+    return dec->write(data, len, dec->ctx);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ---------------- delta ---------------- */
+
+static esp_err_t delta_start(app_ota_decoder_t *dec)
+{
+    delta_t *d = calloc(1, sizeof(delta_t));
+    if (!d) {
+        return ESP_ERR_NO_MEM;
+    }
+    mbedtls_sha256_init(&d->dst_hash);
+    d->copy_buf = malloc(DELTA_COPY_BUF_LEN);
+    d->src = esp_ota_get_running_partition();
+    dec->delta = d;
+    if (!d->copy_buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!d->src) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    d->state = DELTA_HEADER;
+    d->hdr_need = DELTA_HDR_LEN;
+    mbedtls_sha256_starts(&d->dst_hash, 0);
+    return ESP_OK;
+}
+
+static esp_err_t delta_emit(app_ota_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    delta_t *d = dec->delta;
+    if (dec->out_size + len > d->dst_size) {
+        ESP_LOGE(TAG, "Delta output exceeds declared size");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    mbedtls_sha256_update(&d->dst_hash, data, len);
+    return emit(dec, data, len);
+}
+
+/* Hash the first src_size bytes of the running partition and compare with the patch header */
+static esp_err_t delta_check_source(delta_t *d, const uint8_t expected[32])
+{
+    mbedtls_sha256_context ctx;
+    uint8_t digest[32];
+    esp_err_t err = ESP_OK;
+
+    if (d->src_size > d->src->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    for (uint32_t off = 0; off < d->src_size && err == ESP_OK; off += DELTA_COPY_BUF_LEN) {
+        size_t n = d->src_size - off < DELTA_COPY_BUF_LEN ? d->src_size - off : DELTA_COPY_BUF_LEN;
+        err = esp_partition_read(d->src, off, d->copy_buf, n);
+        if (err == ESP_OK) {
+            mbedtls_sha256_update(&ctx, d->copy_buf, n);
+        }
+    }
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (memcmp(digest, expected, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Delta patch was made for a different source image");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t delta_copy(app_ota_decoder_t *dec, uint32_t src_off, uint32_t len)
+{
+    delta_t *d = dec->delta;
+    if (src_off > d->src_size || len > d->src_size - src_off) {
+        ESP_LOGE(TAG, "Delta copy out of range");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    while (len) {
+        size_t n = len < DELTA_COPY_BUF_LEN ? len : DELTA_COPY_BUF_LEN;
+        esp_err_t err = esp_partition_read(d->src, src_off, d->copy_buf, n);
+        if (err == ESP_OK) {
+            err = delta_emit(dec, d->copy_buf, n);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        src_off += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t delta_header_done(app_ota_decoder_t *dec)
+{
+    delta_t *d = dec->delta;
+    if (d->state == DELTA_HEADER) {
+        if (memcmp(d->hdr, DELTA_MAGIC, 4) != 0) {
+            ESP_LOGE(TAG, "Bad delta patch magic");
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        d->src_size = get_le32(&d->hdr[4]);
+        d->dst_size = get_le32(&d->hdr[8]);
+        memcpy(d->dst_sha256, &d->hdr[44], sizeof(d->dst_sha256));
+        ESP_LOGI(TAG, "Delta patch: %u -> %u bytes", (unsigned)d->src_size, (unsigned)d->dst_size);
+        esp_err_t err = delta_check_source(d, &d->hdr[12]);
+        if (err != ESP_OK) {
+            return err;
+        }
+        d->state = DELTA_OP;
+        d->hdr_need = 1;
+        return ESP_OK;
+    }
+
+    /* DELTA_OP: first byte is the opcode, the rest depends on it */
+    switch (d->hdr[0]) {
+    case DELTA_OP_END:
+        d->state = DELTA_DONE;
+        return ESP_OK;
+    case DELTA_OP_COPY:
+        if (d->hdr_len < 9) {
+            d->hdr_need = 9;
+            return ESP_OK;
+        }
+        d->hdr_need = 1;
+        return delta_copy(dec, get_le32(&d->hdr[1]), get_le32(&d->hdr[5]));
+    case DELTA_OP_INSERT:
+        if (d->hdr_len < 5) {
+            d->hdr_need = 5;
+            return ESP_OK;
+        }
+        d->insert_left = get_le32(&d->hdr[1]);
+        d->state = d->insert_left ? DELTA_INSERT_DATA : DELTA_OP;
+        d->hdr_need = 1;
+        return ESP_OK;
+    default:
+        ESP_LOGE(TAG, "Bad delta opcode 0x%02x", d->hdr[0]);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+}
+
+static esp_err_t delta_feed(app_ota_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    delta_t *d = dec->delta;
+    while (len) {
+        esp_err_t err = ESP_OK;
+        switch (d->state) {
+        case DELTA_HEADER:
+        case DELTA_OP: {
+            size_t n = d->hdr_need - d->hdr_len;
+            n = n < len ? n : len;
+            memcpy(&d->hdr[d->hdr_len], data, n);
+            d->hdr_len += n;
+            data += n;
+            len -= n;
+            if (d->hdr_len == d->hdr_need) {
+                size_t before = d->hdr_need;
+                err = delta_header_done(dec);
+                /* The op is complete unless it asked for more bytes */
+                if (d->hdr_need <= before) {
+                    d->hdr_len = 0;
+                }
+            }
+            break;
+        }
+        case DELTA_INSERT_DATA: {
+            size_t n = d->insert_left < len ? d->insert_left : len;
+            err = delta_emit(dec, data, n);
+            data += n;
+            len -= n;
+            d->insert_left -= n;
+            if (d->insert_left == 0) {
+                d->state = DELTA_OP;
+            }
+            break;
+        }
+        case DELTA_DONE:
+            ESP_LOGW(TAG, "Ignoring %u bytes after end of delta patch", (unsigned)len);
+            return ESP_OK;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t delta_finish(app_ota_decoder_t *dec)
+{
+    delta_t *d = dec->delta;
+    uint8_t digest[32];
+    if (d->state != DELTA_DONE || dec->out_size != d->dst_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    mbedtls_sha256_finish(&d->dst_hash, digest);
+    if (memcmp(digest, d->dst_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Delta output hash mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+/* ---------------- Inner stage ---------------- */
+
+static esp_err_t inner_feed(app_ota_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return ESP_OK;
+    }
+    if (dec->inner == DECODE_DETECT) {
+        if (data[0] == ESP_IMAGE_MAGIC) {
+            dec->inner = DECODE_PLAIN;
+        } else if (data[0] == DELTA_MAGIC[0]) {
+            dec->inner = DECODE_DELTA;
+            esp_err_t err = delta_start(dec);
+            if (err != ESP_OK) {
+                return err;
+            }
+        } else {
+            ESP_LOGE(TAG, "Unknown OTA image format (first byte 0x%02x)", data[0]);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    if (dec->inner == DECODE_DELTA) {
+        return delta_feed(dec, data, len);
+    }
+    return emit(dec, data, len);
+}
+
+/* ---------------- zlib ---------------- */
+
+static esp_err_t zlib_start(app_ota_decoder_t *dec)
+{
+    dec->inflator = malloc(sizeof(tinfl_decompressor));
+    dec->dict = malloc(TINFL_LZ_DICT_SIZE);
+    if (!dec->inflator || !dec->dict) {
+        return ESP_ERR_NO_MEM;
+    }
+    tinfl_init(dec->inflator);
+    dec->dict_ofs = 0;
+    return ESP_OK;
+}
+
+static esp_err_t zlib_feed(app_ota_decoder_t *dec, const uint8_t *in, size_t len)
+{
+    const mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32 | TINFL_FLAG_HAS_MORE_INPUT;
+
+    while (!dec->done) {
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - dec->dict_ofs;
+        tinfl_status status = tinfl_decompress(dec->inflator, in, &in_bytes, dec->dict,
+                                               dec->dict + dec->dict_ofs, &out_bytes, flags);
+        in += in_bytes;
+        len -= in_bytes;
+        if (out_bytes) {
+            esp_err_t err = inner_feed(dec, dec->dict + dec->dict_ofs, out_bytes);
+            if (err != ESP_OK) {
+                return err;
+            }
+            dec->dict_ofs = (dec->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+        if (status == TINFL_STATUS_DONE) {
+            dec->done = true;
+        } else if (status < 0) {
+            ESP_LOGE(TAG, "Inflate failed: %d", status);
+            return ESP_ERR_INVALID_RESPONSE;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) {
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+/* ---------------- Public ---------------- */
+
+app_ota_decoder_t *app_ota_decoder_create(app_ota_write_fn_t write, void *ctx)
+{
+    app_ota_decoder_t *dec = calloc(1, sizeof(*dec));
+    if (dec) {
+        dec->write = write;
+        dec->ctx = ctx;
+    }
+    return dec;
+}
+
+esp_err_t app_ota_decoder_feed(app_ota_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return ESP_OK;
+    }
+    if (dec->outer == DECODE_DETECT) {
+        if (data[0] == ZLIB_CMF_DEFLATE_32K) {
+            dec->outer = DECODE_ZLIB;
+            esp_err_t err = zlib_start(dec);
+            if (err != ESP_OK) {
+                return err;
+            }
+        } else {
+            dec->outer = DECODE_RAW;
+        }
+    }
+
+    esp_err_t err;
+    if (dec->outer == DECODE_ZLIB) {
+        if (dec->done) {
+            ESP_LOGW(TAG, "Ignoring %u bytes after end of zlib stream", (unsigned)len);
+            return ESP_OK;
+        }
+        err = zlib_feed(dec, data, len);
+    } else {
+        err = inner_feed(dec, data, len);
+    }
+    if (err == ESP_OK && !dec->logged) {
+        if (dec->inner != DECODE_DETECT) {
+            ESP_LOGI(TAG, "OTA payload format: %s", app_ota_decoder_format(dec));
+            dec->logged = true;
+        }
+    }
+    return err;
+}
+
+esp_err_t app_ota_decoder_finish(app_ota_decoder_t *dec)
+{
+    if (dec->outer == DECODE_ZLIB && !dec->done) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    switch (dec->inner) {
+    case DECODE_PLAIN:
+        return ESP_OK;
+    case DECODE_DELTA:
+        return delta_finish(dec);
+    default:
+        return ESP_ERR_INVALID_SIZE;
+    }
+}
+
+const char *app_ota_decoder_format(const app_ota_decoder_t *dec)
+{
+    bool zlib = dec->outer == DECODE_ZLIB;
+    switch (dec->inner) {
+    case DECODE_PLAIN:
+        return zlib ? "zlib" : "plain";
+    case DECODE_DELTA:
+        return zlib ? "zlib+delta" : "delta";
+    default:
+        return "unknown";
+    }
+}
+
+size_t app_ota_decoder_output_size(const app_ota_decoder_t *dec)
+{
+    return dec->out_size;
+}
+
+void app_ota_decoder_destroy(app_ota_decoder_t *dec)
+{
+    if (!dec) {
+        return;
+    }
+    if (dec->delta) {
+        mbedtls_sha256_free(&dec->delta->dst_hash);
+        free(dec->delta->copy_buf);
+        free(dec->delta);
+    }
+    free(dec->inflator);
+    free(dec->dict);
+    free(dec);
+}
@@ -0,0 +1,73 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Streaming OTA payload decoder
+ *
+ * The download is fed in arbitrary-sized chunks; the decoder detects the
+ * payload format from its first byte and emits the plain app image through
+ * the write callback, in order, in bounded-size chunks:
+ *
+ *   0xE9  plain ESP app image, passed through
+ *   0x78  zlib stream of an app image or delta patch (tools/ota_compress.py,
+ *         tools/ota_delta.py)
+ *   'S'   "SHD1" delta patch against the running image (tools/ota_delta.py)
+ *
+ * Delta patches are rebuilt by copying ranges out of the running partition,
+ * and are rejected unless the SHA-256 of both the source and the rebuilt image
+ * match the patch header.
+ */
+typedef esp_err_t (*app_ota_write_fn_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct app_ota_decoder app_ota_decoder_t;
+
+/* Create a decoder
+ *
+ * @param[in] write Called with decoded image data.
+ * @param[in] ctx Passed to write.
+ *
+ * @return decoder handle, NULL if out of memory.
+ */
+app_ota_decoder_t *app_ota_decoder_create(app_ota_write_fn_t write, void *ctx);
+
+/* Feed downloaded bytes
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_NOT_SUPPORTED for an unknown payload format.
+ * @return ESP_ERR_INVALID_VERSION if a delta patch was made for another image.
+ * @return ESP_ERR_INVALID_RESPONSE for a corrupt stream.
+ * @return error returned by the write callback.
+ */
+esp_err_t app_ota_decoder_feed(app_ota_decoder_t *dec, const uint8_t *data, size_t len);
+
+/* Check that the stream ended cleanly (e.g. zlib trailer and checksum seen)
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_SIZE if the stream is truncated.
+ * @return ESP_ERR_INVALID_CRC if a delta patch rebuilt the wrong image.
+ */
+esp_err_t app_ota_decoder_finish(app_ota_decoder_t *dec);
+
+/* Name of the detected payload format, for logs and reports */
+const char *app_ota_decoder_format(const app_ota_decoder_t *dec);
+
+/* Number of image bytes emitted so far */
+size_t app_ota_decoder_output_size(const app_ota_decoder_t *dec);
+
+void app_ota_decoder_destroy(app_ota_decoder_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
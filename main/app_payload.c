@@ -0,0 +1,172 @@
+/* Local payload encoders
+ *
+ * Snapshot and history payloads in CBOR (tinycbor) or JSON (json_generator).
+ * Both encoders stream directly into the caller's transport buffer; there is no
+ * intermediate document tree. The JSON path is kept for clients that cannot
+ * decode CBOR and as the reference for size/time comparisons (the fast path
+ * reports the encode time of every payload it sends).
+ */
+
+#include <string.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <cbor.h>
+#include <json_generator.h>
+
+#include "app_payload.h"
+#include "app_history.h"
+#include "app_priv.h"
+
+typedef struct {
+    bool light;
+    bool alarm;
+    bool door;
+    uint32_t uptime_ms;
+    uint32_t heap;
+    uint32_t heap_min;
+    uint32_t hist;
+} snapshot_t;
+
+static void snapshot_collect(snapshot_t *s)
+{
+    size_t total = 0;
+    app_history_get_page(0, NULL, 0, &total);
+    s->light = app_light_get();
+    s->alarm = app_alarm_is_enabled();
+    s->door = app_door_is_open();
+    s->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    s->heap = esp_get_free_heap_size();
+    s->heap_min = esp_get_minimum_free_heap_size();
+    s->hist = total;
+}
+
+/* ---------------- CBOR ---------------- */
+
+static int cbor_snapshot(const snapshot_t *s, uint8_t *buf, size_t len)
+{
+    CborEncoder root, map;
+    CborError err = CborNoError;
+    cbor_encoder_init(&root, buf, len, 0);
+    err |= cbor_encoder_create_map(&root, &map, 7);
+    err |= cbor_encode_text_stringz(&map, "light");
+    err |= cbor_encode_boolean(&map, s->light);
+    err |= cbor_encode_text_stringz(&map, "alarm");
+    err |= cbor_encode_boolean(&map, s->alarm);
+    err |= cbor_encode_text_stringz(&map, "door");
+    err |= cbor_encode_boolean(&map, s->door);
+    err |= cbor_encode_text_stringz(&map, "up");
+    err |= cbor_encode_uint(&map, s->uptime_ms);
+    err |= cbor_encode_text_stringz(&map, "heap");
+    err |= cbor_encode_uint(&map, s->heap);
+    err |= cbor_encode_text_stringz(&map, "heap_min");
+    err |= cbor_encode_uint(&map, s->heap_min);
+    err |= cbor_encode_text_stringz(&map, "hist");
+    err |= cbor_encode_uint(&map, s->hist);
+    err |= cbor_encoder_close_container(&root, &map);
+    if (err != CborNoError) {
+        return -1;
+    }
+    return cbor_encoder_get_buffer_size(&root, buf);
+}
+
+static int cbor_history(size_t page, const app_history_entry_t *ev, size_t n, size_t total,
+                        uint8_t *buf, size_t len)
+{
+    CborEncoder root, map, list, item;
+    CborError err = CborNoError;
+    cbor_encoder_init(&root, buf, len, 0);
+    err |= cbor_encoder_create_map(&root, &map, 3);
+    err |= cbor_encode_text_stringz(&map, "page");
+    err |= cbor_encode_uint(&map, page);
+    err |= cbor_encode_text_stringz(&map, "total");
+    err |= cbor_encode_uint(&map, total);
+    err |= cbor_encode_text_stringz(&map, "ev");
+    err |= cbor_encoder_create_array(&map, &list, n);
+    for (size_t i = 0; i < n && err == CborNoError; i++) {
+        err |= cbor_encoder_create_array(&list, &item, 5);
+        err |= cbor_encode_uint(&item, ev[i].wall_s);
+        err |= cbor_encode_uint(&item, ev[i].uptime_ms);
+        err |= cbor_encode_uint(&item, ev[i].id);
+        err |= cbor_encode_uint(&item, ev[i].src);
+        err |= cbor_encode_uint(&item, ev[i].zone);
+        err |= cbor_encoder_close_container(&list, &item);
+    }
+    err |= cbor_encoder_close_container(&map, &list);
+    err |= cbor_encoder_close_container(&root, &map);
+    if (err != CborNoError) {
+        return -1;
+    }
+    return cbor_encoder_get_buffer_size(&root, buf);
+}
+
+/* ---------------- JSON ---------------- */
+
+/* json_generator has no flush callback here, so running out of buffer
+ * shows up as a non-zero return from the set calls */
+static int json_finish(json_gen_str_t *jstr, int err, uint8_t *buf)
+{
+    json_gen_str_end(jstr);
+    if (err) {
+        return -1;
+    }
+    return strlen((char *)buf);
+}
+
+static int json_snapshot(const snapshot_t *s, uint8_t *buf, size_t len)
+{
+    json_gen_str_t jstr;
+    int err = 0;
+    json_gen_str_start(&jstr, (char *)buf, len, NULL, NULL);
+    err |= json_gen_start_object(&jstr);
+    err |= json_gen_obj_set_bool(&jstr, "light", s->light);
+    err |= json_gen_obj_set_bool(&jstr, "alarm", s->alarm);
+    err |= json_gen_obj_set_bool(&jstr, "door", s->door);
+    err |= json_gen_obj_set_int(&jstr, "up", s->uptime_ms);
+    err |= json_gen_obj_set_int(&jstr, "heap", s->heap);
+    err |= json_gen_obj_set_int(&jstr, "heap_min", s->heap_min);
+    err |= json_gen_obj_set_int(&jstr, "hist", s->hist);
+    err |= json_gen_end_object(&jstr);
+    return json_finish(&jstr, err, buf);
+}
+
+static int json_history(size_t page, const app_history_entry_t *ev, size_t n, size_t total,
+                        uint8_t *buf, size_t len)
+{
+    json_gen_str_t jstr;
+    int err = 0;
+    json_gen_str_start(&jstr, (char *)buf, len, NULL, NULL);
+    err |= json_gen_start_object(&jstr);
+    err |= json_gen_obj_set_int(&jstr, "page", page);
+    err |= json_gen_obj_set_int(&jstr, "total", total);
+    err |= json_gen_push_array(&jstr, "ev");
+    for (size_t i = 0; i < n && !err; i++) {
+        err |= json_gen_start_array(&jstr);
+        err |= json_gen_arr_set_int(&jstr, ev[i].wall_s);
+        err |= json_gen_arr_set_int(&jstr, ev[i].uptime_ms);
+        err |= json_gen_arr_set_int(&jstr, ev[i].id);
+        err |= json_gen_arr_set_int(&jstr, ev[i].src);
+        err |= json_gen_arr_set_int(&jstr, ev[i].zone);
+        err |= json_gen_end_array(&jstr);
+    }
+    err |= json_gen_pop_array(&jstr);
+    err |= json_gen_end_object(&jstr);
+    return json_finish(&jstr, err, buf);
+}
+
+/* ---------------- Public ---------------- */
+
+int app_payload_snapshot(app_payload_fmt_t fmt, uint8_t *buf, size_t len)
+{
+    snapshot_t s;
+    snapshot_collect(&s);
+    return fmt == APP_PAYLOAD_JSON ? json_snapshot(&s, buf, len) : cbor_snapshot(&s, buf, len);
+}
+
+int app_payload_history(app_payload_fmt_t fmt, size_t page, uint8_t *buf, size_t len)
+{
+    app_history_entry_t ev[APP_PAYLOAD_HISTORY_PAGE];
+    size_t total = 0;
+    size_t n = app_history_get_page(page, ev, APP_PAYLOAD_HISTORY_PAGE, &total);
+    return fmt == APP_PAYLOAD_JSON ? json_history(page, ev, n, total, buf, len)
+                                   : cbor_history(page, ev, n, total, buf, len);
+}
@@ -0,0 +1,47 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entries per history page */
+#define APP_PAYLOAD_HISTORY_PAGE    16
+
+typedef enum {
+    APP_PAYLOAD_CBOR = 0,
+    APP_PAYLOAD_JSON,
+} app_payload_fmt_t;
+
+/* Encode a status snapshot straight into a transport buffer
+ *
+ * {"light":b,"alarm":b,"door":b,"up":ms,"heap":bytes,"heap_min":bytes,"hist":n}
+ *
+ * @param[in] fmt CBOR or JSON. Both use the same keys.
+ * @param[out] buf Destination buffer.
+ * @param[in] len Size of buf.
+ *
+ * @return number of bytes written, or -1 if buf is too small.
+ */
+int app_payload_snapshot(app_payload_fmt_t fmt, uint8_t *buf, size_t len);
+
+/* Encode one page of event history straight into a transport buffer
+ *
+ * {"page":n,"total":n,"ev":[[wall_s,uptime_ms,id,src,zone],...]}, newest first.
+ *
+ * @return number of bytes written, or -1 if buf is too small.
+ */
+int app_payload_history(app_payload_fmt_t fmt, size_t page, uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <esp_err.h>
+#include "app_events.h"
 
 void app_driver_init(void);
 esp_err_t app_driver_set_gpio(const char *name, bool state);
+esp_err_t app_light_set(bool on);
+bool app_light_get(void);
+bool app_door_is_open(void);
+bool app_alarm_is_enabled(void);
+esp_err_t app_alarm_set(bool enable, app_event_src_t src);
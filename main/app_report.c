@@ -0,0 +1,231 @@
+/* Param reporting with latest-value-wins compaction
+ *
+ * While the cloud session is down, reporting every change would queue each
+ * intermediate value and replay all of them on reconnect, although only the
+ * last one of each param matters (alerts, which need their history, go
+ * through app_alert instead). Here an offline change only updates the value
+ * kept by RainMaker and sets the param's state:
+ *
+ *   clean --offline change--> dirty --connect--> sent --ack--> clean
+ *                               ^                  |
+ *                               +--session lost----+
+ *
+ * On connect, every dirty param goes out in one params report with its
+ * current value. Memory is one slot per tracked param, whatever the length
+ * of the outage.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_diagnostics.h>
+#include <json_generator.h>
+
+#include <esp_rmaker_mqtt.h>
+#include <esp_rmaker_common_events.h>
+
+#include "app_report.h"
+#include "app_conn.h"
+
+static const char *TAG = "app_report";
+
+/* Params of the fixed devices, plus status and battery of every satellite */
+#ifdef CONFIG_APP_HUB_ENABLE
+#define REPORT_MAX_PARAMS   (16 + 2 * CONFIG_APP_HUB_MAX_SATELLITES)
+#else
+#define REPORT_MAX_PARAMS   16
+#endif
+#define REPORT_BUF_LEN      2048
+
+typedef enum {
+    REPORT_CLEAN = 0,
+    REPORT_DIRTY,
+    REPORT_SENT,        // in the snapshot waiting for its ack
+} report_state_t;
+
+typedef struct {
+    const esp_rmaker_param_t *param;
+    const char *device;
+    report_state_t state;
+} report_slot_t;
+
+static report_slot_t s_slots[REPORT_MAX_PARAMS];
+static int s_count;
+static int s_snapshot_msg_id;   // 0 = no snapshot in flight
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static report_slot_t *slot_find(const esp_rmaker_param_t *param)
+{
+    for (int i = 0; i < s_count; i++) {
+        if (s_slots[i].param == param) {
+            return &s_slots[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t app_report_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param)
+{
+    esp_err_t err = esp_rmaker_device_add_param(device, param);
+    if (err != ESP_OK) {
+        return err;
+    }
+    portENTER_CRITICAL(&s_lock);
+    bool full = s_count == REPORT_MAX_PARAMS;
+    if (!full) {
+        s_slots[s_count].param = param;
+        s_slots[s_count].device = esp_rmaker_device_get_name(device);
+        s_slots[s_count].state = REPORT_CLEAN;
+        s_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (full) {
+        /* Still works, just reported on every change */
+        ESP_LOGW(TAG, "Too many params, %s not compacted", esp_rmaker_param_get_name(param));
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val)
+{
+    if (!app_conn_is_online()) {
+        portENTER_CRITICAL(&s_lock);
+        report_slot_t *slot = slot_find(param);
+        if (slot) {
+            slot->state = REPORT_DIRTY;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (slot) {
+            return esp_rmaker_param_update(param, val);
+        }
+    }
+    return esp_rmaker_param_update_and_report(param, val);
+}
+
+/* ---------------- Snapshot ---------------- */
+
+static int snapshot_add_val(json_gen_str_t *jstr, const char *name, const esp_rmaker_param_val_t *val)
+{
+    switch (val->type) {
+    case RMAKER_VAL_TYPE_BOOLEAN:
+        return json_gen_obj_set_bool(jstr, name, val->val.b);
+    case RMAKER_VAL_TYPE_INTEGER:
+        return json_gen_obj_set_int(jstr, name, val->val.i);
+    case RMAKER_VAL_TYPE_FLOAT:
+        return json_gen_obj_set_float(jstr, name, val->val.f);
+    case RMAKER_VAL_TYPE_STRING:
+        return json_gen_obj_set_string(jstr, name, val->val.s ? val->val.s : "");
+    default:
+        return -1;
+    }
+}
+
+/* {"<device>": {"<param>": <value>, ...}, ...} for the dirty params, marking them sent */
+static int snapshot_build(char *buf, size_t len, int *params)
+{
+    json_gen_str_t jstr;
+    int err = 0;
+    *params = 0;
+    json_gen_str_start(&jstr, buf, len, NULL, NULL);
+    err |= json_gen_start_object(&jstr);
+    for (int i = 0; i < s_count; i++) {
+        if (s_slots[i].state != REPORT_DIRTY) {
+            continue;
+        }
+        /* Open each device once, with all of its dirty params */
+        const char *device = s_slots[i].device;
+        err |= json_gen_push_object(&jstr, device);
+        for (int j = i; j < s_count; j++) {
+            report_slot_t *slot = &s_slots[j];
+            if (slot->state != REPORT_DIRTY || strcmp(slot->device, device) != 0) {
+                continue;
+            }
+            slot->state = REPORT_SENT;  // before reading: a change after this makes it dirty again
+            esp_rmaker_param_val_t *val = esp_rmaker_param_get_val((esp_rmaker_param_t *)slot->param);
+            if (val) {
+                err |= snapshot_add_val(&jstr, esp_rmaker_param_get_name(slot->param), val);
+            }
+            (*params)++;
+        }
+        err |= json_gen_pop_object(&jstr);
+    }
+    err |= json_gen_end_object(&jstr);
+    json_gen_str_end(&jstr);
+    return err;
+}
+
+static void snapshot_send(void)
+{
+    char *buf = malloc(REPORT_BUF_LEN);
+    if (!buf) {
+        return;
+    }
+    int params = 0;
+    int err = snapshot_build(buf, REPORT_BUF_LEN, &params);
+    if (params == 0) {
+        free(buf);
+        return;
+    }
+    char topic[64];
+    int msg_id = -1;
+    snprintf(topic, sizeof(topic), "node/%s/params/local", esp_rmaker_get_node_id());
+    if (err == 0 && esp_rmaker_mqtt_publish(topic, buf, strlen(buf), 1, &msg_id) == ESP_OK && msg_id > 0) {
+        s_snapshot_msg_id = msg_id;
+        app_conn_watch_publish(msg_id);
+        ESP_LOGI(TAG, "Reported %d params changed while offline in %u bytes", params, (unsigned)strlen(buf));
+        ESP_DIAG_EVENT("REPORT", "Offline snapshot: %d params, %u bytes", params, (unsigned)strlen(buf));
+    } else {
+        /* Too big or not accepted: fall back to one report per param */
+        ESP_LOGW(TAG, "Snapshot not sent, reporting %d params one by one", params);
+        for (int i = 0; i < s_count; i++) {
+            if (s_slots[i].state == REPORT_SENT) {
+                s_slots[i].state = REPORT_CLEAN;
+                esp_rmaker_param_val_t *val = esp_rmaker_param_get_val((esp_rmaker_param_t *)s_slots[i].param);
+                if (val) {
+                    esp_rmaker_param_update_and_report(s_slots[i].param, *val);
+                }
+            }
+        }
+    }
+    free(buf);
+}
+
+static void report_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == RMAKER_MQTT_EVENT_PUBLISHED && data) {
+        int msg_id = *(int *)data;
+        portENTER_CRITICAL(&s_lock);
+        if (s_snapshot_msg_id && msg_id == s_snapshot_msg_id) {
+            s_snapshot_msg_id = 0;
+            for (int i = 0; i < s_count; i++) {
+                if (s_slots[i].state == REPORT_SENT) {
+                    s_slots[i].state = REPORT_CLEAN;
+                }
+            }
+        }
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    if (id != RMAKER_MQTT_EVENT_CONNECTED && id != RMAKER_MQTT_EVENT_DISCONNECTED) {
+        return;
+    }
+    /* A snapshot the broker did not acknowledge is as good as unsent */
+    portENTER_CRITICAL(&s_lock);
+    s_snapshot_msg_id = 0;
+    for (int i = 0; i < s_count; i++) {
+        if (s_slots[i].state == REPORT_SENT) {
+            s_slots[i].state = REPORT_DIRTY;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (id == RMAKER_MQTT_EVENT_CONNECTED) {
+        snapshot_send();
+    }
+}
+
+esp_err_t app_report_init(void)
+{
+    return esp_event_handler_register(RMAKER_COMMON_EVENT, ESP_EVENT_ANY_ID, report_event_handler, NULL);
+}
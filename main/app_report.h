@@ -0,0 +1,47 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Add a param to its device and track it for offline compaction
+ *
+ * Same as esp_rmaker_device_add_param(). Use it for params that are later
+ * reported with app_report_param().
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_report_add_param(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param);
+
+/* Update a param and report it to the cloud
+ *
+ * Online this is esp_rmaker_param_update_and_report(). Offline, a tracked
+ * param is only updated and marked dirty: on reconnect, all dirty params are
+ * sent in one snapshot with their latest values, and stay dirty until the
+ * broker acknowledges it.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_report_param(const esp_rmaker_param_t *param, esp_rmaker_param_val_t val);
+
+/* Register for cloud connection events. Call before the network is started.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_report_init(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,562 @@
+/* Local rule engine
+ *
+ * Rules arrive as text in the "Rules" param of the Automation service and are
+ * compiled once into a compact bytecode arena, grouped by triggering event:
+ *
+ *   arena: [rules for event 0][rules for event 1]...[rules for event N-1]
+ *   index: index[e]..index[e+1] is the byte range of the rules for event e
+ *   rule : [len][op][args]...[op][args]    (len includes itself)
+ *
+ * Conditions come first and actions last. Evaluation on an event only walks that
+ * event's range, each rule is at most RULE_MAX_LEN bytes and has no jumps/loops,
+ * so the cost per event is bounded by the size of its range.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_diagnostics.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_standard_types.h>
+#include <esp_rmaker_utils.h>
+
+#include "app_rules.h"
+#include "app_events.h"
+#include "app_priv.h"
+#include "app_alert.h"
+#include "app_timer.h"
+#include "app_devcfg.h"
+
+static const char *TAG = "app_rules";
+
+#define RULES_ARENA_SIZE    CONFIG_APP_RULES_ARENA_SIZE
+#define RULE_MAX_LEN        64
+#define RULE_MAX_TOKENS     32
+/* Action bytes of fired rules collected under s_lock, run after it is released.
+ * Holds at least one rule's actions. */
+#define RULES_ACTION_BUF    (2 * RULE_MAX_LEN)
+
+/* Opcodes. Conditions are < OP_ACTION_BASE, actions are >= OP_ACTION_BASE. */
+enum {
+    OP_TIME_AFTER = 0x01,   // u16 minute of day
+    OP_TIME_BEFORE,         // u16 minute of day
+    OP_ARMED,
+    OP_DISARMED,
+    OP_LIGHT_IS_ON,
+    OP_LIGHT_IS_OFF,
+    OP_DOOR_IS_OPEN,
+    OP_DOOR_IS_CLOSED,
+
+    OP_ACTION_BASE = 0x80,
+    OP_LIGHT_ON = OP_ACTION_BASE, // u16 seconds, 0 = stay on
+    OP_LIGHT_OFF,
+    OP_ARM,
+    OP_DISARM,
+    OP_ALERT,
+};
+
+typedef struct {
+    const char *name;
+    uint8_t op;
+} rule_keyword_t;
+
+static const char *const s_event_names[APP_EVENT_MAX] = {
+    [APP_EVENT_DOOR_OPENED]    = "door_open",
+    [APP_EVENT_DOOR_CLOSED]    = "door_close",
+    [APP_EVENT_ALARM_ARMED]    = "alarm_arm",
+    [APP_EVENT_ALARM_DISARMED] = "alarm_disarm",
+    [APP_EVENT_ALARM_TRIGGERED] = "alarm_trigger",
+};
+
+static const rule_keyword_t s_conditions[] = {
+    { "after",       OP_TIME_AFTER },
+    { "before",      OP_TIME_BEFORE },
+    { "armed",       OP_ARMED },
+    { "disarmed",    OP_DISARMED },
+    { "light_on",    OP_LIGHT_IS_ON },
+    { "light_off",   OP_LIGHT_IS_OFF },
+    { "door_open",   OP_DOOR_IS_OPEN },
+    { "door_closed", OP_DOOR_IS_CLOSED },
+};
+
+static const rule_keyword_t s_actions[] = {
+    { "light_on",  OP_LIGHT_ON },
+    { "light_off", OP_LIGHT_OFF },
+    { "arm",       OP_ARM },
+    { "disarm",    OP_DISARM },
+    { "alert",     OP_ALERT },
+};
+
+/* Active program. Replaced as a whole under s_lock. */
+static uint8_t s_arena[RULES_ARENA_SIZE];
+static uint16_t s_index[APP_EVENT_MAX + 1];
+static uint16_t s_rule_count;
+static uint32_t s_generation;   // bumped on every load
+static SemaphoreHandle_t s_lock;
+
+static app_timer_t s_light_timer;
+static esp_rmaker_param_t *s_rules_param;
+static esp_rmaker_param_t *s_status_param;
+
+/* ---------------- Compiler ---------------- */
+
+static int keyword_lookup(const rule_keyword_t *table, size_t count, const char *tok)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(table[i].name, tok) == 0) {
+            return table[i].op;
+        }
+    }
+    return -1;
+}
+
+static int event_lookup(const char *tok)
+{
+    for (int i = 0; i < APP_EVENT_MAX; i++) {
+        if (strcasecmp(s_event_names[i], tok) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int parse_minute_of_day(const char *tok)
+{
+    int h, m;
+    if (!tok || sscanf(tok, "%d:%d", &h, &m) != 2 || h < 0 || h > 23 || m < 0 || m > 59) {
+        return -1;
+    }
+    return h * 60 + m;
+}
+
+static bool is_number(const char *tok)
+{
+    if (!tok || !*tok) {
+        return false;
+    }
+    for (; *tok; tok++) {
+        if (!isdigit((unsigned char)*tok)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Compile one rule into out (starting with the length byte).
+ * Returns the encoded length, or -1 with err_msg filled in. */
+static int compile_rule(char *line, int *event, uint8_t *out, char *err_msg, size_t err_len)
+{
+    char *tokens[RULE_MAX_TOKENS];
+    int ntok = 0;
+    char *save = NULL;
+    for (char *t = strtok_r(line, " \t,", &save); t; t = strtok_r(NULL, " \t,", &save)) {
+        if (ntok == RULE_MAX_TOKENS) {
+            snprintf(err_msg, err_len, "too many tokens");
+            return -1;
+        }
+        tokens[ntok++] = t;
+    }
+
+    int i = 0;
+    if (ntok < 4 || strcasecmp(tokens[i++], "on") != 0) {
+        snprintf(err_msg, err_len, "expected 'on <event> ... then <action>'");
+        return -1;
+    }
+    *event = event_lookup(tokens[i]);
+    if (*event < 0) {
+        snprintf(err_msg, err_len, "unknown event '%s'", tokens[i]);
+        return -1;
+    }
+    i++;
+
+    int len = 1;    // length byte
+    if (strcasecmp(tokens[i], "if") == 0) {
+        i++;
+        while (i < ntok && strcasecmp(tokens[i], "then") != 0) {
+            if (strcasecmp(tokens[i], "and") == 0) {
+                i++;
+                continue;
+            }
+            int op = keyword_lookup(s_conditions, sizeof(s_conditions) / sizeof(s_conditions[0]), tokens[i]);
+            if (op < 0) {
+                snprintf(err_msg, err_len, "unknown condition '%s'", tokens[i]);
+                return -1;
+            }
+            i++;
+            if (len + 3 > RULE_MAX_LEN) {
+                snprintf(err_msg, err_len, "rule too long");
+                return -1;
+            }
+            out[len++] = op;
+            if (op == OP_TIME_AFTER || op == OP_TIME_BEFORE) {
+                int minute = parse_minute_of_day(i < ntok ? tokens[i] : NULL);
+                if (minute < 0) {
+                    snprintf(err_msg, err_len, "expected HH:MM after '%s'", tokens[i - 1]);
+                    return -1;
+                }
+                i++;
+                out[len++] = minute & 0xff;
+                out[len++] = minute >> 8;
+            }
+        }
+    }
+    if (i >= ntok || strcasecmp(tokens[i], "then") != 0) {
+        snprintf(err_msg, err_len, "missing 'then'");
+        return -1;
+    }
+    i++;
+
+    int actions = 0;
+    while (i < ntok) {
+        int op = keyword_lookup(s_actions, sizeof(s_actions) / sizeof(s_actions[0]), tokens[i]);
+        if (op < 0) {
+            snprintf(err_msg, err_len, "unknown action '%s'", tokens[i]);
+            return -1;
+        }
+        i++;
+        if (len + 3 > RULE_MAX_LEN) {
+            snprintf(err_msg, err_len, "rule too long");
+            return -1;
+        }
+        out[len++] = op;
+        if (op == OP_LIGHT_ON) {
+            long seconds = 0;
+            if (i < ntok && is_number(tokens[i])) {
+                seconds = strtol(tokens[i++], NULL, 10);
+                if (seconds > UINT16_MAX) {
+                    snprintf(err_msg, err_len, "light_on duration too long");
+                    return -1;
+                }
+            }
+            out[len++] = seconds & 0xff;
+            out[len++] = seconds >> 8;
+        }
+        actions++;
+    }
+    if (actions == 0) {
+        snprintf(err_msg, err_len, "no action after 'then'");
+        return -1;
+    }
+    out[0] = len;
+    return len;
+}
+
+/* Compile the whole text into arena/index grouped by event.
+ * Rules are first compiled in source order into a scratch buffer
+ * ([event][rule bytes]...), then copied into the arena one event at a time. */
+static esp_err_t compile_program(const char *text, uint8_t *arena, uint16_t *index,
+                                 uint16_t *rule_count, char *err_msg, size_t err_len)
+{
+    uint8_t *scratch = malloc(RULES_ARENA_SIZE);
+    char *src = strdup(text ? text : "");
+    if (!scratch || !src) {
+        free(scratch);
+        free(src);
+        snprintf(err_msg, err_len, "out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = ESP_OK;
+    size_t used = 0;
+    uint16_t count = 0;
+    int line_no = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(src, ";\n", &save); line; line = strtok_r(NULL, ";\n", &save)) {
+        line_no++;
+        while (isspace((unsigned char)*line)) {
+            line++;
+        }
+        if (*line == '\0' || *line == '#') {
+            continue;
+        }
+        uint8_t rule[RULE_MAX_LEN];
+        int event;
+        char rule_err[48];
+        int len = compile_rule(line, &event, rule, rule_err, sizeof(rule_err));
+        if (len < 0) {
+            snprintf(err_msg, err_len, "rule %d: %s", line_no, rule_err);
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        /* Scratch holds one extra event byte per rule; the arena does not. */
+        if (used + 1 + len > RULES_ARENA_SIZE) {
+            snprintf(err_msg, err_len, "rules exceed %d bytes", RULES_ARENA_SIZE);
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        scratch[used++] = event;
+        memcpy(&scratch[used], rule, len);
+        used += len;
+        count++;
+    }
+
+    if (err == ESP_OK) {
+        uint16_t out = 0;
+        for (int e = 0; e < APP_EVENT_MAX; e++) {
+            index[e] = out;
+            for (size_t p = 0; p < used; p += 1 + scratch[p + 1]) {
+                if (scratch[p] == e) {
+                    memcpy(&arena[out], &scratch[p + 1], scratch[p + 1]);
+                    out += scratch[p + 1];
+                }
+            }
+        }
+        index[APP_EVENT_MAX] = out;
+        *rule_count = count;
+        snprintf(err_msg, err_len, "%u rules, %u bytes", count, out);
+    }
+
+    free(src);
+    free(scratch);
+    return err;
+}
+
+esp_err_t app_rules_load(const char *text, char *err_msg, size_t err_len)
+{
+    static uint8_t arena[RULES_ARENA_SIZE];
+    uint16_t index[APP_EVENT_MAX + 1];
+    uint16_t count = 0;
+    char local_msg[64];
+    if (!err_msg) {
+        err_msg = local_msg;
+        err_len = sizeof(local_msg);
+    }
+
+    /* Compile outside the lock; arena is only touched by writers,
+     * which are serialised by the RainMaker task. */
+    esp_err_t err = compile_program(text, arena, index, &count, err_msg, err_len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Rules rejected: %s", err_msg);
+        return err;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memcpy(s_arena, arena, index[APP_EVENT_MAX]);
+    memcpy(s_index, index, sizeof(s_index));
+    s_rule_count = count;
+    s_generation++;
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Loaded %s", err_msg);
+    return ESP_OK;
+}
+
+/* ---------------- Evaluation ---------------- */
+
+typedef struct {
+    bool armed;
+    bool light_on;
+    bool door_open;
+    int minute_of_day;      // -1 if wall-clock time is not known yet
+} rule_ctx_t;
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void rule_light_timer_cb(app_timer_t *timer, void *arg)
+{
+    app_light_set(false);
+}
+
+static void rule_run_action(uint8_t op, const uint8_t *args)
+{
+    switch (op) {
+    case OP_LIGHT_ON: {
+        uint16_t seconds = read_u16(args);
+        app_light_set(true);
+        app_timer_cancel(&s_light_timer);
+        if (seconds) {
+            app_timer_start(&s_light_timer, seconds * 1000u);
+        }
+        break;
+    }
+    case OP_LIGHT_OFF:
+        app_timer_cancel(&s_light_timer);
+        app_light_set(false);
+        break;
+    case OP_ARM:
+        app_alarm_set(true, APP_EVENT_SRC_RULE);
+        break;
+    case OP_DISARM:
+        app_alarm_set(false, APP_EVENT_SRC_RULE);
+        break;
+    case OP_ALERT:
+        app_alert_raise(APP_ALERT_LOW, 0, "Automation rule triggered");
+        break;
+    default:
+        break;
+    }
+}
+
+static void rule_run_actions(const uint8_t *p, const uint8_t *end)
+{
+    while (p < end) {
+        uint8_t op = *p++;
+        rule_run_action(op, p);
+        if (op == OP_LIGHT_ON) {
+            p += 2;
+        }
+    }
+}
+
+/* Check the conditions of one rule. Returns its first action if they all pass, else NULL. */
+static const uint8_t *rule_match(const uint8_t *p, const uint8_t *end, const rule_ctx_t *ctx)
+{
+    while (p < end) {
+        uint8_t op = *p++;
+        bool pass = true;
+        switch (op) {
+        case OP_TIME_AFTER:
+            pass = ctx->minute_of_day >= 0 && ctx->minute_of_day >= read_u16(p);
+            p += 2;
+            break;
+        case OP_TIME_BEFORE:
+            pass = ctx->minute_of_day >= 0 && ctx->minute_of_day < read_u16(p);
+            p += 2;
+            break;
+        case OP_ARMED:          pass = ctx->armed; break;
+        case OP_DISARMED:       pass = !ctx->armed; break;
+        case OP_LIGHT_IS_ON:    pass = ctx->light_on; break;
+        case OP_LIGHT_IS_OFF:   pass = !ctx->light_on; break;
+        case OP_DOOR_IS_OPEN:   pass = ctx->door_open; break;
+        case OP_DOOR_IS_CLOSED: pass = !ctx->door_open; break;
+        default:
+            /* First action: all conditions passed */
+            return p - 1;
+        }
+        if (!pass) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static void rules_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const app_event_data_t *ev = data;
+    if (id < 0 || id >= APP_EVENT_MAX || (ev && (ev->src == APP_EVENT_SRC_RULE || ev->src == APP_EVENT_SRC_TEST))) {
+        return;
+    }
+
+    rule_ctx_t ctx = {
+        .armed = app_alarm_is_enabled(),
+        .light_on = app_light_get(),
+        .door_open = app_door_is_open(),
+        .minute_of_day = -1,
+    };
+    if (esp_rmaker_time_check()) {
+        time_t now = time(NULL);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        ctx.minute_of_day = tm.tm_hour * 60 + tm.tm_min;
+    }
+
+    /* Actions call into the alarm and light code and from there into RainMaker
+     * reporting, so they run with s_lock released: match rules and copy the
+     * actions of those that fire under the lock, then run them. An event with
+     * more actions than fit in the buffer is handled in several batches; if the
+     * rules were replaced in between, the rest of the old set is dropped. */
+    uint8_t actions[RULES_ACTION_BUF];
+    uint32_t generation = 0;
+    size_t offset = 0;      // next rule, from the start of the event's range
+    bool done = false;
+    while (!done) {
+        size_t len = 0;
+        int fired = 0;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        if (offset == 0) {
+            generation = s_generation;
+        } else if (generation != s_generation) {
+            xSemaphoreGive(s_lock);
+            break;
+        }
+        const uint8_t *start = &s_arena[s_index[id]];
+        const uint8_t *end = &s_arena[s_index[id + 1]];
+        const uint8_t *p = start + offset;
+        while (p < end) {
+            const uint8_t *action = rule_match(p + 1, p + p[0], &ctx);
+            if (action) {
+                size_t n = p + p[0] - action;
+                if (len + n > sizeof(actions)) {
+                    break;
+                }
+                memcpy(&actions[len], action, n);
+                len += n;
+                fired++;
+            }
+            p += p[0];
+        }
+        offset = p - start;
+        done = p >= end;
+        xSemaphoreGive(s_lock);
+
+        rule_run_actions(actions, actions + len);
+        if (fired) {
+            ESP_DIAG_EVENT("RULE_ACTION", "%d rule(s) fired on %s", fired, s_event_names[id]);
+        }
+    }
+}
+
+/* ---------------- RainMaker service ---------------- */
+
+static esp_err_t rules_write_cb(const esp_rmaker_device_t *device, const esp_rmaker_param_t *param,
+                                const esp_rmaker_param_val_t val, void *priv_data,
+                                esp_rmaker_write_ctx_t *ctx)
+{
+    if (param != s_rules_param) {
+        return ESP_OK;
+    }
+    char msg[64];
+    esp_err_t err = app_rules_load(val.val.s, msg, sizeof(msg));
+    esp_rmaker_param_update(s_status_param, esp_rmaker_str(msg));
+    if (err == ESP_OK) {
+        esp_rmaker_param_update(param, val);
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_rules_init(const esp_rmaker_node_t *node)
+{
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    app_timer_setup(&s_light_timer, rule_light_timer_cb, NULL);
+
+    esp_rmaker_device_t *service = esp_rmaker_service_create("Automation", "custom.service.rules", NULL);
+    if (!service) {
+        ESP_LOGE(TAG, "Failed to create Automation service");
+        return ESP_FAIL;
+    }
+    esp_rmaker_device_add_cb(service, rules_write_cb, NULL);
+
+    /* Installation default from the devcfg partition; a value written from the app persists over it */
+    const char *defaults = app_devcfg_rules();
+    if (defaults) {
+        char msg[64];
+        if (app_rules_load(defaults, msg, sizeof(msg)) != ESP_OK) {
+            ESP_LOGW(TAG, "Default rules rejected: %s", msg);
+            defaults = NULL;
+        }
+    }
+    s_rules_param = esp_rmaker_param_create("Rules", NULL, esp_rmaker_str(defaults ? defaults : ""),
+                                            PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    esp_rmaker_param_add_ui_type(s_rules_param, ESP_RMAKER_UI_TEXT);
+    s_status_param = esp_rmaker_param_create("Rule Status", NULL, esp_rmaker_str("0 rules"), PROP_FLAG_READ);
+
+    esp_rmaker_device_add_param(service, s_rules_param);
+    esp_rmaker_device_add_param(service, s_status_param);
+    esp_rmaker_node_add_device(node, service);
+
+    return esp_event_handler_register(APP_EVENT, ESP_EVENT_ANY_ID, rules_event_handler, NULL);
+}
@@ -0,0 +1,52 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Create the "Automation" service and subscribe the rule engine to APP_EVENT
+ *
+ * Rules are written to the "Rules" param as text, one rule per line or
+ * separated by ';':
+ *
+ *     on <event> [if <cond> [and <cond>...]] then <action>[, <action>...]
+ *
+ *     event : door_open | door_close | alarm_arm | alarm_disarm | alarm_trigger
+ *     cond  : after HH:MM | before HH:MM | armed | disarmed |
+ *             light_on | light_off | door_open | door_closed
+ *     action: light_on [seconds] | light_off | arm | disarm | alert
+ *
+ * e.g. "on door_open if after 22:00 and disarmed then light_on 120"
+ *
+ * @param[in] node RainMaker node to add the service to.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_rules_init(const esp_rmaker_node_t *node);
+
+/* Compile rule text and replace the active rule set
+ *
+ * @param[in] text Rule source as described above.
+ * @param[out] err_msg Optional buffer for a human readable error.
+ * @param[in] err_len Size of err_msg.
+ *
+ * @return ESP_OK on success. The previous rule set is kept on failure.
+ * @return ESP_ERR_INVALID_ARG on a syntax error.
+ * @return ESP_ERR_NO_MEM if the compiled rules do not fit in the bytecode arena.
+ */
+esp_err_t app_rules_load(const char *text, char *err_msg, size_t err_len);
+
+#ifdef __cplusplus
+}
+#endif
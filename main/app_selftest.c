@@ -0,0 +1,222 @@
+/* Post-OTA self-test
+ *
+ * One pipeline sample follows an intrusion the way the sensor task handles
+ * one: the arming check for the local door, the siren decision,
+ * APP_EVENT_ALARM_TRIGGERED posted with source TEST and seen by our handler
+ * on the event loop, then a ping through the actuator queue. The siren takes
+ * its decision for TEST without switching anything, and rules and history
+ * ignore TEST events, so nothing visible happens. Latency is retried a few times since the first seconds after boot
+ * are busy with provisioning/MQTT; heap and stack checks are not.
+ *
+ * The verdict goes through RainMaker's OTA diagnostics hook rather than
+ * straight to esp_ota_mark_app_valid_cancel_rollback(): RainMaker asks on MQTT
+ * connect, which usually comes before the test has finished, and would
+ * otherwise accept the image right away. While the test runs the hook answers
+ * PENDING, and the task then reports the result with
+ * esp_rmaker_ota_mark_valid()/esp_rmaker_ota_mark_invalid().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_ota_ops.h>
+#include <esp_diagnostics.h>
+#include <esp_rmaker_ota.h>
+
+#include "app_selftest.h"
+#include "app_events.h"
+#include "app_actuator.h"
+#include "app_arming.h"
+#include "app_siren.h"
+
+static const char *TAG = "app_selftest";
+
+#define SELFTEST_TASK_STACK     3072
+#define SELFTEST_TASK_PRIO      1
+#define SELFTEST_SETTLE_MS      10000
+#define SELFTEST_RETRY_MS       10000
+#define SELFTEST_ATTEMPTS       3
+#define SELFTEST_SAMPLES        64
+#define SELFTEST_GAP_MS         20
+#define SELFTEST_STEP_TIMEOUT_MS 200
+
+/* Tasks whose stack headroom is checked; missing ones (e.g. fast path
+ * disabled) are skipped */
+static const char *const s_tasks[] = {
+    "ir_sensor_task",
+    "actuator",
+    "fastpath",
+    "sys_evt",
+};
+
+static TaskHandle_t s_task;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_rmaker_ota_diag_status_t s_verdict = OTA_DIAG_STATUS_PENDING;
+static bool s_cloud_waiting;    // RainMaker got PENDING after MQTT connect
+
+static void selftest_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const app_event_data_t *ev = data;
+    if (ev && ev->src == APP_EVENT_SRC_TEST && s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Run the pipeline samples and return the sorted latencies */
+static void measure_pipeline(uint32_t *samples)
+{
+    for (int i = 0; i < SELFTEST_SAMPLES; i++) {
+        int64_t t0 = esp_timer_get_time();
+        ulTaskNotifyTake(pdTRUE, 0);
+        /* Decided whether the zone is armed or not: the sample costs the same */
+        app_arming_triggered(APP_ZONE_BIT(APP_ZONE_LOCAL_DOOR));
+        app_siren_trigger_from(APP_EVENT_SRC_TEST);
+        bool ok = app_event_post(APP_EVENT_ALARM_TRIGGERED, APP_EVENT_SRC_TEST) == ESP_OK &&
+                  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SELFTEST_STEP_TIMEOUT_MS)) != 0 &&
+                  app_actuator_submit(APP_ACTUATOR_PING, false, APP_EVENT_SRC_TEST,
+                                      SELFTEST_STEP_TIMEOUT_MS) == ESP_OK;
+        /* A lost step counts as the worst possible sample */
+        samples[i] = ok ? (uint32_t)(esp_timer_get_time() - t0) : UINT32_MAX;
+        vTaskDelay(pdMS_TO_TICKS(SELFTEST_GAP_MS));
+    }
+    qsort(samples, SELFTEST_SAMPLES, sizeof(samples[0]), cmp_u32);
+}
+
+static bool check_latency(void)
+{
+    uint32_t samples[SELFTEST_SAMPLES];
+    for (int attempt = 1; attempt <= SELFTEST_ATTEMPTS; attempt++) {
+        measure_pipeline(samples);
+        uint32_t p50 = samples[SELFTEST_SAMPLES * 50 / 100];
+        uint32_t p95 = samples[SELFTEST_SAMPLES * 95 / 100];
+        uint32_t p99 = samples[SELFTEST_SAMPLES - 1 - SELFTEST_SAMPLES / 100];
+        ESP_LOGI(TAG, "Alarm pipeline latency p50/p95/p99: %u/%u/%u us (attempt %d)",
+                 (unsigned)p50, (unsigned)p95, (unsigned)p99, attempt);
+        if (p99 <= CONFIG_APP_SELFTEST_MAX_P99_US) {
+            ESP_DIAG_EVENT("SELFTEST", "latency p50/p95/p99 %u/%u/%u us", (unsigned)p50, (unsigned)p95,
+                           (unsigned)p99);
+            return true;
+        }
+        if (attempt < SELFTEST_ATTEMPTS) {
+            vTaskDelay(pdMS_TO_TICKS(SELFTEST_RETRY_MS));
+        } else {
+            ESP_DIAG_EVENT("SELFTEST", "latency p99 %u us over limit %u us", (unsigned)p99,
+                           (unsigned)CONFIG_APP_SELFTEST_MAX_P99_US);
+        }
+    }
+    return false;
+}
+
+static bool check_heap(void)
+{
+    uint32_t min_free = esp_get_minimum_free_heap_size();
+    ESP_LOGI(TAG, "Heap: %u free, %u minimum since boot", (unsigned)esp_get_free_heap_size(),
+             (unsigned)min_free);
+    if (min_free < CONFIG_APP_SELFTEST_MIN_FREE_HEAP) {
+        ESP_DIAG_EVENT("SELFTEST", "heap minimum %u B below %u B", (unsigned)min_free,
+                       (unsigned)CONFIG_APP_SELFTEST_MIN_FREE_HEAP);
+        return false;
+    }
+    return true;
+}
+
+static bool check_stacks(void)
+{
+    bool pass = true;
+    for (size_t i = 0; i < sizeof(s_tasks) / sizeof(s_tasks[0]); i++) {
+        TaskHandle_t task = xTaskGetHandle(s_tasks[i]);
+        if (!task) {
+            continue;
+        }
+        /* ESP-IDF reports the watermark in bytes */
+        uint32_t free_bytes = uxTaskGetStackHighWaterMark(task);
+        ESP_LOGI(TAG, "Stack headroom %s: %u B", s_tasks[i], (unsigned)free_bytes);
+        if (free_bytes < CONFIG_APP_SELFTEST_MIN_STACK) {
+            ESP_DIAG_EVENT("SELFTEST", "stack headroom %s %u B below %u B", s_tasks[i],
+                           (unsigned)free_bytes, (unsigned)CONFIG_APP_SELFTEST_MIN_STACK);
+            pass = false;
+        }
+    }
+    return pass;
+}
+
+static void selftest_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(SELFTEST_SETTLE_MS));
+    ESP_LOGI(TAG, "Running post-OTA self-test");
+
+    bool pass = check_latency();
+    pass = check_heap() && pass;
+    pass = check_stacks() && pass;
+    esp_event_handler_unregister(APP_EVENT, APP_EVENT_ALARM_TRIGGERED, selftest_event_handler);
+
+    taskENTER_CRITICAL(&s_lock);
+    s_verdict = pass ? OTA_DIAG_STATUS_SUCCESS : OTA_DIAG_STATUS_FAIL;
+    bool waiting = s_cloud_waiting;
+    taskEXIT_CRITICAL(&s_lock);
+    s_task = NULL;
+
+    if (pass) {
+        ESP_DIAG_EVENT("SELFTEST", "passed, image %s", esp_app_get_description()->version);
+        if (waiting) {
+            ESP_LOGI(TAG, "Self-test passed, marking image valid");
+            esp_rmaker_ota_mark_valid();
+        } else {
+            /* RainMaker accepts the image when it asks on MQTT connect; without a
+             * connection its rollback timer still applies */
+            ESP_LOGI(TAG, "Self-test passed, image valid once the cloud connects");
+        }
+    } else {
+        ESP_LOGE(TAG, "Self-test failed, rolling back");
+        ESP_DIAG_EVENT("SELFTEST", "failed, rolling back image %s", esp_app_get_description()->version);
+        /* A bad image does not wait for the cloud */
+        if (!waiting || esp_rmaker_ota_mark_invalid() != ESP_OK) {
+            esp_ota_mark_app_invalid_rollback_and_reboot();
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+esp_rmaker_ota_diag_status_t app_selftest_ota_diag(esp_rmaker_ota_diag_priv_t *diag, void *priv)
+{
+    taskENTER_CRITICAL(&s_lock);
+    esp_rmaker_ota_diag_status_t verdict = s_verdict;
+    if (verdict == OTA_DIAG_STATUS_PENDING && diag->state == OTA_DIAG_STATE_POST_MQTT) {
+        s_cloud_waiting = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (verdict == OTA_DIAG_STATUS_PENDING && diag->state == OTA_DIAG_STATE_POST_MQTT) {
+        ESP_LOGI(TAG, "Cloud connected, image stays pending until the self-test finishes");
+    }
+    return verdict;
+}
+
+esp_err_t app_selftest_start(void)
+{
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK ||
+        state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "New image pending verification");
+    esp_err_t err = esp_event_handler_register(APP_EVENT, APP_EVENT_ALARM_TRIGGERED, selftest_event_handler, NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (xTaskCreate(selftest_task, "selftest", SELFTEST_TASK_STACK, NULL, SELFTEST_TASK_PRIO, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create self-test task");
+        /* Without a verdict RainMaker's rollback timer rolls the image back */
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
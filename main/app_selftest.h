@@ -0,0 +1,43 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <esp_err.h>
+#include <esp_rmaker_ota.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start the first-boot self-test if the running image is pending verification
+ *
+ * Does nothing unless the bootloader booted a new OTA image with rollback
+ * enabled. Otherwise a low-priority task pushes synthetic events through the
+ * alarm pipeline and checks latency percentiles, heap headroom and task stack
+ * watermarks against the CONFIG_APP_SELFTEST_* thresholds. A pass is reported
+ * to RainMaker through app_selftest_ota_diag(), which then marks the image
+ * valid; a failure rolls back to the previous image and reboots. If the new
+ * image crashes before the verdict, the bootloader rolls back on its own.
+ *
+ * Call once, after all application tasks have been started.
+ *
+ * @return ESP_OK on success (including when no self-test is needed).
+ * @return error in case of failure.
+ */
+esp_err_t app_selftest_start(void);
+
+/* RainMaker OTA diagnostics hook (esp_rmaker_ota_config_t.ota_diag)
+ *
+ * @return OTA_DIAG_STATUS_PENDING while the self-test runs; the result is then
+ * reported with esp_rmaker_ota_mark_valid()/esp_rmaker_ota_mark_invalid().
+ * @return OTA_DIAG_STATUS_SUCCESS or OTA_DIAG_STATUS_FAIL once it has finished.
+ */
+esp_rmaker_ota_diag_status_t app_selftest_ota_diag(esp_rmaker_ota_diag_priv_t *diag, void *priv);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,215 @@
+/* Siren policy
+ *
+ *   IDLE --trigger--> CHIRP --CHIRP_SEC--> FULL --MAX_SEC--> SILENT
+ *     ^                 |                    |                 |
+ *     |                 +------- clear ------+-----------------+
+ *     |                                      v
+ *     +---------- COOLDOWN_SEC --------- COOLDOWN --trigger--> SILENT
+ *
+ * reset (disarm) returns to IDLE from any stage. Everything runs from two
+ * app_timers: one for stage deadlines and one for the chirp pattern. There
+ * is no polling.
+ */
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_diagnostics.h>
+
+#include "app_siren.h"
+#include "app_timer.h"
+#include "app_alert.h"
+#include "app_report.h"
+
+static const char *TAG = "app_siren";
+
+#define SEC_MS(s)           ((uint32_t)(s) * 1000)
+#define CHIRP_ON_MS         100
+#define CHIRP_OFF_MS        900
+
+_Static_assert((uint64_t)CONFIG_APP_SIREN_COOLDOWN_SEC * 1000 / CONFIG_APP_TIMER_TICK_MS < APP_TIMER_MAX_TICKS,
+               "siren cool-down longer than the app_timer range: raise CONFIG_APP_TIMER_TICK_MS");
+
+static const char *const s_stage_name[] = {
+    [APP_SIREN_IDLE] = "Idle",
+    [APP_SIREN_CHIRP] = "Chirp",
+    [APP_SIREN_FULL] = "Siren",
+    [APP_SIREN_SILENT] = "Silent",
+    [APP_SIREN_COOLDOWN] = "Cool-down",
+};
+
+static gpio_num_t s_gpio;
+static app_siren_stage_t s_stage;
+static bool s_chirp_on;
+static SemaphoreHandle_t s_lock;
+static app_timer_t s_stage_timer;
+static app_timer_t s_chirp_timer;
+static esp_rmaker_param_t *s_param;
+
+/* Switch stage, outputs and timers. Called with s_lock held. */
+static void enter_stage(app_siren_stage_t stage)
+{
+    app_timer_cancel(&s_stage_timer);
+    app_timer_cancel(&s_chirp_timer);
+    s_chirp_on = false;
+    s_stage = stage;
+
+    switch (stage) {
+    case APP_SIREN_CHIRP:
+        if (CONFIG_APP_SIREN_CHIRP_SEC == 0) {
+            enter_stage(APP_SIREN_FULL);
+            return;
+        }
+        s_chirp_on = true;
+        gpio_set_level(s_gpio, 1);
+        app_timer_start(&s_chirp_timer, CHIRP_ON_MS);
+        app_timer_start(&s_stage_timer, SEC_MS(CONFIG_APP_SIREN_CHIRP_SEC));
+        break;
+    case APP_SIREN_FULL:
+        gpio_set_level(s_gpio, 1);
+        app_timer_start(&s_stage_timer, SEC_MS(CONFIG_APP_SIREN_MAX_SEC));
+        break;
+    case APP_SIREN_COOLDOWN:
+        gpio_set_level(s_gpio, 0);
+        app_timer_start(&s_stage_timer, SEC_MS(CONFIG_APP_SIREN_COOLDOWN_SEC));
+        break;
+    case APP_SIREN_IDLE:
+    case APP_SIREN_SILENT:
+    default:
+        gpio_set_level(s_gpio, 0);
+        break;
+    }
+}
+
+/* Run a transition and report the stage if it changed. Returns the new stage. */
+static app_siren_stage_t transition(app_siren_stage_t (*next)(app_siren_stage_t))
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    app_siren_stage_t old = s_stage;
+    app_siren_stage_t stage = next(old);
+    if (stage != old) {
+        enter_stage(stage);
+        stage = s_stage;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (stage == old) {
+        return stage;
+    }
+    ESP_LOGI(TAG, "%s -> %s", s_stage_name[old], s_stage_name[stage]);
+    ESP_DIAG_EVENT("SIREN", "%s -> %s", s_stage_name[old], s_stage_name[stage]);
+    if (s_param) {
+        app_report_param(s_param, esp_rmaker_str(s_stage_name[stage]));
+    }
+    if (stage == APP_SIREN_SILENT) {
+        app_alert_raise(APP_ALERT_HIGH, 0, "Intrusion continues, siren silenced");
+    }
+    return stage;
+}
+
+static app_siren_stage_t next_on_trigger(app_siren_stage_t s)
+{
+    switch (s) {
+    case APP_SIREN_IDLE:
+        return APP_SIREN_CHIRP;
+    case APP_SIREN_COOLDOWN:
+        return APP_SIREN_SILENT;
+    default:
+        return s;
+    }
+}
+
+static app_siren_stage_t next_on_clear(app_siren_stage_t s)
+{
+    switch (s) {
+    case APP_SIREN_CHIRP:
+    case APP_SIREN_FULL:
+    case APP_SIREN_SILENT:
+        return APP_SIREN_COOLDOWN;
+    default:
+        return s;
+    }
+}
+
+static app_siren_stage_t next_on_reset(app_siren_stage_t s)
+{
+    return APP_SIREN_IDLE;
+}
+
+static app_siren_stage_t next_on_deadline(app_siren_stage_t s)
+{
+    switch (s) {
+    case APP_SIREN_CHIRP:
+        return APP_SIREN_FULL;
+    case APP_SIREN_FULL:
+        return APP_SIREN_SILENT;
+    case APP_SIREN_COOLDOWN:
+        return APP_SIREN_IDLE;
+    default:
+        return s;
+    }
+}
+
+static void stage_timer_cb(app_timer_t *timer, void *arg)
+{
+    transition(next_on_deadline);
+}
+
+static void chirp_timer_cb(app_timer_t *timer, void *arg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_stage == APP_SIREN_CHIRP) {
+        s_chirp_on = !s_chirp_on;
+        gpio_set_level(s_gpio, s_chirp_on);
+        app_timer_start(&s_chirp_timer, s_chirp_on ? CHIRP_ON_MS : CHIRP_OFF_MS);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void app_siren_trigger(void)
+{
+    transition(next_on_trigger);
+}
+
+app_siren_stage_t app_siren_trigger_from(app_event_src_t src)
+{
+    if (src != APP_EVENT_SRC_TEST) {
+        return transition(next_on_trigger);
+    }
+    /* Self-test sample: the real lock and decision, nothing switched */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    app_siren_stage_t stage = next_on_trigger(s_stage);
+    xSemaphoreGive(s_lock);
+    return stage;
+}
+
+void app_siren_clear(void)
+{
+    transition(next_on_clear);
+}
+
+void app_siren_reset(void)
+{
+    transition(next_on_reset);
+}
+
+app_siren_stage_t app_siren_get_stage(void)
+{
+    return s_stage;
+}
+
+esp_err_t app_siren_init(gpio_num_t gpio, esp_rmaker_device_t *alarm_dev)
+{
+    s_gpio = gpio;
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    app_timer_setup(&s_stage_timer, stage_timer_cb, NULL);
+    app_timer_setup(&s_chirp_timer, chirp_timer_cb, NULL);
+
+    s_param = esp_rmaker_param_create("Siren Stage", NULL, esp_rmaker_str(s_stage_name[APP_SIREN_IDLE]),
+                                      PROP_FLAG_READ);
+    app_report_add_param(alarm_dev, s_param);
+    return ESP_OK;
+}
@@ -0,0 +1,61 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <esp_err.h>
+#include <driver/gpio.h>
+#include <esp_rmaker_core.h>
+
+#include "app_events.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    APP_SIREN_IDLE = 0,     // armed and quiet
+    APP_SIREN_CHIRP,        // short beeps: grace period before the full siren
+    APP_SIREN_FULL,         // continuous siren, at most CONFIG_APP_SIREN_MAX_SEC
+    APP_SIREN_SILENT,       // siren timed out; alerts continue, buzzer off
+    APP_SIREN_COOLDOWN,     // intrusion cleared; a new one within the cool-down stays silent
+} app_siren_stage_t;
+
+/* Set up the siren on the buzzer GPIO and add the "Siren Stage" param
+ *
+ * The param is read-only and only reported when the stage changes.
+ *
+ * @param[in] gpio Buzzer GPIO, already configured as output.
+ * @param[in] alarm_dev Alarm System device handle.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_siren_init(gpio_num_t gpio, esp_rmaker_device_t *alarm_dev);
+
+/* Intrusion detected: start the escalation (idempotent while it runs) */
+void app_siren_trigger(void);
+
+/* app_siren_trigger() for an event source
+ *
+ * APP_EVENT_SRC_TEST (post-OTA self-test) takes the same lock and decision
+ * but leaves the stage, the buzzer, the timers and the param alone.
+ *
+ * @return the stage the siren entered or stayed in; for TEST, the one it would.
+ */
+app_siren_stage_t app_siren_trigger_from(app_event_src_t src);
+
+/* Intrusion cleared (door closed, still armed): silence and enter cool-down */
+void app_siren_clear(void);
+
+/* Alarm disarmed: silence and return to idle at once */
+void app_siren_reset(void);
+
+app_siren_stage_t app_siren_get_stage(void);
+
+#ifdef __cplusplus
+}
+#endif
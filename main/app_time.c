@@ -0,0 +1,163 @@
+/* Timestamp service
+ *
+ * UTC time as a function of the monotonic esp_timer clock:
+ *
+ *     utc(mono) = mono + offset + rate * (mono - anchor)
+ *
+ * The system clock and esp_timer run from the same oscillator, so between
+ * SNTP syncs their difference only changes when a sync steps the clock. A
+ * sampler compares the two every APP_TIME_SAMPLE_US; a step re-anchors the
+ * model, and the step size over the time since the previous anchor is the
+ * oscillator error, which is averaged into the drift estimate. Between syncs
+ * timestamps are then corrected for drift the system clock still has, and
+ * a timestamp costs one esp_timer read and a multiply, with no syscalls.
+ *
+ * The model does not depend on the cloud session, so it keeps going across
+ * reconnects, and esp_timer readings taken before the first sync can be
+ * converted once it happens.
+ *
+ * The drift estimate and the model error at each correction are Insights
+ * metrics. They are registered at the first sync: app_time_init() runs before
+ * Insights is enabled.
+ */
+
+#include <sys/time.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_diagnostics.h>
+#if CONFIG_DIAG_ENABLE_METRICS
+#include <esp_diagnostics_metrics.h>
+#endif
+#include <esp_rmaker_utils.h>
+
+#include "app_time.h"
+
+static const char *TAG = "app_time";
+
+#define APP_TIME_SAMPLE_US      (30 * 1000000LL)
+#define APP_TIME_STEP_MIN_US    2000                    // below this a difference is sampling jitter
+#define APP_TIME_DRIFT_MIN_US   (10 * 60 * 1000000LL)   // shortest interval to estimate drift from
+#define APP_TIME_DRIFT_SHIFT    2                       // weight of a new estimate: 1/4
+
+#define TIME_METRIC_DRIFT       "time_drift_ppb"
+#define TIME_METRIC_STEP        "time_step_us"
+
+static esp_timer_handle_t s_timer;
+static int64_t s_anchor_mono;   // esp_timer time of the last correction
+static int64_t s_offset;        // UTC - mono at the anchor
+static int64_t s_rate_ppb;      // correction per unit of esp_timer time, -oscillator error
+static bool s_rate_known;
+static app_time_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t model_locked(int64_t mono)
+{
+    return mono + s_offset + (mono - s_anchor_mono) * s_rate_ppb / 1000000000LL;
+}
+
+static void time_metrics_register(void)
+{
+#if CONFIG_DIAG_ENABLE_METRICS
+    esp_err_t err = esp_diag_metrics_register("TIME", TIME_METRIC_DRIFT, "Oscillator drift (ppb)", "app.time",
+                                              ESP_DIAG_DATA_TYPE_INT);
+    if (err == ESP_OK) {
+        err = esp_diag_metrics_register("TIME", TIME_METRIC_STEP, "Model error at sync (us)", "app.time",
+                                        ESP_DIAG_DATA_TYPE_INT);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to register metrics: %s", esp_err_to_name(err));
+    }
+#endif
+}
+
+static void time_sample_cb(void *arg)
+{
+    if (!esp_rmaker_time_check()) {
+        return;
+    }
+    struct timeval tv;
+    int64_t mono = esp_timer_get_time();
+    gettimeofday(&tv, NULL);
+    int64_t offset = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec - mono;
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_stats.synced) {
+        s_anchor_mono = mono;
+        s_offset = offset;
+        s_stats.synced = true;
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGI(TAG, "Time synced");
+        time_metrics_register();
+        return;
+    }
+    /* Compare against the raw offset: the system clock itself does not drift-compensate */
+    int64_t step = offset - s_offset;
+    if (step < APP_TIME_STEP_MIN_US && step > -APP_TIME_STEP_MIN_US) {
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    int64_t elapsed = mono - s_anchor_mono;
+    int64_t error = offset + mono - model_locked(mono);
+    if (elapsed >= APP_TIME_DRIFT_MIN_US) {
+        int64_t ppb = step * 1000000000LL / elapsed;
+        s_rate_ppb = s_rate_known ? s_rate_ppb + ((ppb - s_rate_ppb) >> APP_TIME_DRIFT_SHIFT) : ppb;
+        s_rate_known = true;
+    }
+    s_anchor_mono = mono;
+    s_offset = offset;
+    s_stats.corrections++;
+    s_stats.drift_ppb = -s_rate_ppb;
+    s_stats.last_step_us = error;
+    app_time_stats_t st = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+
+#if CONFIG_DIAG_ENABLE_METRICS
+    esp_diag_metrics_add_int(TIME_METRIC_DRIFT, st.drift_ppb);
+    esp_diag_metrics_add_int(TIME_METRIC_STEP, st.last_step_us);
+#endif
+
+    ESP_LOGI(TAG, "Clock stepped %lld us after %lld s, model off by %lld us, drift %ld ppb",
+             (long long)step, (long long)(elapsed / 1000000), (long long)error, (long)st.drift_ppb);
+    ESP_DIAG_EVENT("TIME", "Step %lld us, model error %lld us, drift %ld ppb",
+                   (long long)step, (long long)error, (long)st.drift_ppb);
+}
+
+int64_t app_time_from_mono_us(int64_t mono_us)
+{
+    int64_t utc = 0;
+    portENTER_CRITICAL(&s_lock);
+    if (s_stats.synced) {
+        utc = model_locked(mono_us);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return utc;
+}
+
+int64_t app_time_now_us(void)
+{
+    return app_time_from_mono_us(esp_timer_get_time());
+}
+
+void app_time_get_stats(app_time_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t app_time_init(void)
+{
+    esp_timer_create_args_t timer_args = {
+        .callback = time_sample_cb,
+        .name = "app_time",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(s_timer, APP_TIME_SAMPLE_US);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start time sampler");
+    }
+    return err;
+}
@@ -0,0 +1,52 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    bool synced;                // wall-clock time known since boot
+    uint32_t corrections;       // clock steps seen (SNTP syncs that moved the clock)
+    int32_t drift_ppb;          // estimated oscillator error, + = esp_timer runs fast
+    int32_t last_step_us;       // wall clock minus model at the last correction
+} app_time_stats_t;
+
+/* Start following the system clock (kept in sync by RainMaker's SNTP)
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_time_init(void);
+
+/* Current UTC time in microseconds, drift-compensated
+ *
+ * @return UTC microseconds since the epoch, 0 if time was never synced.
+ */
+int64_t app_time_now_us(void);
+
+/* UTC time of an esp_timer_get_time() reading of this boot
+ *
+ * Also works for readings taken before the first sync, so data buffered
+ * offline or before time was known can be placed on the timeline later.
+ *
+ * @param[in] mono_us esp_timer_get_time() value.
+ *
+ * @return UTC microseconds since the epoch, 0 if time was never synced.
+ */
+int64_t app_time_from_mono_us(int64_t mono_us);
+
+void app_time_get_stats(app_time_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,303 @@
+/* Application timer service
+ *
+ * Entry/exit delays, dwell and rule timeouts, siren stages: with one esp_timer
+ * each, every start is an insertion into esp_timer's sorted list, which grows
+ * linearly with the number of armed timers. Here they share one esp_timer
+ * tick and live in a hierarchical timing wheel:
+ *
+ *   level 0: 64 slots of 1 tick        expiry < 64 ticks away
+ *   level 1: 64 slots of 64 ticks      < 64^2
+ *   level 2: 64 slots of 64^2 ticks    < 64^3
+ *   level 3: 64 slots of 64^3 ticks    < 64^4 (APP_TIMER_MAX_TICKS)
+ *
+ * A timer goes into the slot of its expiry on the level that covers its
+ * distance, in an intrusive doubly linked list, so start and cancel are O(1).
+ * Each time level 0 wraps, the next slot of level 1 is cascaded down (and so
+ * on up), and each tick runs the timers of one level 0 slot.
+ *
+ * A bitmap per level marks the slots that hold timers. The tick is a one-shot
+ * esp_timer armed for the next tick that has a slot to run or to cascade,
+ * found with one count-trailing-zeros per level, so a 30 s exit delay costs a
+ * handful of wake-ups instead of one per tick, and an idle service none. A
+ * start that is due before the armed tick re-arms it. Ticks are derived from
+ * esp_timer_get_time(), so a late tick catches up instead of drifting.
+ */
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "app_timer.h"
+
+static const char *TAG = "app_timer";
+
+#define WHEEL_BITS      6
+#define WHEEL_SIZE      (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS    4
+#define TICK_US         (CONFIG_APP_TIMER_TICK_MS * 1000LL)
+
+/* Slot heads are list sentinels: only next/prev are used */
+static app_timer_t s_wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static uint64_t s_occupied[WHEEL_LEVELS];   // bit n: slot n is not empty
+static uint32_t s_base;         // next tick to run
+static uint32_t s_active;
+static bool s_running;          // tick armed or being handled
+static bool s_ticking;          // tick_cb() running: it arms the next tick itself
+static uint32_t s_armed;        // tick the esp_timer is armed for, while s_running
+static esp_timer_handle_t s_tick;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t now_tick(void)
+{
+    return (uint32_t)(esp_timer_get_time() / TICK_US);
+}
+
+/* Clear the occupied bit of a wheel slot that has just become empty. Locked. */
+static void slot_emptied(app_timer_t *head)
+{
+    uintptr_t first = (uintptr_t)&s_wheel[0][0];
+    uintptr_t at = (uintptr_t)head;
+    if (at >= first && at < first + sizeof(s_wheel) && head->next == head) {
+        int n = (at - first) / sizeof(app_timer_t);
+        s_occupied[n / WHEEL_SIZE] &= ~(1ULL << (n % WHEEL_SIZE));
+    }
+}
+
+static void list_unlink(app_timer_t *t)
+{
+    app_timer_t *prev = t->prev;
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+    if (prev->next == prev) {
+        slot_emptied(prev);
+    }
+}
+
+/* Locked */
+static void wheel_add(app_timer_t *t)
+{
+    uint32_t delta = t->expires - s_base;
+    int level, index;
+    if ((int32_t)delta < 0) {
+        level = 0;
+        index = s_base & WHEEL_MASK;    // already due: next tick
+    } else if (delta < (1u << WHEEL_BITS)) {
+        level = 0;
+        index = t->expires & WHEEL_MASK;
+    } else if (delta < (1u << (2 * WHEEL_BITS))) {
+        level = 1;
+        index = (t->expires >> WHEEL_BITS) & WHEEL_MASK;
+    } else if (delta < (1u << (3 * WHEEL_BITS))) {
+        level = 2;
+        index = (t->expires >> (2 * WHEEL_BITS)) & WHEEL_MASK;
+    } else {
+        /* Beyond the wheel (only by a late tick's lag): park at its end, re-added on cascade */
+        uint32_t at = delta < APP_TIMER_MAX_TICKS ? t->expires : s_base + APP_TIMER_MAX_TICKS - 1;
+        level = 3;
+        index = (at >> (3 * WHEEL_BITS)) & WHEEL_MASK;
+    }
+    app_timer_t *head = &s_wheel[level][index];
+    s_occupied[level] |= 1ULL << index;
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+/* Move the timers of one slot down a level. Returns the slot index. Locked. */
+static int wheel_cascade(int level, int index)
+{
+    app_timer_t *head = &s_wheel[level][index];
+    app_timer_t *t = head->next;
+    head->next = head->prev = head;
+    s_occupied[level] &= ~(1ULL << index);
+    while (t != head) {
+        app_timer_t *next = t->next;
+        wheel_add(t);
+        t = next;
+    }
+    return index;
+}
+
+/* First set bit of mask at or after bit from, going round: its distance from from */
+static inline int ring_next(uint64_t mask, int from)
+{
+    uint64_t turned = from ? (mask >> from) | (mask << (WHEEL_SIZE - from)) : mask;
+    return __builtin_ctzll(turned);
+}
+
+/* First tick at or after from that has a level 0 slot to run or a higher
+ * slot to cascade. Only valid while timers are in the wheel. Locked. */
+static uint32_t wheel_next(uint32_t from)
+{
+    uint32_t next = from + APP_TIMER_MAX_TICKS;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (!s_occupied[level]) {
+            continue;
+        }
+        /* Slots of this level are reached on multiples of its span */
+        int shift = level * WHEEL_BITS;
+        uint32_t span = 1u << shift;
+        uint32_t edge = (from + span - 1) & ~(span - 1);
+        uint32_t at = edge + ((uint32_t)ring_next(s_occupied[level], (edge >> shift) & WHEEL_MASK) << shift);
+        if ((int32_t)(at - next) < 0) {
+            next = at;
+        }
+    }
+    return next;
+}
+
+/* Arm the tick for tick at. Starts racing on two tasks can arm in the wrong
+ * order, so whoever armed last checks s_armed again and re-arms if it moved. */
+static void tick_arm(uint32_t at)
+{
+    while (1) {
+        int64_t now_us = esp_timer_get_time();
+        int64_t delay = (int64_t)(int32_t)(at - (uint32_t)(now_us / TICK_US)) * TICK_US - now_us % TICK_US;
+        esp_timer_stop(s_tick);
+        esp_timer_start_once(s_tick, delay > 0 ? delay : 1);
+        portENTER_CRITICAL(&s_lock);
+        bool again = s_running && !s_ticking && s_armed != at;
+        at = s_armed;
+        portEXIT_CRITICAL(&s_lock);
+        if (!again) {
+            return;
+        }
+    }
+}
+
+static void tick_cb(void *arg)
+{
+    uint32_t now = now_tick();
+
+    portENTER_CRITICAL(&s_lock);
+    s_ticking = true;
+    while ((int32_t)(now - s_base) >= 0) {
+        uint32_t tick = s_base;
+        int index = tick & WHEEL_MASK;
+        if (!index &&
+            !wheel_cascade(1, (tick >> WHEEL_BITS) & WHEEL_MASK) &&
+            !wheel_cascade(2, (tick >> (2 * WHEEL_BITS)) & WHEEL_MASK)) {
+            wheel_cascade(3, (tick >> (3 * WHEEL_BITS)) & WHEEL_MASK);
+        }
+        s_base = tick + 1;
+        /* Move the slot to a local list first: a callback restarting its timer
+         * for 64 ticks later would land in this very slot. Then run them one
+         * at a time, unlocked around the callback, which may start or cancel
+         * timers (cancelling one still on the local list unlinks it from there). */
+        app_timer_t expired;
+        app_timer_t *slot = &s_wheel[0][index];
+        if (slot->next != slot) {
+            expired.next = slot->next;
+            expired.prev = slot->prev;
+            expired.next->prev = expired.prev->next = &expired;
+            slot->next = slot->prev = slot;
+            s_occupied[0] &= ~(1ULL << index);
+        } else {
+            expired.next = expired.prev = &expired;
+        }
+        while (expired.next != &expired) {
+            app_timer_t *t = expired.next;
+            list_unlink(t);
+            s_active--;
+            portEXIT_CRITICAL(&s_lock);
+            t->cb(t, t->arg);
+            portENTER_CRITICAL(&s_lock);
+        }
+        /* Ticks with nothing to run or cascade are skipped */
+        if (s_active) {
+            uint32_t next = wheel_next(s_base);
+            s_base = (int32_t)(next - now) > 0 ? now + 1 : next;
+        } else {
+            s_base = now + 1;
+        }
+    }
+    s_ticking = false;
+    s_running = s_active > 0;
+    bool rearm = s_running;
+    uint32_t at = s_armed = rearm ? wheel_next(s_base) : 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (rearm) {
+        tick_arm(at);
+    }
+}
+
+void app_timer_setup(app_timer_t *timer, app_timer_cb_t cb, void *arg)
+{
+    memset(timer, 0, sizeof(*timer));
+    timer->cb = cb;
+    timer->arg = arg;
+}
+
+esp_err_t app_timer_start(app_timer_t *timer, uint32_t delay_ms)
+{
+    uint32_t ticks = (delay_ms + CONFIG_APP_TIMER_TICK_MS - 1) / CONFIG_APP_TIMER_TICK_MS;
+    if (ticks >= APP_TIMER_MAX_TICKS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool arm = false;
+    uint32_t now = now_tick();
+    portENTER_CRITICAL(&s_lock);
+    if (timer->next) {
+        list_unlink(timer);
+        s_active--;
+    }
+    if (!s_running || (!s_ticking && (int32_t)(s_armed - now) > 0)) {
+        /* Nothing is due before the armed tick (an idle wheel is empty): skip
+         * the ticks that passed meanwhile */
+        s_base = now + 1;
+    }
+    /* +1: the current tick is already partly over */
+    timer->expires = now + ticks + 1;
+    wheel_add(timer);
+    s_active++;
+    uint32_t at = wheel_next(s_base);
+    if (!s_ticking && (!s_running || (int32_t)(at - s_armed) < 0)) {
+        s_armed = at;
+        arm = true;
+    }
+    s_running = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (arm) {
+        tick_arm(at);
+    }
+    return ESP_OK;
+}
+
+void app_timer_cancel(app_timer_t *timer)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (timer->next) {
+        list_unlink(timer);
+        s_active--;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool app_timer_is_active(const app_timer_t *timer)
+{
+    return timer->next != NULL;
+}
+
+esp_err_t app_timer_service_init(void)
+{
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        for (int i = 0; i < WHEEL_SIZE; i++) {
+            s_wheel[l][i].next = s_wheel[l][i].prev = &s_wheel[l][i];
+        }
+    }
+    esp_timer_create_args_t timer_args = {
+        .callback = tick_cb,
+        .name = "app_timer",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_tick);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create tick timer");
+    }
+    return err;
+}
@@ -0,0 +1,65 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct app_timer app_timer_t;
+
+/* Runs in the esp_timer task, like an esp_timer callback: keep it short */
+typedef void (*app_timer_cb_t)(app_timer_t *timer, void *arg);
+
+/* Owned by the caller (static or embedded in another struct): the service
+ * allocates nothing. Fields are private. */
+struct app_timer {
+    app_timer_t *next;
+    app_timer_t *prev;
+    uint32_t expires;           // tick
+    app_timer_cb_t cb;
+    void *arg;
+};
+
+/* Longest delay: 2^24 ticks (about 46 h with a 10 ms tick) */
+#define APP_TIMER_MAX_TICKS     (1u << 24)
+
+/* Create the service tick. Call once before any timer is started.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_timer_service_init(void);
+
+/* Prepare a timer. Must not be called on an active timer. */
+void app_timer_setup(app_timer_t *timer, app_timer_cb_t cb, void *arg);
+
+/* (Re)start a timer, O(1)
+ *
+ * An active timer is moved to the new expiry. Delays are rounded up to
+ * whole CONFIG_APP_TIMER_TICK_MS ticks.
+ *
+ * @param[in] timer Timer prepared with app_timer_setup().
+ * @param[in] delay_ms Delay before the callback runs.
+ *
+ * @return ESP_OK on success.
+ * @return ESP_ERR_INVALID_ARG if the delay is longer than APP_TIMER_MAX_TICKS.
+ */
+esp_err_t app_timer_start(app_timer_t *timer, uint32_t delay_ms);
+
+/* Stop a timer if active, O(1). Safe from any task, including callbacks. */
+void app_timer_cancel(app_timer_t *timer);
+
+bool app_timer_is_active(const app_timer_t *timer);
+
+#ifdef __cplusplus
+}
+#endif
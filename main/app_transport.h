@@ -0,0 +1,43 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Datagram transport between the hub and its satellites
+ *
+ * An address is 6 bytes: the peer MAC for ESP-NOW, IPv4 address and port
+ * (network order) for UDP. Frames are small (tens of bytes); authentication is
+ * done above the transport.
+ */
+#define APP_TRANSPORT_ADDR_LEN  6
+#define APP_TRANSPORT_MTU       64
+
+/* Called for every received frame. May run in the Wi-Fi task: copy and return. */
+typedef void (*app_transport_rx_cb_t)(const uint8_t addr[APP_TRANSPORT_ADDR_LEN], const uint8_t *data, size_t len);
+
+typedef struct {
+    const char *name;
+    esp_err_t (*start)(app_transport_rx_cb_t rx);
+    esp_err_t (*send)(const uint8_t addr[APP_TRANSPORT_ADDR_LEN], const void *data, size_t len);
+} app_transport_t;
+
+/* ESP-NOW on the station interface; for battery satellites on real hardware */
+extern const app_transport_t app_transport_espnow;
+
+/* UDP on CONFIG_APP_HUB_UDP_PORT; for satellites simulated on a host */
+extern const app_transport_t app_transport_udp;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+/* ESP-NOW satellite transport
+ *
+ * Satellites send to the hub's station MAC on the AP's channel, so the hub
+ * stays connected to Wi-Fi while it listens. Peers are added on first receive
+ * so the hub can answer them.
+ */
+
+#include <string.h>
+#include <esp_log.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+
+#include "app_transport.h"
+
+static const char *TAG = "app_transport_espnow";
+
+static app_transport_rx_cb_t s_rx;
+
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (s_rx && len > 0) {
+        s_rx(info->src_addr, data, len);
+    }
+}
+
+static esp_err_t espnow_start(app_transport_rx_cb_t rx)
+{
+    s_rx = rx;
+    esp_err_t err = esp_now_init();
+    if (err == ESP_OK) {
+        err = esp_now_register_recv_cb(espnow_recv_cb);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ESP-NOW init failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static esp_err_t espnow_send(const uint8_t addr[APP_TRANSPORT_ADDR_LEN], const void *data, size_t len)
+{
+    if (!esp_now_is_peer_exist(addr)) {
+        esp_now_peer_info_t peer = {
+            .channel = 0,       // current channel
+            .ifidx = WIFI_IF_STA,
+            .encrypt = false,   // frames carry their own HMAC
+        };
+        memcpy(peer.peer_addr, addr, APP_TRANSPORT_ADDR_LEN);
+        esp_err_t err = esp_now_add_peer(&peer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return esp_now_send(addr, data, len);
+}
+
+const app_transport_t app_transport_espnow = {
+    .name = "espnow",
+    .start = espnow_start,
+    .send = espnow_send,
+};
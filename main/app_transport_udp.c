@@ -0,0 +1,81 @@
+/* UDP satellite transport
+ *
+ * Same frames as ESP-NOW, on CONFIG_APP_HUB_UDP_PORT, so satellites can be
+ * simulated from a host (tools/satellite_sim.py). The peer address is its
+ * IPv4 address and port.
+ */
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <lwip/sockets.h>
+
+#include "app_transport.h"
+
+static const char *TAG = "app_transport_udp";
+
+#define UDP_TASK_STACK  3072
+#define UDP_TASK_PRIO   5
+
+static int s_sock = -1;
+static app_transport_rx_cb_t s_rx;
+
+static void udp_task(void *arg)
+{
+    uint8_t buf[APP_TRANSPORT_MTU];
+    uint8_t addr[APP_TRANSPORT_ADDR_LEN];
+    while (1) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(s_sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+        if (len <= 0) {
+            continue;
+        }
+        memcpy(addr, &from.sin_addr.s_addr, 4);
+        memcpy(addr + 4, &from.sin_port, 2);
+        s_rx(addr, buf, len);
+    }
+}
+
+static esp_err_t udp_start(app_transport_rx_cb_t rx)
+{
+    s_rx = rx;
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_APP_HUB_UDP_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(s_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "Failed to bind port %d: errno %d", CONFIG_APP_HUB_UDP_PORT, errno);
+        close(s_sock);
+        s_sock = -1;
+        return ESP_FAIL;
+    }
+    if (xTaskCreate(udp_task, "hub_udp", UDP_TASK_STACK, NULL, UDP_TASK_PRIO, NULL) != pdPASS) {
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Listening on port %d", CONFIG_APP_HUB_UDP_PORT);
+    return ESP_OK;
+}
+
+static esp_err_t udp_send(const uint8_t addr[APP_TRANSPORT_ADDR_LEN], const void *data, size_t len)
+{
+    struct sockaddr_in to = {
+        .sin_family = AF_INET,
+    };
+    memcpy(&to.sin_addr.s_addr, addr, 4);
+    memcpy(&to.sin_port, addr + 4, 2);
+    return sendto(s_sock, data, len, 0, (struct sockaddr *)&to, sizeof(to)) < 0 ? ESP_FAIL : ESP_OK;
+}
+
+const app_transport_t app_transport_udp = {
+    .name = "udp",
+    .start = udp_start,
+    .send = udp_send,
+};
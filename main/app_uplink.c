@@ -0,0 +1,519 @@
+/* Shared cloud uplink
+ *
+ * Optional mode in which the nodes of one home keep a single MQTT session
+ * between them. Every node multicasts a heartbeat once a second; the node with
+ * the highest (priority, MAC) among those heard in the last
+ * APP_UPLINK_PEER_TIMEOUT_MS becomes leader and keeps its cloud session, the
+ * others disconnect theirs.
+ *
+ * A live leader is not displaced by a better node that joins later, so a node
+ * rebooting does not move the session around; if two nodes both claim to lead
+ * (e.g. after a network split heals) the lower one steps down.
+ *
+ * Followers cannot publish to their own RainMaker topics through the leader's
+ * session, so they forward what needs the cloud in a form the leader can
+ * publish as itself: alerts are published by the leader's alert manager with
+ * the follower's id, and the follower's alarm/door/light/siren state travels
+ * in its heartbeat and is reported in the leader's "Home Nodes" param.
+ *
+ * A forwarded alert is acknowledged with ALERT_ACK once the leader holds it;
+ * the follower's alert manager forwards it again until then. The leader
+ * remembers the last alert id taken from each peer, so a forward repeated
+ * because the ack was lost is acknowledged again but not published twice.
+ *
+ * seq only rejects replays from a peer that is live in the table, and after a
+ * power cut no node has a clock to check a timestamp against. So a new or
+ * returning peer stays unverified, and neither counts in the election nor has
+ * its alerts or acks taken, until one of its heartbeats echoes this node's
+ * boot nonce. The nonce is redrawn whenever a peer times out, so a recorded
+ * heartbeat of a node that has since died or rebooted cannot pass again.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_mac.h>
+#include <esp_random.h>
+#include <esp_diagnostics.h>
+#include <lwip/sockets.h>
+#include <json_generator.h>
+
+#include <esp_rmaker_core.h>
+#include <esp_rmaker_utils.h>
+
+#include "app_uplink.h"
+#include "app_conn.h"
+#include "app_report.h"
+#include "app_home_key.h"
+#include "app_siren.h"
+#include "app_alert.h"
+#include "app_priv.h"
+
+static const char *TAG = "app_uplink";
+
+#define UPLINK_TASK_STACK       4096
+#define UPLINK_TASK_PRIO        4
+#define UPLINK_POLL_MS          250
+#define UPLINK_PEERS            16
+#define UPLINK_MAX_SKEW_S       60
+#define UPLINK_FRAME_MAX        (APP_UPLINK_HDR_LEN + APP_UPLINK_MAX_PAYLOAD + APP_HOME_TAG_LEN)
+#define UPLINK_ALERT_COPIES     2
+#define UPLINK_NODES_PARAM_LEN  (UPLINK_PEERS * 48 + 8)
+#define UPLINK_HEARTBEAT_MAX    (7 + UPLINK_PEERS * 4)
+
+_Static_assert(UPLINK_HEARTBEAT_MAX <= APP_UPLINK_MAX_PAYLOAD, "heartbeat echo list does not fit a frame");
+
+typedef struct {
+    uint8_t node[6];
+    uint8_t prio;
+    uint8_t flags;
+    uint8_t state;
+    uint32_t seq;
+    uint32_t alert_id;      // last forwarded alert taken from this peer
+    uint32_t nonce;         // the peer's nonce, echoed in our heartbeats
+    bool verified;          // the peer has echoed our nonce since it appeared
+    int64_t last_us;        // 0 = free slot
+} uplink_peer_t;
+
+static int s_sock = -1;
+static struct sockaddr_in s_group;
+static uint8_t s_node[6];
+static uint32_t s_seq;
+static volatile app_uplink_role_t s_role = APP_UPLINK_ELECTING;
+static volatile bool s_leader_live;     // a follower has heard its leader recently
+static int64_t s_start_us;
+static uint32_t s_nonce;                // only touched by the uplink task
+static uplink_peer_t s_peers[UPLINK_PEERS];     // only touched by the uplink task
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_rmaker_param_t *s_role_param;
+static esp_rmaker_param_t *s_nodes_param;
+
+static const char *const s_role_name[] = {
+    [APP_UPLINK_ELECTING] = "electing",
+    [APP_UPLINK_LEADER] = "leader",
+    [APP_UPLINK_FOLLOWER] = "follower",
+};
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool peer_live(const uplink_peer_t *peer, int64_t now)
+{
+    return peer->last_us && now - peer->last_us < APP_UPLINK_PEER_TIMEOUT_MS * 1000LL;
+}
+
+/* ---------------- Frames ---------------- */
+
+static esp_err_t uplink_send(app_uplink_type_t type, const void *payload, size_t len, int copies)
+{
+    if (s_sock < 0 || len > APP_UPLINK_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t frame[UPLINK_FRAME_MAX] = { 'S', 'U', APP_UPLINK_VERSION, type };
+    memcpy(&frame[4], s_node, sizeof(s_node));
+    portENTER_CRITICAL(&s_lock);
+    uint32_t seq = ++s_seq;
+    portEXIT_CRITICAL(&s_lock);
+    put_le32(&frame[10], seq);
+    put_le32(&frame[14], esp_rmaker_time_check() ? (uint32_t)time(NULL) : 0);
+    frame[18] = len & 0xff;
+    frame[19] = len >> 8;
+    memcpy(&frame[APP_UPLINK_HDR_LEN], payload, len);
+    size_t tagged = APP_UPLINK_HDR_LEN + len;
+    esp_err_t err = app_home_key_tag(NULL, 0, frame, tagged, &frame[tagged]);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (int i = 0; i < copies; i++) {
+        if (sendto(s_sock, frame, tagged + APP_HOME_TAG_LEN, 0, (struct sockaddr *)&s_group, sizeof(s_group)) < 0) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+static void send_heartbeat(void)
+{
+    uint8_t flags = (s_role == APP_UPLINK_LEADER ? APP_UPLINK_FLAG_LEADER : 0) |
+                    (app_conn_is_online() ? APP_UPLINK_FLAG_CLOUD : 0);
+    uint8_t state = (app_alarm_is_enabled() ? APP_UPLINK_STATE_ARMED : 0) |
+                    (app_door_is_open() ? APP_UPLINK_STATE_DOOR : 0) |
+                    (app_light_get() ? APP_UPLINK_STATE_LIGHT : 0) |
+                    (app_siren_get_stage() == APP_SIREN_FULL ? APP_UPLINK_STATE_SIREN : 0);
+    uint8_t payload[UPLINK_HEARTBEAT_MAX] = { CONFIG_APP_UPLINK_PRIORITY, flags, state };
+    put_le32(&payload[3], s_nonce);
+    size_t len = 7;
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < UPLINK_PEERS; i++) {
+        if (peer_live(&s_peers[i], now)) {
+            put_le32(&payload[len], s_peers[i].nonce);
+            len += 4;
+        }
+    }
+    uplink_send(APP_UPLINK_HEARTBEAT, payload, len, 1);
+}
+
+esp_err_t app_uplink_forward_alert(uint32_t id, const char *msg)
+{
+    if (s_role != APP_UPLINK_FOLLOWER || !s_leader_live) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t payload[APP_UPLINK_MAX_PAYLOAD];
+    size_t len = strnlen(msg, sizeof(payload) - 4);
+    put_le32(payload, id);
+    memcpy(&payload[4], msg, len);
+    return uplink_send(APP_UPLINK_ALERT, payload, 4 + len, UPLINK_ALERT_COPIES);
+}
+
+static void send_alert_ack(const uplink_peer_t *peer, uint32_t id)
+{
+    uint8_t payload[10];
+    memcpy(payload, peer->node, 6);
+    put_le32(&payload[6], id);
+    uplink_send(APP_UPLINK_ALERT_ACK, payload, sizeof(payload), UPLINK_ALERT_COPIES);
+}
+
+/* ---------------- Peers ---------------- */
+
+/* > 0 if (prio_a, a) outranks (prio_b, b) */
+static int rank_cmp(uint8_t prio_a, const uint8_t *a, uint8_t prio_b, const uint8_t *b)
+{
+    if (prio_a != prio_b) {
+        return prio_a > prio_b ? 1 : -1;
+    }
+    return memcmp(a, b, 6);
+}
+
+/* Find or add the sender; NULL if the frame is a repeat, a replay or stale */
+static uplink_peer_t *peer_accept(const uint8_t *node, uint32_t seq, uint32_t sent_time, int64_t now)
+{
+    uplink_peer_t *free_slot = NULL;
+    for (int i = 0; i < UPLINK_PEERS; i++) {
+        uplink_peer_t *peer = &s_peers[i];
+        if (peer_live(peer, now) && memcmp(peer->node, node, 6) == 0) {
+            if (seq <= peer->seq) {
+                return NULL;
+            }
+            peer->seq = seq;
+            peer->last_us = now;
+            return peer;
+        }
+        if (!free_slot && !peer_live(peer, now)) {
+            free_slot = peer;
+        }
+    }
+    if (!free_slot) {
+        return NULL;
+    }
+    /* New or returning peer: nothing to compare seq with. Drop a stale timestamp
+     * here; the peer stays unverified until it echoes our nonce. */
+    if (sent_time && esp_rmaker_time_check()) {
+        int64_t skew = (int64_t)time(NULL) - sent_time;
+        if (skew > UPLINK_MAX_SKEW_S || skew < -UPLINK_MAX_SKEW_S) {
+            return NULL;
+        }
+    }
+    memset(free_slot, 0, sizeof(*free_slot));
+    memcpy(free_slot->node, node, 6);
+    free_slot->seq = seq;
+    free_slot->last_us = now;
+    return free_slot;
+}
+
+/* Free the slots of peers that timed out; returns true if there were any */
+static bool expire_peers(int64_t now)
+{
+    bool expired = false;
+    for (int i = 0; i < UPLINK_PEERS; i++) {
+        if (s_peers[i].last_us && !peer_live(&s_peers[i], now)) {
+            s_peers[i].last_us = 0;
+            expired = true;
+        }
+    }
+    if (expired) {
+        /* Frames recorded from a peer that is gone must not verify it again */
+        s_nonce = esp_random();
+    }
+    return expired;
+}
+
+/* True if a heartbeat's echo list holds our nonce */
+static bool echoes_nonce(const uint8_t *echo, size_t len)
+{
+    for (size_t i = 0; i + 4 <= len; i += 4) {
+        if (get_le32(&echo[i]) == s_nonce) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ---------------- Election ---------------- */
+
+static void set_role(app_uplink_role_t role)
+{
+    if (role == s_role) {
+        return;
+    }
+    ESP_LOGI(TAG, "Role: %s -> %s", s_role_name[s_role], s_role_name[role]);
+    ESP_DIAG_EVENT("UPLINK", "Role %s -> %s", s_role_name[s_role], s_role_name[role]);
+    s_role = role;
+    app_conn_set_wanted(role == APP_UPLINK_LEADER);
+    app_report_param(s_role_param, esp_rmaker_str(s_role_name[role]));
+}
+
+static void elect(int64_t now)
+{
+    const uplink_peer_t *leader = NULL;     // best live node claiming to lead
+    bool outranked = false;                 // some live node outranks us
+    for (int i = 0; i < UPLINK_PEERS; i++) {
+        const uplink_peer_t *peer = &s_peers[i];
+        if (!peer_live(peer, now) || !peer->verified) {
+            continue;
+        }
+        if ((peer->flags & APP_UPLINK_FLAG_LEADER) &&
+            (!leader || rank_cmp(peer->prio, peer->node, leader->prio, leader->node) > 0)) {
+            leader = peer;
+        }
+        if (rank_cmp(peer->prio, peer->node, CONFIG_APP_UPLINK_PRIORITY, s_node) > 0) {
+            outranked = true;
+        }
+    }
+    s_leader_live = leader != NULL;
+
+    if (s_role == APP_UPLINK_ELECTING && now - s_start_us < APP_UPLINK_PEER_TIMEOUT_MS * 1000LL) {
+        return;     // still listening for an existing leader
+    }
+    if (leader) {
+        bool we_win = s_role == APP_UPLINK_LEADER &&
+                      rank_cmp(CONFIG_APP_UPLINK_PRIORITY, s_node, leader->prio, leader->node) > 0;
+        set_role(we_win ? APP_UPLINK_LEADER : APP_UPLINK_FOLLOWER);
+    } else if (s_role == APP_UPLINK_LEADER || !outranked) {
+        set_role(APP_UPLINK_LEADER);
+    } else {
+        /* A better node is up but has not claimed yet: wait for it */
+        set_role(APP_UPLINK_FOLLOWER);
+    }
+}
+
+/* [{"id":"a1b2c3","s":state,"l":leader},...] for the live, verified peers */
+static void report_nodes(int64_t now)
+{
+    static char buf[UPLINK_NODES_PARAM_LEN];
+    char id[8];
+    json_gen_str_t jstr;
+    int err = 0;
+    json_gen_str_start(&jstr, buf, sizeof(buf), NULL, NULL);
+    err |= json_gen_start_array(&jstr);
+    for (int i = 0; i < UPLINK_PEERS; i++) {
+        const uplink_peer_t *peer = &s_peers[i];
+        if (!peer_live(peer, now) || !peer->verified) {
+            continue;
+        }
+        snprintf(id, sizeof(id), "%02x%02x%02x", peer->node[3], peer->node[4], peer->node[5]);
+        err |= json_gen_start_object(&jstr);
+        err |= json_gen_obj_set_string(&jstr, "id", id);
+        err |= json_gen_obj_set_int(&jstr, "s", peer->state);
+        err |= json_gen_obj_set_bool(&jstr, "l", (peer->flags & APP_UPLINK_FLAG_LEADER) != 0);
+        err |= json_gen_end_object(&jstr);
+    }
+    err |= json_gen_end_array(&jstr);
+    json_gen_str_end(&jstr);
+    if (err == 0) {
+        app_report_param(s_nodes_param, esp_rmaker_str(buf));
+    }
+}
+
+/* Returns true if the set of live peers or their state changed */
+static bool handle_frame(const uint8_t *frame, int len, int64_t now)
+{
+    if (len < APP_UPLINK_HDR_LEN + APP_HOME_TAG_LEN || frame[0] != 'S' || frame[1] != 'U' ||
+        frame[2] != APP_UPLINK_VERSION || memcmp(&frame[4], s_node, 6) == 0) {
+        return false;
+    }
+    size_t plen = frame[18] | (frame[19] << 8);
+    size_t tagged = APP_UPLINK_HDR_LEN + plen;
+    if (plen > APP_UPLINK_MAX_PAYLOAD || (size_t)len != tagged + APP_HOME_TAG_LEN ||
+        !app_home_key_verify(NULL, 0, frame, tagged, &frame[tagged])) {
+        return false;
+    }
+    bool known = false;
+    for (int i = 0; i < UPLINK_PEERS; i++) {
+        known |= peer_live(&s_peers[i], now) && memcmp(s_peers[i].node, &frame[4], 6) == 0;
+    }
+    uplink_peer_t *peer = peer_accept(&frame[4], get_le32(&frame[10]), get_le32(&frame[14]), now);
+    if (!peer) {
+        return false;
+    }
+    const uint8_t *payload = &frame[APP_UPLINK_HDR_LEN];
+    switch (frame[3]) {
+    case APP_UPLINK_HEARTBEAT: {
+        if (plen < 7) {
+            return false;
+        }
+        bool verified = peer->verified || echoes_nonce(&payload[7], plen - 7);
+        bool changed = !known || verified != peer->verified || peer->flags != payload[1] ||
+                       peer->state != payload[2];
+        peer->prio = payload[0];
+        peer->flags = payload[1];
+        peer->state = payload[2];
+        peer->nonce = get_le32(&payload[3]);
+        peer->verified = verified;
+        return changed;
+    }
+    case APP_UPLINK_ALERT:
+        if (s_role == APP_UPLINK_LEADER && peer->verified && plen >= 4) {
+            uint32_t id = get_le32(payload);
+            if (id > peer->alert_id) {
+                char msg[APP_UPLINK_MAX_PAYLOAD + 16];
+                snprintf(msg, sizeof(msg), "%02x%02x%02x: %.*s", peer->node[3], peer->node[4], peer->node[5],
+                         (int)plen - 4, (const char *)&payload[4]);
+                if (app_alert_relay(msg) != ESP_OK) {
+                    return !known;
+                }
+                peer->alert_id = id;
+            }
+            send_alert_ack(peer, id);
+        }
+        return !known;
+    case APP_UPLINK_ALERT_ACK:
+        if (peer->verified && plen >= 10 && memcmp(payload, s_node, 6) == 0) {
+            app_alert_forward_acked(get_le32(&payload[6]));
+        }
+        return !known;
+    default:
+        return !known;
+    }
+}
+
+static void uplink_task(void *arg)
+{
+    uint8_t frame[UPLINK_FRAME_MAX];
+    int64_t next_heartbeat = 0;
+    int64_t last_count_us = 0;
+    int live_before = 0;
+    s_start_us = esp_timer_get_time();
+    s_nonce = esp_random();
+
+    while (1) {
+        int len = recv(s_sock, frame, sizeof(frame), 0);
+        int64_t now = esp_timer_get_time();
+        bool changed = expire_peers(now);
+        changed |= len > 0 && handle_frame(frame, len, now);
+
+        if (now >= next_heartbeat) {
+            send_heartbeat();
+            next_heartbeat = now + APP_UPLINK_HEARTBEAT_MS * 1000LL;
+        }
+        /* Peers timing out also change the set; check that a few times a second */
+        if (now - last_count_us >= UPLINK_POLL_MS * 1000LL) {
+            int live = 0;
+            for (int i = 0; i < UPLINK_PEERS; i++) {
+                live += peer_live(&s_peers[i], now);
+            }
+            changed |= live != live_before;
+            live_before = live;
+            last_count_us = now;
+            elect(now);
+        }
+        if (changed && s_role == APP_UPLINK_LEADER) {
+            report_nodes(now);
+        }
+    }
+}
+
+/* ---------------- Setup ---------------- */
+
+static int uplink_open(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_APP_UPLINK_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "Failed to bind port %d: errno %d", CONFIG_APP_UPLINK_PORT, errno);
+        close(sock);
+        return -1;
+    }
+    uint8_t ttl = 1, loop = 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    struct timeval tv = { .tv_usec = UPLINK_POLL_MS * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+static void uplink_join_task(void *arg)
+{
+    /* Joining fails until the station interface has an address */
+    struct ip_mreq mreq = {
+        .imr_multiaddr = s_group.sin_addr,
+        .imr_interface.s_addr = htonl(INADDR_ANY),
+    };
+    while (setsockopt(s_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+        vTaskDelay(pdMS_TO_TICKS(2000));
+    }
+    ESP_LOGI(TAG, "Joined %s port %d, priority %d", CONFIG_APP_LANSYNC_GROUP, CONFIG_APP_UPLINK_PORT,
+             CONFIG_APP_UPLINK_PRIORITY);
+    uplink_task(arg);
+}
+
+app_uplink_role_t app_uplink_get_role(void)
+{
+    return s_role;
+}
+
+esp_err_t app_uplink_start(const esp_rmaker_node_t *node)
+{
+    esp_rmaker_device_t *service = esp_rmaker_service_create("Uplink", "custom.service.uplink", NULL);
+    s_role_param = esp_rmaker_param_create("Role", NULL, esp_rmaker_str(s_role_name[APP_UPLINK_ELECTING]),
+                                           PROP_FLAG_READ);
+    s_nodes_param = esp_rmaker_param_create("Home Nodes", NULL, esp_rmaker_str("[]"), PROP_FLAG_READ);
+    app_report_add_param(service, s_role_param);
+    app_report_add_param(service, s_nodes_param);
+    esp_err_t err = esp_rmaker_node_add_device(node, service);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_group = (struct sockaddr_in) {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_APP_UPLINK_PORT),
+    };
+    if (inet_aton(CONFIG_APP_LANSYNC_GROUP, &s_group.sin_addr) == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_read_mac(s_node, ESP_MAC_WIFI_STA);
+    s_sock = uplink_open();
+    if (s_sock < 0) {
+        return ESP_FAIL;
+    }
+    if (xTaskCreate(uplink_join_task, "uplink", UPLINK_TASK_STACK, NULL, UPLINK_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create uplink task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,93 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_rmaker_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Shared uplink wire format (UDP multicast, all integers little endian)
+ *
+ *     'S' 'U' version type  node[6]  seq[4]  time[4]  len[2]  payload[len]  tag[16]
+ *     tag = HMAC-SHA256(home key, everything before it)[0..15]
+ *
+ * HEARTBEAT payload: priority flags state nonce[4] echo[4]..., sent every
+ *     APP_UPLINK_HEARTBEAT_MS. nonce is drawn at boot and whenever a peer
+ *     times out; echo repeats the last nonce heard from each live peer. A peer
+ *     counts once it has echoed the receiver's nonce.
+ * ALERT payload: id[4] text. A notification from a follower, held and
+ *     published by the leader; id is the follower's alert manager seq.
+ * ALERT_ACK payload: node[6] id[4]. Sent by the leader once it holds the
+ *     notification; the follower keeps forwarding it until then.
+ * seq increases with every frame of a node within one boot.
+ */
+#define APP_UPLINK_VERSION          3
+#define APP_UPLINK_HDR_LEN          20
+#define APP_UPLINK_MAX_PAYLOAD      256     // a forwarded alert follow-up with every zone
+#define APP_UPLINK_HEARTBEAT_MS     1000
+#define APP_UPLINK_PEER_TIMEOUT_MS  3000    // a leader silent this long is replaced
+
+typedef enum {
+    APP_UPLINK_HEARTBEAT = 0x01,
+    APP_UPLINK_ALERT = 0x02,
+    APP_UPLINK_ALERT_ACK = 0x03,
+} app_uplink_type_t;
+
+/* Heartbeat flags */
+#define APP_UPLINK_FLAG_LEADER      (1 << 0)    // sender holds the cloud session
+#define APP_UPLINK_FLAG_CLOUD       (1 << 1)    // sender's MQTT session is up
+
+/* Heartbeat state bits */
+#define APP_UPLINK_STATE_ARMED      (1 << 0)
+#define APP_UPLINK_STATE_DOOR       (1 << 1)
+#define APP_UPLINK_STATE_LIGHT      (1 << 2)
+#define APP_UPLINK_STATE_SIREN      (1 << 3)
+
+typedef enum {
+    APP_UPLINK_ELECTING = 0,    // listening for a leader after start
+    APP_UPLINK_LEADER,
+    APP_UPLINK_FOLLOWER,
+} app_uplink_role_t;
+
+/* Add the "Uplink" service and start leader election
+ *
+ * Nodes of one home elect the one with the highest CONFIG_APP_UPLINK_PRIORITY
+ * (then the highest MAC) to hold the cloud session. No node connects before it
+ * is elected (see app_conn_set_wanted()). The others send their alerts to the
+ * leader, and publish their state in
+ * heartbeats that the leader reports in its "Home Nodes" param. If the leader
+ * goes silent for APP_UPLINK_PEER_TIMEOUT_MS the next node takes over.
+ *
+ * @param[in] node RainMaker node to add the service to.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_uplink_start(const esp_rmaker_node_t *node);
+
+app_uplink_role_t app_uplink_get_role(void);
+
+/* Hand a held notification to the leader if this node is a follower
+ *
+ * The leader answers with an ALERT_ACK, passed to app_alert_forward_acked().
+ *
+ * @param[in] id Alert manager seq of the notification.
+ * @param[in] msg Notification text.
+ *
+ * @return ESP_OK if the notification was sent to the leader.
+ * @return ESP_ERR_INVALID_STATE if there is no live leader to send it to.
+ */
+esp_err_t app_uplink_forward_alert(uint32_t id, const char *msg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Check a partition table CSV (and optionally the built app image) before flashing.
+
+    check_partitions.py partitions_4mb_eventlog.csv --flash-size 4MB --app build/SmartHomeSystem.bin
+
+Runs automatically after every build (see the top-level CMakeLists.txt) and fails the
+build when:
+  - partitions overlap, run past the end of flash or into the partition table
+  - a partition is not aligned to a 4K flash sector (app partitions: 64K)
+  - an event-log / metrics partition (evlog, metrics) is not aligned to a 64K
+    erase block, so it can be erased with block erases instead of sector by sector
+  - the app image leaves less than --headroom percent of the smallest app slot free
+"""
+import argparse
+import csv
+import os
+import sys
+
+SECTOR = 0x1000
+BLOCK = 0x10000
+TABLE_SIZE = 0x1000
+BLOCK_ALIGNED = ('evlog', 'metrics')
+
+
+def parse_int(value):
+    value = value.strip()
+    for suffix, mult in (('K', 1024), ('M', 1024 * 1024)):
+        if value.upper().endswith(suffix):
+            return int(value[:-1], 0) * mult
+    return int(value, 0)
+
+
+def load(path, table_offset):
+    parts = []
+    next_offset = table_offset + TABLE_SIZE
+    with open(path) as f:
+        rows = [r for r in csv.reader(line for line in f if not line.lstrip().startswith('#'))]
+    for row in rows:
+        row = [c.strip() for c in row]
+        if len(row) < 5 or not row[0]:
+            continue
+        name, ptype, subtype, offset, size = row[:5]
+        align = BLOCK if ptype == 'app' else SECTOR
+        if offset:
+            offset = parse_int(offset)
+        else:
+            offset = (next_offset + align - 1) & ~(align - 1)
+        size = parse_int(size)
+        parts.append({'name': name, 'type': ptype, 'subtype': subtype, 'offset': offset, 'size': size})
+        next_offset = offset + size
+    return parts
+
+
+def check(parts, flash_size, table_offset, app_size, headroom):
+    errors = []
+    for p in parts:
+        align = BLOCK if p['type'] == 'app' else SECTOR
+        if p['offset'] % align or p['size'] % SECTOR:
+            errors.append('%s: offset 0x%x / size 0x%x not aligned to 0x%x' % (p['name'], p['offset'], p['size'], align))
+        if p['name'] in BLOCK_ALIGNED and (p['offset'] % BLOCK or p['size'] % BLOCK):
+            errors.append('%s: offset 0x%x / size 0x%x not aligned to a 64K erase block' %
+                          (p['name'], p['offset'], p['size']))
+        if p['offset'] < table_offset + TABLE_SIZE:
+            errors.append('%s: overlaps bootloader / partition table' % p['name'])
+        if p['offset'] + p['size'] > flash_size:
+            errors.append('%s: ends at 0x%x, past the end of flash (0x%x)' %
+                          (p['name'], p['offset'] + p['size'], flash_size))
+    ordered = sorted(parts, key=lambda p: p['offset'])
+    for a, b in zip(ordered, ordered[1:]):
+        if a['offset'] + a['size'] > b['offset']:
+            errors.append('%s overlaps %s' % (a['name'], b['name']))
+
+    apps = [p for p in parts if p['type'] == 'app']
+    if not apps:
+        errors.append('no app partition')
+    elif app_size is not None:
+        slot = min(p['size'] for p in apps)
+        limit = slot * (100 - headroom) // 100
+        print('app image %d bytes, smallest app slot %d bytes (%.1f%% free, need %d%%)' %
+              (app_size, slot, 100.0 * (slot - app_size) / slot, headroom))
+        if app_size > limit:
+            errors.append('app image %d bytes exceeds %d bytes (%d%% headroom in a 0x%x slot)' %
+                          (app_size, limit, headroom, slot))
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('table', help='partition table CSV')
+    parser.add_argument('--flash-size', default='4MB', help='flash size, e.g. 4MB')
+    parser.add_argument('--table-offset', default='0xc000', help='CONFIG_PARTITION_TABLE_OFFSET')
+    parser.add_argument('--app', help='built app image to check against the smallest app slot')
+    parser.add_argument('--headroom', type=int, default=10, help='minimum free space in the app slot, percent')
+    args = parser.parse_args()
+
+    flash_size = parse_int(args.flash_size.upper().rstrip('B'))
+    table_offset = parse_int(args.table_offset)
+    parts = load(args.table, table_offset)
+    app_size = os.path.getsize(args.app) if args.app and os.path.exists(args.app) else None
+
+    for p in parts:
+        print('%-16s %-5s %-10s 0x%06x 0x%06x (%dK)' % (p['name'], p['type'], p['subtype'] or '-',
+                                                      p['offset'], p['size'], p['size'] // 1024))
+    errors = check(parts, flash_size, table_offset, app_size, args.headroom)
+    for e in errors:
+        print('%s: error: %s' % (args.table, e), file=sys.stderr)
+    if errors:
+        sys.exit(1)
+    print('%s: OK' % args.table)
+
+
+if __name__ == '__main__':
+    main()
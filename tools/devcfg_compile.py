@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Compile a device configuration (JSON) into the binary blob read by main/app_devcfg.c.
+
+    devcfg_compile.py site.json devcfg.bin
+    parttool.py -p PORT write_partition --partition-name devcfg --input devcfg.bin
+    devcfg_compile.py --dump devcfg.bin
+
+The node maps the "devcfg" partition and reads the blob in place, so JSON is
+only ever parsed here. Every key is optional; anything left out keeps the
+firmware's built-in default:
+
+    {
+      "pins":  {"led": 2, "ir_sensor": 3, "buzzer": 4},
+      "names": {"light": "Hall Light", "alarm": "Alarm", "door": "Front Door"},
+      "rules": "on door_open if after 22:00 and disarmed then light_on 120",
+      "zones": ["Unassigned", "Front", "Garage"],
+      "satellites": [
+        {"id": "24:0a:c4:12:34:56", "zone": 1, "name": "Front Door"}
+      ]
+    }
+
+Zone names are indexed by zone number. The layout (see main/app_devcfg.h) is
+a fixed header, the zone and satellite records, then a string table; the
+satellites are sorted by id for the node's binary search.
+"""
+import argparse
+import json
+import struct
+import zlib
+
+MAGIC = 0x46434853  # "SHCF"
+VERSION = 1
+HEADER = struct.Struct('<IHHII bbbB IIII HH III')
+ZONE = struct.Struct('<I')
+SAT = struct.Struct('<6sBB I')
+MAX_ZONE = 30      # zone masks are int params on the node: bit 31 cannot be set
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+class Strings:
+    """String table, deduplicated. add() returns the offset in the table, None if unset."""
+
+    def __init__(self):
+        # Leading NUL: a string never sits at table offset 0
+        self.data = bytearray(b'\0')
+        self.index = {}
+
+    def add(self, text):
+        if text is None:
+            return None
+        if text not in self.index:
+            self.index[text] = len(self.data)
+            self.data += text.encode('utf-8') + b'\0'
+        return self.index[text]
+
+
+def parse_id(text):
+    parts = text.replace('-', ':').split(':')
+    if len(parts) != 6:
+        raise SystemExit('bad satellite id %r, expected 6 hex bytes' % text)
+    return bytes(int(p, 16) for p in parts)
+
+
+def pin(pins, key):
+    value = pins.get(key, -1)
+    if not -1 <= value <= 127:
+        raise SystemExit('pins.%s: %d out of range' % (key, value))
+    return value
+
+
+def compile_config(cfg):
+    pins = cfg.get('pins', {})
+    names = cfg.get('names', {})
+    zones = cfg.get('zones', [])
+    sats = sorted(((parse_id(s['id']), s) for s in cfg.get('satellites', [])), key=lambda s: s[0])
+    if len(zones) > MAX_ZONE + 1:
+        raise SystemExit('%d zones, at most %d' % (len(zones), MAX_ZONE + 1))
+    for (a, _), (b, _) in zip(sats, sats[1:]):
+        if a == b:
+            raise SystemExit('duplicate satellite id %s' % a.hex(':'))
+
+    # String offsets are relative to the table until its position is known
+    strings = Strings()
+    refs = [strings.add(names.get(k)) for k in ('light', 'alarm', 'door')] + [strings.add(cfg.get('rules'))]
+    zone_refs = [strings.add(z) for z in zones]
+    sat_recs = []
+    for sat_id, s in sats:
+        zone = s.get('zone', 0)
+        if not 0 <= zone <= MAX_ZONE:
+            raise SystemExit('satellite %s: zone %d out of range' % (sat_id.hex(':'), zone))
+        sat_recs.append((sat_id, zone, strings.add(s.get('name'))))
+
+    zones_off = HEADER.size
+    sats_off = align4(zones_off + len(zones) * ZONE.size)
+    strings_off = align4(sats_off + len(sats) * SAT.size)
+
+    def ref(r):
+        return 0 if r is None else strings_off + r
+
+    body = bytearray(strings_off - HEADER.size)
+    pos = zones_off - HEADER.size
+    for r in zone_refs:
+        ZONE.pack_into(body, pos, ref(r))
+        pos += ZONE.size
+    pos = sats_off - HEADER.size
+    for sat_id, zone, r in sat_recs:
+        SAT.pack_into(body, pos, sat_id, zone, 0, ref(r))
+        pos += SAT.size
+    body += strings.data
+
+    total = HEADER.size + len(body)
+    light, alarm, door, rules = refs
+    header = HEADER.pack(MAGIC, VERSION, HEADER.size, total, zlib.crc32(body),
+                         pin(pins, 'led'), pin(pins, 'ir_sensor'), pin(pins, 'buzzer'), 0,
+                         ref(light), ref(alarm), ref(door), ref(rules),
+                         len(zones), len(sats), zones_off, sats_off, strings_off)
+    return header + bytes(body)
+
+
+def dump(blob):
+    (magic, version, hdr_len, total, crc, led, ir, buzzer, _, light, alarm, door, rules,
+     zone_count, sat_count, zones_off, sats_off, strings_off) = HEADER.unpack_from(blob)
+    if magic != MAGIC:
+        raise SystemExit('no configuration blob (magic 0x%08x)' % magic)
+    if zlib.crc32(blob[hdr_len:total]) != crc:
+        raise SystemExit('CRC mismatch')
+
+    def string(off):
+        return blob[off:blob.index(b'\0', off)].decode('utf-8') if off else None
+
+    cfg = {'version': version, 'size': total,
+           'pins': {'led': led, 'ir_sensor': ir, 'buzzer': buzzer},
+           'names': {'light': string(light), 'alarm': string(alarm), 'door': string(door)},
+           'rules': string(rules),
+           'zones': [string(ZONE.unpack_from(blob, zones_off + i * ZONE.size)[0]) for i in range(zone_count)],
+           'satellites': []}
+    for i in range(sat_count):
+        sat_id, zone, _, name = SAT.unpack_from(blob, sats_off + i * SAT.size)
+        cfg['satellites'].append({'id': sat_id.hex(':'), 'zone': zone, 'name': string(name)})
+    print(json.dumps(cfg, indent=2))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='configuration JSON, or a blob with --dump')
+    parser.add_argument('output', nargs='?', help='blob to write')
+    parser.add_argument('--dump', action='store_true', help='print the contents of a blob')
+    parser.add_argument('--partition-size', type=lambda v: int(v, 0), default=0x8000,
+                        help='fail if the blob does not fit (default 0x8000, the smallest devcfg partition)')
+    args = parser.parse_args()
+
+    if args.dump:
+        with open(args.input, 'rb') as f:
+            dump(f.read())
+        return
+    if not args.output:
+        parser.error('output is required')
+    with open(args.input) as f:
+        blob = compile_config(json.load(f))
+    if len(blob) > args.partition_size:
+        raise SystemExit('blob is %d bytes, partition is %d' % (len(blob), args.partition_size))
+    with open(args.output, 'wb') as f:
+        f.write(blob)
+    print('%s: %d bytes' % (args.output, len(blob)))
+
+
+if __name__ == '__main__':
+    main()
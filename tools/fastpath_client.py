@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Client for the local control fast path (see main/app_fastpath.h).
+
+Opens one persistent session and sends light/alarm/status commands,
+printing the round-trip time of each command.
+
+    fastpath_client.py <host> <home-key-hex> light on
+    fastpath_client.py <host> <home-key-hex> alarm off
+    fastpath_client.py <host> <home-key-hex> toggle-light --count 200
+    fastpath_client.py <host> <home-key-hex> snapshot --json
+    fastpath_client.py <host> <home-key-hex> history --page 1
+    fastpath_client.py <host> <home-key-hex> compare
+
+"compare" fetches the snapshot and the first history page as CBOR and as
+JSON and prints payload bytes and on-device encode time for each.
+"""
+import argparse
+import hashlib
+import hmac
+import socket
+import statistics
+import struct
+import time
+
+VERSION = 1
+HELLO_LEN = 20
+RESP_LEN = 8
+CMDS = {'light': 0x01, 'alarm': 0x02, 'status': 0x03, 'snapshot': 0x04, 'history': 0x05}
+VALUE_JSON = 0x80
+STATUS = ['OK', 'AUTH', 'BAD_CMD', 'BUSY', 'REPLAY']
+
+
+def recv_exact(sock, n):
+    buf = b''
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError('connection closed')
+        buf += chunk
+    return buf
+
+
+class Session:
+    def __init__(self, host, port, key):
+        self.key = key
+        self.seq = 0
+        self.sock = socket.create_connection((host, port), timeout=5)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        hello = recv_exact(self.sock, HELLO_LEN)
+        if hello[:2] != b'SH' or hello[2] != VERSION:
+            raise RuntimeError('unexpected hello %r' % hello[:4])
+        self.nonce = hello[4:]
+
+    def command(self, cmd, value):
+        self.seq += 1
+        head = struct.pack('<2sBBI', b'SH', cmd, value, self.seq)
+        tag = hmac.new(self.key, self.nonce + head, hashlib.sha256).digest()[:16]
+        start = time.perf_counter()
+        self.sock.sendall(head + tag)
+        resp = recv_exact(self.sock, RESP_LEN)
+        elapsed_ms = (time.perf_counter() - start) * 1000
+        _, status, state, seq = struct.unpack('<2sBBI', resp)
+        if seq != self.seq:
+            raise RuntimeError('sequence mismatch')
+        return status, state, elapsed_ms
+
+    def payload(self, cmd, value):
+        """Send SNAPSHOT/HISTORY and return (status, payload, encode_us)."""
+        status, _, _ = self.command(cmd, value)
+        if status != 0:
+            return status, b'', 0
+        length, encode_us = struct.unpack('<HH', recv_exact(self.sock, 4))
+        return status, recv_exact(self.sock, length), encode_us
+
+
+def compare(session):
+    print('%-10s %-5s %7s %10s' % ('payload', 'fmt', 'bytes', 'encode_us'))
+    for name in ('snapshot', 'history'):
+        for fmt, flag in (('cbor', 0), ('json', VALUE_JSON)):
+            status, data, encode_us = session.payload(CMDS[name], flag)
+            if status != 0:
+                print('%-10s %-5s failed: %s' % (name, fmt, STATUS[status]))
+                continue
+            print('%-10s %-5s %7d %10d' % (name, fmt, len(data), encode_us))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('host')
+    parser.add_argument('key', help='home key, 64 hex characters')
+    parser.add_argument('target', choices=['light', 'alarm', 'status', 'toggle-light', 'snapshot', 'history', 'compare'])
+    parser.add_argument('value', nargs='?', choices=['on', 'off'], default='off')
+    parser.add_argument('--port', type=int, default=3333)
+    parser.add_argument('--count', type=int, default=1)
+    parser.add_argument('--json', action='store_true', help='request JSON instead of CBOR payloads')
+    parser.add_argument('--page', type=int, default=0, help='history page, 0 = newest')
+    args = parser.parse_args()
+
+    session = Session(args.host, args.port, bytes.fromhex(args.key))
+    if args.target == 'compare':
+        compare(session)
+        return
+    if args.target in ('snapshot', 'history'):
+        value = (VALUE_JSON if args.json else 0) | (args.page & 0x7f if args.target == 'history' else 0)
+        status, data, encode_us = session.payload(CMDS[args.target], value)
+        if status != 0:
+            print('status=%s' % STATUS[status])
+            return
+        print('%d bytes, encoded in %d us' % (len(data), encode_us))
+        print(data.decode() if args.json else data.hex())
+        return
+    times = []
+    for i in range(args.count):
+        if args.target == 'toggle-light':
+            cmd, value = CMDS['light'], i & 1
+        else:
+            cmd, value = CMDS[args.target], 1 if args.value == 'on' else 0
+        status, state, elapsed_ms = session.command(cmd, value)
+        times.append(elapsed_ms)
+        if args.count == 1 or status != 0:
+            print('status=%s light=%d alarm=%d door=%d rtt=%.2f ms' % (
+                STATUS[status] if status < len(STATUS) else status,
+                state & 1, (state >> 1) & 1, (state >> 2) & 1, elapsed_ms))
+    if args.count > 1:
+        times.sort()
+        print('%d commands: min %.2f ms, median %.2f ms, p95 %.2f ms, max %.2f ms' % (
+            len(times), times[0], statistics.median(times), times[int(len(times) * 0.95) - 1], times[-1]))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Send or watch LAN alarm sync frames (see main/app_lansync.h).
+
+    lansync_tool.py <home-key-hex> listen
+    lansync_tool.py <home-key-hex> trigger --zone 2
+    lansync_tool.py <home-key-hex> disarm
+
+"listen" prints every frame on the group with its tag check result, and marks
+repeats and replays the way a node would drop them. "trigger" and "disarm"
+act as an extra node: armed nodes sound their siren on a trigger, and every
+node disarms on a disarm. The sender keeps its sequence number in a small
+state file so nodes do not drop its frames as replays.
+"""
+import argparse
+import hashlib
+import hmac
+import json
+import os
+import socket
+import struct
+import time
+
+VERSION = 1
+HDR_LEN = 20
+FRAME_LEN = HDR_LEN + 16
+REPEAT_DELAYS = (0.02, 0.06)
+TYPES = {'trigger': 0x01, 'disarm': 0x02}
+TYPE_NAMES = {v: k for k, v in TYPES.items()}
+STATE_FILE = os.path.expanduser('~/.lansync_tool.json')
+
+
+def load_state():
+    try:
+        with open(STATE_FILE) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return {'node': os.urandom(6).hex(), 'seq': 0}
+
+
+def send(args, key):
+    state = load_state()
+    state['seq'] += 1
+    with open(STATE_FILE, 'w') as f:
+        json.dump(state, f)
+    head = struct.pack('<2sBBBB6sII', b'SY', VERSION, TYPES[args.cmd], args.zone, 0,
+                       bytes.fromhex(state['node']), state['seq'], int(time.time()))
+    frame = head + hmac.new(key, head, hashlib.sha256).digest()[:16]
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    for delay in (0,) + REPEAT_DELAYS:
+        time.sleep(delay)
+        sock.sendto(frame, (args.group, args.port))
+    print('sent %s zone %d seq %d as node %s' % (args.cmd, args.zone, state['seq'], state['node']))
+
+
+def listen(args, key):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(('', args.port))
+    mreq = struct.pack('4s4s', socket.inet_aton(args.group), socket.inet_aton('0.0.0.0'))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    last_seq = {}
+    while True:
+        frame, addr = sock.recvfrom(64)
+        now = time.time()
+        if len(frame) != FRAME_LEN or frame[:2] != b'SY' or frame[2] != VERSION:
+            print('%s: not a sync frame (%d bytes)' % (addr[0], len(frame)))
+            continue
+        _, _, ftype, zone, _, node, seq, sent = struct.unpack('<2sBBBB6sII', frame[:HDR_LEN])
+        good = hmac.compare_digest(hmac.new(key, frame[:HDR_LEN], hashlib.sha256).digest()[:16], frame[HDR_LEN:])
+        node = node.hex(':')
+        if not good:
+            verdict = 'BAD TAG'
+        elif seq <= last_seq.get(node, -1):
+            verdict = 'repeat' if seq == last_seq[node] else 'replay'
+        else:
+            verdict = 'new'
+            last_seq[node] = seq
+        age = ' age %+.0f s' % (now - sent) if sent else ''
+        print('%.3f %s %s %-7s zone %d seq %d%s  [%s]' % (now, addr[0], node, TYPE_NAMES.get(ftype, hex(ftype)),
+                                                       zone, seq, age, verdict))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('key', help='home key, 64 hex characters')
+    parser.add_argument('cmd', choices=['listen'] + sorted(TYPES))
+    parser.add_argument('--zone', type=int, default=0)
+    parser.add_argument('--group', default='239.255.83.89', help='CONFIG_APP_LANSYNC_GROUP')
+    parser.add_argument('--port', type=int, default=3334, help='CONFIG_APP_LANSYNC_PORT')
+    args = parser.parse_args()
+    key = bytes.fromhex(args.key)
+    if args.cmd == 'listen':
+        listen(args, key)
+    else:
+        send(args, key)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+"""Compress a firmware image for the streaming OTA handler (main/app_ota_decode.c).
+
+    ota_compress.py build/SmartHomeSystem.bin build/SmartHomeSystem.bin.zlib
+
+Upload the .zlib file as the OTA image in the RainMaker dashboard. The node
+detects the zlib header, inflates while downloading and writes the plain
+image to the inactive OTA slot.
+"""
+import argparse
+import zlib
+
+ESP_IMAGE_MAGIC = 0xE9
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('image', help='plain app image (.bin)')
+    parser.add_argument('output', help='compressed output file')
+    parser.add_argument('--level', type=int, default=9, choices=range(1, 10))
+    args = parser.parse_args()
+
+    with open(args.image, 'rb') as f:
+        image = f.read()
+    if not image or image[0] != ESP_IMAGE_MAGIC:
+        raise SystemExit('%s is not an ESP app image' % args.image)
+
+    # wbits=15: zlib header + 32K window, matching the 32K ROM tinfl dictionary on the device
+    compressor = zlib.compressobj(args.level, zlib.DEFLATED, 15)
+    data = compressor.compress(image) + compressor.flush()
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    print('%s: %d -> %d bytes (%.1f%%)' % (args.output, len(image), len(data), 100.0 * len(data) / len(image)))
+
+
+if __name__ == '__main__':
+    main()
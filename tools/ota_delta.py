@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Build or apply a delta OTA patch for the streaming OTA handler (main/app_ota_decode.c).
+
+    ota_delta.py gen   old.bin new.bin new.delta      # zlib-compressed patch
+    ota_delta.py apply old.bin new.delta out.bin      # check a patch on the host
+
+old.bin must be the exact image the node is running: the node hashes that many
+bytes of its running partition and refuses the patch on mismatch, then checks
+the SHA-256 of the rebuilt image before esp_ota_end() validates it again.
+
+Patch format (little endian):
+    "SHD1" src_size[4] dst_size[4] src_sha256[32] dst_sha256[32]
+    0x01 src_off[4] len[4]      copy from the running image
+    0x02 len[4] data[len]       insert literal bytes
+    0x00                        end
+"""
+import argparse
+import hashlib
+import struct
+import zlib
+
+MAGIC = b'SHD1'
+OP_END, OP_COPY, OP_INSERT = 0, 1, 2
+BLOCK = 32          # minimum match length, also the index key size
+INDEX_STEP = 4      # index every 4th source offset (app images are word aligned)
+
+
+def build_index(src):
+    index = {}
+    for off in range(0, len(src) - BLOCK + 1, INDEX_STEP):
+        index.setdefault(src[off:off + BLOCK], off)
+    return index
+
+
+def gen_ops(src, dst):
+    index = build_index(src)
+    ops = []
+    lit_start = 0
+    i = 0
+    # Try the continuation of the previous copy first: unchanged code after an
+    # edit usually sits at the same offset delta as the code before it
+    next_src = None
+    while i <= len(dst) - BLOCK:
+        j = None
+        if next_src is not None and src[next_src:next_src + BLOCK] == dst[i:i + BLOCK]:
+            j = next_src
+        else:
+            j = index.get(dst[i:i + BLOCK])
+        if j is None:
+            i += 1
+            continue
+        # extend backwards into the pending literal, then forwards
+        while i > lit_start and j > 0 and src[j - 1] == dst[i - 1]:
+            i -= 1
+            j -= 1
+        n = BLOCK
+        while i + n < len(dst) and j + n < len(src) and src[j + n] == dst[i + n]:
+            n += 1
+        if i > lit_start:
+            ops.append((OP_INSERT, dst[lit_start:i]))
+        ops.append((OP_COPY, j, n))
+        i += n
+        lit_start = i
+        next_src = j + n
+    if lit_start < len(dst):
+        ops.append((OP_INSERT, dst[lit_start:]))
+    return ops
+
+
+def encode(src, dst, ops):
+    out = bytearray(MAGIC)
+    out += struct.pack('<II', len(src), len(dst))
+    out += hashlib.sha256(src).digest() + hashlib.sha256(dst).digest()
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack('<BII', OP_COPY, op[1], op[2])
+        else:
+            out += struct.pack('<BI', OP_INSERT, len(op[1])) + op[1]
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply_patch(src, patch):
+    if patch[:1] == b'\x78':
+        patch = zlib.decompress(patch)
+    if patch[:4] != MAGIC:
+        raise SystemExit('not a delta patch')
+    src_size, dst_size = struct.unpack_from('<II', patch, 4)
+    src_sha, dst_sha = patch[12:44], patch[44:76]
+    if src_size > len(src) or hashlib.sha256(src[:src_size]).digest() != src_sha:
+        raise SystemExit('patch was made for a different source image')
+    out = bytearray()
+    pos = 76
+    while True:
+        op = patch[pos]
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            off, n = struct.unpack_from('<II', patch, pos + 1)
+            if off + n > src_size:
+                raise SystemExit('copy out of range')
+            out += src[off:off + n]
+            pos += 9
+        elif op == OP_INSERT:
+            (n,) = struct.unpack_from('<I', patch, pos + 1)
+            out += patch[pos + 5:pos + 5 + n]
+            pos += 5 + n
+        else:
+            raise SystemExit('bad opcode 0x%02x at %d' % (op, pos))
+    if len(out) != dst_size or hashlib.sha256(out).digest() != dst_sha:
+        raise SystemExit('output hash mismatch')
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    p = sub.add_parser('gen', help='create a patch')
+    p.add_argument('old', help='image the node is running (.bin)')
+    p.add_argument('new', help='new image (.bin)')
+    p.add_argument('output', help='patch file')
+    p.add_argument('--no-compress', action='store_true', help='write the raw patch without zlib')
+    p = sub.add_parser('apply', help='apply a patch on the host')
+    p.add_argument('old')
+    p.add_argument('patch')
+    p.add_argument('output')
+    args = parser.parse_args()
+
+    with open(args.old, 'rb') as f:
+        old = f.read()
+    if args.cmd == 'apply':
+        with open(args.patch, 'rb') as f:
+            new = apply_patch(old, f.read())
+        with open(args.output, 'wb') as f:
+            f.write(new)
+        print('%s: %d bytes, hash OK' % (args.output, len(new)))
+        return
+
+    with open(args.new, 'rb') as f:
+        new = f.read()
+    ops = gen_ops(old, new)
+    patch = encode(old, new, ops)
+    if not args.no_compress:
+        # wbits=15 matches the 32K ROM tinfl dictionary on the device
+        compressor = zlib.compressobj(9, zlib.DEFLATED, 15)
+        patch = compressor.compress(patch) + compressor.flush()
+    apply_patch(old, patch)
+    with open(args.output, 'wb') as f:
+        f.write(patch)
+    copied = sum(op[2] for op in ops if op[0] == OP_COPY)
+    print('%s: %d -> %d bytes (%.1f%% of new image, %.1f%% copied from old)' %
+          (args.output, len(new), len(patch), 100.0 * len(patch) / len(new), 100.0 * copied / max(len(new), 1)))
+
+
+if __name__ == '__main__':
+    main()
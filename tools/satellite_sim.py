@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Simulate satellite sensors against a hub built with the UDP transport
+(CONFIG_APP_HUB_TRANSPORT_UDP, see main/app_hub.h for the frame format).
+
+    satellite_sim.py <hub-ip> <home-key-hex> --sats 8,16,32,48 --rounds 20
+
+For each satellite count, every simulated satellite toggles its door state
+--rounds times and waits for the hub's ACK. The report-to-ACK time covers the
+hub's queue, HMAC checks, param updates and alarm logic, so it is the
+end-to-end latency a satellite sees. The hub logs the heap cost of each
+satellite the first time it reports.
+
+Satellite ids are derived from the index, so the same satellites are reused on
+the next run; --burst sends one report from every satellite at once instead
+of one at a time.
+"""
+import argparse
+import hashlib
+import hmac
+import socket
+import statistics
+import struct
+import time
+
+VERSION = 1
+HDR_LEN = 16
+FRAME_LEN = HDR_LEN + 16
+REPORT, ACK = 0x01, 0x02
+RETRIES = 3
+TIMEOUT = 0.5
+
+
+def sat_id(index):
+    return b'\x02\x53\x49' + struct.pack('>I', index)[1:]
+
+
+class Satellite:
+    def __init__(self, index, key):
+        self.id = sat_id(index)
+        self.key = key
+        # seq must increase across runs too
+        self.seq = int(time.time() * 10) & 0x7fffffff
+        self.open = False
+
+    def report(self):
+        self.seq += 1
+        self.open = not self.open
+        head = struct.pack('<2sBB6sIBB', b'ST', VERSION, REPORT, self.id, self.seq, int(self.open), 90)
+        return head + hmac.new(self.key, head, hashlib.sha256).digest()[:16]
+
+    def is_ack(self, frame):
+        if len(frame) != FRAME_LEN or frame[:4] != struct.pack('<2sBB', b'ST', VERSION, ACK):
+            return False
+        tag = hmac.new(self.key, frame[:HDR_LEN], hashlib.sha256).digest()[:16]
+        return frame[4:10] == self.id and struct.unpack_from('<I', frame, 10)[0] == self.seq and \
+            hmac.compare_digest(tag, frame[HDR_LEN:])
+
+
+def one_at_a_time(sock, hub, sats, rounds):
+    times, lost = [], 0
+    for _ in range(rounds):
+        for sat in sats:
+            frame = sat.report()
+            for _ in range(RETRIES):
+                start = time.perf_counter()
+                sock.sendto(frame, hub)
+                try:
+                    while not sat.is_ack(sock.recv(64)):
+                        pass
+                    times.append((time.perf_counter() - start) * 1000)
+                    break
+                except socket.timeout:
+                    continue
+            else:
+                lost += 1
+    return times, lost
+
+
+def burst(sock, hub, sats, rounds):
+    times, lost = [], 0
+    for _ in range(rounds):
+        pending = {}
+        start = time.perf_counter()
+        for sat in sats:
+            sock.sendto(sat.report(), hub)
+            pending[sat.id] = sat
+        try:
+            while pending:
+                frame = sock.recv(64)
+                sat = pending.get(frame[4:10])
+                if sat and sat.is_ack(frame):
+                    del pending[sat.id]
+                    times.append((time.perf_counter() - start) * 1000)
+        except socket.timeout:
+            lost += len(pending)
+    return times, lost
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('host')
+    parser.add_argument('key', help='home key, 64 hex characters')
+    parser.add_argument('--port', type=int, default=3336, help='CONFIG_APP_HUB_UDP_PORT')
+    parser.add_argument('--sats', default='8,16,32', help='comma-separated satellite counts')
+    parser.add_argument('--rounds', type=int, default=10)
+    parser.add_argument('--burst', action='store_true', help='all satellites report at the same time')
+    args = parser.parse_args()
+
+    key = bytes.fromhex(args.key)
+    hub = (args.host, args.port)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(TIMEOUT)
+    print('%5s %8s %8s %8s %8s %5s' % ('sats', 'reports', 'p50 ms', 'p95 ms', 'max ms', 'lost'))
+    for count in (int(n) for n in args.sats.split(',')):
+        sats = [Satellite(i, key) for i in range(count)]
+        times, lost = (burst if args.burst else one_at_a_time)(sock, hub, sats, args.rounds)
+        if not times:
+            print('%5d no ACKs' % count)
+            continue
+        times.sort()
+        print('%5d %8d %8.2f %8.2f %8.2f %5d' % (count, len(times), statistics.median(times),
+                                                times[max(int(len(times) * 0.95) - 1, 0)], times[-1], lost))
+
+
+if __name__ == '__main__':
+    main()